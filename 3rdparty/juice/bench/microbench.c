@@ -0,0 +1,282 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "../src/addr.h"
+#include "../src/crc32.h"
+#include "../src/hmac.h"
+#include "../src/stun.h"
+#include "../src/turn.h"
+
+#include "../include/juice/juice.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#else
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_CYCLE_COUNTER 1
+#endif
+#endif
+
+// Times the STUN/TURN codec and crypto primitives on the messages an agent and a TURN server
+// actually exchange. Each case doubles its iteration count until one run lasts MIN_RUN_NS, then
+// prints ns/op and bytes/cycle. Cycles come from the time stamp counter (reference cycles, not core
+// cycles under frequency scaling), so bytes/cycle is only printed on x86.
+// Usage: microbench [FILTER] (runs the cases whose name contains FILTER)
+
+#define MIN_RUN_NS 200000000ULL
+#define BUFFER_SIZE 4096
+#define DATA_SIZE 1024
+
+#define ICE_PASSWORD "VOkJxbRl1RmTxUk/WvJxBt"
+#define TURN_PASSWORD "bench-password"
+
+static volatile uint64_t sink;
+static const char *filter;
+
+static uint64_t now_ns(void) {
+#ifdef _WIN32
+	LARGE_INTEGER freq, count;
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&count);
+	return (uint64_t)((double)count.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static uint64_t now_cycles(void) {
+#ifdef HAVE_CYCLE_COUNTER
+	return (uint64_t)__rdtsc();
+#else
+	return 0;
+#endif
+}
+
+static void report(const char *name, size_t bytes, uint64_t iterations, uint64_t ns,
+                   uint64_t cycles) {
+	double ns_per_op = (double)ns / (double)iterations;
+	if (cycles)
+		printf("%-42s %6zu %12.1f %12.1f %10.3f\n", name, bytes, ns_per_op,
+		       (double)cycles / (double)iterations,
+		       (double)bytes * (double)iterations / (double)cycles);
+	else
+		printf("%-42s %6zu %12.1f %12s %10s\n", name, bytes, ns_per_op, "-", "-");
+}
+
+// Runs op in a loop, doubling the iteration count until a run lasts at least MIN_RUN_NS
+#define BENCH(name, bytes, op)                                                                     \
+	do {                                                                                           \
+		if (filter && !strstr(name, filter))                                                       \
+			break;                                                                                 \
+		for (uint64_t iterations = 1;; iterations *= 2) {                                          \
+			uint64_t start_ns = now_ns();                                                          \
+			uint64_t start_cycles = now_cycles();                                                  \
+			for (uint64_t i = 0; i < iterations; ++i) {                                            \
+				op;                                                                                \
+			}                                                                                      \
+			uint64_t cycles = now_cycles() - start_cycles;                                         \
+			uint64_t ns = now_ns() - start_ns;                                                     \
+			if (ns >= MIN_RUN_NS) {                                                                \
+				report(name, bytes, iterations, ns, cycles);                                       \
+				break;                                                                             \
+			}                                                                                      \
+		}                                                                                          \
+	} while (0)
+
+static void make_address(const char *host, const char *port, addr_record_t *record) {
+	if (addr_resolve(host, port, SOCK_DGRAM, record, 1) <= 0) {
+		fprintf(stderr, "Failed to resolve %s:%s\n", host, port);
+		exit(1);
+	}
+}
+
+static void make_transaction_id(uint8_t *transaction_id, uint8_t seed) {
+	for (int i = 0; i < STUN_TRANSACTION_ID_SIZE; ++i)
+		transaction_id[i] = (uint8_t)(seed + i * 37);
+}
+
+// ICE connectivity check from the controlling agent, nominating the pair
+static void make_binding_request(stun_message_t *msg) {
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_class = STUN_CLASS_REQUEST;
+	msg->msg_method = STUN_METHOD_BINDING;
+	make_transaction_id(msg->transaction_id, 1);
+	snprintf(msg->credentials.username, STUN_MAX_USERNAME_LEN, "%s", "evtjh6vY:Kb8wQz3p");
+	msg->priority = 0x6e0001ff;
+	msg->ice_controlling = 0x932ff9b151263b36ULL;
+	msg->use_candidate = true;
+}
+
+// Its success response, carrying the reflexive address
+static void make_binding_response(stun_message_t *msg) {
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_class = STUN_CLASS_RESP_SUCCESS;
+	msg->msg_method = STUN_METHOD_BINDING;
+	make_transaction_id(msg->transaction_id, 1);
+	make_address("203.0.113.7", "54321", &msg->mapped);
+}
+
+static void set_long_term_credentials(stun_message_t *msg) {
+	snprintf(msg->credentials.username, STUN_MAX_USERNAME_LEN, "%s", "1760000000:bench-user");
+	snprintf(msg->credentials.realm, STUN_MAX_REALM_LEN, "%s", "turn.example.org");
+	snprintf(msg->credentials.nonce, STUN_MAX_NONCE_LEN, "%s",
+	         STUN_NONCE_COOKIE "AAAAh3x8bm9uY2Utdm9y-3b9c2f1e");
+}
+
+// Authenticated TURN Allocate request, after the 401 challenge
+static void make_allocate_request(stun_message_t *msg) {
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_class = STUN_CLASS_REQUEST;
+	msg->msg_method = STUN_METHOD_ALLOCATE;
+	make_transaction_id(msg->transaction_id, 2);
+	set_long_term_credentials(msg);
+	msg->requested_transport = true;
+	msg->lifetime = 600;
+}
+
+static void make_channel_bind_request(stun_message_t *msg) {
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_class = STUN_CLASS_REQUEST;
+	msg->msg_method = STUN_METHOD_CHANNEL_BIND;
+	make_transaction_id(msg->transaction_id, 3);
+	set_long_term_credentials(msg);
+	msg->channel_number = 0x4000;
+	make_address("198.51.100.23", "61000", &msg->peers[0]);
+	msg->peers_size = 1;
+}
+
+// Relayed application data without a channel
+static void make_send_indication(stun_message_t *msg, const char *data) {
+	memset(msg, 0, sizeof(*msg));
+	msg->msg_class = STUN_CLASS_INDICATION;
+	msg->msg_method = STUN_METHOD_SEND;
+	make_transaction_id(msg->transaction_id, 4);
+	make_address("198.51.100.23", "61000", &msg->peers[0]);
+	msg->peers_size = 1;
+	msg->data = data;
+	msg->data_size = DATA_SIZE;
+}
+
+typedef struct encoded {
+	const char *name;
+	stun_message_t msg;
+	const char *password;
+	uint8_t buffer[BUFFER_SIZE];
+	size_t size;
+} encoded_t;
+
+static void encode(encoded_t *e, const char *name, const char *password) {
+	e->name = name;
+	e->password = password;
+	int len = stun_write(e->buffer, BUFFER_SIZE, &e->msg, password);
+	if (len <= 0) {
+		fprintf(stderr, "Failed to write %s\n", name);
+		exit(1);
+	}
+	e->size = (size_t)len;
+
+	// Check the message round-trips before timing it
+	stun_message_t check;
+	if (stun_read(e->buffer, e->size, &check) <= 0 ||
+	    (password && !stun_check_integrity(e->buffer, e->size, &check, password))) {
+		fprintf(stderr, "Failed to read back %s\n", name);
+		exit(1);
+	}
+}
+
+int main(int argc, char **argv) {
+	juice_set_log_level(JUICE_LOG_LEVEL_NONE);
+	filter = argc > 1 ? argv[1] : NULL;
+
+	static char data[DATA_SIZE];
+	for (size_t i = 0; i < DATA_SIZE; ++i)
+		data[i] = (char)(i * 131);
+
+	enum {
+		BINDING_REQUEST,
+		BINDING_RESPONSE,
+		ALLOCATE_REQUEST,
+		CHANNEL_BIND_REQUEST,
+		SEND_INDICATION,
+		MESSAGES_COUNT
+	};
+	static encoded_t messages[MESSAGES_COUNT];
+	make_binding_request(&messages[BINDING_REQUEST].msg);
+	encode(&messages[BINDING_REQUEST], "binding request", ICE_PASSWORD);
+	make_binding_response(&messages[BINDING_RESPONSE].msg);
+	encode(&messages[BINDING_RESPONSE], "binding response", ICE_PASSWORD);
+	make_allocate_request(&messages[ALLOCATE_REQUEST].msg);
+	encode(&messages[ALLOCATE_REQUEST], "allocate request", TURN_PASSWORD);
+	make_channel_bind_request(&messages[CHANNEL_BIND_REQUEST].msg);
+	encode(&messages[CHANNEL_BIND_REQUEST], "channel bind request", TURN_PASSWORD);
+	make_send_indication(&messages[SEND_INDICATION].msg, data);
+	encode(&messages[SEND_INDICATION], "send indication", NULL);
+
+	printf("%-42s %6s %12s %12s %10s\n", "case", "bytes", "ns/op", "cycles/op", "bytes/cyc");
+
+	char name[64];
+	uint8_t out[BUFFER_SIZE];
+	stun_message_t msg;
+	for (int m = 0; m < MESSAGES_COUNT; ++m) {
+		encoded_t *e = messages + m;
+		snprintf(name, sizeof(name), "is_stun_datagram %s", e->name);
+		BENCH(name, e->size, sink += is_stun_datagram(e->buffer, e->size));
+		snprintf(name, sizeof(name), "stun_read %s", e->name);
+		BENCH(name, e->size, sink += (uint64_t)stun_read(e->buffer, e->size, &msg));
+		snprintf(name, sizeof(name), "stun_write %s", e->name);
+		BENCH(name, e->size, sink += (uint64_t)stun_write(out, BUFFER_SIZE, &e->msg, e->password));
+		if (e->password) {
+			stun_read(e->buffer, e->size, &msg);
+			snprintf(name, sizeof(name), "stun_check_integrity %s", e->name);
+			BENCH(name, e->size,
+			      sink += stun_check_integrity(e->buffer, e->size, &msg, e->password));
+		}
+	}
+
+	// The receive path tests every application datagram before handing it over
+	BENCH("is_stun_datagram app data", DATA_SIZE, sink += is_stun_datagram(data, DATA_SIZE));
+	BENCH("turn_wrap_channel_data", DATA_SIZE,
+	      sink += (uint64_t)turn_wrap_channel_data((char *)out, BUFFER_SIZE, data, DATA_SIZE,
+	                                               0x4000));
+
+	const encoded_t *check = &messages[BINDING_REQUEST];
+	BENCH("crc32 binding request", check->size, sink += CRC32(check->buffer, check->size));
+	BENCH("crc32 app data", DATA_SIZE, sink += CRC32(data, DATA_SIZE));
+
+	uint8_t digest[HMAC_SHA256_SIZE];
+	BENCH("hmac_sha1 binding request", check->size,
+	      (hmac_sha1(check->buffer, check->size, ICE_PASSWORD, strlen(ICE_PASSWORD), digest),
+	       sink += digest[0]));
+	BENCH("hmac_sha256 binding request", check->size,
+	      (hmac_sha256(check->buffer, check->size, ICE_PASSWORD, strlen(ICE_PASSWORD), digest),
+	       sink += digest[0]));
+	BENCH("hmac_sha1 app data", DATA_SIZE,
+	      (hmac_sha1(data, DATA_SIZE, ICE_PASSWORD, strlen(ICE_PASSWORD), digest),
+	       sink += digest[0]));
+
+	addr_record_t ipv4, ipv6;
+	make_address("203.0.113.7", "54321", &ipv4);
+	make_address("2001:db8::1:7", "54321", &ipv6);
+	BENCH("addr_record_hash ipv4", sizeof(struct sockaddr_in),
+	      sink += addr_record_hash(&ipv4, true));
+	BENCH("addr_record_hash ipv6", sizeof(struct sockaddr_in6),
+	      sink += addr_record_hash(&ipv6, true));
+
+	return 0;
+}
@@ -85,9 +85,11 @@ typedef struct juice_turn_server {
 } juice_turn_server_t;
 
 typedef enum juice_concurrency_mode {
-	JUICE_CONCURRENCY_MODE_POLL = 0, // Connections share a single thread
+	JUICE_CONCURRENCY_MODE_POLL = 0, // Connections share a thread, see juice_set_poll_config()
 	JUICE_CONCURRENCY_MODE_MUX,      // Connections are multiplexed on a single UDP socket
 	JUICE_CONCURRENCY_MODE_THREAD,   // Each connection runs in its own thread
+	JUICE_CONCURRENCY_MODE_SIM,      // Connections run on a simulated network, see juice_sim_*()
+	JUICE_CONCURRENCY_MODE_URING,    // Connections share a single io_uring thread (Linux 5.19+)
 } juice_concurrency_mode_t;
 
 typedef enum juice_ice_tcp_mode {
@@ -116,8 +118,75 @@ typedef struct juice_config {
 
 	void *user_ptr;
 
+	// Relay application data in TURN Send indications instead of ChannelData messages: no
+	// ChannelBind round trip, but 36 bytes of framing per datagram instead of 4
+	bool turn_send_indication;
+
+	// Linux only: send runs of equal-sized datagrams from juice_send_batch() with UDP segmentation
+	// offload (UDP_SEGMENT), and let the kernel coalesce received ones (UDP_GRO, POLL and MUX
+	// modes). Ignored where unsupported. In MUX mode, the first agent on the port decides.
+	bool enable_udp_offload;
+
+	// POLL mode with JUICE_POLL_BALANCE_HASH: agents with the same non-zero key, for instance a
+	// hash of a session identifier, share a poll thread. Zero falls back to the least loaded one.
+	uint32_t poll_affinity_key;
+
 } juice_config_t;
 
+// Demultiplexing counters of the MUX socket bound to a local port
+typedef struct juice_mux_stats {
+	int agents;    // agents sharing the socket
+	int map_size;  // slots in the source address map
+	int map_count; // source addresses mapped to an agent
+	uint64_t datagrams_received;
+	uint64_t lookups;        // datagrams looked up by source address
+	uint64_t map_probes;     // map slots inspected by address lookups and inserts
+	uint64_t map_misses;     // lookups that fell back to the STUN ufrag or transaction ID
+	uint64_t agents_scanned; // agents compared during those fallbacks
+	uint64_t dropped;        // datagrams matching no agent
+} juice_mux_stats_t;
+
+typedef struct juice_stats {
+	// Application datagrams, as passed to juice_send() and delivered to cb_recv
+	uint64_t datagrams_sent;
+	uint64_t bytes_sent;
+	uint64_t datagrams_received;
+	uint64_t bytes_received;
+
+	// Everything on the wire, including STUN, TURN and ChannelData framing
+	uint64_t wire_datagrams_sent;
+	uint64_t wire_bytes_sent;
+	uint64_t wire_datagrams_received;
+	uint64_t wire_bytes_received;
+	uint64_t datagrams_dropped; // received but ignored: malformed, unexpected or from an unknown address
+
+	// Failed sends by cause
+	uint64_t send_again;     // EAGAIN or EWOULDBLOCK, the socket buffer is full
+	uint64_t send_too_large; // EMSGSIZE
+	uint64_t send_failed;    // any other error, or sending while not connected
+	int last_send_errno;
+
+	uint64_t stun_requests_sent; // connectivity checks, consent checks, STUN and TURN requests
+	uint64_t stun_retransmissions;
+	uint64_t rtt_samples;
+	int rtt_ms;     // last connectivity or consent check round trip, -1 if none yet
+	int min_rtt_ms; // -1 if none yet
+
+	// Milliseconds from juice_create() to each phase, -1 if not reached yet
+	int64_t gathering_ms;
+	int64_t gathering_done_ms;
+	int64_t connecting_ms;
+	int64_t connected_ms;
+	int64_t completed_ms;
+	int64_t failed_ms;
+} juice_stats_t;
+
+// One datagram of a juice_send_batch() call
+typedef struct juice_iovec {
+	const char *data;
+	size_t size;
+} juice_iovec_t;
+
 JUICE_EXPORT juice_agent_t *juice_create(const juice_config_t *config);
 JUICE_EXPORT void juice_destroy(juice_agent_t *agent);
 
@@ -129,7 +198,12 @@ JUICE_EXPORT int juice_add_turn_server(juice_agent_t *agent, const juice_turn_se
 JUICE_EXPORT int juice_set_remote_gathering_done(juice_agent_t *agent);
 JUICE_EXPORT int juice_send(juice_agent_t *agent, const char *data, size_t size);
 JUICE_EXPORT int juice_send_diffserv(juice_agent_t *agent, const char *data, size_t size, int ds);
+// Sends the datagrams in order under a single lock, with one sendmmsg() where available. Returns
+// how many were sent, which may be less than count: sending the rest again reports the error. If
+// none could be sent, returns the error code juice_send() would have returned for the first one.
+JUICE_EXPORT int juice_send_batch(juice_agent_t *agent, const juice_iovec_t *msgs, size_t count);
 JUICE_EXPORT juice_state_t juice_get_state(juice_agent_t *agent);
+JUICE_EXPORT int juice_get_stats(juice_agent_t *agent, juice_stats_t *stats);
 JUICE_EXPORT int juice_get_selected_candidates(juice_agent_t *agent, char *local, size_t local_size,
                                                char *remote, size_t remote_size);
 JUICE_EXPORT int juice_get_selected_addresses(juice_agent_t *agent, char *local, size_t local_size,
@@ -137,8 +211,76 @@ JUICE_EXPORT int juice_get_selected_addresses(juice_agent_t *agent, char *local,
 JUICE_EXPORT int juice_set_local_ice_attributes(juice_agent_t *agent, const char *ufrag, const char *pwd);
 JUICE_EXPORT const char *juice_state_to_string(juice_state_t state);
 JUICE_EXPORT int juice_mux_listen(const char *bind_address, int local_port, juice_cb_mux_incoming_t cb, void *user_ptr);
+JUICE_EXPORT int juice_mux_get_stats(int local_port, juice_mux_stats_t *stats);
 JUICE_EXPORT int juice_set_ice_tcp_mode(juice_agent_t *agent, juice_ice_tcp_mode_t ice_tcp_mode);
 
+// Poll threads
+// By default, agents in JUICE_CONCURRENCY_MODE_POLL share a single thread. With more threads, each
+// agent is assigned to one of them when created and stays there; the threads start with their
+// first agent and stop with their last one.
+
+#define JUICE_POLL_MAX_THREADS 256
+
+typedef enum juice_poll_balance {
+	JUICE_POLL_BALANCE_LEAST_LOADED = 0, // the thread with the fewest agents
+	JUICE_POLL_BALANCE_HASH,             // by juice_config_t.poll_affinity_key
+} juice_poll_balance_t;
+
+typedef struct juice_poll_config {
+	int threads; // 1 to JUICE_POLL_MAX_THREADS, 0 for the default of 1
+	juice_poll_balance_t balance;
+	bool pin_threads; // pin thread i to CPU i modulo the number of CPUs (Linux only)
+} juice_poll_config_t;
+
+// Applies to agents created afterwards. Returns JUICE_ERR_INVALID if the config is out of range.
+JUICE_EXPORT int juice_set_poll_config(const juice_poll_config_t *config);
+
+// Simulated network
+// Agents created with JUICE_CONCURRENCY_MODE_SIM exchange datagrams through an in-memory network
+// with latency, loss and NATs instead of sockets. Nothing runs in the background:
+// juice_sim_advance() moves a virtual clock forward, delivering datagrams and firing agent timers
+// in order, and agent callbacks run in the calling thread. While a simulation runs the whole
+// library uses the virtual clock, so do not mix it with agents in other modes. The same seed and
+// the same sequence of calls give the same run. Each simulated agent needs a numeric bind_address,
+// its host address on the simulated network. TURN and ICE-TCP are not simulated.
+
+typedef enum juice_sim_nat_type {
+	JUICE_SIM_NAT_FULL_CONE = 0,        // endpoint-independent mapping and filtering
+	JUICE_SIM_NAT_RESTRICTED_CONE,      // endpoint-independent mapping, address-dependent filtering
+	JUICE_SIM_NAT_PORT_RESTRICTED_CONE, // endpoint-independent mapping, address and port filtering
+	JUICE_SIM_NAT_SYMMETRIC,            // address and port-dependent mapping and filtering
+} juice_sim_nat_type_t;
+
+typedef struct juice_sim_config {
+	unsigned int seed; // seeds the loss and jitter draws
+	int latency_ms;    // one-way delay of every datagram
+	int jitter_ms;     // extra delay drawn uniformly in [0, jitter_ms], may reorder datagrams
+	double loss;       // probability for each datagram to be dropped
+
+	// Numeric address of a STUN server answering Binding requests, NULL for none
+	const char *stun_server_address;
+	uint16_t stun_server_port;
+} juice_sim_config_t;
+
+typedef struct juice_sim_stats {
+	int64_t elapsed_ms; // virtual time since juice_sim_start()
+	uint64_t events;    // datagram deliveries and agent timers processed
+	uint64_t datagrams_sent;
+	uint64_t datagrams_delivered;
+	uint64_t datagrams_lost;        // dropped by the loss model
+	uint64_t datagrams_filtered;    // dropped by a NAT without a matching mapping
+	uint64_t datagrams_unreachable; // no agent bound, or a private address from outside its NAT
+} juice_sim_stats_t;
+
+JUICE_EXPORT int juice_sim_start(const juice_sim_config_t *config);
+JUICE_EXPORT int juice_sim_stop(void); // fails while simulated agents exist
+// Puts host_address behind the NAT whose public address is public_address, created on first use.
+// Hosts without NAT are public. Hosts behind the same NAT reach each other directly.
+JUICE_EXPORT int juice_sim_set_nat(const char *host_address, const char *public_address,
+                                   juice_sim_nat_type_t type);
+JUICE_EXPORT int juice_sim_advance(int ms);
+JUICE_EXPORT int juice_sim_get_stats(juice_sim_stats_t *stats);
+
 // ICE server
 
 typedef struct juice_server juice_server_t;
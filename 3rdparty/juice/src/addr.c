@@ -308,3 +308,17 @@ int addr_record_to_string(const addr_record_t *record, char *buffer, size_t size
 unsigned long addr_record_hash(const addr_record_t *record, bool with_port) {
 	return addr_hash((const struct sockaddr *)&record->addr, with_port);
 }
+
+unsigned long addr_record_map_hash(const addr_record_t *record, bool with_port) {
+	// djb2 over the port bytes collides for nearby ports, so the port is added as a whole, and the
+	// result goes through the murmur3 finalizer so that sequential hosts spread too
+	uint64_t h = addr_record_hash(record, false);
+	if (with_port)
+		h ^= (uint64_t)addr_get_port((const struct sockaddr *)&record->addr) << 32;
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return (unsigned long)h;
+}
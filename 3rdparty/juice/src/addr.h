@@ -42,5 +42,7 @@ bool addr_is_numeric_hostname(const char *hostname);
 bool addr_record_is_equal(const addr_record_t *a, const addr_record_t *b, bool compare_ports);
 int addr_record_to_string(const addr_record_t *record, char *buffer, size_t size);
 unsigned long addr_record_hash(const addr_record_t *record, bool with_port);
+// Mixed for open addressing, where consecutive addresses or ports must spread over the table
+unsigned long addr_record_map_hash(const addr_record_t *record, bool with_port);
 
 #endif // JUICE_ADDR_H
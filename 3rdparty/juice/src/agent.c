@@ -74,6 +74,77 @@ static int copy_turn_server(juice_turn_server_t *dst, const juice_turn_server_t
 	return 0;
 }
 
+static int next_table_capacity(int capacity, int initial, int max) {
+	int next = capacity ? capacity * 2 : initial;
+	return next < max ? next : max;
+}
+
+// Returns a zeroed entry in the slot after the last one, or NULL if there is no room left. Entries
+// are allocated one by one so that pointers to them stay valid as the table grows. The caller
+// increments entries_count once the entry is set up.
+static agent_stun_entry_t *agent_prepare_entry(juice_agent_t *agent) {
+	if (agent->entries_count >= MAX_STUN_ENTRIES_COUNT) {
+		JLOG_WARN("No free STUN entry left");
+		return NULL;
+	}
+
+	if (agent->entries_count == agent->entries_capacity) {
+		int capacity = next_table_capacity(agent->entries_capacity, AGENT_INITIAL_ENTRIES_CAPACITY,
+		                                   MAX_STUN_ENTRIES_COUNT);
+		agent_stun_entry_t **entries =
+		    realloc(agent->entries, capacity * sizeof(agent_stun_entry_t *));
+		if (!entries) {
+			JLOG_ERROR("Memory allocation for STUN entries failed");
+			return NULL;
+		}
+		memset(entries + agent->entries_capacity, 0,
+		       (capacity - agent->entries_capacity) * sizeof(agent_stun_entry_t *));
+		agent->entries = entries;
+		agent->entries_capacity = capacity;
+	}
+
+	agent_stun_entry_t **slot = agent->entries + agent->entries_count;
+	if (!*slot && !(*slot = malloc(sizeof(agent_stun_entry_t)))) {
+		JLOG_ERROR("Memory allocation for STUN entry failed");
+		return NULL;
+	}
+	memset(*slot, 0, sizeof(agent_stun_entry_t));
+	return *slot;
+}
+
+// Same for candidate pairs, the ordered table grows along
+static ice_candidate_pair_t *agent_prepare_candidate_pair(juice_agent_t *agent) {
+	if (agent->candidate_pairs_count == agent->candidate_pairs_capacity) {
+		int capacity = next_table_capacity(agent->candidate_pairs_capacity,
+		                                   AGENT_INITIAL_CANDIDATE_PAIRS_CAPACITY,
+		                                   MAX_CANDIDATE_PAIRS_COUNT);
+		ice_candidate_pair_t **pairs =
+		    realloc(agent->candidate_pairs, capacity * sizeof(ice_candidate_pair_t *));
+		if (!pairs) {
+			JLOG_ERROR("Memory allocation for candidate pairs failed");
+			return NULL;
+		}
+		agent->candidate_pairs = pairs;
+		ice_candidate_pair_t **ordered_pairs =
+		    realloc(agent->ordered_pairs, capacity * sizeof(ice_candidate_pair_t *));
+		if (!ordered_pairs) {
+			JLOG_ERROR("Memory allocation for candidate pairs failed");
+			return NULL;
+		}
+		agent->ordered_pairs = ordered_pairs;
+		memset(pairs + agent->candidate_pairs_capacity, 0,
+		       (capacity - agent->candidate_pairs_capacity) * sizeof(ice_candidate_pair_t *));
+		agent->candidate_pairs_capacity = capacity;
+	}
+
+	ice_candidate_pair_t **slot = agent->candidate_pairs + agent->candidate_pairs_count;
+	if (!*slot && !(*slot = malloc(sizeof(ice_candidate_pair_t)))) {
+		JLOG_ERROR("Memory allocation for candidate pair failed");
+		return NULL;
+	}
+	return *slot;
+}
+
 juice_agent_t *agent_create(const juice_config_t *config) {
 	JLOG_VERBOSE("Creating agent");
 
@@ -104,6 +175,9 @@ juice_agent_t *agent_create(const juice_config_t *config) {
 	agent->config.cb_gathering_done = config->cb_gathering_done;
 	agent->config.cb_recv = config->cb_recv;
 	agent->config.user_ptr = config->user_ptr;
+	agent->config.turn_send_indication = config->turn_send_indication;
+	agent->config.enable_udp_offload = config->enable_udp_offload;
+	agent->config.poll_affinity_key = config->poll_affinity_key;
 	if (alloc_failed) {
 		JLOG_FATAL("Memory allocation for configuration copy failed");
 		goto error;
@@ -134,6 +208,8 @@ juice_agent_t *agent_create(const juice_config_t *config) {
 	agent->conn_index = -1;
 	agent->conn_impl = NULL;
 
+	agent->stats.created_timestamp = current_timestamp();
+
 	ice_create_local_description(&agent->local);
 
 	// RFC 8445: 16.1. Attributes
@@ -167,13 +243,26 @@ void agent_destroy(juice_agent_t *agent) {
 
 	// Free credentials in entries
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->turn) {
 			turn_destroy_map(&entry->turn->map);
 			free(entry->turn);
 		}
 	}
 
+	// Free tables
+	for (int i = 0; i < agent->entries_capacity; ++i)
+		free(agent->entries[i]);
+
+	free(agent->entries);
+	for (int i = 0; i < agent->candidate_pairs_capacity; ++i)
+		free(agent->candidate_pairs[i]);
+
+	free(agent->candidate_pairs);
+	free(agent->ordered_pairs);
+	ice_destroy_description(&agent->local);
+	ice_destroy_description(&agent->remote);
+
 	// Free strings in config
 	free((void *)agent->config.stun_server_host);
 	for (int i = 0; i < agent->config.turn_servers_count; ++i) {
@@ -245,6 +334,8 @@ int agent_gather_candidates(juice_agent_t *agent) {
 	socket_config.bind_address = agent->config.bind_address;
 	socket_config.port_begin = agent->config.local_port_range_begin;
 	socket_config.port_end = agent->config.local_port_range_end;
+	socket_config.enable_offload = agent->config.enable_udp_offload;
+	socket_config.affinity_key = agent->config.poll_affinity_key;
 
 	if (conn_create(agent, &socket_config)) {
 		JLOG_FATAL("Connection creation for agent failed");
@@ -293,11 +384,11 @@ int agent_gather_candidates(juice_agent_t *agent) {
 	ice_sort_candidates(&agent->local);
 
 	for (int i = 0; i < agent->entries_count; ++i)
-		agent_translate_host_candidate_entry(agent, agent->entries + i);
+		agent_translate_host_candidate_entry(agent, agent->entries[i]);
 
 	char buffer[BUFFER_SIZE];
 	for (int i = 0; i < agent->local.candidates_count; ++i) {
-		ice_candidate_t *candidate = agent->local.candidates + i;
+		ice_candidate_t *candidate = agent->local.candidates[i];
 		if (candidate->type != ICE_CANDIDATE_TYPE_HOST)
 			continue;
 
@@ -390,7 +481,7 @@ int agent_resolve_servers(juice_agent_t *agent) {
 					// Ignore duplicate TURN servers as they will cause conflicts
 					bool is_duplicate = false;
 					for (int i = 0; i < agent->entries_count; ++i) {
-						agent_stun_entry_t *entry = agent->entries + i;
+						agent_stun_entry_t *entry = agent->entries[i];
 						if (entry->type == AGENT_STUN_ENTRY_TYPE_RELAY &&
 						    addr_record_is_equal(&entry->record, record, true)) {
 							is_duplicate = true;
@@ -404,7 +495,10 @@ int agent_resolve_servers(juice_agent_t *agent) {
 
 					JLOG_VERBOSE("Registering STUN entry %d for relay request",
 					             agent->entries_count);
-					agent_stun_entry_t *entry = agent->entries + agent->entries_count;
+					agent_stun_entry_t *entry = agent_prepare_entry(agent);
+					if (!entry)
+						break;
+
 					entry->type = AGENT_STUN_ENTRY_TYPE_RELAY;
 					entry->state = AGENT_STUN_ENTRY_STATE_PENDING;
 					entry->pair = NULL;
@@ -464,7 +558,10 @@ int agent_resolve_servers(juice_agent_t *agent) {
 				if (i >= MAX_SERVER_ENTRIES_COUNT)
 					break;
 				JLOG_VERBOSE("Registering STUN entry %d for server request", agent->entries_count);
-				agent_stun_entry_t *entry = agent->entries + agent->entries_count;
+				agent_stun_entry_t *entry = agent_prepare_entry(agent);
+				if (!entry)
+					break;
+
 				entry->type = AGENT_STUN_ENTRY_TYPE_SERVER;
 				entry->state = AGENT_STUN_ENTRY_STATE_PENDING;
 				entry->pair = NULL;
@@ -522,6 +619,7 @@ int agent_set_remote_description(juice_agent_t *agent, const char *sdp) {
 			JLOG_ERROR("Failed to parse remote SDP description");
 			break;
 		}
+		ice_destroy_description(&remote);
 		conn_unlock(agent);
 		return JUICE_ERR_INVALID;
 	}
@@ -531,16 +629,34 @@ int agent_set_remote_description(juice_agent_t *agent, const char *sdp) {
 		if (strcmp(agent->remote.ice_ufrag, remote.ice_ufrag) == 0 &&
 		    strcmp(agent->remote.ice_pwd, remote.ice_pwd) == 0) {
 			JLOG_DEBUG("Remote description is already set, ignoring");
+			ice_destroy_description(&remote);
 			conn_unlock(agent);
 			return JUICE_ERR_SUCCESS;
 		}
 
 		JLOG_WARN("ICE restart is not supported");
+		ice_destroy_description(&remote);
 		conn_unlock(agent);
 		return JUICE_ERR_FAILED;
 	}
 
+	// Candidates added before the description are kept, pairs point to them
+	int previous_count = agent->remote.candidates_count;
+	ice_candidate_t **previous = agent->remote.candidates;
+	int previous_capacity = agent->remote.candidates_capacity;
 	agent->remote = remote;
+	if (previous_count > 0) {
+		agent->remote.candidates = previous;
+		agent->remote.candidates_count = previous_count;
+		agent->remote.candidates_capacity = previous_capacity;
+		for (int i = 0; i < remote.candidates_count; ++i)
+			if (ice_add_candidate(remote.candidates[i], &agent->remote))
+				JLOG_WARN("Failed to add candidate to remote description");
+
+		ice_destroy_description(&remote);
+	} else {
+		free(previous);
+	}
 
 	agent_update_pac_timer(agent);
 
@@ -558,11 +674,12 @@ int agent_set_remote_description(juice_agent_t *agent, const char *sdp) {
 	// There is only one component, therefore we can unfreeze already existing pairs now
 	JLOG_DEBUG("Unfreezing %d existing candidate pairs", (int)agent->candidate_pairs_count);
 	for (int i = 0; i < agent->candidate_pairs_count; ++i) {
-		agent_unfreeze_candidate_pair(agent, agent->candidate_pairs + i);
+		agent_unfreeze_candidate_pair(agent, agent->candidate_pairs[i]);
 	}
-	JLOG_DEBUG("Adding %d candidates from remote description", (int)agent->remote.candidates_count);
-	for (int i = 0; i < agent->remote.candidates_count; ++i) {
-		ice_candidate_t *remote = agent->remote.candidates + i;
+	JLOG_DEBUG("Adding %d candidates from remote description",
+	           (int)agent->remote.candidates_count - previous_count);
+	for (int i = previous_count; i < agent->remote.candidates_count; ++i) {
+		ice_candidate_t *remote = agent->remote.candidates[i];
 		if (agent_add_candidate_pairs_for_remote(agent, remote))
 			JLOG_WARN("Failed to add candidate pair");
 	}
@@ -598,7 +715,7 @@ int agent_add_remote_candidate(juice_agent_t *agent, const char *sdp) {
 		conn_unlock(agent);
 		return JUICE_ERR_FAILED;
 	}
-	ice_candidate_t *remote = agent->remote.candidates + agent->remote.candidates_count - 1;
+	ice_candidate_t *remote = agent->remote.candidates[agent->remote.candidates_count - 1];
 	if (agent_add_candidate_pairs_for_remote(agent, remote)) {
 		JLOG_WARN("Failed to add candidate pair");
 		conn_unlock(agent);
@@ -658,29 +775,98 @@ int agent_set_remote_gathering_done(juice_agent_t *agent) {
 	return 0;
 }
 
+static void agent_count_send_error(juice_agent_t *agent, int ret) {
+	// Connection send functions return the negated socket error
+	if (ret == -SEAGAIN || ret == -SEWOULDBLOCK)
+		atomic_fetch_add_explicit(&agent->stats.send_again, 1, memory_order_relaxed);
+	else if (ret == -SEMSGSIZE)
+		atomic_fetch_add_explicit(&agent->stats.send_too_large, 1, memory_order_relaxed);
+	else
+		atomic_fetch_add_explicit(&agent->stats.send_failed, 1, memory_order_relaxed);
+
+	atomic_store(&agent->stats.last_send_errno, -ret);
+}
+
 int agent_send(juice_agent_t *agent, const char *data, size_t size, int ds) {
 	// Try not to lock in the send path
 	agent_stun_entry_t *selected_entry = atomic_load(&agent->selected_entry);
 	if (!selected_entry) {
 		JLOG_ERROR("Send while ICE is not connected");
+		atomic_fetch_add_explicit(&agent->stats.send_failed, 1, memory_order_relaxed);
 		return -1;
 	}
 
+	int ret;
 	if (selected_entry->relay_entry) {
-		// The datagram should be sent through the relay, use a channel to minimize overhead
+		// The datagram should be sent through the relay, use a channel to minimize overhead unless
+		// Send indications were requested
 		conn_lock(agent); // We have to lock
-		int ret = agent_channel_send(agent, selected_entry->relay_entry, &selected_entry->record,
-		                             data, size, ds);
+		if (agent->config.turn_send_indication)
+			ret = agent_relay_send(agent, selected_entry->relay_entry, &selected_entry->record,
+			                       data, size, ds);
+		else
+			ret = agent_channel_send(agent, selected_entry->relay_entry, &selected_entry->record,
+			                         data, size, ds);
 		conn_unlock(agent);
+	} else {
+		ret = agent_direct_send(agent, &selected_entry->record, data, size, ds);
+	}
+
+	if (ret >= 0) {
+		atomic_fetch_add_explicit(&agent->stats.datagrams_sent, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&agent->stats.bytes_sent, size, memory_order_relaxed);
+	}
+	return ret;
+}
+
+int agent_send_batch(juice_agent_t *agent, const juice_iovec_t *msgs, size_t count, int ds) {
+	agent_stun_entry_t *selected_entry = atomic_load(&agent->selected_entry);
+	if (!selected_entry) {
+		JLOG_ERROR("Send while ICE is not connected");
+		atomic_fetch_add_explicit(&agent->stats.send_failed, 1, memory_order_relaxed);
+		return -1;
+	}
+
+	if (selected_entry->relay_entry) {
+		// TURN framing is written per datagram
+		size_t sent = 0;
+		while (sent < count) {
+			int ret = agent_send(agent, msgs[sent].data, msgs[sent].size, ds);
+			if (ret < 0)
+				return sent > 0 ? (int)sent : ret;
+			++sent;
+		}
+		return (int)sent;
+	}
+
+	int ret = conn_send_batch(agent, &selected_entry->record, msgs, count, ds);
+	if (ret < 0) {
+		agent_count_send_error(agent, ret);
 		return ret;
 	}
 
-	return agent_direct_send(agent, &selected_entry->record, data, size, ds);
+	size_t bytes = 0;
+	for (int i = 0; i < ret; ++i)
+		bytes += msgs[i].size;
+
+	atomic_fetch_add_explicit(&agent->stats.datagrams_sent, ret, memory_order_relaxed);
+	atomic_fetch_add_explicit(&agent->stats.bytes_sent, bytes, memory_order_relaxed);
+	atomic_fetch_add_explicit(&agent->stats.wire_datagrams_sent, ret, memory_order_relaxed);
+	atomic_fetch_add_explicit(&agent->stats.wire_bytes_sent, bytes, memory_order_relaxed);
+	return ret;
 }
 
 int agent_direct_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
                       int ds) {
-	return conn_send(agent, dst, data, size, ds);
+	int ret = conn_send(agent, dst, data, size, ds);
+	if (ret >= 0) {
+		atomic_fetch_add_explicit(&agent->stats.wire_datagrams_sent, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&agent->stats.wire_bytes_sent, size, memory_order_relaxed);
+		return ret;
+	}
+
+	agent_count_send_error(agent, ret);
+	return ret;
 }
 
 int agent_relay_send(juice_agent_t *agent, agent_stun_entry_t *entry, const addr_record_t *dst,
@@ -751,6 +937,43 @@ juice_state_t agent_get_state(juice_agent_t *agent) {
 	return state;
 }
 
+static int64_t stats_elapsed(const agent_stats_t *stats, timestamp_t timestamp) {
+	return timestamp ? timestamp - stats->created_timestamp : -1;
+}
+
+void agent_get_stats(juice_agent_t *agent, juice_stats_t *stats) {
+	agent_stats_t *s = &agent->stats;
+	stats->datagrams_sent = atomic_load_explicit(&s->datagrams_sent, memory_order_relaxed);
+	stats->bytes_sent = atomic_load_explicit(&s->bytes_sent, memory_order_relaxed);
+	stats->datagrams_received = atomic_load_explicit(&s->datagrams_received, memory_order_relaxed);
+	stats->bytes_received = atomic_load_explicit(&s->bytes_received, memory_order_relaxed);
+	stats->wire_datagrams_sent = atomic_load_explicit(&s->wire_datagrams_sent, memory_order_relaxed);
+	stats->wire_bytes_sent = atomic_load_explicit(&s->wire_bytes_sent, memory_order_relaxed);
+	stats->wire_datagrams_received =
+	    atomic_load_explicit(&s->wire_datagrams_received, memory_order_relaxed);
+	stats->wire_bytes_received = atomic_load_explicit(&s->wire_bytes_received, memory_order_relaxed);
+	stats->datagrams_dropped = atomic_load_explicit(&s->datagrams_dropped, memory_order_relaxed);
+	stats->send_again = atomic_load_explicit(&s->send_again, memory_order_relaxed);
+	stats->send_too_large = atomic_load_explicit(&s->send_too_large, memory_order_relaxed);
+	stats->send_failed = atomic_load_explicit(&s->send_failed, memory_order_relaxed);
+	stats->last_send_errno = atomic_load_explicit(&s->last_send_errno, memory_order_relaxed);
+	stats->stun_requests_sent = atomic_load_explicit(&s->stun_requests_sent, memory_order_relaxed);
+	stats->stun_retransmissions =
+	    atomic_load_explicit(&s->stun_retransmissions, memory_order_relaxed);
+
+	conn_lock(agent);
+	stats->rtt_samples = s->rtt_samples;
+	stats->rtt_ms = s->rtt_samples ? (int)s->rtt : -1;
+	stats->min_rtt_ms = s->rtt_samples ? (int)s->min_rtt : -1;
+	stats->gathering_ms = stats_elapsed(s, s->state_timestamps[JUICE_STATE_GATHERING]);
+	stats->gathering_done_ms = stats_elapsed(s, s->gathering_done_timestamp);
+	stats->connecting_ms = stats_elapsed(s, s->state_timestamps[JUICE_STATE_CONNECTING]);
+	stats->connected_ms = stats_elapsed(s, s->state_timestamps[JUICE_STATE_CONNECTED]);
+	stats->completed_ms = stats_elapsed(s, s->state_timestamps[JUICE_STATE_COMPLETED]);
+	stats->failed_ms = stats_elapsed(s, s->state_timestamps[JUICE_STATE_FAILED]);
+	conn_unlock(agent);
+}
+
 int agent_get_selected_candidate_pair(juice_agent_t *agent, ice_candidate_t *local,
                                       ice_candidate_t *remote) {
 	conn_lock(agent);
@@ -760,8 +983,14 @@ int agent_get_selected_candidate_pair(juice_agent_t *agent, ice_candidate_t *loc
 		return -1;
 	}
 
-	if (local)
-		*local = pair->local ? *pair->local : agent->local.candidates[0];
+	if (local) {
+		if (pair->local)
+			*local = *pair->local;
+		else if (agent->local.candidates_count > 0)
+			*local = *agent->local.candidates[0];
+		else
+			memset(local, 0, sizeof(*local));
+	}
 	if (remote)
 		*remote = *pair->remote;
 
@@ -774,7 +1003,11 @@ int agent_conn_update(juice_agent_t *agent, timestamp_t *next_timestamp) {
 }
 
 int agent_conn_recv(juice_agent_t *agent, char *buf, size_t len, const addr_record_t *src) {
-	agent_input(agent, buf, len, src, NULL);
+	atomic_fetch_add_explicit(&agent->stats.wire_datagrams_received, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&agent->stats.wire_bytes_received, len, memory_order_relaxed);
+	if (agent_input(agent, buf, len, src, NULL) < 0)
+		atomic_fetch_add_explicit(&agent->stats.datagrams_dropped, 1, memory_order_relaxed);
+
 	return 0; // ignore errors
 }
 
@@ -784,6 +1017,11 @@ int agent_conn_fail(juice_agent_t *agent) {
 	return 0;
 }
 
+void agent_conn_send_error(juice_agent_t *agent, int ret) {
+	// The datagram was counted as sent when it was queued
+	agent_count_send_error(agent, ret);
+}
+
 int agent_input(juice_agent_t *agent, char *buf, size_t len, const addr_record_t *src,
                 const addr_record_t *relayed) {
 	JLOG_VERBOSE("Received datagram, size=%d", len);
@@ -837,6 +1075,8 @@ int agent_input(juice_agent_t *agent, char *buf, size_t len, const addr_record_t
 
 	case AGENT_STUN_ENTRY_TYPE_CHECK:
 		JLOG_DEBUG("Received application datagram");
+		atomic_fetch_add_explicit(&agent->stats.datagrams_received, 1, memory_order_relaxed);
+		atomic_fetch_add_explicit(&agent->stats.bytes_received, len, memory_order_relaxed);
 		if (agent->config.cb_recv)
 			agent->config.cb_recv(agent, buf, len, agent->config.user_ptr);
 		return 0;
@@ -851,7 +1091,10 @@ int agent_input(juice_agent_t *agent, char *buf, size_t len, const addr_record_t
 
 void agent_register_entry_for_candidate_pair(juice_agent_t *agent, ice_candidate_pair_t *pair, agent_stun_entry_t *relay_entry) {
 	JLOG_VERBOSE("Registering STUN entry %d for candidate pair checking", agent->entries_count);
-	agent_stun_entry_t *entry = agent->entries + agent->entries_count;
+	agent_stun_entry_t *entry = agent_prepare_entry(agent);
+	if (!entry)
+		return;
+
 	entry->type = AGENT_STUN_ENTRY_TYPE_CHECK;
 	entry->state = AGENT_STUN_ENTRY_STATE_IDLE;
 	entry->mode = AGENT_MODE_UNKNOWN;
@@ -868,7 +1111,7 @@ void agent_register_entry_for_candidate_pair(juice_agent_t *agent, ice_candidate
 
 void agent_tcp_conn_connected(juice_agent_t *agent) {
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->pair->remote->transport != ICE_CANDIDATE_TRANSPORT_UDP) {
 			entry->pair->tcp_connected = true;
 			entry->next_transmission = current_timestamp();
@@ -887,7 +1130,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 		return 0;
 
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 
 		if (entry->pair && entry->pair->remote->transport != ICE_CANDIDATE_TRANSPORT_UDP && entry->pair->tcp_connected == false) {
 			conn_tcp_connect(agent, &entry->pair->remote->resolved, agent_tcp_conn_connected);
@@ -907,6 +1150,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 				if (entry->transaction_id_expired) {
 					juice_random(entry->transaction_id, STUN_TRANSACTION_ID_SIZE);
 					entry->transaction_id_expired = false;
+					entry->request_timestamp = 0;
 				}
 				int ret;
 				switch (entry->type) {
@@ -920,6 +1164,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 				}
 
 				if (ret >= 0) {
+					agent_record_request(agent, entry, now);
 					--entry->retransmissions;
 					if (entry->retransmissions < 0) {
 						entry->next_transmission = now + LAST_STUN_RETRANSMISSION_TIMEOUT;
@@ -977,6 +1222,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 
 			juice_random(entry->transaction_id, STUN_TRANSACTION_ID_SIZE);
 			entry->transaction_id_expired = false;
+			entry->request_timestamp = 0;
 
 			int ret;
 			switch (entry->type) {
@@ -1017,6 +1263,12 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 				continue;
 			}
 
+#if JUICE_DISABLE_CONSENT_FRESHNESS
+			if (entry->type != AGENT_STUN_ENTRY_TYPE_CHECK)
+				agent_record_request(agent, entry, now);
+#else
+			agent_record_request(agent, entry, now);
+#endif
 			agent_arm_keepalive(agent, entry);
 
 		} else {
@@ -1071,7 +1323,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 
 	// Cancel entries of frozen pairs
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->pair && entry->pair->state == ICE_CANDIDATE_PAIR_STATE_FROZEN &&
 		    entry->state != AGENT_STUN_ENTRY_STATE_IDLE &&
 		    entry->state != AGENT_STUN_ENTRY_STATE_CANCELLED) {
@@ -1100,7 +1352,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 				agent->nomination_timestamp = now + NOMINATION_TIMEOUT;
 
 			for (int i = 0; i < agent->entries_count; ++i) {
-				agent_stun_entry_t *entry = agent->entries + i;
+				agent_stun_entry_t *entry = agent->entries[i];
 				if (entry->pair == selected_pair) {
 					atomic_store(&agent->selected_entry, entry);
 					break;
@@ -1119,7 +1371,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 			agent_stun_entry_t *nominated_entry = NULL;
 			agent_stun_entry_t *relay_entry = NULL;
 			for (int i = 0; i < agent->entries_count; ++i) {
-				agent_stun_entry_t *entry = agent->entries + i;
+				agent_stun_entry_t *entry = agent->entries[i];
 				if (entry->pair && entry->pair == nominated_pair) {
 					nominated_entry = entry;
 					relay_entry = nominated_entry->relay_entry;
@@ -1144,7 +1396,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 
 			// Disable keepalives for other entries
 			for (int i = 0; i < agent->entries_count; ++i) {
-				agent_stun_entry_t *entry = agent->entries + i;
+				agent_stun_entry_t *entry = agent->entries[i];
 				if (entry != nominated_entry && entry != relay_entry &&
 				    entry->state == AGENT_STUN_ENTRY_STATE_SUCCEEDED_KEEPALIVE)
 					entry->state = AGENT_STUN_ENTRY_STATE_SUCCEEDED;
@@ -1161,7 +1413,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 					JLOG_DEBUG("Requesting pair nomination (controlling)");
 					selected_pair->nomination_requested = true;
 					for (int i = 0; i < agent->entries_count; ++i) {
-						agent_stun_entry_t *entry = agent->entries + i;
+						agent_stun_entry_t *entry = agent->entries[i];
 						if (entry->pair && entry->pair == selected_pair) {
 							entry->state =
 							    AGENT_STUN_ENTRY_STATE_PENDING;      // we don't want keepalives
@@ -1191,7 +1443,7 @@ int agent_bookkeeping(juice_agent_t *agent, timestamp_t *next_timestamp) {
 	}
 
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->next_transmission && *next_timestamp > entry->next_transmission)
 			*next_timestamp = entry->next_transmission;
 
@@ -1211,6 +1463,8 @@ void agent_change_state(juice_agent_t *agent, juice_state_t state) {
 	if (state != agent->state) {
 		JLOG_INFO("Changing state to %s", juice_state_to_string(state));
 		agent->state = state;
+		if (!agent->stats.state_timestamps[state])
+			agent->stats.state_timestamps[state] = current_timestamp();
 		if (agent->config.cb_state_changed)
 			agent->config.cb_state_changed(agent, state, agent->config.user_ptr);
 	}
@@ -1487,6 +1741,9 @@ int agent_process_stun_binding(juice_agent_t *agent, const stun_message_t *msg,
 		if (entry->type == AGENT_STUN_ENTRY_TYPE_SERVER)
 			JLOG_INFO("STUN server binding successful");
 
+		if (entry->type == AGENT_STUN_ENTRY_TYPE_CHECK)
+			agent_record_response(agent, entry);
+
 		if (entry->state != AGENT_STUN_ENTRY_STATE_SUCCEEDED_KEEPALIVE) {
 			entry->state = AGENT_STUN_ENTRY_STATE_SUCCEEDED;
 			entry->next_transmission = 0;
@@ -1679,9 +1936,11 @@ int agent_send_stun_binding(juice_agent_t *agent, agent_stun_entry_t *entry, stu
 			// computed by the algorithm in Section 5.1.2 for the local candidate, but with the
 			// candidate type preference of peer-reflexive candidates.
 			int family = entry->record.addr.ss_family;
-			int index = entry->pair && entry->pair->local
-			                ? (int)(entry->pair->local - agent->local.candidates)
-			                : 0;
+			int index = 0;
+			if (entry->pair && entry->pair->local)
+				while (index < agent->local.candidates_count &&
+				       agent->local.candidates[index] != entry->pair->local)
+					++index;
 			msg.priority =
 			    ice_compute_priority(ICE_CANDIDATE_TYPE_PEER_REFLEXIVE, family, 1, index, false);
 
@@ -2248,9 +2507,9 @@ int agent_add_local_relayed_candidate(juice_agent_t *agent, const addr_record_t
 	JLOG_DEBUG("Gathered relayed candidate: %s", buffer);
 
 	// Relayed candidates must be differenciated, so match them with already known remote candidates
-	ice_candidate_t *local = agent->local.candidates + agent->local.candidates_count - 1;
+	ice_candidate_t *local = agent->local.candidates[agent->local.candidates_count - 1];
 	for (int i = 0; i < agent->remote.candidates_count; ++i) {
-		ice_candidate_t *remote = agent->remote.candidates + i;
+		ice_candidate_t *remote = agent->remote.candidates[i];
 		if (local->resolved.addr.ss_family == remote->resolved.addr.ss_family)
 			agent_add_candidate_pair(agent, local, remote);
 	}
@@ -2331,7 +2590,7 @@ int agent_add_remote_reflexive_candidate(juice_agent_t *agent, ice_candidate_typ
 
 	JLOG_DEBUG("Obtained a new remote reflexive candidate, priority=%lu", (unsigned long)priority);
 
-	ice_candidate_t *remote = agent->remote.candidates + agent->remote.candidates_count - 1;
+	ice_candidate_t *remote = agent->remote.candidates[agent->remote.candidates_count - 1];
 	remote->priority = priority;
 
 	return agent_add_candidate_pairs_for_remote(agent, remote);
@@ -2363,7 +2622,7 @@ int agent_add_candidate_pair(juice_agent_t *agent, ice_candidate_t *local, // lo
 		}
 
 		for (int i = 0; i < agent->candidate_pairs_count; ++i) {
-			ice_candidate_pair_t *pair = &agent->candidate_pairs[i];
+			ice_candidate_pair_t *pair = agent->candidate_pairs[i];
 			if (pair->remote->transport != ICE_CANDIDATE_TRANSPORT_UDP) {
 				JLOG_INFO("Only one ICE-TCP remote candidate is supported ignoring TCP Candidate");
 				return 0;
@@ -2374,7 +2633,10 @@ int agent_add_candidate_pair(juice_agent_t *agent, ice_candidate_t *local, // lo
 	JLOG_VERBOSE("Adding new candidate pair, priority=%" PRIu64, pair.priority);
 
 	// Add pair
-	ice_candidate_pair_t *pos = agent->candidate_pairs + agent->candidate_pairs_count;
+	ice_candidate_pair_t *pos = agent_prepare_candidate_pair(agent);
+	if (!pos)
+		return -1;
+
 	*pos = pair;
 	++agent->candidate_pairs_count;
 
@@ -2388,7 +2650,7 @@ int agent_add_candidate_pair(juice_agent_t *agent, ice_candidate_t *local, // lo
 	agent_stun_entry_t *relay_entry = NULL;
 	if (local && local->type == ICE_CANDIDATE_TYPE_RELAYED) {
 		for (int i = 0; i < agent->entries_count; ++i) {
-			agent_stun_entry_t *other_entry = agent->entries + i;
+			agent_stun_entry_t *other_entry = agent->entries[i];
 			if (other_entry->type == AGENT_STUN_ENTRY_TYPE_RELAY &&
 			    addr_record_is_equal(&other_entry->relayed, &local->resolved, true)) {
 				relay_entry = other_entry;
@@ -2436,7 +2698,7 @@ int agent_add_candidate_pairs_for_remote(juice_agent_t *agent, ice_candidate_t *
 
 	// However, we need still to differenciate local relayed candidates
 	for (int i = 0; i < agent->local.candidates_count; ++i) {
-		ice_candidate_t *local = agent->local.candidates + i;
+		ice_candidate_t *local = agent->local.candidates[i];
 		if (local->type == ICE_CANDIDATE_TYPE_RELAYED &&
 		    local->resolved.addr.ss_family == remote->resolved.addr.ss_family)
 			if (agent_add_candidate_pair(agent, local, remote))
@@ -2451,7 +2713,7 @@ int agent_unfreeze_candidate_pair(juice_agent_t *agent, ice_candidate_pair_t *pa
 		return 0;
 
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->pair == pair) {
 			pair->state = ICE_CANDIDATE_PAIR_STATE_PENDING;
 			entry->state = AGENT_STUN_ENTRY_STATE_PENDING;
@@ -2493,6 +2755,30 @@ void agent_arm_keepalive(juice_agent_t *agent, agent_stun_entry_t *entry) {
 	agent_arm_transmission(agent, entry, period);
 }
 
+void agent_record_request(juice_agent_t *agent, agent_stun_entry_t *entry, timestamp_t now) {
+	atomic_fetch_add_explicit(&agent->stats.stun_requests_sent, 1, memory_order_relaxed);
+	if (entry->request_timestamp) {
+		// Same transaction again, its response can't be matched to a transmission for RTT
+		atomic_fetch_add_explicit(&agent->stats.stun_retransmissions, 1, memory_order_relaxed);
+		entry->request_retransmitted = true;
+	} else {
+		entry->request_timestamp = now;
+		entry->request_retransmitted = false;
+	}
+}
+
+void agent_record_response(juice_agent_t *agent, agent_stun_entry_t *entry) {
+	if (entry->request_timestamp && !entry->request_retransmitted) {
+		timediff_t rtt = current_timestamp() - entry->request_timestamp;
+		agent_stats_t *stats = &agent->stats;
+		stats->rtt = rtt;
+		if (!stats->rtt_samples || rtt < stats->min_rtt)
+			stats->min_rtt = rtt;
+		++stats->rtt_samples;
+	}
+	entry->request_timestamp = 0;
+}
+
 void agent_arm_transmission(juice_agent_t *agent, agent_stun_entry_t *entry, timediff_t delay) {
 	if (entry->state != AGENT_STUN_ENTRY_STATE_SUCCEEDED_KEEPALIVE)
 		entry->state = AGENT_STUN_ENTRY_STATE_PENDING;
@@ -2508,18 +2794,19 @@ void agent_arm_transmission(juice_agent_t *agent, agent_stun_entry_t *entry, tim
 	}
 
 	// Find a time slot
-	agent_stun_entry_t *other = agent->entries;
-	while (other != agent->entries + agent->entries_count) {
+	int i = 0;
+	while (i < agent->entries_count) {
+		agent_stun_entry_t *other = agent->entries[i];
 		if (other != entry) {
 			timestamp_t other_transmission = other->next_transmission;
 			timediff_t timediff = entry->next_transmission - other_transmission;
 			if (other_transmission && abs((int)timediff) < STUN_PACING_TIME) {
 				entry->next_transmission = other_transmission + STUN_PACING_TIME;
-				other = agent->entries;
+				i = 0;
 				continue;
 			}
 		}
-		++other;
+		++i;
 	}
 }
 
@@ -2541,7 +2828,7 @@ void agent_update_pac_timer(juice_agent_t *agent) {
 void agent_update_gathering_done(juice_agent_t *agent) {
 	JLOG_VERBOSE("Updating gathering status");
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->type != AGENT_STUN_ENTRY_TYPE_CHECK &&
 		    entry->state == AGENT_STUN_ENTRY_STATE_PENDING) {
 			JLOG_VERBOSE("STUN server or relay entry %d is still pending", i);
@@ -2552,6 +2839,7 @@ void agent_update_gathering_done(juice_agent_t *agent) {
 		JLOG_INFO("Candidate gathering done");
 		agent->local.finished = true;
 		agent->gathering_done = true;
+		agent->stats.gathering_done_timestamp = current_timestamp();
 
 		agent_update_pac_timer(agent);
 
@@ -2563,14 +2851,14 @@ void agent_update_gathering_done(juice_agent_t *agent) {
 void agent_update_candidate_pairs(juice_agent_t *agent) {
 	bool is_controlling = agent->mode == AGENT_MODE_CONTROLLING;
 	for (int i = 0; i < agent->candidate_pairs_count; ++i) {
-		ice_candidate_pair_t *pair = agent->candidate_pairs + i;
+		ice_candidate_pair_t *pair = agent->candidate_pairs[i];
 		ice_update_candidate_pair(pair, is_controlling);
 	}
 	agent_update_ordered_pairs(agent);
 
 	// Expire all transaction IDs for checks
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (entry->type == AGENT_STUN_ENTRY_TYPE_CHECK) {
 			entry->transaction_id_expired = true;
 		}
@@ -2583,11 +2871,11 @@ void agent_update_ordered_pairs(juice_agent_t *agent) {
 		ice_candidate_pair_t **begin = agent->ordered_pairs;
 		ice_candidate_pair_t **end = begin + i;
 		ice_candidate_pair_t **prev = end;
-		uint64_t priority = agent->candidate_pairs[i].priority;
+		uint64_t priority = agent->candidate_pairs[i]->priority;
 		while (--prev >= begin && (*prev)->priority < priority)
 			*(prev + 1) = *prev;
 
-		*(prev + 1) = agent->candidate_pairs + i;
+		*(prev + 1) = agent->candidate_pairs[i];
 	}
 }
 
@@ -2602,7 +2890,7 @@ static inline bool entry_is_relayed(const agent_stun_entry_t *entry) {
 agent_stun_entry_t *agent_find_entry_from_transaction_id(juice_agent_t *agent,
                                                          const uint8_t *transaction_id) {
 	for (int i = 0; i < agent->entries_count; ++i) {
-		agent_stun_entry_t *entry = agent->entries + i;
+		agent_stun_entry_t *entry = agent->entries[i];
 		if (memcmp(transaction_id, entry->transaction_id, STUN_TRANSACTION_ID_SIZE) == 0) {
 			JLOG_VERBOSE("STUN entry %d matching incoming transaction ID", i);
 			return entry;
@@ -2641,7 +2929,7 @@ agent_stun_entry_t *agent_find_entry_from_record(juice_agent_t *agent, const add
 
 	if (relayed) {
 		for (int i = 0; i < agent->entries_count; ++i) {
-			agent_stun_entry_t *entry = agent->entries + i;
+			agent_stun_entry_t *entry = agent->entries[i];
 			if (entry_is_relayed(entry) &&
 			    addr_record_is_equal(&entry->pair->local->resolved, relayed, true) &&
 			    addr_record_is_equal(&entry->record, record, true)) {
@@ -2664,7 +2952,7 @@ agent_stun_entry_t *agent_find_entry_from_record(juice_agent_t *agent, const add
 		if (matching_pair) {
 			// Just find the corresponding entry
 			for (int i = 0; i < agent->entries_count; ++i) {
-				agent_stun_entry_t *entry = agent->entries + i;
+				agent_stun_entry_t *entry = agent->entries[i];
 				if (entry->pair == matching_pair) {
 					JLOG_DEBUG("STUN entry %d pair matching incoming address", i);
 					return entry;
@@ -2674,7 +2962,7 @@ agent_stun_entry_t *agent_find_entry_from_record(juice_agent_t *agent, const add
 
 		// Try to match entries directly
 		for (int i = 0; i < agent->entries_count; ++i) {
-			agent_stun_entry_t *entry = agent->entries + i;
+			agent_stun_entry_t *entry = agent->entries[i];
 			if (!entry_is_relayed(entry) && addr_record_is_equal(&entry->record, record, true)) {
 				JLOG_DEBUG("STUN entry %d matching incoming address", i);
 				return entry;
@@ -2701,7 +2989,7 @@ void agent_translate_host_candidate_entry(juice_agent_t *agent, agent_stun_entry
 
 #if JUICE_ENABLE_LOCAL_ADDRESS_TRANSLATION
 	for (int i = 0; i < agent->local.candidates_count; ++i) {
-		ice_candidate_t *candidate = agent->local.candidates + i;
+		ice_candidate_t *candidate = agent->local.candidates[i];
 		if (candidate->type != ICE_CANDIDATE_TYPE_HOST)
 			continue;
 
@@ -74,6 +74,10 @@
 
 #define AGENT_TURN_MAP_SIZE ICE_MAX_CANDIDATES_COUNT
 
+// Initial table sizes, doubled as needed: a host-only peer needs a couple of each
+#define AGENT_INITIAL_ENTRIES_CAPACITY 4
+#define AGENT_INITIAL_CANDIDATE_PAIRS_CAPACITY 4
+
 typedef enum agent_mode {
 	AGENT_MODE_UNKNOWN,
 	AGENT_MODE_CONTROLLED,
@@ -111,6 +115,8 @@ typedef struct agent_stun_entry {
 	addr_record_t relayed;
 	uint8_t transaction_id[STUN_TRANSACTION_ID_SIZE];
 	timestamp_t next_transmission;
+	timestamp_t request_timestamp; // first transmission of the pending request, 0 if none
+	bool request_retransmitted;
 	timediff_t retransmission_timeout;
 	int retransmissions;
 	bool transaction_id_expired;
@@ -122,35 +128,70 @@ typedef struct agent_stun_entry {
 
 } agent_stun_entry_t;
 
+// Counters are updated with relaxed atomics so that the send path stays lock-free, other fields are
+// protected by the agent lock
+typedef struct agent_stats {
+	atomic(uint64_t) datagrams_sent;
+	atomic(uint64_t) bytes_sent;
+	atomic(uint64_t) datagrams_received;
+	atomic(uint64_t) bytes_received;
+	atomic(uint64_t) wire_datagrams_sent;
+	atomic(uint64_t) wire_bytes_sent;
+	atomic(uint64_t) wire_datagrams_received;
+	atomic(uint64_t) wire_bytes_received;
+	atomic(uint64_t) datagrams_dropped;
+	atomic(uint64_t) send_again;
+	atomic(uint64_t) send_too_large;
+	atomic(uint64_t) send_failed;
+	atomic(int) last_send_errno;
+	atomic(uint64_t) stun_requests_sent;
+	atomic(uint64_t) stun_retransmissions;
+
+	uint64_t rtt_samples;
+	timediff_t rtt;
+	timediff_t min_rtt;
+
+	timestamp_t created_timestamp;
+	timestamp_t gathering_done_timestamp;
+	timestamp_t state_timestamps[JUICE_STATE_FAILED + 1]; // first entry into each state, 0 if never
+} agent_stats_t;
+
 struct juice_agent {
-	juice_config_t config;
+	// Fields used on every send and receive come first
 	juice_state_t state;
 	agent_mode_t mode;
-	juice_ice_tcp_mode_t ice_tcp_mode;
+	atomic_ptr(agent_stun_entry_t) selected_entry;
+	ice_candidate_pair_t *selected_pair;
 
-	ice_description_t local;
-	ice_description_t remote;
+	conn_registry_t *registry;
+	int conn_index;
+	void *conn_impl;
 
-	ice_candidate_pair_t candidate_pairs[MAX_CANDIDATE_PAIRS_COUNT];
-	ice_candidate_pair_t *ordered_pairs[MAX_CANDIDATE_PAIRS_COUNT];
-	ice_candidate_pair_t *selected_pair;
-	int candidate_pairs_count;
+	juice_config_t config;
+	agent_stats_t stats;
 
-	agent_stun_entry_t entries[MAX_STUN_ENTRIES_COUNT];
+	// Tables are grown on demand up to their MAX_*_COUNT. Entries and pairs are allocated one by
+	// one, so pointers to them (selected_entry, relay_entry, entry->pair) stay valid.
+	agent_stun_entry_t **entries;
 	int entries_count;
-	atomic_ptr(agent_stun_entry_t) selected_entry;
+	int entries_capacity;
+
+	ice_candidate_pair_t **candidate_pairs;
+	ice_candidate_pair_t **ordered_pairs;
+	int candidate_pairs_count;
+	int candidate_pairs_capacity;
 
+	juice_ice_tcp_mode_t ice_tcp_mode;
 	uint64_t ice_tiebreaker;
 	timestamp_t pac_timestamp; // Patiently Awaiting Connectivity timer
 	timestamp_t nomination_timestamp;
 	bool gathering_done;
 
-	conn_registry_t *registry;
-	int conn_index;
-	void *conn_impl;
-
 	thread_t resolver_thread;
 	bool resolver_thread_started;
+
+	ice_description_t local;
+	ice_description_t remote;
 };
 
 juice_agent_t *agent_create(const juice_config_t *config);
@@ -165,6 +206,7 @@ int agent_set_local_ice_attributes(juice_agent_t *agent, const char *ufrag, cons
 int agent_add_turn_server(juice_agent_t *agent, const juice_turn_server_t *turn_server);
 int agent_set_remote_gathering_done(juice_agent_t *agent);
 int agent_send(juice_agent_t *agent, const char *data, size_t size, int ds);
+int agent_send_batch(juice_agent_t *agent, const juice_iovec_t *msgs, size_t count, int ds);
 int agent_direct_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
                       int ds);
 int agent_relay_send(juice_agent_t *agent, agent_stun_entry_t *entry, const addr_record_t *dst,
@@ -172,12 +214,14 @@ int agent_relay_send(juice_agent_t *agent, agent_stun_entry_t *entry, const addr
 int agent_channel_send(juice_agent_t *agent, agent_stun_entry_t *entry, const addr_record_t *dst,
                        const char *data, size_t size, int ds);
 juice_state_t agent_get_state(juice_agent_t *agent);
+void agent_get_stats(juice_agent_t *agent, juice_stats_t *stats);
 int agent_get_selected_candidate_pair(juice_agent_t *agent, ice_candidate_t *local,
                                       ice_candidate_t *remote);
 
 int agent_conn_recv(juice_agent_t *agent, char *buf, size_t len, const addr_record_t *src);
 int agent_conn_update(juice_agent_t *agent, timestamp_t *next_timestamp);
 int agent_conn_fail(juice_agent_t *agent);
+void agent_conn_send_error(juice_agent_t *agent, int ret); // for sends completed asynchronously
 
 int agent_input(juice_agent_t *agent, char *buf, size_t len, const addr_record_t *src,
                 const addr_record_t *relayed); // relayed may be NULL
@@ -226,6 +270,8 @@ int agent_unfreeze_candidate_pair(juice_agent_t *agent, ice_candidate_pair_t *pa
 
 void agent_arm_keepalive(juice_agent_t *agent, agent_stun_entry_t *entry);
 void agent_arm_transmission(juice_agent_t *agent, agent_stun_entry_t *entry, timediff_t delay);
+void agent_record_request(juice_agent_t *agent, agent_stun_entry_t *entry, timestamp_t now);
+void agent_record_response(juice_agent_t *agent, agent_stun_entry_t *entry);
 void agent_update_pac_timer(juice_agent_t *agent);
 void agent_update_gathering_done(juice_agent_t *agent);
 void agent_update_candidate_pairs(juice_agent_t *agent);
@@ -10,7 +10,9 @@
 #include "agent.h"
 #include "conn_mux.h"
 #include "conn_poll.h"
+#include "conn_sim.h"
 #include "conn_thread.h"
+#include "conn_uring.h"
 #include "log.h"
 
 #include <assert.h>
@@ -18,21 +20,27 @@
 
 #define INITIAL_REGISTRY_SIZE 16
 
-#define MODE_ENTRIES_SIZE 3
+#define MODE_ENTRIES_SIZE 5
 
 static conn_mode_entry_t mode_entries[MODE_ENTRIES_SIZE] = {
     {conn_poll_registry_init, conn_poll_registry_cleanup, conn_poll_init, conn_poll_cleanup,
-     conn_poll_lock, conn_poll_unlock, conn_poll_interrupt, conn_poll_send, conn_poll_tcp_connect_func, conn_poll_get_addrs,
-     NULL, NULL, NULL, MUTEX_INITIALIZER, NULL},
+     conn_poll_lock, conn_poll_unlock, conn_poll_interrupt, conn_poll_send, conn_poll_send_batch, conn_poll_tcp_connect_func, conn_poll_get_addrs,
+     NULL, conn_poll_get_registry, NULL, MUTEX_INITIALIZER, NULL},
     {conn_mux_registry_init, conn_mux_registry_cleanup, conn_mux_init, conn_mux_cleanup,
-     conn_mux_lock, conn_mux_unlock, conn_mux_interrupt, conn_mux_send, NULL, conn_mux_get_addrs,
+     conn_mux_lock, conn_mux_unlock, conn_mux_interrupt, conn_mux_send, conn_mux_send_batch, NULL, conn_mux_get_addrs,
      conn_mux_listen, conn_mux_get_registry, conn_mux_can_release_registry, MUTEX_INITIALIZER, NULL},
     {NULL, NULL, conn_thread_init, conn_thread_cleanup,
-     conn_thread_lock, conn_thread_unlock, conn_thread_interrupt, conn_thread_send, NULL, conn_thread_get_addrs,
+     conn_thread_lock, conn_thread_unlock, conn_thread_interrupt, conn_thread_send, conn_thread_send_batch, NULL, conn_thread_get_addrs,
+     NULL, NULL, NULL, MUTEX_INITIALIZER, NULL},
+    {conn_sim_registry_init, conn_sim_registry_cleanup, conn_sim_init, conn_sim_cleanup,
+     conn_sim_lock, conn_sim_unlock, conn_sim_interrupt, conn_sim_send, NULL, NULL, conn_sim_get_addrs,
+     NULL, NULL, conn_sim_can_release_registry, MUTEX_INITIALIZER, NULL},
+    {conn_uring_registry_init, conn_uring_registry_cleanup, conn_uring_init, conn_uring_cleanup,
+     conn_uring_lock, conn_uring_unlock, conn_uring_interrupt, conn_uring_send, conn_uring_send_batch, NULL, conn_uring_get_addrs,
      NULL, NULL, NULL, MUTEX_INITIALIZER, NULL}
 };
 
-#define MODE_ENTRIES_SIZE 3
+#define MODE_ENTRIES_SIZE 5
 
 static conn_mode_entry_t mode_entries[MODE_ENTRIES_SIZE];
 
@@ -253,6 +261,26 @@ int conn_send(juice_agent_t *agent, const addr_record_t *dst, const char *data,
 	return get_agent_mode_entry(agent)->send_func(agent, dst, data, size, ds);
 }
 
+int conn_send_batch(juice_agent_t *agent, const addr_record_t *dst, const juice_iovec_t *msgs,
+                    size_t count, int ds) {
+	if (!agent->conn_impl)
+		return -1;
+
+	conn_mode_entry_t *entry = get_agent_mode_entry(agent);
+	if (entry->send_batch_func && dst->socktype != SOCK_STREAM)
+		return entry->send_batch_func(agent, dst, msgs, count, ds);
+
+	// One send per datagram
+	size_t sent = 0;
+	while (sent < count) {
+		int ret = entry->send_func(agent, dst, msgs[sent].data, msgs[sent].size, ds);
+		if (ret < 0)
+			return sent > 0 ? (int)sent : ret;
+		++sent;
+	}
+	return (int)sent;
+}
+
 void conn_tcp_connect(juice_agent_t *agent, const addr_record_t *dst, void (*callback)(juice_agent_t*)) {
 	if (!agent->conn_impl)
 		return;
@@ -287,6 +315,7 @@ int juice_mux_listen(const char *bind_address, int local_port, juice_cb_mux_inco
 	mutex_lock(&entry->mutex);
 
 	udp_socket_config_t config;
+	memset(&config, 0, sizeof(config));
 	config.bind_address = bind_address;
 	config.port_begin = config.port_end = local_port;
 
@@ -316,3 +345,151 @@ int juice_mux_listen(const char *bind_address, int local_port, juice_cb_mux_inco
 	mutex_unlock(&entry->mutex);
 	return 0;
 }
+
+int juice_mux_get_stats(int local_port, juice_mux_stats_t *stats) {
+	if (!stats)
+		return JUICE_ERR_INVALID;
+
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_MUX];
+	mutex_lock(&entry->mutex);
+
+	udp_socket_config_t config;
+	memset(&config, 0, sizeof(config));
+	config.port_begin = config.port_end = local_port;
+
+	// Never creates the registry
+	conn_registry_t *registry = conn_mux_get_registry(&config);
+	if (!registry) {
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_NOT_AVAIL;
+	}
+
+	mutex_lock(&registry->mutex);
+	conn_mux_get_stats(registry, stats);
+	mutex_unlock(&registry->mutex);
+
+	mutex_unlock(&entry->mutex);
+	return JUICE_ERR_SUCCESS;
+}
+
+int juice_set_poll_config(const juice_poll_config_t *config) {
+	if (!config || config->threads < 0 || config->threads > JUICE_POLL_MAX_THREADS ||
+	    (config->balance != JUICE_POLL_BALANCE_LEAST_LOADED &&
+	     config->balance != JUICE_POLL_BALANCE_HASH))
+		return JUICE_ERR_INVALID;
+
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_POLL];
+	mutex_lock(&entry->mutex);
+	conn_poll_set_config(config);
+	mutex_unlock(&entry->mutex);
+	return JUICE_ERR_SUCCESS;
+}
+
+int juice_sim_start(const juice_sim_config_t *config) {
+	if (!config)
+		return JUICE_ERR_INVALID;
+
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_SIM];
+	mutex_lock(&entry->mutex);
+
+	conn_registry_t *registry;
+	if (acquire_registry(entry, NULL, &registry)) { // locks the registry, creating it first
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_FAILED;
+	}
+
+	int ret = conn_sim_start(registry, config);
+	release_registry(entry, registry); // kept while the simulation runs
+	mutex_unlock(&entry->mutex);
+	return ret == 0 ? JUICE_ERR_SUCCESS : JUICE_ERR_FAILED;
+}
+
+int juice_sim_stop(void) {
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_SIM];
+	mutex_lock(&entry->mutex);
+
+	conn_registry_t *registry = entry->registry;
+	if (!registry) {
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_NOT_AVAIL;
+	}
+
+	mutex_lock(&registry->mutex);
+	if (registry->agents_count > 0) {
+		JLOG_ERROR("Simulated agents must be destroyed before stopping the simulation");
+		mutex_unlock(&registry->mutex);
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_FAILED;
+	}
+
+	conn_sim_stop(registry);
+	release_registry(entry, registry); // unlocks and destroys the registry
+	mutex_unlock(&entry->mutex);
+	return JUICE_ERR_SUCCESS;
+}
+
+int juice_sim_set_nat(const char *host_address, const char *public_address,
+                      juice_sim_nat_type_t type) {
+	if (!host_address || !public_address)
+		return JUICE_ERR_INVALID;
+
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_SIM];
+	mutex_lock(&entry->mutex);
+
+	conn_registry_t *registry = entry->registry;
+	if (!registry) {
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_NOT_AVAIL;
+	}
+
+	mutex_lock(&registry->mutex);
+	int ret = conn_sim_set_nat(registry, host_address, public_address, type);
+	mutex_unlock(&registry->mutex);
+
+	mutex_unlock(&entry->mutex);
+	return ret == 0 ? JUICE_ERR_SUCCESS : JUICE_ERR_INVALID;
+}
+
+int juice_sim_advance(int ms) {
+	if (ms < 0)
+		return JUICE_ERR_INVALID;
+
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_SIM];
+	mutex_lock(&entry->mutex);
+
+	conn_registry_t *registry = entry->registry;
+	if (!registry) {
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_NOT_AVAIL;
+	}
+
+	// The registry stays while the simulation runs. Release the entry so that callbacks may create
+	// and destroy agents.
+	mutex_lock(&registry->mutex);
+	mutex_unlock(&entry->mutex);
+
+	int ret = conn_sim_advance(registry, ms);
+	mutex_unlock(&registry->mutex);
+	return ret == 0 ? JUICE_ERR_SUCCESS : JUICE_ERR_FAILED;
+}
+
+int juice_sim_get_stats(juice_sim_stats_t *stats) {
+	if (!stats)
+		return JUICE_ERR_INVALID;
+
+	conn_mode_entry_t *entry = &mode_entries[JUICE_CONCURRENCY_MODE_SIM];
+	mutex_lock(&entry->mutex);
+
+	conn_registry_t *registry = entry->registry;
+	if (!registry) {
+		mutex_unlock(&entry->mutex);
+		return JUICE_ERR_NOT_AVAIL;
+	}
+
+	mutex_lock(&registry->mutex);
+	conn_sim_get_stats(registry, stats);
+	mutex_unlock(&registry->mutex);
+
+	mutex_unlock(&entry->mutex);
+	return JUICE_ERR_SUCCESS;
+}
@@ -18,6 +18,8 @@
 #include <string.h>
 
 #define BUFFER_SIZE 4096
+#define RECV_BATCH_SIZE 32
+#define GRO_BATCH_SIZE 8 // of UDP_GRO_BUFFER_SIZE bytes
 #define INITIAL_MAP_SIZE 16
 
 typedef enum map_entry_type {
@@ -37,13 +39,23 @@ typedef struct registry_impl {
 	uint16_t port;
 	thread_t thread;
 	socket_t sock;
+	udp_batch_t *recv_batch; // used by the connections thread only
 	mutex_t send_mutex;
 	int send_ds;
+	bool send_gso;
 	map_entry_t *map;
 	int map_size;
 	int map_count;
 	juice_cb_mux_incoming_t cb_mux_incoming;
 	void *mux_incoming_user_ptr;
+
+	// Statistics, protected by the registry mutex
+	uint64_t datagrams_received;
+	uint64_t lookups;
+	uint64_t map_probes;
+	uint64_t map_misses;
+	uint64_t agents_scanned;
+	uint64_t dropped;
 } registry_impl_t;
 
 typedef struct conn_impl {
@@ -129,9 +141,11 @@ static int grow_map(registry_impl_t *impl, int new_size);
 
 static map_entry_t *find_map_entry(registry_impl_t *impl, const addr_record_t *record,
                                    bool allow_deleted) {
-	unsigned long key = addr_record_hash(record, false) % impl->map_size;
+	// Many peers may share one address (a NAT, a relay, loopback), with nearby ports
+	unsigned long key = addr_record_map_hash(record, true) % impl->map_size;
 	unsigned long pos = key;
 	while (true) {
+		++impl->map_probes;
 		map_entry_t *entry = impl->map + pos;
 		if (entry->type == MAP_ENTRY_TYPE_EMPTY ||
 		    addr_record_is_equal(&entry->record, record, true)) // compare ports
@@ -215,7 +229,7 @@ static int grow_map(registry_impl_t *impl, int new_size) {
 
 int conn_mux_prepare(conn_registry_t *registry, struct pollfd *pfd, timestamp_t *next_timestamp);
 int conn_mux_process(conn_registry_t *registry, struct pollfd *pfd);
-int conn_mux_recv(conn_registry_t *registry, char *buffer, size_t size, addr_record_t *src);
+int conn_mux_recv(conn_registry_t *registry, udp_message_t **messages);
 void conn_mux_fail(conn_registry_t *registry);
 int conn_mux_run(conn_registry_t *registry);
 
@@ -227,7 +241,6 @@ static thread_return_t THREAD_CALL conn_mux_thread_entry(void *arg) {
 }
 
 int conn_mux_registry_init(conn_registry_t *registry, udp_socket_config_t *config) {
-	(void)config;
 	registry_impl_t *registry_impl = calloc(1, sizeof(registry_impl_t));
 	if (!registry_impl) {
 		JLOG_FATAL("Memory allocation failed for connections registry impl");
@@ -243,9 +256,20 @@ int conn_mux_registry_init(conn_registry_t *registry, udp_socket_config_t *confi
 	registry_impl->map_size = INITIAL_MAP_SIZE;
 	registry_impl->map_count = 0;
 
+	// The first agent on the port decides for UDP offload
+	registry_impl->recv_batch =
+	    config->enable_offload ? udp_batch_create(GRO_BATCH_SIZE, UDP_GRO_BUFFER_SIZE)
+	                           : udp_batch_create(RECV_BATCH_SIZE, BUFFER_SIZE);
+	if (!registry_impl->recv_batch) {
+		free(registry_impl->map);
+		free(registry_impl);
+		return -1;
+	}
+
 	registry_impl->sock = udp_create_socket(config);
 	if (registry_impl->sock == INVALID_SOCKET) {
 		JLOG_FATAL("UDP socket creation failed");
+		udp_batch_destroy(registry_impl->recv_batch);
 		free(registry_impl->map);
 		free(registry_impl);
 		return -1;
@@ -253,6 +277,14 @@ int conn_mux_registry_init(conn_registry_t *registry, udp_socket_config_t *confi
 
 	registry_impl->port = udp_get_port(registry_impl->sock);
 
+	if (config->enable_offload) {
+		registry_impl->send_gso = udp_enable_gso(registry_impl->sock) == 0;
+		bool recv_gro = udp_enable_gro(registry_impl->sock) == 0;
+		JLOG_DEBUG("UDP offload: segmentation %s, receive %s",
+		           registry_impl->send_gso ? "enabled" : "unavailable",
+		           recv_gro ? "enabled" : "unavailable");
+	}
+
 	mutex_init(&registry_impl->send_mutex, 0);
 	registry->impl = registry_impl;
 
@@ -275,6 +307,7 @@ int conn_mux_registry_init(conn_registry_t *registry, udp_socket_config_t *confi
 error:
 	mutex_destroy(&registry_impl->send_mutex);
 	closesocket(registry_impl->sock);
+	udp_batch_destroy(registry_impl->recv_batch);
 	free(registry_impl->map);
 	free(registry_impl);
 	registry->impl = NULL;
@@ -299,6 +332,7 @@ void conn_mux_registry_cleanup(conn_registry_t *registry) {
 
 	mutex_destroy(&registry_impl->send_mutex);
 	closesocket(registry_impl->sock);
+	udp_batch_destroy(registry_impl->recv_batch);
 	free(registry_impl->map);
 	free(registry->impl);
 	registry->impl = NULL;
@@ -335,6 +369,7 @@ static juice_agent_t *lookup_agent(conn_registry_t *registry, char *buf, size_t
 	JLOG_VERBOSE("Looking up agent from address");
 
 	registry_impl_t *registry_impl = registry->impl;
+	++registry_impl->lookups;
 	map_entry_t *entry = find_map_entry(registry_impl, src, false);
 	juice_agent_t *agent = entry && entry->type == MAP_ENTRY_TYPE_FULL ? entry->agent : NULL;
 	if (agent) {
@@ -342,6 +377,8 @@ static juice_agent_t *lookup_agent(conn_registry_t *registry, char *buf, size_t
 		return agent;
 	}
 
+	++registry_impl->map_misses;
+
 	if (!is_stun_datagram(buf, len)) {
 		JLOG_INFO("Got non-STUN message from unknown source address");
 		return NULL;
@@ -370,6 +407,7 @@ static juice_agent_t *lookup_agent(conn_registry_t *registry, char *buf, size_t
 		for (int i = 0; i < registry->agents_size; ++i) {
 			agent = registry->agents[i];
 			if (is_ready(agent)) {
+				++registry_impl->agents_scanned;
 				if (strcmp(local_ufrag, agent->local.ice_ufrag) == 0) {
 					JLOG_DEBUG("Found agent from ICE ufrag");
 					insert_map_entry(registry_impl, src, agent);
@@ -408,6 +446,7 @@ static juice_agent_t *lookup_agent(conn_registry_t *registry, char *buf, size_t
 		for (int i = 0; i < registry->agents_size; ++i) {
 			agent = registry->agents[i];
 			if (is_ready(agent)) {
+				++registry_impl->agents_scanned;
 				if (agent_find_entry_from_transaction_id(agent, msg.transaction_id)) {
 					JLOG_DEBUG("Found agent from transaction ID");
 					return agent;
@@ -430,30 +469,46 @@ int conn_mux_process(conn_registry_t *registry, struct pollfd *pfd) {
 	}
 
 	if (pfd->revents & POLLIN) {
-		char buffer[BUFFER_SIZE];
-		addr_record_t src;
+		registry_impl_t *registry_impl = registry->impl;
+		udp_message_t *messages;
 		int ret;
-		while ((ret = conn_mux_recv(registry, buffer, BUFFER_SIZE, &src)) > 0) {
-			if (JLOG_DEBUG_ENABLED) {
-				char src_str[ADDR_MAX_STRING_LEN];
-				addr_record_to_string(&src, src_str, ADDR_MAX_STRING_LEN);
-				JLOG_DEBUG("Demultiplexing incoming datagram from %s", src_str);
-			}
+		while ((ret = conn_mux_recv(registry, &messages)) > 0) {
+			// Agents are updated once after the whole batch, in the loop below
+			timestamp_t now = current_timestamp();
+			for (int i = 0; i < ret; ++i) {
+				udp_message_t *message = messages + i;
+				if (message->len == 0)
+					continue; // empty datagram (used to interrupt)
+
+				if (JLOG_DEBUG_ENABLED) {
+					char src_str[ADDR_MAX_STRING_LEN];
+					addr_record_to_string(&message->src, src_str, ADDR_MAX_STRING_LEN);
+					JLOG_DEBUG("Demultiplexing incoming datagram from %s", src_str);
+				}
 
-			juice_agent_t *agent = lookup_agent(registry, buffer, (size_t)ret, &src);
-			if (!agent || !is_ready(agent)) {
-				JLOG_DEBUG("Agent not found for incoming datagram, dropping");
-				continue;
-			}
+				// Datagrams coalesced by GRO share the source, so the first one finds the agent
+				size_t step = message->segment_size > 0 ? message->segment_size : message->len;
+				size_t segments = (message->len + step - 1) / step;
+				registry_impl->datagrams_received += segments;
+				juice_agent_t *agent = lookup_agent(registry, message->data, step, &message->src);
+				if (!agent || !is_ready(agent)) {
+					JLOG_DEBUG("Agent not found for incoming datagram, dropping");
+					registry_impl->dropped += segments;
+					continue;
+				}
 
-			conn_impl_t *conn_impl = agent->conn_impl;
-			if (agent_conn_recv(agent, buffer, (size_t)ret, &src) != 0) {
-				JLOG_WARN("Agent receive failed");
-				conn_impl->finished = true;
-				continue;
-			}
+				conn_impl_t *conn_impl = agent->conn_impl;
+				for (size_t offset = 0; offset < message->len; offset += step) {
+					size_t len = message->len - offset < step ? message->len - offset : step;
+					if (agent_conn_recv(agent, message->data + offset, len, &message->src) != 0) {
+						JLOG_WARN("Agent receive failed");
+						conn_impl->finished = true;
+						break;
+					}
+				}
 
-			conn_impl->next_timestamp = current_timestamp();
+				conn_impl->next_timestamp = now;
+			}
 		}
 
 		if (ret < 0) {
@@ -481,15 +536,11 @@ int conn_mux_process(conn_registry_t *registry, struct pollfd *pfd) {
 	return 0;
 }
 
-int conn_mux_recv(conn_registry_t *registry, char *buffer, size_t size, addr_record_t *src) {
-	JLOG_VERBOSE("Receiving datagram");
+int conn_mux_recv(conn_registry_t *registry, udp_message_t **messages) {
+	JLOG_VERBOSE("Receiving datagrams");
 	registry_impl_t *registry_impl = registry->impl;
-	int len;
-	while ((len = udp_recvfrom(registry_impl->sock, buffer, size, src)) == 0) {
-		// Empty datagram (used to interrupt)
-	}
-
-	if (len < 0) {
+	int count = udp_recv_batch(registry_impl->sock, registry_impl->recv_batch, messages);
+	if (count < 0) {
 		if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK) {
 			JLOG_VERBOSE("No more datagrams to receive");
 			return 0;
@@ -498,8 +549,7 @@ int conn_mux_recv(conn_registry_t *registry, char *buffer, size_t size, addr_rec
 		return -1;
 	}
 
-	addr_unmap_inet6_v4mapped((struct sockaddr *)&src->addr, &src->len);
-	return len; // len > 0
+	return count; // count > 0, empty datagrams included
 }
 
 void conn_mux_fail(conn_registry_t *registry) {
@@ -643,6 +693,38 @@ int conn_mux_send(juice_agent_t *agent, const addr_record_t *dst, const char *da
 	return ret;
 }
 
+int conn_mux_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                        const juice_iovec_t *msgs, size_t count, int ds) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	registry_impl_t *registry_impl = conn_impl->registry->impl;
+
+	mutex_lock(&registry_impl->send_mutex);
+
+	if (registry_impl->send_ds >= 0 && registry_impl->send_ds != ds) {
+		JLOG_VERBOSE("Setting Differentiated Services field to 0x%X", ds);
+		if (udp_set_diffserv(registry_impl->sock, ds) == 0)
+			registry_impl->send_ds = ds;
+		else
+			registry_impl->send_ds = -1; // disable for next time
+	}
+
+	JLOG_VERBOSE("Sending %d datagrams", (int)count);
+
+	int ret = udp_sendto_batch(registry_impl->sock, msgs, count, dst, &registry_impl->send_gso);
+	if (ret < 0) {
+		ret = -sockerrno;
+		if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK)
+			JLOG_INFO("Send failed, buffer is full");
+		else if (sockerrno == SEMSGSIZE)
+			JLOG_WARN("Send failed, datagram is too large");
+		else
+			JLOG_WARN("Send failed, errno=%d", sockerrno);
+	}
+
+	mutex_unlock(&registry_impl->send_mutex);
+	return ret;
+}
+
 int conn_mux_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size) {
 	conn_impl_t *conn_impl = agent->conn_impl;
 	registry_impl_t *registry_impl = conn_impl->registry->impl;
@@ -686,6 +768,24 @@ int conn_mux_listen(conn_registry_t *registry, juice_cb_mux_incoming_t cb, void
 	return 0;
 }
 
+void conn_mux_get_stats(conn_registry_t *registry, juice_mux_stats_t *stats) {
+	// registry must be locked
+	registry_impl_t *registry_impl = registry->impl;
+	memset(stats, 0, sizeof(*stats));
+	if (!registry_impl)
+		return;
+
+	stats->agents = registry->agents_count;
+	stats->map_size = registry_impl->map_size;
+	stats->map_count = registry_impl->map_count;
+	stats->datagrams_received = registry_impl->datagrams_received;
+	stats->lookups = registry_impl->lookups;
+	stats->map_probes = registry_impl->map_probes;
+	stats->map_misses = registry_impl->map_misses;
+	stats->agents_scanned = registry_impl->agents_scanned;
+	stats->dropped = registry_impl->dropped;
+}
+
 bool conn_mux_can_release_registry(conn_registry_t *registry) {
 	registry_impl_t *registry_impl = registry->impl;
 
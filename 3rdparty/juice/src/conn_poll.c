@@ -6,27 +6,66 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for pthread_setaffinity_np()
+#endif
+
 #include "conn_poll.h"
 #include "agent.h"
 #include "log.h"
 #include "socket.h"
 #include "tcp.h"
 #include "thread.h"
+#include "timerheap.h"
 #include "udp.h"
 
 #include <assert.h>
+#include <stdio.h>
 #include <string.h>
 
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// On Linux, sockets are registered once with epoll instead of being collected into a pollfd array
+// on every iteration, and timers are kept in a min-heap, so a wake-up costs what fired rather than
+// the number of agents sharing the thread
+#if defined(__linux__) && !defined(JUICE_DISABLE_EPOLL)
+#define CONN_POLL_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #define BUFFER_SIZE 4096
+#define RECV_BATCH_SIZE 32
+#define GRO_BATCH_SIZE 8 // of UDP_GRO_BUFFER_SIZE bytes
+
+#ifdef CONN_POLL_EPOLL
+#define EPOLL_EVENTS_SIZE 64
+#define MAX_POLL_TIMEOUT 60000 // msecs
+#define INITIAL_FD_AGENTS_SIZE 64
+#define INITIAL_TIMERS_SIZE 16
+#endif
+
+struct conn_impl;
 
 typedef struct registry_impl {
 	thread_t thread;
+	int index; // in conn_poll_registries
+	int cpu;   // the thread is pinned to, -1 if none
+	udp_batch_t *recv_batch; // used by the connections thread only
+	udp_batch_t *gro_batch;  // for sockets with UDP_GRO, created with the first one
 #ifdef _WIN32
 	socket_t interrupt_sock;
 #else
 	int interrupt_pipe_out;
 	int interrupt_pipe_in;
 #endif
+#ifdef CONN_POLL_EPOLL
+	int epoll_fd;
+	juice_agent_t **fd_agents; // owner of each watched socket, indexed by descriptor
+	int fd_agents_size;
+	timer_heap_t timers; // on next_timestamp
+#endif
 } registry_impl_t;
 
 typedef enum conn_state { CONN_STATE_NEW = 0, CONN_STATE_READY, CONN_STATE_FINISHED } conn_state_t;
@@ -41,9 +80,18 @@ typedef struct conn_impl {
 	uint16_t ice_tcp_len;
 	mutex_t send_mutex;
 	int send_ds;
+	bool send_gso;
+	bool recv_gro;
 	timestamp_t next_timestamp;
+#ifdef CONN_POLL_EPOLL
+	juice_agent_t *agent;
+	heap_timer_t timer; // in the registry timers heap
+#endif
 } conn_impl_t;
 
+#ifdef CONN_POLL_EPOLL
+int conn_poll_process_events(conn_registry_t *registry, struct epoll_event *events, int count);
+#else
 typedef struct pfds_record {
 	struct pollfd *pfds;
 	nfds_t size;
@@ -51,24 +99,159 @@ typedef struct pfds_record {
 
 int conn_poll_prepare(conn_registry_t *registry, pfds_record_t *pfds, timestamp_t *next_timestamp);
 int conn_poll_process(conn_registry_t *registry, pfds_record_t *pfds);
-int conn_poll_recv_udp(socket_t sock, char *buffer, size_t size, addr_record_t *src);
+#endif
+int conn_poll_recv_udp(socket_t sock, udp_batch_t *batch, udp_message_t **messages);
 int conn_poll_run(conn_registry_t *registry);
 
+// Registries by thread index, protected by the POLL mode entry mutex
+static conn_registry_t *conn_poll_registries[JUICE_POLL_MAX_THREADS];
+static juice_poll_config_t conn_poll_config = {1, JUICE_POLL_BALANCE_LEAST_LOADED, false};
+
+static uint32_t mix_affinity_key(uint32_t key) {
+	// Finalizer of MurmurHash3, so that close keys land on different threads
+	key ^= key >> 16;
+	key *= 0x85ebca6b;
+	key ^= key >> 13;
+	key *= 0xc2b2ae35;
+	key ^= key >> 16;
+	return key;
+}
+
+static int select_registry_index(const udp_socket_config_t *config) {
+	int threads = conn_poll_config.threads > 0 ? conn_poll_config.threads : 1;
+	if (conn_poll_config.balance == JUICE_POLL_BALANCE_HASH && config && config->affinity_key)
+		return (int)(mix_affinity_key(config->affinity_key) % (uint32_t)threads);
+
+	// Least loaded, a thread not started yet counts as empty
+	int best = 0;
+	for (int i = 0; i < threads; ++i) {
+		if (!conn_poll_registries[i])
+			return i;
+
+		if (conn_poll_registries[i]->agents_count < conn_poll_registries[best]->agents_count)
+			best = i;
+	}
+	return best;
+}
+
+void conn_poll_set_config(const juice_poll_config_t *config) {
+	// The mode entry is locked
+	conn_poll_config = *config;
+}
+
+conn_registry_t *conn_poll_get_registry(udp_socket_config_t *config) {
+	// The mode entry is locked, so agent counts are stable. NULL makes the caller create the
+	// registry, and conn_poll_registry_init() selects the same index again.
+	return conn_poll_registries[select_registry_index(config)];
+}
+
+static void pin_thread_self(int cpu) {
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	int ret = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (ret)
+		JLOG_WARN("Pinning poll thread to CPU %d failed, error=%d", cpu, ret);
+	else
+		JLOG_DEBUG("Poll thread pinned to CPU %d", cpu);
+#else
+	(void)cpu;
+	JLOG_WARN("Pinning poll threads is not supported on this platform");
+#endif
+}
+
+#ifdef CONN_POLL_EPOLL
+static int watch_socket(registry_impl_t *registry_impl, juice_agent_t *agent, socket_t sock,
+                        uint32_t events) {
+	if (sock >= registry_impl->fd_agents_size) {
+		int new_size = registry_impl->fd_agents_size;
+		while (new_size <= sock)
+			new_size *= 2;
+
+		juice_agent_t **new_fd_agents =
+		    realloc(registry_impl->fd_agents, new_size * sizeof(juice_agent_t *));
+		if (!new_fd_agents) {
+			JLOG_FATAL("Memory reallocation failed for epoll descriptors map");
+			return -1;
+		}
+		memset(new_fd_agents + registry_impl->fd_agents_size, 0,
+		       (new_size - registry_impl->fd_agents_size) * sizeof(juice_agent_t *));
+		registry_impl->fd_agents = new_fd_agents;
+		registry_impl->fd_agents_size = new_size;
+	}
+
+	struct epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = events;
+	event.data.fd = sock;
+	if (epoll_ctl(registry_impl->epoll_fd, EPOLL_CTL_ADD, sock, &event)) {
+		JLOG_ERROR("epoll_ctl add failed, errno=%d", errno);
+		return -1;
+	}
+
+	registry_impl->fd_agents[sock] = agent;
+	return 0;
+}
+
+static void unwatch_socket(registry_impl_t *registry_impl, socket_t sock) {
+	if (sock == INVALID_SOCKET || sock >= registry_impl->fd_agents_size ||
+	    !registry_impl->fd_agents[sock])
+		return;
+
+	epoll_ctl(registry_impl->epoll_fd, EPOLL_CTL_DEL, sock, NULL);
+	registry_impl->fd_agents[sock] = NULL;
+}
+
+// A finished connection is left alone until it is destroyed
+static void conn_poll_reschedule(registry_impl_t *registry_impl, conn_impl_t *conn_impl) {
+	if (conn_impl->state == CONN_STATE_FINISHED) {
+		unwatch_socket(registry_impl, conn_impl->udp_sock);
+		unwatch_socket(registry_impl, conn_impl->tcp_sock);
+		timer_heap_remove(&registry_impl->timers, &conn_impl->timer);
+		return;
+	}
+
+	timer_heap_update(&registry_impl->timers, &conn_impl->timer);
+}
+#endif
+
 static thread_return_t THREAD_CALL conn_thread_entry(void *arg) {
-	thread_set_name_self("juice poll");
 	conn_registry_t *registry = (conn_registry_t *)arg;
+	registry_impl_t *registry_impl = registry->impl;
+	if (registry_impl->index == 0) {
+		thread_set_name_self("juice poll");
+	} else {
+		char name[16];
+		snprintf(name, sizeof(name), "juice poll %d", registry_impl->index);
+		thread_set_name_self(name);
+	}
+	if (registry_impl->cpu >= 0)
+		pin_thread_self(registry_impl->cpu);
+
 	conn_poll_run(registry);
 	return (thread_return_t)0;
 }
 
 int conn_poll_registry_init(conn_registry_t *registry, udp_socket_config_t *config) {
-	(void)config;
 	registry_impl_t *registry_impl = calloc(1, sizeof(registry_impl_t));
 	if (!registry_impl) {
 		JLOG_FATAL("Memory allocation failed for connections registry impl");
 		return -1;
 	}
 
+	registry_impl->index = select_registry_index(config);
+	assert(!conn_poll_registries[registry_impl->index]);
+	registry_impl->cpu = -1;
+	if (conn_poll_config.pin_threads) {
+#ifdef __linux__
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		registry_impl->cpu = registry_impl->index % (cpus > 0 ? (int)cpus : 1);
+#else
+		registry_impl->cpu = registry_impl->index;
+#endif
+	}
+
 #ifdef _WIN32
 	udp_socket_config_t interrupt_config;
 	memset(&interrupt_config, 0, sizeof(interrupt_config));
@@ -93,18 +276,57 @@ int conn_poll_registry_init(conn_registry_t *registry, udp_socket_config_t *conf
 	registry_impl->interrupt_pipe_in = pipefds[0];  // write
 #endif
 
+	registry_impl->recv_batch = udp_batch_create(RECV_BATCH_SIZE, BUFFER_SIZE);
+	if (!registry_impl->recv_batch)
+		goto error;
+
+#ifdef CONN_POLL_EPOLL
+	registry_impl->epoll_fd = -1;
+	registry_impl->fd_agents = calloc(INITIAL_FD_AGENTS_SIZE, sizeof(juice_agent_t *));
+	registry_impl->fd_agents_size = INITIAL_FD_AGENTS_SIZE;
+	if (!registry_impl->fd_agents ||
+	    timer_heap_init(&registry_impl->timers, INITIAL_TIMERS_SIZE)) {
+		JLOG_FATAL("Memory allocation failed for epoll registry");
+		goto error;
+	}
+
+	registry_impl->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (registry_impl->epoll_fd < 0) {
+		JLOG_FATAL("epoll creation failed, errno=%d", errno);
+		goto error;
+	}
+
+	struct epoll_event interrupt_event;
+	memset(&interrupt_event, 0, sizeof(interrupt_event));
+	interrupt_event.events = EPOLLIN;
+	interrupt_event.data.fd = registry_impl->interrupt_pipe_in;
+	if (epoll_ctl(registry_impl->epoll_fd, EPOLL_CTL_ADD, registry_impl->interrupt_pipe_in,
+	              &interrupt_event)) {
+		JLOG_FATAL("epoll_ctl add failed for interrupt pipe, errno=%d", errno);
+		goto error;
+	}
+#endif
+
 	registry->impl = registry_impl;
 
-	JLOG_DEBUG("Starting connections thread");
+	JLOG_DEBUG("Starting connections thread %d", registry_impl->index);
 	int ret = thread_init(&registry_impl->thread, conn_thread_entry, registry);
 	if (ret) {
 		JLOG_FATAL("Thread creation failed, error=%d", ret);
 		goto error;
 	}
 
+	conn_poll_registries[registry_impl->index] = registry;
 	return 0;
 
 error:
+	udp_batch_destroy(registry_impl->recv_batch);
+#ifdef CONN_POLL_EPOLL
+	if (registry_impl->epoll_fd >= 0)
+		close(registry_impl->epoll_fd);
+	free(registry_impl->fd_agents);
+	timer_heap_cleanup(&registry_impl->timers);
+#endif
 #ifndef _WIN32
 	close(registry_impl->interrupt_pipe_out);
 	close(registry_impl->interrupt_pipe_in);
@@ -120,16 +342,27 @@ void conn_poll_registry_cleanup(conn_registry_t *registry) {
 	JLOG_VERBOSE("Waiting for connections thread");
 	thread_join(registry_impl->thread, NULL);
 
+	assert(conn_poll_registries[registry_impl->index] == registry);
+	conn_poll_registries[registry_impl->index] = NULL;
+
 #ifdef _WIN32
 	closesocket(registry_impl->interrupt_sock);
 #else
 	close(registry_impl->interrupt_pipe_out);
 	close(registry_impl->interrupt_pipe_in);
 #endif
+#ifdef CONN_POLL_EPOLL
+	close(registry_impl->epoll_fd);
+	free(registry_impl->fd_agents);
+	timer_heap_cleanup(&registry_impl->timers);
+#endif
+	udp_batch_destroy(registry_impl->recv_batch);
+	udp_batch_destroy(registry_impl->gro_batch);
 	free(registry->impl);
 	registry->impl = NULL;
 }
 
+#ifndef CONN_POLL_EPOLL
 int conn_poll_prepare(conn_registry_t *registry, pfds_record_t *pfds, timestamp_t *next_timestamp) {
 	timestamp_t now = current_timestamp();
 	*next_timestamp = now + 60000;
@@ -214,15 +447,12 @@ error:
 	mutex_unlock(&registry->mutex);
 	return -1;
 }
+#endif
 
-int conn_poll_recv_udp(socket_t sock, char *buffer, size_t size, addr_record_t *src) {
-	JLOG_VERBOSE("Receiving datagram");
-	int len;
-	while ((len = udp_recvfrom(sock, buffer, size, src)) == 0) {
-		// Empty datagram, ignore
-	}
-
-	if (len < 0) {
+int conn_poll_recv_udp(socket_t sock, udp_batch_t *batch, udp_message_t **messages) {
+	JLOG_VERBOSE("Receiving datagrams");
+	int count = udp_recv_batch(sock, batch, messages);
+	if (count < 0) {
 		if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK) {
 			JLOG_VERBOSE("No more datagrams to receive");
 			return 0;
@@ -231,8 +461,7 @@ int conn_poll_recv_udp(socket_t sock, char *buffer, size_t size, addr_record_t *
 		return -1;
 	}
 
-	addr_unmap_inet6_v4mapped((struct sockaddr *)&src->addr, &src->len);
-	return len; // len > 0
+	return count; // count > 0, empty datagrams included
 }
 
 void conn_poll_process_udp(juice_agent_t *agent, conn_impl_t *conn_impl, struct pollfd *pfd) {
@@ -242,20 +471,29 @@ void conn_poll_process_udp(juice_agent_t *agent, conn_impl_t *conn_impl, struct
 	}
 
 	if (pfd->revents & POLLIN) {
-		char buffer[BUFFER_SIZE];
-		addr_record_t src;
+		registry_impl_t *registry_impl = conn_impl->registry->impl;
+		udp_batch_t *batch =
+		    conn_impl->recv_gro ? registry_impl->gro_batch : registry_impl->recv_batch;
+		udp_message_t *messages;
 		int ret = 0;
 		int left = 1000; // limit for fairness between sockets
-		while (left--) {
-			if ((ret = conn_poll_recv_udp(conn_impl->udp_sock, buffer, BUFFER_SIZE,
-							&src)) <= 0) {
+		while (left > 0 && conn_impl->state != CONN_STATE_FINISHED) {
+			if ((ret = conn_poll_recv_udp(conn_impl->udp_sock, batch, &messages)) <= 0)
 				break;
-			}
 
-			if (agent_conn_recv(agent, buffer, (size_t)ret, &src) != 0) {
-				JLOG_WARN("Agent receive failed");
-				conn_impl->state = CONN_STATE_FINISHED;
-				break;
+			left -= ret;
+			for (int i = 0; i < ret && conn_impl->state != CONN_STATE_FINISHED; ++i) {
+				// Split datagrams coalesced by GRO, an empty datagram is ignored
+				udp_message_t *message = messages + i;
+				size_t step = message->segment_size > 0 ? message->segment_size : message->len;
+				for (size_t offset = 0; offset < message->len; offset += step) {
+					size_t len = message->len - offset < step ? message->len - offset : step;
+					if (agent_conn_recv(agent, message->data + offset, len, &message->src) != 0) {
+						JLOG_WARN("Agent receive failed");
+						conn_impl->state = CONN_STATE_FINISHED;
+						break;
+					}
+				}
 			}
 		}
 
@@ -341,6 +579,114 @@ void conn_poll_process_tcp(juice_agent_t *agent, conn_impl_t *conn_impl, struct
 	}
 }
 
+#ifdef CONN_POLL_EPOLL
+int conn_poll_process_events(conn_registry_t *registry, struct epoll_event *events, int count) {
+	registry_impl_t *registry_impl = registry->impl;
+
+	mutex_lock(&registry->mutex);
+
+	for (int i = 0; i < count; ++i) {
+		socket_t sock = events[i].data.fd;
+		if (sock == registry_impl->interrupt_pipe_in) {
+			char dummy;
+			while (read(sock, &dummy, 1) > 0) {
+				// Ignore
+			}
+			continue;
+		}
+
+		// The socket may have been unwatched, or even closed and reused, since epoll_wait returned
+		juice_agent_t *agent =
+		    sock < registry_impl->fd_agents_size ? registry_impl->fd_agents[sock] : NULL;
+		if (!agent)
+			continue;
+
+		conn_impl_t *conn_impl = agent->conn_impl;
+
+		// epoll event bits have the values of their poll counterparts
+		struct pollfd pfd;
+		pfd.fd = sock;
+		pfd.events = 0;
+		pfd.revents = (short)events[i].events;
+		if (sock == conn_impl->udp_sock) {
+			conn_poll_process_udp(agent, conn_impl, &pfd);
+		} else {
+			conn_poll_process_tcp(agent, conn_impl, &pfd);
+			if (conn_impl->state != CONN_STATE_FINISHED && (events[i].events & EPOLLOUT) &&
+			    !conn_impl->tcp_sock_connected) {
+				struct epoll_event event;
+				memset(&event, 0, sizeof(event));
+				event.events = EPOLLIN;
+				event.data.fd = sock;
+				epoll_ctl(registry_impl->epoll_fd, EPOLL_CTL_MOD, sock, &event);
+			}
+		}
+
+		conn_poll_reschedule(registry_impl, conn_impl);
+	}
+
+	// Timers of the connections that have nothing to read, each at most once per wake-up
+	timestamp_t now = current_timestamp();
+	heap_timer_t *timer;
+	int left = registry_impl->timers.count;
+	while (left-- > 0 && (timer = timer_heap_top(&registry_impl->timers)) &&
+	       *timer->timestamp <= now) {
+		conn_impl_t *conn_impl = timer->user_ptr;
+		if (agent_conn_update(conn_impl->agent, &conn_impl->next_timestamp) != 0) {
+			JLOG_WARN("Agent update failed");
+			conn_impl->state = CONN_STATE_FINISHED;
+		}
+
+		conn_poll_reschedule(registry_impl, conn_impl);
+	}
+
+	mutex_unlock(&registry->mutex);
+	return 0;
+}
+
+int conn_poll_run(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+	struct epoll_event events[EPOLL_EVENTS_SIZE];
+	while (true) {
+		mutex_lock(&registry->mutex);
+		if (registry->agents_count == 0) {
+			mutex_unlock(&registry->mutex);
+			break;
+		}
+
+		timediff_t timediff = MAX_POLL_TIMEOUT;
+		heap_timer_t *timer = timer_heap_top(&registry_impl->timers);
+		if (timer) {
+			timediff = *timer->timestamp - current_timestamp();
+			if (timediff < 0)
+				timediff = 0;
+			else if (timediff > MAX_POLL_TIMEOUT)
+				timediff = MAX_POLL_TIMEOUT;
+		}
+		mutex_unlock(&registry->mutex);
+
+		JLOG_VERBOSE("Entering epoll for %d ms", (int)timediff);
+		int count = epoll_wait(registry_impl->epoll_fd, events, EPOLL_EVENTS_SIZE, (int)timediff);
+		JLOG_VERBOSE("Leaving epoll");
+		if (count < 0) {
+			if (errno == EINTR) {
+				JLOG_VERBOSE("epoll interrupted");
+				continue;
+			} else {
+				JLOG_FATAL("epoll_wait failed, errno=%d", errno);
+				break;
+			}
+		}
+
+		if (conn_poll_process_events(registry, events, count) < 0)
+			break;
+	}
+
+	JLOG_DEBUG("Leaving connections thread");
+	return 0;
+}
+
+#else
 int conn_poll_process(conn_registry_t *registry, pfds_record_t *pfds) {
 	struct pollfd *interrupt_pfd = pfds->pfds;
 	if (interrupt_pfd->revents & POLLIN) {
@@ -429,6 +775,7 @@ int conn_poll_run(conn_registry_t *registry) {
 	free(pfds.pfds);
 	return 0;
 }
+#endif
 
 int conn_poll_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config) {
 	conn_impl_t *conn_impl = calloc(1, sizeof(conn_impl_t));
@@ -449,6 +796,33 @@ int conn_poll_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_c
 	conn_impl->tcp_sock = INVALID_SOCKET;
 	conn_impl->tcp_sock_connected = NULL;
 
+	registry_impl_t *registry_impl = registry->impl;
+	if (config->enable_offload) {
+		conn_impl->send_gso = udp_enable_gso(conn_impl->udp_sock) == 0;
+		// The registry is locked, so the batch may be created here
+		if (!registry_impl->gro_batch)
+			registry_impl->gro_batch = udp_batch_create(GRO_BATCH_SIZE, UDP_GRO_BUFFER_SIZE);
+		conn_impl->recv_gro =
+		    registry_impl->gro_batch && udp_enable_gro(conn_impl->udp_sock) == 0;
+		JLOG_DEBUG("UDP offload: segmentation %s, receive %s",
+		           conn_impl->send_gso ? "enabled" : "unavailable",
+		           conn_impl->recv_gro ? "enabled" : "unavailable");
+	}
+
+#ifdef CONN_POLL_EPOLL
+	// The registry is locked, next_timestamp is zero so the agent is updated on the next wake-up
+	conn_impl->agent = agent;
+	heap_timer_init(&conn_impl->timer, &conn_impl->next_timestamp, conn_impl);
+	if (watch_socket(registry_impl, agent, conn_impl->udp_sock, EPOLLIN) ||
+	    timer_heap_schedule(&registry_impl->timers, &conn_impl->timer)) {
+		unwatch_socket(registry_impl, conn_impl->udp_sock);
+		mutex_destroy(&conn_impl->send_mutex);
+		closesocket(conn_impl->udp_sock);
+		free(conn_impl);
+		return -1;
+	}
+#endif
+
 	agent->conn_impl = conn_impl;
 	return 0;
 }
@@ -458,6 +832,15 @@ void conn_poll_cleanup(juice_agent_t *agent) {
 
 	conn_poll_interrupt(agent);
 
+#ifdef CONN_POLL_EPOLL
+	registry_impl_t *registry_impl = conn_impl->registry->impl;
+	mutex_lock(&conn_impl->registry->mutex);
+	unwatch_socket(registry_impl, conn_impl->udp_sock);
+	unwatch_socket(registry_impl, conn_impl->tcp_sock);
+	timer_heap_remove(&registry_impl->timers, &conn_impl->timer);
+	mutex_unlock(&conn_impl->registry->mutex);
+#endif
+
 	mutex_destroy(&conn_impl->send_mutex);
 	closesocket(conn_impl->udp_sock);
 	closesocket(conn_impl->tcp_sock);
@@ -484,6 +867,9 @@ int conn_poll_interrupt(juice_agent_t *agent) {
 
 	mutex_lock(&registry->mutex);
 	conn_impl->next_timestamp = current_timestamp();
+#ifdef CONN_POLL_EPOLL
+	timer_heap_update(&registry_impl->timers, &conn_impl->timer);
+#endif
 	mutex_unlock(&registry->mutex);
 
 	JLOG_VERBOSE("Interrupting connections thread");
@@ -542,6 +928,37 @@ int conn_poll_send(juice_agent_t *agent, const addr_record_t *dst, const char *d
 	return ret;
 }
 
+int conn_poll_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                         const juice_iovec_t *msgs, size_t count, int ds) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+
+	mutex_lock(&conn_impl->send_mutex);
+
+	if (conn_impl->send_ds >= 0 && conn_impl->send_ds != ds) {
+		JLOG_VERBOSE("Setting Differentiated Services field to 0x%X", ds);
+		if (udp_set_diffserv(conn_impl->udp_sock, ds) == 0)
+			conn_impl->send_ds = ds;
+		else
+			conn_impl->send_ds = -1; // disable for next time
+	}
+
+	JLOG_VERBOSE("Sending %d datagrams", (int)count);
+
+	int ret = udp_sendto_batch(conn_impl->udp_sock, msgs, count, dst, &conn_impl->send_gso);
+	if (ret < 0) {
+		ret = -sockerrno;
+		if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK)
+			JLOG_INFO("Send failed, buffer is full");
+		else if (sockerrno == SEMSGSIZE)
+			JLOG_WARN("Send failed, datagram is too large");
+		else
+			JLOG_WARN("Send failed, errno=%d", sockerrno);
+	}
+
+	mutex_unlock(&conn_impl->send_mutex);
+	return ret;
+}
+
 void conn_poll_tcp_connect_func(juice_agent_t *agent, const addr_record_t *dst, void (*callback)(juice_agent_t *)) {
 	conn_impl_t *conn_impl = agent->conn_impl;
 
@@ -551,6 +968,14 @@ void conn_poll_tcp_connect_func(juice_agent_t *agent, const addr_record_t *dst,
 		conn_impl->tcp_sock = tcp_create_socket(dst);
 		memcpy(&conn_impl->tcp_dst, dst, sizeof(conn_impl->tcp_dst));
 		conn_impl->tcp_sock_connected = callback;
+#ifdef CONN_POLL_EPOLL
+		if (conn_impl->tcp_sock != INVALID_SOCKET &&
+		    watch_socket(conn_impl->registry->impl, agent, conn_impl->tcp_sock,
+		                 EPOLLIN | EPOLLOUT)) {
+			closesocket(conn_impl->tcp_sock);
+			conn_impl->tcp_sock = INVALID_SOCKET;
+		}
+#endif
 	}
 	mutex_unlock(&conn_impl->send_mutex);
 	mutex_unlock(&conn_impl->registry->mutex);
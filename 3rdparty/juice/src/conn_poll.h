@@ -19,6 +19,8 @@
 
 int conn_poll_registry_init(conn_registry_t *registry, udp_socket_config_t *config);
 void conn_poll_registry_cleanup(conn_registry_t *registry);
+void conn_poll_set_config(const juice_poll_config_t *config);
+conn_registry_t *conn_poll_get_registry(udp_socket_config_t *config);
 
 int conn_poll_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config);
 void conn_poll_cleanup(juice_agent_t *agent);
@@ -27,6 +29,8 @@ void conn_poll_unlock(juice_agent_t *agent);
 int conn_poll_interrupt(juice_agent_t *agent);
 int conn_poll_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
                         int ds);
+int conn_poll_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                         const juice_iovec_t *msgs, size_t count, int ds);
 void conn_poll_tcp_connect_func(juice_agent_t *agent, const addr_record_t *dst, void (*callback)(juice_agent_t *)) ;
 int conn_poll_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size);
 
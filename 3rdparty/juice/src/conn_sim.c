@@ -0,0 +1,827 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "conn_sim.h"
+#include "agent.h"
+#include "log.h"
+#include "socket.h"
+#include "stun.h"
+#include "thread.h"
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BUFFER_SIZE 4096
+#define MAX_DATAGRAM_SIZE 65507
+#define INITIAL_EVENTS_SIZE 64
+#define INITIAL_MAP_SIZE 64
+#define INITIAL_BINDINGS_SIZE 4
+#define FIRST_EPHEMERAL_PORT 10000
+
+// Arbitrary non-zero origin of the virtual clock, as 0 switches current_timestamp() back to the
+// monotonic clock
+#define VIRTUAL_EPOCH 1000000
+
+typedef struct sim_nat sim_nat_t;
+
+// A datagram in flight, addressed as seen on the wire: the source is already translated by the
+// sender NAT, the destination is translated by the receiver NAT on delivery
+typedef struct sim_datagram {
+	addr_record_t src;
+	addr_record_t dst;
+	sim_nat_t *lan; // NAT of the sender, only hosts behind it can receive on a private address
+	size_t size;
+	char data[];
+} sim_datagram_t;
+
+typedef struct sim_event {
+	timestamp_t timestamp;
+	uint64_t seq;             // events due at the same time run in scheduling order
+	sim_datagram_t *datagram; // NULL for an agent timer
+	int agent_index;          // index in the registry for an agent timer
+} sim_event_t;
+
+// Open addressing with linear probing, values are never NULL
+typedef struct sim_map_entry {
+	addr_record_t key;
+	void *value; // NULL if the slot is free
+} sim_map_entry_t;
+
+typedef struct sim_map {
+	sim_map_entry_t *entries;
+	int size; // power of two
+	int count;
+	bool with_port;
+} sim_map_t;
+
+// Created by each outgoing flow, it is both the port mapping and the filtering state
+typedef struct sim_binding {
+	addr_record_t internal;
+	addr_record_t remote;
+	uint16_t external_port;
+} sim_binding_t;
+
+struct sim_nat {
+	addr_record_t public_address;
+	juice_sim_nat_type_t type;
+	sim_binding_t *bindings;
+	int bindings_size;
+	int bindings_count;
+	uint16_t next_port;
+};
+
+typedef struct registry_impl {
+	bool running;
+	int latency_ms;
+	int jitter_ms;
+	double loss;
+	bool has_stun_server;
+	addr_record_t stun_server;
+	uint64_t random_state;
+	timestamp_t now;
+	timestamp_t start;
+	uint64_t next_seq;
+	sim_event_t *events; // binary min-heap on (timestamp, seq)
+	int events_size;
+	int events_count;
+	sim_map_t endpoints; // bound host address and port to agent
+	sim_map_t hosts;     // host address to NAT
+	sim_map_t publics;   // NAT public address to NAT
+	sim_nat_t **nats;
+	int nats_size;
+	int nats_count;
+	uint16_t next_port;
+	juice_sim_stats_t stats;
+} registry_impl_t;
+
+typedef struct conn_impl {
+	conn_registry_t *registry;
+	addr_record_t address;
+	timestamp_t next_timestamp;
+	timestamp_t timer_timestamp; // earliest timer event queued, 0 if none
+	bool finished;
+} conn_impl_t;
+
+static int map_find_slot(const sim_map_t *map, const addr_record_t *key) {
+	int mask = map->size - 1;
+	// Simulated hosts are typically numbered sequentially
+	int pos = (int)(addr_record_map_hash(key, map->with_port) & (unsigned long)mask);
+	while (map->entries[pos].value &&
+	       !addr_record_is_equal(&map->entries[pos].key, key, map->with_port))
+		pos = (pos + 1) & mask;
+
+	return pos;
+}
+
+static void *map_get(const sim_map_t *map, const addr_record_t *key) {
+	if (!map->entries)
+		return NULL;
+
+	return map->entries[map_find_slot(map, key)].value;
+}
+
+static int map_set(sim_map_t *map, const addr_record_t *key, void *value) {
+	assert(value);
+	if ((map->count + 1) * 2 > map->size) {
+		int new_size = map->size ? map->size * 2 : INITIAL_MAP_SIZE;
+		sim_map_entry_t *new_entries = calloc(new_size, sizeof(sim_map_entry_t));
+		if (!new_entries) {
+			JLOG_FATAL("Memory allocation failed for simulated address map");
+			return -1;
+		}
+
+		sim_map_t grown = *map;
+		grown.entries = new_entries;
+		grown.size = new_size;
+		for (int i = 0; i < map->size; ++i) {
+			if (map->entries[i].value)
+				grown.entries[map_find_slot(&grown, &map->entries[i].key)] = map->entries[i];
+		}
+		free(map->entries);
+		*map = grown;
+	}
+
+	sim_map_entry_t *entry = map->entries + map_find_slot(map, key);
+	if (!entry->value)
+		++map->count;
+
+	entry->key = *key;
+	entry->value = value;
+	return 0;
+}
+
+static void map_remove(sim_map_t *map, const addr_record_t *key) {
+	if (!map->entries)
+		return;
+
+	int mask = map->size - 1;
+	int pos = map_find_slot(map, key);
+	if (!map->entries[pos].value)
+		return;
+
+	// Backward shift deletion: move up the following entries which would not be reachable anymore
+	int next = (pos + 1) & mask;
+	while (map->entries[next].value) {
+		unsigned long hash = addr_record_map_hash(&map->entries[next].key, map->with_port);
+		int home = (int)(hash & (unsigned long)mask);
+		if (((next - home) & mask) >= ((next - pos) & mask)) {
+			map->entries[pos] = map->entries[next];
+			pos = next;
+		}
+		next = (next + 1) & mask;
+	}
+	map->entries[pos].value = NULL;
+	--map->count;
+}
+
+static void map_destroy(sim_map_t *map) {
+	free(map->entries);
+	map->entries = NULL;
+	map->size = 0;
+	map->count = 0;
+}
+
+// splitmix64, so runs only depend on the configured seed
+static uint64_t random_next(registry_impl_t *impl) {
+	uint64_t z = (impl->random_state += 0x9e3779b97f4a7c15ULL);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+static double random_unit(registry_impl_t *impl) {
+	return (double)(random_next(impl) >> 11) / (double)(1ULL << 53);
+}
+
+static bool event_before(const sim_event_t *a, const sim_event_t *b) {
+	return a->timestamp < b->timestamp || (a->timestamp == b->timestamp && a->seq < b->seq);
+}
+
+static int push_event(registry_impl_t *impl, timestamp_t timestamp, sim_datagram_t *datagram,
+                      int agent_index) {
+	if (impl->events_count == impl->events_size) {
+		int new_size = impl->events_size ? impl->events_size * 2 : INITIAL_EVENTS_SIZE;
+		sim_event_t *new_events = realloc(impl->events, new_size * sizeof(sim_event_t));
+		if (!new_events) {
+			JLOG_FATAL("Memory reallocation failed for simulated events");
+			return -1;
+		}
+		impl->events = new_events;
+		impl->events_size = new_size;
+	}
+
+	sim_event_t event;
+	event.timestamp = timestamp;
+	event.seq = impl->next_seq++;
+	event.datagram = datagram;
+	event.agent_index = agent_index;
+
+	int i = impl->events_count++;
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (!event_before(&event, impl->events + parent))
+			break;
+
+		impl->events[i] = impl->events[parent];
+		i = parent;
+	}
+	impl->events[i] = event;
+	return 0;
+}
+
+static void pop_event(registry_impl_t *impl, sim_event_t *event) {
+	assert(impl->events_count > 0);
+	*event = impl->events[0];
+
+	sim_event_t last = impl->events[--impl->events_count];
+	int count = impl->events_count;
+	int i = 0;
+	while (true) {
+		int child = 2 * i + 1;
+		if (child >= count)
+			break;
+
+		if (child + 1 < count && event_before(impl->events + child + 1, impl->events + child))
+			++child;
+
+		if (!event_before(impl->events + child, &last))
+			break;
+
+		impl->events[i] = impl->events[child];
+		i = child;
+	}
+	if (count > 0)
+		impl->events[i] = last;
+}
+
+static void drop_events(registry_impl_t *impl) {
+	for (int i = 0; i < impl->events_count; ++i)
+		free(impl->events[i].datagram);
+
+	impl->events_count = 0;
+}
+
+static int parse_address(const char *address, uint16_t port, addr_record_t *record) {
+	if (!address || !addr_is_numeric_hostname(address)) {
+		JLOG_ERROR("Simulated addresses must be numeric");
+		return -1;
+	}
+
+	char service[8];
+	snprintf(service, 8, "%hu", port);
+	if (addr_resolve(address, service, SOCK_DGRAM, record, 1) <= 0) {
+		JLOG_ERROR("Invalid simulated address: %s", address);
+		return -1;
+	}
+
+	return 0;
+}
+
+static sim_nat_t *get_or_create_nat(registry_impl_t *impl, const addr_record_t *public_address,
+                                    juice_sim_nat_type_t type) {
+	sim_nat_t *nat = map_get(&impl->publics, public_address);
+	if (nat) {
+		nat->type = type;
+		return nat;
+	}
+
+	if (impl->nats_count == impl->nats_size) {
+		int new_size = impl->nats_size ? impl->nats_size * 2 : INITIAL_MAP_SIZE;
+		sim_nat_t **new_nats = realloc(impl->nats, new_size * sizeof(sim_nat_t *));
+		if (!new_nats) {
+			JLOG_FATAL("Memory reallocation failed for simulated NATs");
+			return NULL;
+		}
+		impl->nats = new_nats;
+		impl->nats_size = new_size;
+	}
+
+	nat = calloc(1, sizeof(sim_nat_t));
+	if (!nat) {
+		JLOG_FATAL("Memory allocation failed for simulated NAT");
+		return NULL;
+	}
+
+	nat->public_address = *public_address;
+	nat->type = type;
+	nat->next_port = FIRST_EPHEMERAL_PORT;
+	if (map_set(&impl->publics, public_address, nat)) {
+		free(nat);
+		return NULL;
+	}
+
+	impl->nats[impl->nats_count++] = nat;
+	return nat;
+}
+
+static void destroy_nats(registry_impl_t *impl) {
+	for (int i = 0; i < impl->nats_count; ++i) {
+		free(impl->nats[i]->bindings);
+		free(impl->nats[i]);
+	}
+	free(impl->nats);
+	impl->nats = NULL;
+	impl->nats_size = 0;
+	impl->nats_count = 0;
+	map_destroy(&impl->hosts);
+	map_destroy(&impl->publics);
+}
+
+// Returns the source address of a datagram from internal to remote as seen outside the NAT
+static int translate_outbound(registry_impl_t *impl, const addr_record_t *internal,
+                              const addr_record_t *remote, addr_record_t *external) {
+	sim_nat_t *nat = map_get(&impl->hosts, internal);
+	if (!nat) {
+		*external = *internal;
+		return 0;
+	}
+
+	bool dependent_mapping = nat->type == JUICE_SIM_NAT_SYMMETRIC;
+	uint16_t port = 0;
+	bool found = false;
+	for (int i = 0; i < nat->bindings_count; ++i) {
+		sim_binding_t *binding = nat->bindings + i;
+		if (!addr_record_is_equal(&binding->internal, internal, true))
+			continue;
+
+		if (addr_record_is_equal(&binding->remote, remote, true)) {
+			port = binding->external_port;
+			found = true;
+			break;
+		}
+		if (!dependent_mapping)
+			port = binding->external_port;
+	}
+
+	if (!found) {
+		if (port == 0) {
+			port = nat->next_port++;
+			if (nat->next_port == 0)
+				nat->next_port = FIRST_EPHEMERAL_PORT;
+		}
+
+		if (nat->bindings_count == nat->bindings_size) {
+			int new_size = nat->bindings_size ? nat->bindings_size * 2 : INITIAL_BINDINGS_SIZE;
+			sim_binding_t *new_bindings =
+			    realloc(nat->bindings, new_size * sizeof(sim_binding_t));
+			if (!new_bindings) {
+				JLOG_FATAL("Memory reallocation failed for simulated NAT bindings");
+				return -1;
+			}
+			nat->bindings = new_bindings;
+			nat->bindings_size = new_size;
+		}
+
+		sim_binding_t *binding = nat->bindings + nat->bindings_count++;
+		binding->internal = *internal;
+		binding->remote = *remote;
+		binding->external_port = port;
+	}
+
+	*external = nat->public_address;
+	addr_set_port((struct sockaddr *)&external->addr, port);
+	return 0;
+}
+
+// Returns false if the NAT in front of external filters datagrams from remote
+static bool translate_inbound(registry_impl_t *impl, const addr_record_t *remote,
+                              const addr_record_t *external, addr_record_t *internal) {
+	sim_nat_t *nat = map_get(&impl->publics, external);
+	if (!nat) {
+		*internal = *external;
+		return true;
+	}
+
+	uint16_t port = addr_get_port((const struct sockaddr *)&external->addr);
+	for (int i = 0; i < nat->bindings_count; ++i) {
+		sim_binding_t *binding = nat->bindings + i;
+		if (binding->external_port != port)
+			continue;
+
+		bool allowed;
+		switch (nat->type) {
+		case JUICE_SIM_NAT_FULL_CONE:
+			allowed = true;
+			break;
+		case JUICE_SIM_NAT_RESTRICTED_CONE:
+			allowed = addr_record_is_equal(&binding->remote, remote, false);
+			break;
+		default:
+			allowed = addr_record_is_equal(&binding->remote, remote, true);
+			break;
+		}
+		if (allowed) {
+			*internal = binding->internal;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static int send_datagram(registry_impl_t *impl, const addr_record_t *src, const addr_record_t *dst,
+                         const char *data, size_t size) {
+	++impl->stats.datagrams_sent;
+
+	// Hosts behind the same NAT talk directly
+	sim_nat_t *lan = map_get(&impl->hosts, src);
+	addr_record_t external = *src;
+	if ((!lan || lan != map_get(&impl->hosts, dst)) &&
+	    translate_outbound(impl, src, dst, &external))
+		return -1;
+
+	if (impl->loss > 0 && random_unit(impl) < impl->loss) {
+		JLOG_VERBOSE("Simulated datagram lost");
+		++impl->stats.datagrams_lost;
+		return 0;
+	}
+
+	sim_datagram_t *datagram = malloc(sizeof(sim_datagram_t) + size);
+	if (!datagram) {
+		JLOG_FATAL("Memory allocation failed for simulated datagram");
+		return -1;
+	}
+	datagram->src = external;
+	datagram->dst = *dst;
+	datagram->lan = lan;
+	datagram->size = size;
+	memcpy(datagram->data, data, size);
+
+	timediff_t delay = impl->latency_ms;
+	if (impl->jitter_ms > 0)
+		delay += (timediff_t)(random_next(impl) % (uint64_t)(impl->jitter_ms + 1));
+
+	if (push_event(impl, impl->now + delay, datagram, -1)) {
+		free(datagram);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void answer_stun(registry_impl_t *impl, sim_datagram_t *datagram) {
+	stun_message_t msg;
+	if (!is_stun_datagram(datagram->data, datagram->size) ||
+	    stun_read(datagram->data, datagram->size, &msg) < 0 ||
+	    msg.msg_class != STUN_CLASS_REQUEST || msg.msg_method != STUN_METHOD_BINDING) {
+		JLOG_DEBUG("Simulated STUN server ignored a datagram");
+		return;
+	}
+
+	stun_message_t ans;
+	memset(&ans, 0, sizeof(ans));
+	ans.msg_class = STUN_CLASS_RESP_SUCCESS;
+	ans.msg_method = STUN_METHOD_BINDING;
+	ans.mapped = datagram->src;
+	memcpy(ans.transaction_id, msg.transaction_id, STUN_TRANSACTION_ID_SIZE);
+
+	char buffer[BUFFER_SIZE];
+	int size = stun_write(buffer, BUFFER_SIZE, &ans, NULL);
+	if (size <= 0) {
+		JLOG_ERROR("STUN message write failed");
+		return;
+	}
+
+	send_datagram(impl, &impl->stun_server, &datagram->src, buffer, size);
+}
+
+static void schedule_timer(registry_impl_t *impl, juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	if (conn_impl->finished)
+		return;
+
+	// A timer event due no later fires first and schedules again
+	if (conn_impl->timer_timestamp && conn_impl->timer_timestamp <= conn_impl->next_timestamp)
+		return;
+
+	timestamp_t timestamp =
+	    conn_impl->next_timestamp > impl->now ? conn_impl->next_timestamp : impl->now;
+	if (push_event(impl, timestamp, NULL, agent->conn_index) == 0)
+		conn_impl->timer_timestamp = timestamp;
+}
+
+static void process_datagram(conn_registry_t *registry, sim_datagram_t *datagram) {
+	registry_impl_t *impl = registry->impl;
+
+	if (impl->has_stun_server && addr_record_is_equal(&datagram->dst, &impl->stun_server, true)) {
+		++impl->stats.datagrams_delivered;
+		answer_stun(impl, datagram);
+		return;
+	}
+
+	sim_nat_t *lan = map_get(&impl->hosts, &datagram->dst);
+	if (lan && lan != datagram->lan) {
+		JLOG_VERBOSE("Simulated datagram sent to a private address");
+		++impl->stats.datagrams_unreachable;
+		return;
+	}
+
+	addr_record_t internal;
+	if (!translate_inbound(impl, &datagram->src, &datagram->dst, &internal)) {
+		JLOG_VERBOSE("Simulated datagram filtered by NAT");
+		++impl->stats.datagrams_filtered;
+		return;
+	}
+
+	juice_agent_t *agent = map_get(&impl->endpoints, &internal);
+	conn_impl_t *conn_impl = agent ? agent->conn_impl : NULL;
+	if (!conn_impl || conn_impl->finished) {
+		JLOG_VERBOSE("Simulated datagram unreachable");
+		++impl->stats.datagrams_unreachable;
+		return;
+	}
+
+	++impl->stats.datagrams_delivered;
+	if (agent_conn_recv(agent, datagram->data, datagram->size, &datagram->src) != 0) {
+		JLOG_WARN("Agent receive failed");
+		conn_impl->finished = true;
+		return;
+	}
+
+	if (agent_conn_update(agent, &conn_impl->next_timestamp) != 0) {
+		JLOG_WARN("Agent update failed");
+		conn_impl->finished = true;
+		return;
+	}
+
+	schedule_timer(impl, agent);
+}
+
+static void process_timer(conn_registry_t *registry, const sim_event_t *event) {
+	registry_impl_t *impl = registry->impl;
+
+	// The agent may be gone, or another one may have taken its slot: an early update is harmless
+	juice_agent_t *agent =
+	    event->agent_index < registry->agents_size ? registry->agents[event->agent_index] : NULL;
+	conn_impl_t *conn_impl = agent ? agent->conn_impl : NULL;
+	if (!conn_impl)
+		return;
+
+	if (conn_impl->timer_timestamp == event->timestamp)
+		conn_impl->timer_timestamp = 0;
+
+	if (conn_impl->finished)
+		return;
+
+	if (conn_impl->next_timestamp <= impl->now) {
+		if (agent_conn_update(agent, &conn_impl->next_timestamp) != 0) {
+			JLOG_WARN("Agent update failed");
+			conn_impl->finished = true;
+			return;
+		}
+	}
+
+	schedule_timer(impl, agent);
+}
+
+int conn_sim_registry_init(conn_registry_t *registry, udp_socket_config_t *config) {
+	(void)config;
+	registry_impl_t *registry_impl = calloc(1, sizeof(registry_impl_t));
+	if (!registry_impl) {
+		JLOG_FATAL("Memory allocation failed for connections registry impl");
+		return -1;
+	}
+
+	registry_impl->endpoints.with_port = true;
+	registry_impl->hosts.with_port = false;
+	registry_impl->publics.with_port = false;
+	registry->impl = registry_impl;
+	return 0;
+}
+
+void conn_sim_registry_cleanup(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+
+	drop_events(registry_impl);
+	free(registry_impl->events);
+	map_destroy(&registry_impl->endpoints);
+	destroy_nats(registry_impl);
+	free(registry->impl);
+	registry->impl = NULL;
+}
+
+int conn_sim_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config) {
+	registry_impl_t *registry_impl = registry->impl;
+	if (!registry_impl->running) {
+		JLOG_ERROR("Simulated agent created while no simulation is running");
+		return -1;
+	}
+
+	addr_record_t address;
+	if (parse_address(config->bind_address, 0, &address))
+		return -1;
+
+	conn_impl_t *conn_impl = calloc(1, sizeof(conn_impl_t));
+	if (!conn_impl) {
+		JLOG_FATAL("Memory allocation failed for connection impl");
+		return -1;
+	}
+
+	// Bind the first free port in the range, or the next free ephemeral port
+	bool ephemeral = config->port_begin == 0;
+	int begin = ephemeral ? FIRST_EPHEMERAL_PORT : config->port_begin;
+	int end = ephemeral ? 65535 : (config->port_end ? config->port_end : config->port_begin);
+	int attempts = end - begin + 1;
+	bool bound = false;
+	for (int i = 0; i < attempts && !bound; ++i) {
+		uint16_t port;
+		if (ephemeral) {
+			port = registry_impl->next_port++;
+			if (registry_impl->next_port == 0)
+				registry_impl->next_port = FIRST_EPHEMERAL_PORT;
+		} else {
+			port = (uint16_t)(begin + i);
+		}
+
+		addr_set_port((struct sockaddr *)&address.addr, port);
+		bound = map_get(&registry_impl->endpoints, &address) == NULL;
+	}
+
+	if (!bound || map_set(&registry_impl->endpoints, &address, agent)) {
+		JLOG_ERROR("No simulated port available on %s", config->bind_address);
+		free(conn_impl);
+		return -1;
+	}
+
+	conn_impl->registry = registry;
+	conn_impl->address = address;
+	conn_impl->next_timestamp = registry_impl->now;
+	agent->conn_impl = conn_impl;
+	return 0;
+}
+
+void conn_sim_cleanup(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	registry_impl_t *registry_impl = registry->impl;
+
+	mutex_lock(&registry->mutex);
+	map_remove(&registry_impl->endpoints, &conn_impl->address);
+	mutex_unlock(&registry->mutex);
+
+	free(agent->conn_impl);
+	agent->conn_impl = NULL;
+}
+
+void conn_sim_lock(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	mutex_lock(&registry->mutex);
+}
+
+void conn_sim_unlock(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	mutex_unlock(&registry->mutex);
+}
+
+int conn_sim_interrupt(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	registry_impl_t *registry_impl = registry->impl;
+
+	// Nothing to wake up: the update runs at the current virtual time on the next advance
+	mutex_lock(&registry->mutex);
+	conn_impl->next_timestamp = registry_impl->now;
+	if (agent->conn_index >= 0)
+		schedule_timer(registry_impl, agent);
+	mutex_unlock(&registry->mutex);
+	return 0;
+}
+
+int conn_sim_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
+                  int ds) {
+	(void)ds;
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+
+	if (size > MAX_DATAGRAM_SIZE) {
+		JLOG_WARN("Send failed, datagram is too large");
+		return -SEMSGSIZE;
+	}
+
+	JLOG_VERBOSE("Sending simulated datagram, size=%d", size);
+
+	mutex_lock(&registry->mutex);
+	int ret = send_datagram(registry->impl, &conn_impl->address, dst, data, size);
+	mutex_unlock(&registry->mutex);
+	return ret < 0 ? -1 : (int)size;
+}
+
+int conn_sim_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	if (size > 0)
+		records[0] = conn_impl->address;
+
+	return 1;
+}
+
+bool conn_sim_can_release_registry(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+	return !registry_impl->running;
+}
+
+int conn_sim_start(conn_registry_t *registry, const juice_sim_config_t *config) {
+	registry_impl_t *registry_impl = registry->impl;
+	if (registry_impl->running) {
+		JLOG_ERROR("A simulation is already running");
+		return -1;
+	}
+
+	if (config->latency_ms < 0 || config->jitter_ms < 0 || config->loss < 0 || config->loss > 1) {
+		JLOG_ERROR("Invalid simulated network parameters");
+		return -1;
+	}
+
+	registry_impl->has_stun_server = config->stun_server_address != NULL;
+	if (registry_impl->has_stun_server && parse_address(config->stun_server_address,
+	                                                    config->stun_server_port,
+	                                                    &registry_impl->stun_server))
+		return -1;
+
+	JLOG_INFO("Starting simulation, latency=%dms, jitter=%dms, loss=%.3f", config->latency_ms,
+	          config->jitter_ms, config->loss);
+
+	registry_impl->latency_ms = config->latency_ms;
+	registry_impl->jitter_ms = config->jitter_ms;
+	registry_impl->loss = config->loss;
+	registry_impl->random_state = config->seed;
+	registry_impl->now = VIRTUAL_EPOCH;
+	registry_impl->start = VIRTUAL_EPOCH;
+	registry_impl->next_seq = 0;
+	registry_impl->next_port = FIRST_EPHEMERAL_PORT;
+	memset(&registry_impl->stats, 0, sizeof(registry_impl->stats));
+	registry_impl->running = true;
+	timestamp_set_virtual(registry_impl->now);
+	return 0;
+}
+
+void conn_sim_stop(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+	if (!registry_impl->running)
+		return;
+
+	JLOG_INFO("Stopping simulation");
+	drop_events(registry_impl);
+	destroy_nats(registry_impl);
+	registry_impl->running = false;
+	timestamp_set_virtual(0);
+}
+
+int conn_sim_set_nat(conn_registry_t *registry, const char *host_address,
+                     const char *public_address, juice_sim_nat_type_t type) {
+	registry_impl_t *registry_impl = registry->impl;
+
+	addr_record_t host, external;
+	if (parse_address(host_address, 0, &host) || parse_address(public_address, 0, &external))
+		return -1;
+
+	sim_nat_t *nat = get_or_create_nat(registry_impl, &external, type);
+	if (!nat)
+		return -1;
+
+	return map_set(&registry_impl->hosts, &host, nat);
+}
+
+int conn_sim_advance(conn_registry_t *registry, timediff_t duration) {
+	registry_impl_t *registry_impl = registry->impl;
+	if (!registry_impl->running)
+		return -1;
+
+	timestamp_t end = registry_impl->now + duration;
+	while (registry_impl->running && registry_impl->events_count > 0 &&
+	       registry_impl->events[0].timestamp <= end) {
+		sim_event_t event;
+		pop_event(registry_impl, &event);
+		if (event.timestamp > registry_impl->now) {
+			registry_impl->now = event.timestamp;
+			timestamp_set_virtual(registry_impl->now);
+		}
+
+		++registry_impl->stats.events;
+		if (event.datagram) {
+			process_datagram(registry, event.datagram);
+			free(event.datagram);
+		} else {
+			process_timer(registry, &event);
+		}
+	}
+
+	if (registry_impl->running) {
+		registry_impl->now = end;
+		timestamp_set_virtual(end);
+	}
+	return 0;
+}
+
+void conn_sim_get_stats(conn_registry_t *registry, juice_sim_stats_t *stats) {
+	registry_impl_t *registry_impl = registry->impl;
+	*stats = registry_impl->stats;
+	stats->elapsed_ms = registry_impl->now - registry_impl->start;
+}
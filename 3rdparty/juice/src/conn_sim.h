@@ -0,0 +1,41 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef JUICE_CONN_SIM_H
+#define JUICE_CONN_SIM_H
+
+#include "addr.h"
+#include "conn.h"
+#include "thread.h"
+#include "timestamp.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+int conn_sim_registry_init(conn_registry_t *registry, udp_socket_config_t *config);
+void conn_sim_registry_cleanup(conn_registry_t *registry);
+
+int conn_sim_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config);
+void conn_sim_cleanup(juice_agent_t *agent);
+void conn_sim_lock(juice_agent_t *agent);
+void conn_sim_unlock(juice_agent_t *agent);
+int conn_sim_interrupt(juice_agent_t *agent);
+int conn_sim_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
+                  int ds);
+int conn_sim_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size);
+bool conn_sim_can_release_registry(conn_registry_t *registry);
+
+// The registry must be locked
+int conn_sim_start(conn_registry_t *registry, const juice_sim_config_t *config);
+void conn_sim_stop(conn_registry_t *registry);
+int conn_sim_set_nat(conn_registry_t *registry, const char *host_address,
+                     const char *public_address, juice_sim_nat_type_t type);
+int conn_sim_advance(conn_registry_t *registry, timediff_t duration);
+void conn_sim_get_stats(conn_registry_t *registry, juice_sim_stats_t *stats);
+
+#endif
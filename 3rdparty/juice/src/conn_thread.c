@@ -24,6 +24,7 @@ typedef struct conn_impl {
 	mutex_t mutex;
 	mutex_t send_mutex;
 	int send_ds;
+	bool send_gso; // receiving stays one datagram at a time, so no GRO
 	timestamp_t next_timestamp;
 	bool stopped;
 } conn_impl_t;
@@ -176,6 +177,9 @@ int conn_thread_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket
 	mutex_init(&conn_impl->mutex, MUTEX_RECURSIVE); // Recursive to allow calls from user callbacks
 	mutex_init(&conn_impl->send_mutex, 0);
 
+	if (config->enable_offload)
+		conn_impl->send_gso = udp_enable_gso(conn_impl->sock) == 0;
+
 	agent->conn_impl = conn_impl;
 
 	JLOG_DEBUG("Starting connection thread");
@@ -273,6 +277,37 @@ int conn_thread_send(juice_agent_t *agent, const addr_record_t *dst, const char
 	return ret;
 }
 
+int conn_thread_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                           const juice_iovec_t *msgs, size_t count, int ds) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+
+	mutex_lock(&conn_impl->send_mutex);
+
+	if (conn_impl->send_ds >= 0 && conn_impl->send_ds != ds) {
+		JLOG_VERBOSE("Setting Differentiated Services field to 0x%X", ds);
+		if (udp_set_diffserv(conn_impl->sock, ds) == 0)
+			conn_impl->send_ds = ds;
+		else
+			conn_impl->send_ds = -1; // disable for next time
+	}
+
+	JLOG_VERBOSE("Sending %d datagrams", (int)count);
+
+	int ret = udp_sendto_batch(conn_impl->sock, msgs, count, dst, &conn_impl->send_gso);
+	if (ret < 0) {
+		ret = -sockerrno;
+		if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK)
+			JLOG_INFO("Send failed, buffer is full");
+		else if (sockerrno == SEMSGSIZE)
+			JLOG_WARN("Send failed, datagram is too large");
+		else
+			JLOG_WARN("Send failed, errno=%d", sockerrno);
+	}
+
+	mutex_unlock(&conn_impl->send_mutex);
+	return ret;
+}
+
 int conn_thread_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size) {
 	conn_impl_t *conn_impl = agent->conn_impl;
 
@@ -27,6 +27,8 @@ void conn_thread_unlock(juice_agent_t *agent);
 int conn_thread_interrupt(juice_agent_t *agent);
 int conn_thread_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
                      int ds);
+int conn_thread_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                           const juice_iovec_t *msgs, size_t count, int ds);
 int conn_thread_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size);
 
 #endif
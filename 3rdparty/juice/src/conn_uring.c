@@ -0,0 +1,1023 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "conn_uring.h"
+#include "agent.h"
+#include "log.h"
+#include "socket.h"
+#include "thread.h"
+#include "timerheap.h"
+#include "udp.h"
+
+#include <string.h>
+
+#if defined(__linux__) && !defined(JUICE_DISABLE_IO_URING)
+#include <linux/io_uring.h>
+#ifdef IORING_RECV_MULTISHOT // headers from Linux 6.0 or later
+#define CONN_URING
+#endif
+#endif
+
+#ifdef CONN_URING
+
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+// One thread per registry drives an io_uring instance. Every agent socket keeps a multishot
+// receive posted, which takes its buffers from a ring shared by the registry, so incoming
+// datagrams need no syscall at all. Sends, including batches, are copied into send slots and
+// submitted together by the io_uring_enter() that also waits for the next completions, whichever
+// thread issues them; only when the ring thread is already waiting does the sending thread submit
+// them itself, with a single io_uring_enter() for a batch, instead of waking it up for that. The
+// submission queue has a mutex of its own, so sends never wait for the registry mutex, which the
+// ring thread holds while running agent callbacks. Errors of queued sends are counted in the agent
+// stats; once one finds the socket buffer full, or when no send slot is left, the connection sends
+// directly, so that the caller gets EAGAIN, until a direct send succeeds. Only agents that received
+// something or whose timer expired are updated on a wake-up, timers being kept in a min-heap.
+
+#define BUFFER_SIZE 4096
+#define SQ_ENTRIES 256
+#define CQ_ENTRIES 4096
+#define RECV_BUFFERS_COUNT 512 // power of 2
+#define RECV_BUFFER_GROUP 0
+#define SEND_SLOTS_COUNT 256
+#define INITIAL_CONNS_SIZE 16
+#define INITIAL_TIMERS_SIZE 16
+#define MAX_WAIT_TIMEOUT 60000 // msecs
+
+// user_data: generation (32 bits) | connection or send slot (24 bits) | operation (8 bits)
+#define OP_RECV 1
+#define OP_SEND 2
+#define OP_CANCEL 3
+#define OP_WAKE 4
+
+#define USER_DATA(op, slot, generation)                                                            \
+	(((uint64_t)(generation) << 32) | ((uint64_t)(slot) << 8) | (uint64_t)(op))
+#define USER_DATA_OP(user_data) ((int)((user_data)&0xFF))
+#define USER_DATA_SLOT(user_data) ((int)(((user_data) >> 8) & 0xFFFFFF))
+#define USER_DATA_GENERATION(user_data) ((uint32_t)((user_data) >> 32))
+
+// Room for the recvmsg header and the source address in front of the payload
+#define RECV_NAME_SIZE sizeof(struct sockaddr_storage)
+#define RECV_BUFFER_SIZE (sizeof(struct io_uring_recvmsg_out) + RECV_NAME_SIZE + BUFFER_SIZE)
+
+typedef enum conn_state { CONN_STATE_READY = 0, CONN_STATE_FINISHED } conn_state_t;
+
+typedef struct conn_impl {
+	conn_registry_t *registry;
+	juice_agent_t *agent;
+	conn_state_t state;
+	socket_t sock;
+	mutex_t send_mutex;
+	int send_ds;
+	bool send_blocked; // a queued send found the socket buffer full
+	timestamp_t next_timestamp;
+	int slot;
+	uint32_t generation;
+	bool recv_armed;
+	bool received; // since the last update
+	heap_timer_t timer; // in the registry timers heap
+	bool pending;
+	struct conn_impl *next_pending;
+} conn_impl_t;
+
+typedef struct send_slot {
+	int conn_slot;
+	uint32_t conn_generation;
+	struct msghdr msg;
+	struct iovec iov;
+	struct sockaddr_storage addr;
+	char data[BUFFER_SIZE];
+} send_slot_t;
+
+typedef struct registry_impl {
+	thread_t thread;
+	int ring_fd;
+
+	void *sq_ptr;
+	size_t sq_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned sq_entries;
+	unsigned sq_local_tail;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ptr;
+	size_t cq_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+
+	struct io_uring_buf_ring *buf_ring;
+	char *recv_buffers;
+	uint16_t buf_tail;
+	struct msghdr recv_msg; // layout of the multishot receives
+
+	mutex_t submit_mutex; // submission queue, send slots and waiting flag
+	send_slot_t *send_slots;
+	int *free_send_slots;
+	int free_send_count;
+
+	conn_impl_t **conns; // referenced by user_data slot
+	int conns_size;
+	uint32_t next_generation;
+	int recv_inflight; // receives with a final completion to come
+
+	timer_heap_t timers; // on next_timestamp
+	conn_impl_t *pending; // connections that received something or must re-arm their receive
+
+	int wake_fd;
+	uint64_t wake_value;
+	bool wake_armed;
+	bool waiting; // the ring thread is past its last submission, until it locks again
+} registry_impl_t;
+
+// Set on the ring thread, whose sends are always left to its next io_uring_enter()
+static _Thread_local conn_registry_t *current_registry = NULL;
+
+int conn_uring_run(conn_registry_t *registry);
+
+static int uring_enter(registry_impl_t *registry_impl, unsigned to_submit, unsigned min_complete,
+                       unsigned flags, int timeout_ms) {
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	void *argp = NULL;
+	size_t argsz = 0;
+	if (timeout_ms >= 0) {
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+		memset(&arg, 0, sizeof(arg));
+		arg.ts = (uint64_t)(uintptr_t)&ts;
+		argp = &arg;
+		argsz = sizeof(arg);
+		flags |= IORING_ENTER_EXT_ARG;
+	}
+	return (int)syscall(__NR_io_uring_enter, registry_impl->ring_fd, to_submit, min_complete, flags,
+	                    argp, argsz);
+}
+
+// The submission mutex must be locked for everything touching the submission queue
+static struct io_uring_sqe *sq_get(registry_impl_t *registry_impl) {
+	unsigned head = __atomic_load_n(registry_impl->sq_head, __ATOMIC_ACQUIRE);
+	if (registry_impl->sq_local_tail - head >= registry_impl->sq_entries)
+		return NULL;
+
+	unsigned index = registry_impl->sq_local_tail & *registry_impl->sq_mask;
+	struct io_uring_sqe *sqe = registry_impl->sqes + index;
+	memset(sqe, 0, sizeof(*sqe));
+	registry_impl->sq_array[index] = index;
+	return sqe;
+}
+
+static void sq_commit(registry_impl_t *registry_impl) {
+	++registry_impl->sq_local_tail;
+	__atomic_store_n(registry_impl->sq_tail, registry_impl->sq_local_tail, __ATOMIC_RELEASE);
+}
+
+static unsigned sq_pending(registry_impl_t *registry_impl) {
+	return registry_impl->sq_local_tail - __atomic_load_n(registry_impl->sq_head, __ATOMIC_ACQUIRE);
+}
+
+// Submits right away, for requests queued outside of the ring thread
+static void sq_flush(registry_impl_t *registry_impl) {
+	unsigned pending = sq_pending(registry_impl);
+	if (pending > 0 && uring_enter(registry_impl, pending, 0, 0, -1) < 0)
+		JLOG_WARN("io_uring submission failed, errno=%d", errno);
+}
+
+static struct io_uring_sqe *sq_get_or_flush(registry_impl_t *registry_impl) {
+	struct io_uring_sqe *sqe = sq_get(registry_impl);
+	if (!sqe) {
+		sq_flush(registry_impl);
+		sqe = sq_get(registry_impl);
+	}
+	return sqe;
+}
+
+static void recv_buffer_recycle(registry_impl_t *registry_impl, unsigned bid) {
+	struct io_uring_buf *buf =
+	    &registry_impl->buf_ring->bufs[registry_impl->buf_tail & (RECV_BUFFERS_COUNT - 1)];
+	buf->addr = (uint64_t)(uintptr_t)(registry_impl->recv_buffers + (size_t)bid * RECV_BUFFER_SIZE);
+	buf->len = RECV_BUFFER_SIZE;
+	buf->bid = (uint16_t)bid;
+	++registry_impl->buf_tail;
+}
+
+static void recv_buffers_publish(registry_impl_t *registry_impl) {
+	__atomic_store_n(&registry_impl->buf_ring->tail, registry_impl->buf_tail, __ATOMIC_RELEASE);
+}
+
+static int arm_recv(registry_impl_t *registry_impl, conn_impl_t *conn_impl) {
+	// The registry is locked
+	mutex_lock(&registry_impl->submit_mutex);
+	struct io_uring_sqe *sqe = sq_get(registry_impl);
+	if (!sqe) {
+		mutex_unlock(&registry_impl->submit_mutex);
+		return -1; // retried on the next iteration
+	}
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = conn_impl->sock;
+	sqe->addr = (uint64_t)(uintptr_t)&registry_impl->recv_msg;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = RECV_BUFFER_GROUP;
+	sqe->user_data = USER_DATA(OP_RECV, conn_impl->slot, conn_impl->generation);
+	sq_commit(registry_impl);
+	mutex_unlock(&registry_impl->submit_mutex);
+	conn_impl->recv_armed = true;
+	++registry_impl->recv_inflight;
+	return 0;
+}
+
+static void arm_wake(registry_impl_t *registry_impl) {
+	mutex_lock(&registry_impl->submit_mutex);
+	struct io_uring_sqe *sqe = sq_get(registry_impl);
+	if (!sqe) {
+		mutex_unlock(&registry_impl->submit_mutex);
+		return;
+	}
+
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = registry_impl->wake_fd;
+	sqe->addr = (uint64_t)(uintptr_t)&registry_impl->wake_value;
+	sqe->len = sizeof(registry_impl->wake_value);
+	sqe->user_data = USER_DATA(OP_WAKE, 0, 0);
+	sq_commit(registry_impl);
+	mutex_unlock(&registry_impl->submit_mutex);
+	registry_impl->wake_armed = true;
+}
+
+static void wake(registry_impl_t *registry_impl) {
+	uint64_t one = 1;
+	if (write(registry_impl->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+		JLOG_WARN("Failed to wake io_uring thread, errno=%d", errno);
+}
+
+// Queued sends are left to the next io_uring_enter() of the ring thread unless it is waiting, the
+// submission mutex is locked
+static void submit_queued(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+	if (current_registry != registry && registry_impl->waiting)
+		sq_flush(registry_impl);
+}
+
+static void mark_pending(registry_impl_t *registry_impl, conn_impl_t *conn_impl) {
+	if (conn_impl->pending)
+		return;
+
+	conn_impl->pending = true;
+	conn_impl->next_pending = registry_impl->pending;
+	registry_impl->pending = conn_impl;
+}
+
+static void unmark_pending(registry_impl_t *registry_impl, conn_impl_t *conn_impl) {
+	if (!conn_impl->pending)
+		return;
+
+	conn_impl_t **link = &registry_impl->pending;
+	while (*link != conn_impl)
+		link = &(*link)->next_pending;
+
+	*link = conn_impl->next_pending;
+	conn_impl->pending = false;
+}
+
+static void conn_uring_process_recv(registry_impl_t *registry_impl, struct io_uring_cqe *cqe) {
+	int slot = USER_DATA_SLOT(cqe->user_data);
+	conn_impl_t *conn_impl = slot < registry_impl->conns_size ? registry_impl->conns[slot] : NULL;
+	if (conn_impl && conn_impl->generation != USER_DATA_GENERATION(cqe->user_data))
+		conn_impl = NULL; // destroyed, the slot has been reused since
+
+	if (!(cqe->flags & IORING_CQE_F_MORE)) {
+		--registry_impl->recv_inflight;
+		if (conn_impl)
+			conn_impl->recv_armed = false; // re-armed after the batch unless finished
+	}
+
+	bool has_buffer = (cqe->flags & IORING_CQE_F_BUFFER) != 0;
+	unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+	if (conn_impl && conn_impl->state != CONN_STATE_FINISHED) {
+		if (cqe->res < 0 && cqe->res != -ENOBUFS && cqe->res != -ECANCELED) {
+			JLOG_ERROR("io_uring receive failed, errno=%d", -cqe->res);
+			agent_conn_fail(conn_impl->agent);
+			conn_impl->state = CONN_STATE_FINISHED;
+
+		} else if (cqe->res > 0 && has_buffer) {
+			char *buffer = registry_impl->recv_buffers + (size_t)bid * RECV_BUFFER_SIZE;
+			struct io_uring_recvmsg_out *out = (struct io_uring_recvmsg_out *)buffer;
+			char *name = buffer + sizeof(*out);
+			char *payload = name + registry_impl->recv_msg.msg_namelen;
+			if (out->flags & MSG_TRUNC) {
+				JLOG_WARN("Truncated datagram, ignoring");
+			} else if (out->payloadlen > 0) {
+				addr_record_t src;
+				memset(&src, 0, sizeof(src));
+				src.len = out->namelen < RECV_NAME_SIZE ? out->namelen : RECV_NAME_SIZE;
+				memcpy(&src.addr, name, src.len);
+				src.socktype = SOCK_DGRAM;
+				addr_unmap_inet6_v4mapped((struct sockaddr *)&src.addr, &src.len);
+
+				conn_impl->received = true;
+				if (agent_conn_recv(conn_impl->agent, payload, out->payloadlen, &src) != 0) {
+					JLOG_WARN("Agent receive failed");
+					conn_impl->state = CONN_STATE_FINISHED;
+				}
+			}
+		}
+	}
+
+	if (conn_impl)
+		mark_pending(registry_impl, conn_impl);
+
+	if (has_buffer)
+		recv_buffer_recycle(registry_impl, bid);
+}
+
+static void conn_uring_process_send(registry_impl_t *registry_impl, struct io_uring_cqe *cqe) {
+	int slot = USER_DATA_SLOT(cqe->user_data);
+	send_slot_t *send_slot = registry_impl->send_slots + slot;
+	if (cqe->res < 0) {
+		conn_impl_t *conn_impl = registry_impl->conns[send_slot->conn_slot];
+		if (conn_impl && conn_impl->generation == send_slot->conn_generation &&
+		    conn_impl->state != CONN_STATE_FINISHED) {
+			if (cqe->res == -EAGAIN || cqe->res == -EWOULDBLOCK) {
+				JLOG_INFO("Send failed, buffer is full");
+				__atomic_store_n(&conn_impl->send_blocked, true, __ATOMIC_RELAXED);
+			} else {
+				JLOG_WARN("Send failed, errno=%d", -cqe->res);
+			}
+			agent_conn_send_error(conn_impl->agent, cqe->res);
+		}
+	}
+
+	mutex_lock(&registry_impl->submit_mutex);
+	registry_impl->free_send_slots[registry_impl->free_send_count++] = slot;
+	mutex_unlock(&registry_impl->submit_mutex);
+}
+
+static void conn_uring_process_completions(registry_impl_t *registry_impl) {
+	unsigned head = *registry_impl->cq_head;
+	unsigned tail = __atomic_load_n(registry_impl->cq_tail, __ATOMIC_ACQUIRE);
+	while (head != tail) {
+		struct io_uring_cqe *cqe = registry_impl->cqes + (head & *registry_impl->cq_mask);
+		switch (USER_DATA_OP(cqe->user_data)) {
+		case OP_RECV:
+			conn_uring_process_recv(registry_impl, cqe);
+			break;
+
+		case OP_SEND:
+			conn_uring_process_send(registry_impl, cqe);
+			break;
+
+		case OP_WAKE:
+			registry_impl->wake_armed = false;
+			break;
+
+		default: // OP_CANCEL
+			break;
+		}
+
+		++head;
+		// Keep up with completions posted meanwhile, as a flood is exactly when they pile up
+		if (head == tail)
+			tail = __atomic_load_n(registry_impl->cq_tail, __ATOMIC_ACQUIRE);
+	}
+	__atomic_store_n(registry_impl->cq_head, head, __ATOMIC_RELEASE);
+	recv_buffers_publish(registry_impl);
+}
+
+// Updates the agent if asked to and re-arms its receive, a finished connection is left alone until
+// it is destroyed
+static void conn_uring_refresh(registry_impl_t *registry_impl, conn_impl_t *conn_impl,
+                               bool update) {
+	if (update && conn_impl->state != CONN_STATE_FINISHED) {
+		conn_impl->received = false;
+		if (agent_conn_update(conn_impl->agent, &conn_impl->next_timestamp) != 0) {
+			JLOG_WARN("Agent update failed");
+			conn_impl->state = CONN_STATE_FINISHED;
+		}
+	}
+
+	if (conn_impl->state == CONN_STATE_FINISHED) {
+		timer_heap_remove(&registry_impl->timers, &conn_impl->timer);
+		return;
+	}
+
+	if (!conn_impl->recv_armed && arm_recv(registry_impl, conn_impl) < 0)
+		conn_impl->next_timestamp = current_timestamp(); // the queue is full, retry right away
+
+	timer_heap_update(&registry_impl->timers, &conn_impl->timer);
+}
+
+// Updates the agents that received something or whose timer expired, re-arms what needs to be and
+// returns the next timestamp
+static timestamp_t conn_uring_update(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+	conn_impl_t *conn_impl;
+	while ((conn_impl = registry_impl->pending)) {
+		registry_impl->pending = conn_impl->next_pending;
+		conn_impl->pending = false;
+		conn_uring_refresh(registry_impl, conn_impl, conn_impl->received);
+	}
+
+	// Timers of the other connections, each at most once per wake-up
+	timestamp_t now = current_timestamp();
+	heap_timer_t *timer;
+	int left = registry_impl->timers.count;
+	while (left-- > 0 && (timer = timer_heap_top(&registry_impl->timers)) &&
+	       *timer->timestamp <= now)
+		conn_uring_refresh(registry_impl, timer->user_ptr, true);
+
+	if (!registry_impl->wake_armed)
+		arm_wake(registry_impl);
+
+	timestamp_t next_timestamp = now + MAX_WAIT_TIMEOUT;
+	timer = timer_heap_top(&registry_impl->timers);
+	if (timer && *timer->timestamp < next_timestamp)
+		next_timestamp = *timer->timestamp;
+
+	return next_timestamp;
+}
+
+static thread_return_t THREAD_CALL conn_thread_entry(void *arg) {
+	thread_set_name_self("juice uring");
+	conn_registry_t *registry = (conn_registry_t *)arg;
+	current_registry = registry;
+	conn_uring_run(registry);
+	return (thread_return_t)0;
+}
+
+int conn_uring_run(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+	while (true) {
+		mutex_lock(&registry->mutex);
+		mutex_lock(&registry_impl->submit_mutex);
+		registry_impl->waiting = false;
+		mutex_unlock(&registry_impl->submit_mutex);
+		conn_uring_process_completions(registry_impl);
+		if (registry->agents_count == 0 && registry_impl->recv_inflight == 0 &&
+		    registry_impl->free_send_count == SEND_SLOTS_COUNT) {
+			mutex_unlock(&registry->mutex);
+			break;
+		}
+
+		timestamp_t next_timestamp = conn_uring_update(registry);
+		// Completions produced by the update itself are handled before sleeping
+		conn_uring_process_completions(registry_impl);
+		mutex_lock(&registry_impl->submit_mutex);
+		unsigned to_submit = sq_pending(registry_impl);
+		registry_impl->waiting = true;
+		mutex_unlock(&registry_impl->submit_mutex);
+		mutex_unlock(&registry->mutex);
+
+		timediff_t timediff = next_timestamp - current_timestamp();
+		if (timediff < 0)
+			timediff = 0;
+
+		JLOG_VERBOSE("Entering io_uring wait for %d ms, submitting %u", (int)timediff, to_submit);
+		if (uring_enter(registry_impl, to_submit, 1, IORING_ENTER_GETEVENTS, (int)timediff) < 0 &&
+		    errno != ETIME && errno != EINTR && errno != EBUSY) {
+			JLOG_FATAL("io_uring_enter failed, errno=%d", errno);
+			break;
+		}
+	}
+
+	JLOG_DEBUG("Leaving connections thread");
+	return 0;
+}
+
+static void registry_impl_destroy(registry_impl_t *registry_impl) {
+	if (registry_impl->ring_fd >= 0)
+		close(registry_impl->ring_fd); // cancels what is left, after the thread is done
+
+	if (registry_impl->wake_fd >= 0)
+		close(registry_impl->wake_fd);
+
+	if (registry_impl->sqes)
+		munmap(registry_impl->sqes, registry_impl->sqes_size);
+
+	if (registry_impl->cq_ptr && registry_impl->cq_ptr != registry_impl->sq_ptr)
+		munmap(registry_impl->cq_ptr, registry_impl->cq_size);
+
+	if (registry_impl->sq_ptr)
+		munmap(registry_impl->sq_ptr, registry_impl->sq_size);
+
+	free(registry_impl->buf_ring);
+	free(registry_impl->recv_buffers);
+	free(registry_impl->send_slots);
+	free(registry_impl->free_send_slots);
+	free(registry_impl->conns);
+	timer_heap_cleanup(&registry_impl->timers);
+	mutex_destroy(&registry_impl->submit_mutex);
+	free(registry_impl);
+}
+
+static int registry_impl_setup_ring(registry_impl_t *registry_impl) {
+	struct io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = CQ_ENTRIES;
+	registry_impl->ring_fd = (int)syscall(__NR_io_uring_setup, SQ_ENTRIES, &params);
+	if (registry_impl->ring_fd < 0) {
+		JLOG_ERROR("io_uring setup failed, errno=%d", errno);
+		return -1;
+	}
+	if (!(params.features & IORING_FEAT_EXT_ARG)) {
+		JLOG_ERROR("io_uring lacks IORING_FEAT_EXT_ARG, Linux 5.11 or later is required");
+		return -1;
+	}
+
+	registry_impl->sq_entries = params.sq_entries;
+	registry_impl->sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	registry_impl->cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (single_mmap) {
+		if (registry_impl->cq_size > registry_impl->sq_size)
+			registry_impl->sq_size = registry_impl->cq_size;
+		registry_impl->cq_size = registry_impl->sq_size;
+	}
+
+	void *sq_ptr = mmap(NULL, registry_impl->sq_size, PROT_READ | PROT_WRITE,
+	                    MAP_SHARED | MAP_POPULATE, registry_impl->ring_fd, IORING_OFF_SQ_RING);
+	if (sq_ptr == MAP_FAILED) {
+		JLOG_ERROR("io_uring submission queue mapping failed, errno=%d", errno);
+		return -1;
+	}
+	registry_impl->sq_ptr = sq_ptr;
+
+	void *cq_ptr = sq_ptr;
+	if (!single_mmap) {
+		cq_ptr = mmap(NULL, registry_impl->cq_size, PROT_READ | PROT_WRITE,
+		              MAP_SHARED | MAP_POPULATE, registry_impl->ring_fd, IORING_OFF_CQ_RING);
+		if (cq_ptr == MAP_FAILED) {
+			JLOG_ERROR("io_uring completion queue mapping failed, errno=%d", errno);
+			return -1;
+		}
+	}
+	registry_impl->cq_ptr = cq_ptr;
+
+	registry_impl->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	void *sqes = mmap(NULL, registry_impl->sqes_size, PROT_READ | PROT_WRITE,
+	                  MAP_SHARED | MAP_POPULATE, registry_impl->ring_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		JLOG_ERROR("io_uring submission entries mapping failed, errno=%d", errno);
+		return -1;
+	}
+	registry_impl->sqes = sqes;
+
+	char *sq = sq_ptr;
+	registry_impl->sq_head = (unsigned *)(sq + params.sq_off.head);
+	registry_impl->sq_tail = (unsigned *)(sq + params.sq_off.tail);
+	registry_impl->sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+	registry_impl->sq_array = (unsigned *)(sq + params.sq_off.array);
+	registry_impl->sq_local_tail = *registry_impl->sq_tail;
+
+	char *cq = cq_ptr;
+	registry_impl->cq_head = (unsigned *)(cq + params.cq_off.head);
+	registry_impl->cq_tail = (unsigned *)(cq + params.cq_off.tail);
+	registry_impl->cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+	registry_impl->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	// Provided buffer ring for the multishot receives
+	if (posix_memalign((void **)&registry_impl->buf_ring, (size_t)sysconf(_SC_PAGESIZE),
+	                   RECV_BUFFERS_COUNT * sizeof(struct io_uring_buf))) {
+		registry_impl->buf_ring = NULL;
+		JLOG_FATAL("Memory allocation failed for io_uring buffer ring");
+		return -1;
+	}
+	memset(registry_impl->buf_ring, 0, RECV_BUFFERS_COUNT * sizeof(struct io_uring_buf));
+	registry_impl->recv_buffers = malloc((size_t)RECV_BUFFERS_COUNT * RECV_BUFFER_SIZE);
+	if (!registry_impl->recv_buffers) {
+		JLOG_FATAL("Memory allocation failed for io_uring receive buffers");
+		return -1;
+	}
+
+	struct io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (uint64_t)(uintptr_t)registry_impl->buf_ring;
+	reg.ring_entries = RECV_BUFFERS_COUNT;
+	reg.bgid = RECV_BUFFER_GROUP;
+	if (syscall(__NR_io_uring_register, registry_impl->ring_fd, IORING_REGISTER_PBUF_RING, &reg,
+	            1) < 0) {
+		JLOG_ERROR("io_uring buffer ring registration failed, Linux 5.19 or later is required, "
+		           "errno=%d",
+		           errno);
+		return -1;
+	}
+	for (unsigned bid = 0; bid < RECV_BUFFERS_COUNT; ++bid)
+		recv_buffer_recycle(registry_impl, bid);
+	recv_buffers_publish(registry_impl);
+
+	memset(&registry_impl->recv_msg, 0, sizeof(registry_impl->recv_msg));
+	registry_impl->recv_msg.msg_namelen = RECV_NAME_SIZE;
+	return 0;
+}
+
+int conn_uring_registry_init(conn_registry_t *registry, udp_socket_config_t *config) {
+	(void)config;
+	registry_impl_t *registry_impl = calloc(1, sizeof(registry_impl_t));
+	if (!registry_impl) {
+		JLOG_FATAL("Memory allocation failed for connections registry impl");
+		return -1;
+	}
+	registry_impl->ring_fd = -1;
+	registry_impl->wake_fd = -1;
+	mutex_init(&registry_impl->submit_mutex, 0);
+
+	if (registry_impl_setup_ring(registry_impl))
+		goto error;
+
+	registry_impl->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (registry_impl->wake_fd < 0) {
+		JLOG_FATAL("eventfd creation failed, errno=%d", errno);
+		goto error;
+	}
+
+	registry_impl->send_slots = malloc(SEND_SLOTS_COUNT * sizeof(send_slot_t));
+	registry_impl->free_send_slots = malloc(SEND_SLOTS_COUNT * sizeof(int));
+	registry_impl->conns = calloc(INITIAL_CONNS_SIZE, sizeof(conn_impl_t *));
+	if (!registry_impl->send_slots || !registry_impl->free_send_slots || !registry_impl->conns ||
+	    timer_heap_init(&registry_impl->timers, INITIAL_TIMERS_SIZE)) {
+		JLOG_FATAL("Memory allocation failed for io_uring registry");
+		goto error;
+	}
+	for (int i = 0; i < SEND_SLOTS_COUNT; ++i)
+		registry_impl->free_send_slots[i] = SEND_SLOTS_COUNT - 1 - i;
+	registry_impl->free_send_count = SEND_SLOTS_COUNT;
+	registry_impl->conns_size = INITIAL_CONNS_SIZE;
+
+	registry->impl = registry_impl;
+
+	JLOG_DEBUG("Starting connections thread");
+	int ret = thread_init(&registry_impl->thread, conn_thread_entry, registry);
+	if (ret) {
+		JLOG_FATAL("Thread creation failed, error=%d", ret);
+		registry->impl = NULL;
+		goto error;
+	}
+
+	return 0;
+
+error:
+	registry_impl_destroy(registry_impl);
+	return -1;
+}
+
+void conn_uring_registry_cleanup(conn_registry_t *registry) {
+	registry_impl_t *registry_impl = registry->impl;
+
+	JLOG_VERBOSE("Waiting for connections thread");
+	thread_join(registry_impl->thread, NULL);
+
+	registry_impl_destroy(registry_impl);
+	registry->impl = NULL;
+}
+
+int conn_uring_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config) {
+	// The registry is locked
+	registry_impl_t *registry_impl = registry->impl;
+
+	int slot = 0;
+	while (slot < registry_impl->conns_size && registry_impl->conns[slot])
+		++slot;
+
+	if (slot == registry_impl->conns_size) {
+		int new_size = registry_impl->conns_size * 2;
+		conn_impl_t **new_conns = realloc(registry_impl->conns, new_size * sizeof(conn_impl_t *));
+		if (!new_conns) {
+			JLOG_FATAL("Memory reallocation failed for io_uring connections");
+			return -1;
+		}
+		memset(new_conns + slot, 0, (new_size - slot) * sizeof(conn_impl_t *));
+		registry_impl->conns = new_conns;
+		registry_impl->conns_size = new_size;
+	}
+
+	conn_impl_t *conn_impl = calloc(1, sizeof(conn_impl_t));
+	if (!conn_impl) {
+		JLOG_FATAL("Memory allocation failed for connection impl");
+		return -1;
+	}
+
+	// next_timestamp is zero so the agent is updated on the next wake-up
+	heap_timer_init(&conn_impl->timer, &conn_impl->next_timestamp, conn_impl);
+	if (timer_heap_schedule(&registry_impl->timers, &conn_impl->timer)) {
+		free(conn_impl);
+		return -1;
+	}
+
+	conn_impl->sock = udp_create_socket(config);
+	if (conn_impl->sock == INVALID_SOCKET) {
+		JLOG_ERROR("UDP socket creation failed");
+		timer_heap_remove(&registry_impl->timers, &conn_impl->timer);
+		free(conn_impl);
+		return -1;
+	}
+
+	mutex_init(&conn_impl->send_mutex, 0);
+	conn_impl->registry = registry;
+	conn_impl->agent = agent;
+	conn_impl->state = CONN_STATE_READY;
+	conn_impl->slot = slot;
+	conn_impl->generation = ++registry_impl->next_generation;
+	registry_impl->conns[slot] = conn_impl;
+
+	// If the queue is full, the ring thread arms it on the first update
+	if (arm_recv(registry_impl, conn_impl) == 0) {
+		mutex_lock(&registry_impl->submit_mutex);
+		sq_flush(registry_impl);
+		mutex_unlock(&registry_impl->submit_mutex);
+	}
+
+	agent->conn_impl = conn_impl;
+	return 0;
+}
+
+void conn_uring_cleanup(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	registry_impl_t *registry_impl = registry->impl;
+
+	mutex_lock(&registry->mutex);
+	conn_impl->state = CONN_STATE_FINISHED;
+	if (conn_impl->recv_armed) {
+		mutex_lock(&registry_impl->submit_mutex);
+		struct io_uring_sqe *sqe = sq_get_or_flush(registry_impl);
+		if (sqe) {
+			sqe->opcode = IORING_OP_ASYNC_CANCEL;
+			sqe->addr = USER_DATA(OP_RECV, conn_impl->slot, conn_impl->generation);
+			sqe->user_data = USER_DATA(OP_CANCEL, conn_impl->slot, conn_impl->generation);
+			sq_commit(registry_impl);
+			sq_flush(registry_impl);
+		} else {
+			JLOG_WARN("Failed to cancel io_uring receive");
+		}
+		mutex_unlock(&registry_impl->submit_mutex);
+	}
+	registry_impl->conns[conn_impl->slot] = NULL;
+	timer_heap_remove(&registry_impl->timers, &conn_impl->timer);
+	unmark_pending(registry_impl, conn_impl);
+	mutex_unlock(&registry->mutex);
+
+	wake(registry_impl);
+
+	mutex_destroy(&conn_impl->send_mutex);
+	closesocket(conn_impl->sock);
+	free(agent->conn_impl);
+	agent->conn_impl = NULL;
+}
+
+void conn_uring_lock(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	mutex_lock(&registry->mutex);
+}
+
+void conn_uring_unlock(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	mutex_unlock(&registry->mutex);
+}
+
+int conn_uring_interrupt(juice_agent_t *agent) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	registry_impl_t *registry_impl = registry->impl;
+
+	mutex_lock(&registry->mutex);
+	conn_impl->next_timestamp = current_timestamp();
+	timer_heap_update(&registry_impl->timers, &conn_impl->timer);
+	mutex_unlock(&registry->mutex);
+
+	// The ring thread goes through the expired timers before waiting again anyway
+	if (current_registry != registry) {
+		JLOG_VERBOSE("Interrupting connections thread");
+		wake(registry_impl);
+	}
+	return 0;
+}
+
+static int conn_uring_queue_send(conn_impl_t *conn_impl, const addr_record_t *dst, const char *data,
+                                 size_t size) {
+	// The submission mutex is locked
+	registry_impl_t *registry_impl = conn_impl->registry->impl;
+	if (size > BUFFER_SIZE || registry_impl->free_send_count == 0)
+		return -1;
+
+	struct io_uring_sqe *sqe = sq_get(registry_impl);
+	if (!sqe)
+		return -1;
+
+	int slot = registry_impl->free_send_slots[--registry_impl->free_send_count];
+	send_slot_t *send_slot = registry_impl->send_slots + slot;
+	send_slot->conn_slot = conn_impl->slot;
+	send_slot->conn_generation = conn_impl->generation;
+	memcpy(send_slot->data, data, size);
+	memcpy(&send_slot->addr, &dst->addr, dst->len);
+	send_slot->iov.iov_base = send_slot->data;
+	send_slot->iov.iov_len = size;
+	memset(&send_slot->msg, 0, sizeof(send_slot->msg));
+	send_slot->msg.msg_name = &send_slot->addr;
+	send_slot->msg.msg_namelen = dst->len;
+	send_slot->msg.msg_iov = &send_slot->iov;
+	send_slot->msg.msg_iovlen = 1;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = conn_impl->sock;
+	sqe->addr = (uint64_t)(uintptr_t)&send_slot->msg;
+	sqe->user_data = USER_DATA(OP_SEND, slot, 0);
+	sq_commit(registry_impl);
+	return (int)size;
+}
+
+static void conn_uring_set_diffserv(conn_impl_t *conn_impl, int ds) {
+	// The send mutex is locked
+	if (conn_impl->send_ds < 0 || conn_impl->send_ds == ds)
+		return;
+
+	// Queued sends must leave with the field they were issued with
+	registry_impl_t *registry_impl = conn_impl->registry->impl;
+	mutex_lock(&registry_impl->submit_mutex);
+	sq_flush(registry_impl);
+	mutex_unlock(&registry_impl->submit_mutex);
+
+	JLOG_VERBOSE("Setting Differentiated Services field to 0x%X", ds);
+	if (udp_set_diffserv(conn_impl->sock, ds) == 0)
+		conn_impl->send_ds = ds;
+	else
+		conn_impl->send_ds = -1; // disable for next time
+}
+
+static void log_send_error(void) {
+	if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK)
+		JLOG_INFO("Send failed, buffer is full");
+	else if (sockerrno == SEMSGSIZE)
+		JLOG_WARN("Send failed, datagram is too large");
+	else
+		JLOG_WARN("Send failed, errno=%d", sockerrno);
+}
+
+int conn_uring_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
+                    int ds) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	registry_impl_t *registry_impl = registry->impl;
+
+	if (dst->socktype == SOCK_STREAM) {
+		JLOG_WARN("ICE-TCP is not supported in io_uring mode");
+		return -1;
+	}
+
+	mutex_lock(&conn_impl->send_mutex);
+
+	JLOG_VERBOSE("Sending datagram, size=%d", size);
+
+	conn_uring_set_diffserv(conn_impl, ds);
+
+	int ret = -1;
+	mutex_lock(&registry_impl->submit_mutex);
+	if (!__atomic_load_n(&conn_impl->send_blocked, __ATOMIC_RELAXED))
+		ret = conn_uring_queue_send(conn_impl, dst, data, size);
+
+	if (ret >= 0)
+		submit_queued(registry);
+	else
+		sq_flush(registry_impl); // what is queued goes out first
+
+	mutex_unlock(&registry_impl->submit_mutex);
+
+	if (ret < 0) {
+		// Blocked, out of send slots or submission entries, or too large
+		ret = udp_sendto(conn_impl->sock, data, size, dst);
+		if (ret >= 0) {
+			__atomic_store_n(&conn_impl->send_blocked, false, __ATOMIC_RELAXED);
+		} else {
+			ret = -sockerrno;
+			log_send_error();
+		}
+	}
+
+	mutex_unlock(&conn_impl->send_mutex);
+	return ret;
+}
+
+int conn_uring_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                          const juice_iovec_t *msgs, size_t count, int ds) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+	conn_registry_t *registry = conn_impl->registry;
+	registry_impl_t *registry_impl = registry->impl;
+
+	mutex_lock(&conn_impl->send_mutex);
+
+	conn_uring_set_diffserv(conn_impl, ds);
+
+	JLOG_VERBOSE("Sending %d datagrams", (int)count);
+
+	size_t queued = 0;
+	mutex_lock(&registry_impl->submit_mutex);
+	if (!__atomic_load_n(&conn_impl->send_blocked, __ATOMIC_RELAXED))
+		while (queued < count &&
+		       conn_uring_queue_send(conn_impl, dst, msgs[queued].data, msgs[queued].size) >= 0)
+			++queued;
+
+	if (queued == count)
+		submit_queued(registry);
+	else
+		sq_flush(registry_impl); // the rest goes out directly after the queued sends
+
+	mutex_unlock(&registry_impl->submit_mutex);
+
+	int ret = (int)queued;
+	if (queued < count) {
+		int sent = udp_sendto_batch(conn_impl->sock, msgs + queued, count - queued, dst, NULL);
+		if (sent < 0) {
+			if (queued == 0)
+				ret = -sockerrno;
+			log_send_error();
+		} else {
+			if (sent > 0)
+				__atomic_store_n(&conn_impl->send_blocked, false, __ATOMIC_RELAXED);
+			ret += sent;
+		}
+	}
+
+	mutex_unlock(&conn_impl->send_mutex);
+	return ret;
+}
+
+int conn_uring_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size) {
+	conn_impl_t *conn_impl = agent->conn_impl;
+
+	return udp_get_addrs(conn_impl->sock, records, size);
+}
+
+#else // CONN_URING
+
+int conn_uring_registry_init(conn_registry_t *registry, udp_socket_config_t *config) {
+	(void)registry;
+	(void)config;
+	JLOG_ERROR("io_uring concurrency mode is not supported on this platform");
+	return -1;
+}
+
+void conn_uring_registry_cleanup(conn_registry_t *registry) { (void)registry; }
+
+int conn_uring_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config) {
+	(void)agent;
+	(void)registry;
+	(void)config;
+	return -1;
+}
+
+void conn_uring_cleanup(juice_agent_t *agent) { (void)agent; }
+
+void conn_uring_lock(juice_agent_t *agent) { (void)agent; }
+
+void conn_uring_unlock(juice_agent_t *agent) { (void)agent; }
+
+int conn_uring_interrupt(juice_agent_t *agent) {
+	(void)agent;
+	return -1;
+}
+
+int conn_uring_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
+                    int ds) {
+	(void)agent;
+	(void)dst;
+	(void)data;
+	(void)size;
+	(void)ds;
+	return -1;
+}
+
+int conn_uring_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                          const juice_iovec_t *msgs, size_t count, int ds) {
+	(void)agent;
+	(void)dst;
+	(void)msgs;
+	(void)count;
+	(void)ds;
+	return -1;
+}
+
+int conn_uring_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size) {
+	(void)agent;
+	(void)records;
+	(void)size;
+	return -1;
+}
+
+#endif // CONN_URING
@@ -0,0 +1,34 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef JUICE_CONN_URING_H
+#define JUICE_CONN_URING_H
+
+#include "addr.h"
+#include "conn.h"
+#include "thread.h"
+#include "timestamp.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+int conn_uring_registry_init(conn_registry_t *registry, udp_socket_config_t *config);
+void conn_uring_registry_cleanup(conn_registry_t *registry);
+
+int conn_uring_init(juice_agent_t *agent, conn_registry_t *registry, udp_socket_config_t *config);
+void conn_uring_cleanup(juice_agent_t *agent);
+void conn_uring_lock(juice_agent_t *agent);
+void conn_uring_unlock(juice_agent_t *agent);
+int conn_uring_interrupt(juice_agent_t *agent);
+int conn_uring_send(juice_agent_t *agent, const addr_record_t *dst, const char *data, size_t size,
+                    int ds);
+int conn_uring_send_batch(juice_agent_t *agent, const addr_record_t *dst,
+                          const juice_iovec_t *msgs, size_t count, int ds);
+int conn_uring_get_addrs(juice_agent_t *agent, addr_record_t *records, size_t size);
+
+#endif
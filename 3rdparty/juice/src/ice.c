@@ -235,26 +235,60 @@ int ice_add_candidate(ice_candidate_t *candidate, ice_description_t *description
 		return -1;
 	}
 
+	if (description->candidates_count == description->candidates_capacity) {
+		int capacity = description->candidates_capacity ? description->candidates_capacity * 2
+		                                                : ICE_INITIAL_CANDIDATES_CAPACITY;
+		if (capacity > ICE_MAX_CANDIDATES_COUNT)
+			capacity = ICE_MAX_CANDIDATES_COUNT;
+
+		ice_candidate_t **candidates =
+		    realloc(description->candidates, capacity * sizeof(ice_candidate_t *));
+		if (!candidates) {
+			JLOG_ERROR("Memory allocation for candidates failed");
+			return -1;
+		}
+		description->candidates = candidates;
+		description->candidates_capacity = capacity;
+	}
+
+	ice_candidate_t *pos = malloc(sizeof(ice_candidate_t));
+	if (!pos) {
+		JLOG_ERROR("Memory allocation for candidate failed");
+		return -1;
+	}
+
 	if (strcmp(candidate->foundation, "-") == 0)
 		snprintf(candidate->foundation, 32, "%u",
 		         (unsigned int)(description->candidates_count + 1));
 
-	ice_candidate_t *pos = description->candidates + description->candidates_count;
 	*pos = *candidate;
-	++description->candidates_count;
+	description->candidates[description->candidates_count++] = pos;
 	return 0;
 }
 
+void ice_destroy_description(ice_description_t *description) {
+	for (int i = 0; i < description->candidates_count; ++i)
+		free(description->candidates[i]);
+
+	free(description->candidates);
+	description->candidates = NULL;
+	description->candidates_count = 0;
+	description->candidates_capacity = 0;
+}
+
 void ice_sort_candidates(ice_description_t *description) {
-	// In-place insertion sort
-	ice_candidate_t *begin = description->candidates;
-	ice_candidate_t *end = begin + description->candidates_count;
-	ice_candidate_t *cur = begin;
+	// In-place insertion sort of the pointers, candidates don't move
+	if (!description->candidates_count)
+		return;
+
+	ice_candidate_t **begin = description->candidates;
+	ice_candidate_t **end = begin + description->candidates_count;
+	ice_candidate_t **cur = begin;
 	while (++cur < end) {
-		uint32_t priority = cur->priority;
-		ice_candidate_t *prev = cur;
-		ice_candidate_t tmp = *prev;
-		while (--prev >= begin && prev->priority < priority) {
+		uint32_t priority = (*cur)->priority;
+		ice_candidate_t **prev = cur;
+		ice_candidate_t *tmp = *prev;
+		while (--prev >= begin && (*prev)->priority < priority) {
 			*(prev + 1) = *prev;
 		}
 		if (prev + 1 != cur)
@@ -265,14 +299,12 @@ void ice_sort_candidates(ice_description_t *description) {
 ice_candidate_t *ice_find_candidate_from_addr(ice_description_t *description,
                                               const addr_record_t *record,
                                               ice_candidate_type_t type) {
-	ice_candidate_t *cur = description->candidates;
-	ice_candidate_t *end = cur + description->candidates_count;
-	while (cur != end) {
+	for (int i = 0; i < description->candidates_count; ++i) {
+		ice_candidate_t *cur = description->candidates[i];
 		if ((type == ICE_CANDIDATE_TYPE_UNKNOWN || cur->type == type) &&
 		    addr_is_equal((struct sockaddr *)&record->addr, (struct sockaddr *)&cur->resolved.addr,
 		                  true))
 			return cur;
-		++cur;
 	}
 	return NULL;
 }
@@ -297,7 +329,7 @@ int ice_generate_sdp(const ice_description_t *description, char *buffer, size_t
 				ret = snprintf(begin, end - begin, "a=ice-lite\r\n");
 
 		} else if (i < description->candidates_count + 1) {
-			const ice_candidate_t *candidate = description->candidates + i - 1;
+			const ice_candidate_t *candidate = description->candidates[i - 1];
 			if (candidate->type == ICE_CANDIDATE_TYPE_UNKNOWN ||
 			    candidate->type == ICE_CANDIDATE_TYPE_PEER_REFLEXIVE)
 				continue;
@@ -408,7 +440,7 @@ int ice_update_candidate_pair(ice_candidate_pair_t *pair, bool is_controlling) {
 int ice_candidates_count(const ice_description_t *description, ice_candidate_type_t type) {
 	int count = 0;
 	for (int i = 0; i < description->candidates_count; ++i) {
-		const ice_candidate_t *candidate = description->candidates + i;
+		const ice_candidate_t *candidate = description->candidates[i];
 		if (candidate->type == type)
 			++count;
 	}
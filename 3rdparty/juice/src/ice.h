@@ -16,7 +16,8 @@
 #include <stdbool.h>
 #include <stdint.h>
 
-#define ICE_MAX_CANDIDATES_COUNT 20 // ~ 500B * 20 = 10KB
+#define ICE_MAX_CANDIDATES_COUNT 20 // ~ 500B * 20 = 10KB at most, allocated on demand
+#define ICE_INITIAL_CANDIDATES_CAPACITY 4
 
 #define ICE_CANDIDATE_PENALTY_TCP 50
 
@@ -57,9 +58,12 @@ typedef struct ice_description {
 	char ice_ufrag[256 + 1]; // 4 to 256 characters
 	char ice_pwd[256 + 1];   // 22 to 256 characters
 	bool ice_lite;
-	ice_candidate_t candidates[ICE_MAX_CANDIDATES_COUNT];
-	int candidates_count;
 	bool finished;
+	// Candidates are allocated one by one as they are added, so pointers to them stay valid while
+	// the array grows and when it is sorted
+	ice_candidate_t **candidates;
+	int candidates_count;
+	int candidates_capacity;
 } ice_description_t;
 
 typedef enum ice_candidate_pair_state {
@@ -97,6 +101,7 @@ int ice_create_local_candidate(ice_candidate_type_t type, int component, int ind
                                const addr_record_t *record, ice_candidate_t *candidate, ice_candidate_transport_t transport);
 int ice_resolve_candidate(ice_candidate_t *candidate, ice_resolve_mode_t mode);
 int ice_add_candidate(ice_candidate_t *candidate, ice_description_t *description);
+void ice_destroy_description(ice_description_t *description);
 void ice_sort_candidates(ice_description_t *description);
 ice_candidate_t *ice_find_candidate_from_addr(ice_description_t *description,
                                               const addr_record_t *record,
@@ -15,6 +15,7 @@
 #include "server.h"
 #endif
 
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -88,6 +89,14 @@ JUICE_EXPORT int juice_send(juice_agent_t *agent, const char *data, size_t size)
 	return juice_send_diffserv(agent, data, size, 0);
 }
 
+static int send_error_code(int ret) {
+	if(ret == -SEAGAIN || ret == -SEWOULDBLOCK)
+		return JUICE_ERR_AGAIN;
+	if(ret == -SEMSGSIZE)
+		return JUICE_ERR_TOO_LARGE;
+	return JUICE_ERR_FAILED;
+}
+
 JUICE_EXPORT int juice_send_diffserv(juice_agent_t *agent, const char *data, size_t size, int ds) {
 	if (!agent || (!data && size))
 		return JUICE_ERR_INVALID;
@@ -95,15 +104,36 @@ JUICE_EXPORT int juice_send_diffserv(juice_agent_t *agent, const char *data, siz
 	int ret = agent_send(agent, data, size, ds);
 	if(ret >= 0)
 		return JUICE_ERR_SUCCESS;
-	if(ret == -SEAGAIN || ret == -SEWOULDBLOCK)
-		return JUICE_ERR_AGAIN;
-	if(ret == -SEMSGSIZE)
-		return JUICE_ERR_TOO_LARGE;
-	return JUICE_ERR_FAILED;
+	return send_error_code(ret);
+}
+
+JUICE_EXPORT int juice_send_batch(juice_agent_t *agent, const juice_iovec_t *msgs, size_t count) {
+	if (!agent || (!msgs && count) || count > INT_MAX)
+		return JUICE_ERR_INVALID;
+
+	for (size_t i = 0; i < count; ++i)
+		if (!msgs[i].data && msgs[i].size)
+			return JUICE_ERR_INVALID;
+
+	if (count == 0)
+		return 0;
+
+	int ret = agent_send_batch(agent, msgs, count, 0);
+	if(ret >= 0)
+		return ret;
+	return send_error_code(ret);
 }
 
 JUICE_EXPORT juice_state_t juice_get_state(juice_agent_t *agent) { return agent_get_state(agent); }
 
+JUICE_EXPORT int juice_get_stats(juice_agent_t *agent, juice_stats_t *stats) {
+	if (!agent || !stats)
+		return JUICE_ERR_INVALID;
+
+	agent_get_stats(agent, stats);
+	return JUICE_ERR_SUCCESS;
+}
+
 JUICE_EXPORT int juice_get_selected_candidates(juice_agent_t *agent, char *local, size_t local_size,
                                                char *remote, size_t remote_size) {
 	if (!agent || (!local && local_size) || (!remote && remote_size))
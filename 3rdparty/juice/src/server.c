@@ -43,6 +43,7 @@
 
 #define MAX_RELAYED_RECORDS_COUNT 8
 #define BUFFER_SIZE 4096
+#define RECV_BATCH_SIZE 32
 
 static char *alloc_string_copy(const char *orig, bool *alloc_failed) {
 	if (!orig)
@@ -126,6 +127,10 @@ juice_server_t *server_create(const juice_server_config_t *config) {
 
 	mutex_init(&server->mutex, MUTEX_RECURSIVE);
 
+	server->recv_batch = udp_batch_create(RECV_BATCH_SIZE, BUFFER_SIZE);
+	if (!server->recv_batch)
+		goto error;
+
 	bool alloc_failed = false;
 	server->config.max_allocations =
 	    config->max_allocations > 0 ? config->max_allocations : SERVER_DEFAULT_MAX_ALLOCATIONS;
@@ -209,6 +214,7 @@ void server_do_destroy(juice_server_t *server) {
 	JLOG_DEBUG("Destroying server");
 
 	closesocket(server->sock);
+	udp_batch_destroy(server->recv_batch);
 	mutex_destroy(&server->mutex);
 
 	server_turn_alloc_t *end = server->allocs + server->allocs_count;
@@ -440,10 +446,9 @@ int server_stun_send(juice_server_t *server, const addr_record_t *dst, const stu
 int server_recv(juice_server_t *server) {
 	JLOG_VERBOSE("Receiving datagrams");
 	while (true) {
-		char buffer[BUFFER_SIZE];
-		addr_record_t record;
-		int len = udp_recvfrom(server->sock, buffer, BUFFER_SIZE, &record);
-		if (len < 0) {
+		udp_message_t *messages;
+		int count = udp_recv_batch(server->sock, server->recv_batch, &messages);
+		if (count < 0) {
 			if (sockerrno == SEAGAIN || sockerrno == SEWOULDBLOCK) {
 				JLOG_VERBOSE("No more datagrams to receive");
 				break;
@@ -451,13 +456,15 @@ int server_recv(juice_server_t *server) {
 			JLOG_ERROR("recvfrom failed, errno=%d", sockerrno);
 			return -1;
 		}
-		if (len == 0) {
-			// Empty datagram (used to interrupt)
-			continue;
-		}
 
-		addr_unmap_inet6_v4mapped((struct sockaddr *)&record.addr, &record.len);
-		server_input(server, buffer, len, &record);
+		for (int i = 0; i < count; ++i) {
+			if (messages[i].len == 0) {
+				// Empty datagram (used to interrupt)
+				continue;
+			}
+
+			server_input(server, messages[i].data, messages[i].len, &messages[i].src);
+		}
 	}
 
 	return 0;
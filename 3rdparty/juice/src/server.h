@@ -18,6 +18,7 @@
 #include "thread.h"
 #include "timestamp.h"
 #include "turn.h"
+#include "udp.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -61,6 +62,7 @@ typedef struct juice_server {
 	uint8_t nonce_key[SERVER_NONCE_KEY_SIZE];
 	timestamp_t nonce_key_timestamp;
 	socket_t sock;
+	udp_batch_t *recv_batch; // used by the server thread only
 	thread_t thread;
 	mutex_t mutex;
 	bool thread_stopped;
@@ -141,6 +141,9 @@ static inline void thread_set_name_self(const char *name) {
 #define atomic_ptr(T) T *volatile
 #define atomic_store(a, v) (void)(*(a) = (v))
 #define atomic_load(a) (*(a))
+#define memory_order_relaxed 0
+#define atomic_load_explicit(a, o) (*(a))
+#define atomic_fetch_add_explicit(a, v, o) (*(a) += (v))
 
 #endif // if atomics
 
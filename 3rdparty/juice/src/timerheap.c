@@ -0,0 +1,108 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "timerheap.h"
+#include "log.h"
+
+#include <stdlib.h>
+
+int timer_heap_init(timer_heap_t *heap, int initial_size) {
+	heap->timers = malloc(initial_size * sizeof(heap_timer_t *));
+	if (!heap->timers) {
+		JLOG_FATAL("Memory allocation failed for timers heap");
+		return -1;
+	}
+	heap->count = 0;
+	heap->size = initial_size;
+	return 0;
+}
+
+void timer_heap_cleanup(timer_heap_t *heap) {
+	free(heap->timers);
+	heap->timers = NULL;
+	heap->count = 0;
+	heap->size = 0;
+}
+
+void heap_timer_init(heap_timer_t *timer, const timestamp_t *timestamp, void *user_ptr) {
+	timer->timestamp = timestamp;
+	timer->user_ptr = user_ptr;
+	timer->index = -1;
+}
+
+static void timer_place(timer_heap_t *heap, int i, heap_timer_t *timer) {
+	heap->timers[i] = timer;
+	timer->index = i;
+}
+
+void timer_heap_update(timer_heap_t *heap, heap_timer_t *timer) {
+	heap_timer_t **timers = heap->timers;
+	int i = timer->index;
+	if (i < 0)
+		return;
+
+	while (i > 0) {
+		int parent = (i - 1) / 2;
+		if (*timers[parent]->timestamp <= *timer->timestamp)
+			break;
+
+		timer_place(heap, i, timers[parent]);
+		i = parent;
+	}
+	while (true) {
+		int child = 2 * i + 1;
+		if (child >= heap->count)
+			break;
+
+		if (child + 1 < heap->count && *timers[child + 1]->timestamp < *timers[child]->timestamp)
+			++child;
+
+		if (*timer->timestamp <= *timers[child]->timestamp)
+			break;
+
+		timer_place(heap, i, timers[child]);
+		i = child;
+	}
+	timer_place(heap, i, timer);
+}
+
+int timer_heap_schedule(timer_heap_t *heap, heap_timer_t *timer) {
+	if (timer->index < 0) {
+		if (heap->count == heap->size) {
+			int new_size = heap->size * 2;
+			heap_timer_t **new_timers = realloc(heap->timers, new_size * sizeof(heap_timer_t *));
+			if (!new_timers) {
+				JLOG_FATAL("Memory reallocation failed for timers heap");
+				return -1;
+			}
+			heap->timers = new_timers;
+			heap->size = new_size;
+		}
+		timer_place(heap, heap->count++, timer);
+	}
+
+	timer_heap_update(heap, timer);
+	return 0;
+}
+
+void timer_heap_remove(timer_heap_t *heap, heap_timer_t *timer) {
+	int i = timer->index;
+	if (i < 0)
+		return;
+
+	timer->index = -1;
+	heap_timer_t *last = heap->timers[--heap->count];
+	if (last != timer) {
+		timer_place(heap, i, last);
+		timer_heap_update(heap, last);
+	}
+}
+
+heap_timer_t *timer_heap_top(const timer_heap_t *heap) {
+	return heap->count > 0 ? heap->timers[0] : NULL;
+}
@@ -0,0 +1,45 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef JUICE_TIMERHEAP_H
+#define JUICE_TIMERHEAP_H
+
+#include "timestamp.h"
+
+#include <stdbool.h>
+
+// Min-heap of timers, so that a connections thread finds what expired without going through every
+// agent. A timer points to a timestamp owned by its user, which is updated in place and followed
+// by timer_heap_update().
+typedef struct heap_timer {
+	const timestamp_t *timestamp;
+	void *user_ptr;
+	int index; // in the heap, -1 if not scheduled
+} heap_timer_t;
+
+typedef struct timer_heap {
+	heap_timer_t **timers;
+	int count;
+	int size;
+} timer_heap_t;
+
+int timer_heap_init(timer_heap_t *heap, int initial_size);
+void timer_heap_cleanup(timer_heap_t *heap);
+
+void heap_timer_init(heap_timer_t *timer, const timestamp_t *timestamp, void *user_ptr);
+
+// Inserts the timer if it is not scheduled yet, then restores the heap order
+int timer_heap_schedule(timer_heap_t *heap, heap_timer_t *timer);
+// Restores the heap order around a scheduled timer whose timestamp changed
+void timer_heap_update(timer_heap_t *heap, heap_timer_t *timer);
+void timer_heap_remove(timer_heap_t *heap, heap_timer_t *timer);
+
+// Returns the timer expiring first, or NULL if the heap is empty
+heap_timer_t *timer_heap_top(const timer_heap_t *heap);
+
+#endif
@@ -7,6 +7,7 @@
  */
 
 #include "timestamp.h"
+#include "thread.h" // for atomics
 
 #ifdef _WIN32
 #include <windows.h>
@@ -33,7 +34,16 @@ int clock_gettime(int clk_id, struct timespec *t) {
 
 #endif
 
+// Non-zero while a simulation drives the clock, see conn_sim.c
+static atomic(timestamp_t) virtual_timestamp = 0;
+
+void timestamp_set_virtual(timestamp_t timestamp) { atomic_store(&virtual_timestamp, timestamp); }
+
 timestamp_t current_timestamp() {
+	timestamp_t virtual_now = atomic_load_explicit(&virtual_timestamp, memory_order_relaxed);
+	if (virtual_now)
+		return virtual_now;
+
 #ifdef _WIN32
 	return (timestamp_t)GetTickCount();
 #else // POSIX
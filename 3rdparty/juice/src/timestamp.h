@@ -17,4 +17,7 @@ typedef timestamp_t timediff_t;
 
 timestamp_t current_timestamp();
 
+// Makes current_timestamp() return timestamp instead of the monotonic clock, 0 to go back
+void timestamp_set_virtual(timestamp_t timestamp);
+
 #endif
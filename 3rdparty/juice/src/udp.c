@@ -6,6 +6,10 @@
  * file, You can obtain one at https://mozilla.org/MPL/2.0/.
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE // for recvmmsg() and sendmmsg()
+#endif
+
 #include "udp.h"
 #include "addr.h"
 #include "log.h"
@@ -14,9 +18,43 @@
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 
+#if defined(__linux__) && !defined(JUICE_DISABLE_RECVMMSG)
+#define UDP_RECVMMSG
+#endif
+
+#if defined(__linux__) && !defined(JUICE_DISABLE_SENDMMSG)
+#define UDP_SENDMMSG
+#define UDP_SEND_BATCH_MAX 64 // datagrams per sendmmsg() call
+#endif
+
+#if defined(UDP_RECVMMSG) && defined(UDP_SENDMMSG) && !defined(JUICE_DISABLE_UDP_OFFLOAD)
+#include <netinet/udp.h>
+#if defined(UDP_SEGMENT) && defined(UDP_GRO)
+#define UDP_OFFLOAD
+#define UDP_GSO_MAX_SEGMENTS 64 // kernel limit before Linux 6.9
+#define UDP_GSO_MAX_BYTES 65000 // below the 16-bit IP length field, headers included
+#define UDP_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+#endif
+#endif
+
+struct udp_batch {
+	int count;
+	size_t buffer_size;
+	udp_message_t *messages;
+	char *buffers;
+#ifdef UDP_RECVMMSG
+	struct mmsghdr *headers;
+	struct iovec *iovs;
+#endif
+#ifdef UDP_OFFLOAD
+	char *controls; // GRO segment size
+#endif
+};
+
 static struct addrinfo *find_family(struct addrinfo *ai_list, int family) {
 	struct addrinfo *ai = ai_list;
 	while (ai && ai->ai_family != family)
@@ -200,6 +238,130 @@ int udp_recvfrom(socket_t sock, char *buffer, size_t size, addr_record_t *src) {
 	}
 }
 
+udp_batch_t *udp_batch_create(int count, size_t buffer_size) {
+	udp_batch_t *batch = calloc(1, sizeof(udp_batch_t));
+	if (!batch) {
+		JLOG_FATAL("Memory allocation failed for receive batch");
+		return NULL;
+	}
+
+#ifndef UDP_RECVMMSG
+	count = 1; // one recvfrom() at a time
+#endif
+	batch->count = count;
+	batch->buffer_size = buffer_size;
+	batch->messages = calloc(count, sizeof(udp_message_t));
+	batch->buffers = malloc(count * buffer_size);
+#ifdef UDP_RECVMMSG
+	batch->headers = calloc(count, sizeof(struct mmsghdr));
+	batch->iovs = calloc(count, sizeof(struct iovec));
+#ifdef UDP_OFFLOAD
+	batch->controls = calloc(count, UDP_CONTROL_SIZE);
+	if (!batch->controls) {
+		JLOG_FATAL("Memory allocation failed for receive batch");
+		udp_batch_destroy(batch);
+		return NULL;
+	}
+#endif
+	if (!batch->headers || !batch->iovs) {
+		JLOG_FATAL("Memory allocation failed for receive batch");
+		udp_batch_destroy(batch);
+		return NULL;
+	}
+#endif
+	if (!batch->messages || !batch->buffers) {
+		JLOG_FATAL("Memory allocation failed for receive batch");
+		udp_batch_destroy(batch);
+		return NULL;
+	}
+
+	for (int i = 0; i < count; ++i) {
+		udp_message_t *message = batch->messages + i;
+		message->data = batch->buffers + i * buffer_size;
+#ifdef UDP_RECVMMSG
+		batch->iovs[i].iov_base = message->data;
+		batch->iovs[i].iov_len = buffer_size;
+		struct msghdr *hdr = &batch->headers[i].msg_hdr;
+		hdr->msg_name = &message->src.addr;
+		hdr->msg_iov = batch->iovs + i;
+		hdr->msg_iovlen = 1;
+#endif
+	}
+
+	return batch;
+}
+
+void udp_batch_destroy(udp_batch_t *batch) {
+	if (!batch)
+		return;
+
+#ifdef UDP_RECVMMSG
+	free(batch->headers);
+	free(batch->iovs);
+#endif
+#ifdef UDP_OFFLOAD
+	free(batch->controls);
+#endif
+	free(batch->messages);
+	free(batch->buffers);
+	free(batch);
+}
+
+int udp_recv_batch(socket_t sock, udp_batch_t *batch, udp_message_t **messages) {
+	*messages = batch->messages;
+#ifdef UDP_RECVMMSG
+	while (true) {
+		for (int i = 0; i < batch->count; ++i) {
+			struct msghdr *hdr = &batch->headers[i].msg_hdr;
+			hdr->msg_namelen = sizeof(batch->messages[i].src.addr);
+#ifdef UDP_OFFLOAD
+			hdr->msg_control = batch->controls + i * UDP_CONTROL_SIZE;
+			hdr->msg_controllen = UDP_CONTROL_SIZE;
+#endif
+		}
+
+		int count = recvmmsg(sock, batch->headers, (unsigned int)batch->count, 0, NULL);
+		if (count < 0) {
+			if (sockerrno == SECONNRESET || sockerrno == SENETRESET ||
+			    sockerrno == SECONNREFUSED) {
+				JLOG_DEBUG("Ignoring error returned by recvmmsg, errno=%d", sockerrno);
+				continue;
+			}
+			return -1;
+		}
+
+		for (int i = 0; i < count; ++i) {
+			udp_message_t *message = batch->messages + i;
+			message->len = batch->headers[i].msg_len;
+			message->src.len = batch->headers[i].msg_hdr.msg_namelen;
+			addr_unmap_inet6_v4mapped((struct sockaddr *)&message->src.addr, &message->src.len);
+			message->segment_size = 0;
+#ifdef UDP_OFFLOAD
+			struct msghdr *hdr = &batch->headers[i].msg_hdr;
+			for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr); cmsg; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+				if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+					int segment_size;
+					memcpy(&segment_size, CMSG_DATA(cmsg), sizeof(segment_size));
+					if (segment_size > 0 && (size_t)segment_size < message->len)
+						message->segment_size = (size_t)segment_size;
+				}
+			}
+#endif
+		}
+		return count;
+	}
+#else
+	udp_message_t *message = batch->messages;
+	int len = udp_recvfrom(sock, message->data, batch->buffer_size, &message->src);
+	if (len < 0)
+		return -1;
+
+	message->len = (size_t)len;
+	message->segment_size = 0;
+	return 1;
+#endif
+}
+
 int udp_sendto(socket_t sock, const char *data, size_t size, const addr_record_t *dst) {
 #ifndef __linux__
 	addr_record_t tmp = *dst;
@@ -217,6 +379,159 @@ int udp_sendto(socket_t sock, const char *data, size_t size, const addr_record_t
 #endif
 }
 
+#ifdef UDP_OFFLOAD
+// Send runs of equal-sized datagrams, the last one possibly shorter, as single UDP_SEGMENT messages
+static int udp_sendto_segmented(socket_t sock, const juice_iovec_t *msgs, size_t count,
+                                const addr_record_t *dst) {
+	struct mmsghdr headers[UDP_SEND_BATCH_MAX];
+	struct iovec iovs[UDP_SEND_BATCH_MAX];
+	char controls[UDP_SEND_BATCH_MAX][CMSG_SPACE(sizeof(uint16_t))];
+	unsigned int runs[UDP_SEND_BATCH_MAX]; // datagrams in each header
+	size_t sent = 0;
+	while (sent < count) {
+		unsigned int nheaders = 0;
+		unsigned int niovs = 0;
+		size_t next = sent;
+		memset(headers, 0, sizeof(headers));
+		while (next < count && niovs < UDP_SEND_BATCH_MAX) {
+			size_t segment_size = msgs[next].size;
+			size_t total = segment_size;
+			unsigned int run = 1;
+			iovs[niovs].iov_base = (void *)msgs[next].data;
+			iovs[niovs].iov_len = segment_size;
+			while (segment_size > 0 && next + run < count && niovs + run < UDP_SEND_BATCH_MAX &&
+			       run < UDP_GSO_MAX_SEGMENTS) {
+				size_t size = msgs[next + run].size;
+				if (size == 0 || size > segment_size || total + size > UDP_GSO_MAX_BYTES)
+					break;
+
+				iovs[niovs + run].iov_base = (void *)msgs[next + run].data;
+				iovs[niovs + run].iov_len = size;
+				total += size;
+				++run;
+				if (size < segment_size)
+					break; // only the last segment may be shorter
+			}
+
+			struct msghdr *hdr = &headers[nheaders].msg_hdr;
+			hdr->msg_name = (void *)&dst->addr;
+			hdr->msg_namelen = dst->len;
+			hdr->msg_iov = iovs + niovs;
+			hdr->msg_iovlen = run;
+			if (run > 1) {
+				hdr->msg_control = controls[nheaders];
+				hdr->msg_controllen = sizeof(controls[nheaders]);
+				struct cmsghdr *cmsg = CMSG_FIRSTHDR(hdr);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+				uint16_t gso_size = (uint16_t)segment_size;
+				memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+			}
+			runs[nheaders++] = run;
+			niovs += run;
+			next += run;
+		}
+
+		int ret = sendmmsg(sock, headers, nheaders, 0);
+		if (ret < 0)
+			return sent > 0 ? (int)sent : -1;
+
+		for (int i = 0; i < ret; ++i)
+			sent += runs[i];
+
+		if ((unsigned int)ret < nheaders)
+			break; // the next one failed, sending it again reports the error
+	}
+	return (int)sent;
+}
+#endif
+
+int udp_sendto_batch(socket_t sock, const juice_iovec_t *msgs, size_t count,
+                     const addr_record_t *dst, bool *gso) {
+	size_t sent = 0;
+#ifdef UDP_OFFLOAD
+	if (gso && *gso && count > 1) {
+		int ret = udp_sendto_segmented(sock, msgs, count, dst);
+		if (ret >= 0)
+			return ret;
+
+		if (sockerrno == EIO || sockerrno == ENOPROTOOPT || sockerrno == EOPNOTSUPP) {
+			JLOG_INFO("UDP segmentation offload is not available, disabling it");
+			*gso = false;
+		} else if (sockerrno != EINVAL) { // EINVAL if a segment does not fit the path MTU
+			return -1;
+		}
+	}
+#else
+	(void)gso;
+#endif
+#ifdef UDP_SENDMMSG
+	struct mmsghdr headers[UDP_SEND_BATCH_MAX];
+	struct iovec iovs[UDP_SEND_BATCH_MAX];
+	while (sent < count) {
+		unsigned int chunk =
+		    count - sent < UDP_SEND_BATCH_MAX ? (unsigned int)(count - sent) : UDP_SEND_BATCH_MAX;
+		memset(headers, 0, chunk * sizeof(*headers));
+		for (unsigned int i = 0; i < chunk; ++i) {
+			iovs[i].iov_base = (void *)msgs[sent + i].data;
+			iovs[i].iov_len = msgs[sent + i].size;
+			struct msghdr *hdr = &headers[i].msg_hdr;
+			hdr->msg_name = (void *)&dst->addr;
+			hdr->msg_namelen = dst->len;
+			hdr->msg_iov = iovs + i;
+			hdr->msg_iovlen = 1;
+		}
+
+		int ret = sendmmsg(sock, headers, chunk, 0);
+		if (ret < 0)
+			return sent > 0 ? (int)sent : -1;
+
+		sent += (size_t)ret;
+		if ((unsigned int)ret < chunk)
+			break; // the next one failed, sending it again reports the error
+	}
+#else
+	while (sent < count) {
+		if (udp_sendto(sock, msgs[sent].data, msgs[sent].size, dst) < 0)
+			return sent > 0 ? (int)sent : -1;
+
+		++sent;
+	}
+#endif
+	return (int)sent;
+}
+
+int udp_enable_gso(socket_t sock) {
+#ifdef UDP_OFFLOAD
+	// The option is per-send, so only check that the kernel knows it
+	int gso_size = 0;
+	socklen_t len = sizeof(gso_size);
+	if (getsockopt(sock, SOL_UDP, UDP_SEGMENT, &gso_size, &len) < 0) {
+		JLOG_DEBUG("UDP segmentation offload is not supported, errno=%d", sockerrno);
+		return -1;
+	}
+	return 0;
+#else
+	(void)sock;
+	return -1;
+#endif
+}
+
+int udp_enable_gro(socket_t sock) {
+#ifdef UDP_OFFLOAD
+	int enabled = 1;
+	if (setsockopt(sock, SOL_UDP, UDP_GRO, &enabled, sizeof(enabled)) < 0) {
+		JLOG_DEBUG("UDP receive offload is not supported, errno=%d", sockerrno);
+		return -1;
+	}
+	return 0;
+#else
+	(void)sock;
+	return -1;
+#endif
+}
+
 int udp_sendto_self(socket_t sock, const char *data, size_t size) {
 	addr_record_t local;
 	if (udp_get_local_addr(sock, AF_UNSPEC, &local) < 0)
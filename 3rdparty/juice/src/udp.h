@@ -10,19 +10,32 @@
 #define JUICE_UDP_H
 
 #include "addr.h"
+#include "../include/juice/juice.h"
 #include "socket.h"
 
+#include <stdbool.h>
 #include <stdint.h>
 
 typedef struct udp_socket_config {
 	const char *bind_address;
 	uint16_t port_begin;
 	uint16_t port_end;
+	bool enable_offload; // try udp_enable_gso() and udp_enable_gro() on the socket
+	uint32_t affinity_key; // picks the POLL registry, see juice_poll_config_t
 } udp_socket_config_t;
 
 socket_t udp_create_socket(const udp_socket_config_t *config);
 int udp_recvfrom(socket_t sock, char *buffer, size_t size, addr_record_t *src);
 int udp_sendto(socket_t sock, const char *data, size_t size, const addr_record_t *dst);
+// Returns how many datagrams were sent, or -1 with sockerrno set if none was. If gso points to
+// true, runs of equal-sized datagrams go out as single UDP_SEGMENT sends, and it is cleared if the
+// kernel turns out not to support them.
+int udp_sendto_batch(socket_t sock, const juice_iovec_t *msgs, size_t count,
+                     const addr_record_t *dst, bool *gso);
+// Return 0 if the socket supports UDP segmentation offload, or -1 if it does not
+int udp_enable_gso(socket_t sock);
+// Let the kernel coalesce received datagrams, see udp_message_t. Returns -1 if not supported.
+int udp_enable_gro(socket_t sock);
 int udp_sendto_self(socket_t sock, const char *data, size_t size);
 int udp_set_diffserv(socket_t sock, int ds);
 uint16_t udp_get_port(socket_t sock);
@@ -30,4 +43,23 @@ int udp_get_bound_addr(socket_t sock, addr_record_t *record);
 int udp_get_local_addr(socket_t sock, int family, addr_record_t *record); // family may be AF_UNSPEC
 int udp_get_addrs(socket_t sock, addr_record_t *records, size_t count);
 
+// Receive batch, filled by a single recvmmsg() where available
+typedef struct udp_message {
+	char *data;
+	size_t len; // may be 0 for empty datagrams
+	// Non-zero if the kernel coalesced datagrams of this size from src (GRO), the last one may be
+	// shorter. The batch buffers must then hold UDP_GRO_BUFFER_SIZE bytes.
+	size_t segment_size;
+	addr_record_t src;
+} udp_message_t;
+
+#define UDP_GRO_BUFFER_SIZE 65536
+
+typedef struct udp_batch udp_batch_t;
+
+udp_batch_t *udp_batch_create(int count, size_t buffer_size);
+void udp_batch_destroy(udp_batch_t *batch);
+// Returns the number of datagrams received, or -1 with sockerrno set
+int udp_recv_batch(socket_t sock, udp_batch_t *batch, udp_message_t **messages);
+
 #endif // JUICE_UDP_H
@@ -16,6 +16,9 @@ int test_stun(void);
 int test_connectivity(void);
 int test_thread(void);
 int test_mux(void);
+int test_sim(void);
+int test_uring(void);
+int test_offload(void);
 int test_notrickle(void);
 int test_gathering(void);
 int test_turn(void);
@@ -85,6 +88,24 @@ int main(int argc, char **argv) {
 		return -1;
 	}
 
+	printf("\nRunning simulated network connectivity test...\n");
+	if (test_sim()) {
+		fprintf(stderr, "Simulated network connectivity test failed\n");
+		return -1;
+	}
+
+	printf("\nRunning io_uring-mode connectivity test...\n");
+	if (test_uring()) {
+		fprintf(stderr, "io_uring-mode connectivity test failed\n");
+		return -1;
+	}
+
+	printf("\nRunning connectivity test with UDP offload...\n");
+	if (test_offload()) {
+		fprintf(stderr, "Connectivity test with UDP offload failed\n");
+		return -1;
+	}
+
 	printf("\nRunning non-trickled connectivity test...\n");
 	if (test_notrickle()) {
 		fprintf(stderr, "Non-trickled connectivity test failed\n");
@@ -0,0 +1,223 @@
+/**
+ * Copyright (c) 2026 loki-p2p-chat contributors
+ *
+ * This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at https://mozilla.org/MPL/2.0/.
+ */
+
+#include "../include/juice/juice.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define BUFFER_SIZE 4096
+#define STEP_MS 10
+#define TIMEOUT_MS 10000
+
+static juice_agent_t *agent1;
+static juice_agent_t *agent2;
+static int received1;
+static int received2;
+
+static void on_state_changed1(juice_agent_t *agent, juice_state_t state, void *user_ptr);
+static void on_state_changed2(juice_agent_t *agent, juice_state_t state, void *user_ptr);
+
+static void on_candidate1(juice_agent_t *agent, const char *sdp, void *user_ptr);
+static void on_candidate2(juice_agent_t *agent, const char *sdp, void *user_ptr);
+
+static void on_gathering_done1(juice_agent_t *agent, void *user_ptr);
+static void on_gathering_done2(juice_agent_t *agent, void *user_ptr);
+
+static void on_recv1(juice_agent_t *agent, const char *data, size_t size, void *user_ptr);
+static void on_recv2(juice_agent_t *agent, const char *data, size_t size, void *user_ptr);
+
+static bool is_connected(juice_agent_t *agent) {
+	juice_state_t state = juice_get_state(agent);
+	return state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED;
+}
+
+// Two agents behind port-restricted cone NATs on a lossy network: only the server reflexive
+// candidates learned from the simulated STUN server can connect them
+static bool run(unsigned int seed, int64_t *connected_ms, juice_sim_stats_t *stats) {
+	juice_sim_config_t sim_config;
+	memset(&sim_config, 0, sizeof(sim_config));
+	sim_config.seed = seed;
+	sim_config.latency_ms = 40;
+	sim_config.jitter_ms = 20;
+	sim_config.loss = 0.05;
+	sim_config.stun_server_address = "198.51.100.1";
+	sim_config.stun_server_port = 3478;
+	if (juice_sim_start(&sim_config))
+		return false;
+
+	juice_sim_set_nat("10.0.0.1", "203.0.113.1", JUICE_SIM_NAT_PORT_RESTRICTED_CONE);
+	juice_sim_set_nat("10.0.1.1", "203.0.113.2", JUICE_SIM_NAT_PORT_RESTRICTED_CONE);
+
+	received1 = 0;
+	received2 = 0;
+
+	// Agent 1: Create agent
+	juice_config_t config1;
+	memset(&config1, 0, sizeof(config1));
+	config1.concurrency_mode = JUICE_CONCURRENCY_MODE_SIM;
+	config1.stun_server_host = "198.51.100.1";
+	config1.stun_server_port = 3478;
+	config1.bind_address = "10.0.0.1";
+	config1.cb_state_changed = on_state_changed1;
+	config1.cb_candidate = on_candidate1;
+	config1.cb_gathering_done = on_gathering_done1;
+	config1.cb_recv = on_recv1;
+
+	agent1 = juice_create(&config1);
+
+	// Agent 2: Create agent
+	juice_config_t config2;
+	memset(&config2, 0, sizeof(config2));
+	config2.concurrency_mode = JUICE_CONCURRENCY_MODE_SIM;
+	config2.stun_server_host = "198.51.100.1";
+	config2.stun_server_port = 3478;
+	config2.bind_address = "10.0.1.1";
+	config2.cb_state_changed = on_state_changed2;
+	config2.cb_candidate = on_candidate2;
+	config2.cb_gathering_done = on_gathering_done2;
+	config2.cb_recv = on_recv2;
+
+	agent2 = juice_create(&config2);
+
+	// Agent 1: Generate local description
+	char sdp1[JUICE_MAX_SDP_STRING_LEN];
+	juice_get_local_description(agent1, sdp1, JUICE_MAX_SDP_STRING_LEN);
+
+	// Agent 2: Receive description from agent 1
+	juice_set_remote_description(agent2, sdp1);
+
+	// Agent 2: Generate local description
+	char sdp2[JUICE_MAX_SDP_STRING_LEN];
+	juice_get_local_description(agent2, sdp2, JUICE_MAX_SDP_STRING_LEN);
+
+	// Agent 1: Receive description from agent 2
+	juice_set_remote_description(agent1, sdp2);
+
+	juice_gather_candidates(agent1);
+	juice_gather_candidates(agent2);
+
+	// Run until both agents received their message, in virtual time
+	*connected_ms = -1;
+	for (int elapsed = 0; elapsed < TIMEOUT_MS && !(received1 && received2); elapsed += STEP_MS) {
+		juice_sim_advance(STEP_MS);
+		if (*connected_ms < 0 && is_connected(agent1) && is_connected(agent2))
+			*connected_ms = elapsed + STEP_MS;
+	}
+
+	bool success = received1 && received2;
+
+	// The only way through the NATs is with the server reflexive candidates
+	char local[JUICE_MAX_CANDIDATE_SDP_STRING_LEN];
+	char remote[JUICE_MAX_CANDIDATE_SDP_STRING_LEN];
+	if (success &=
+	    (juice_get_selected_candidates(agent1, local, JUICE_MAX_CANDIDATE_SDP_STRING_LEN, remote,
+	                                   JUICE_MAX_CANDIDATE_SDP_STRING_LEN) == 0)) {
+		printf("Local candidate  1: %s\n", local);
+		printf("Remote candidate 1: %s\n", remote);
+		if (strstr(local, "typ host") || strstr(remote, "typ host"))
+			success = false;
+	}
+
+	juice_sim_get_stats(stats);
+
+	juice_destroy(agent1);
+	juice_destroy(agent2);
+
+	if (juice_sim_stop())
+		success = false;
+
+	return success;
+}
+
+int test_sim() {
+	juice_set_log_level(JUICE_LOG_LEVEL_WARN);
+
+	int64_t connected_ms[2];
+	juice_sim_stats_t stats[2];
+	for (int i = 0; i < 2; ++i) {
+		if (!run(42, connected_ms + i, stats + i)) {
+			printf("Failure\n");
+			return -1;
+		}
+		printf("Connected after %lldms of virtual time, %llu events, %llu datagrams sent, %llu "
+		       "lost, %llu filtered\n",
+		       (long long)connected_ms[i], (unsigned long long)stats[i].events,
+		       (unsigned long long)stats[i].datagrams_sent,
+		       (unsigned long long)stats[i].datagrams_lost,
+		       (unsigned long long)stats[i].datagrams_filtered);
+	}
+
+	// Same seed, same calls: same run
+	if (connected_ms[0] != connected_ms[1] || stats[0].events != stats[1].events ||
+	    stats[0].datagrams_sent != stats[1].datagrams_sent ||
+	    stats[0].datagrams_lost != stats[1].datagrams_lost) {
+		printf("Runs with the same seed differ\n");
+		printf("Failure\n");
+		return -1;
+	}
+
+	printf("Success\n");
+	return 0;
+}
+
+// Agent 1: on state changed
+static void on_state_changed1(juice_agent_t *agent, juice_state_t state, void *user_ptr) {
+	printf("State 1: %s\n", juice_state_to_string(state));
+
+	if (state == JUICE_STATE_CONNECTED) {
+		// Agent 1: on connected, send a message
+		const char *message = "Hello from 1";
+		juice_send(agent, message, strlen(message));
+	}
+}
+
+// Agent 2: on state changed
+static void on_state_changed2(juice_agent_t *agent, juice_state_t state, void *user_ptr) {
+	printf("State 2: %s\n", juice_state_to_string(state));
+
+	if (state == JUICE_STATE_CONNECTED) {
+		// Agent 2: on connected, send a message
+		const char *message = "Hello from 2";
+		juice_send(agent, message, strlen(message));
+	}
+}
+
+// Agent 1: on local candidate gathered
+static void on_candidate1(juice_agent_t *agent, const char *sdp, void *user_ptr) {
+	// Agent 2: Receive it from agent 1
+	juice_add_remote_candidate(agent2, sdp);
+}
+
+// Agent 2: on local candidate gathered
+static void on_candidate2(juice_agent_t *agent, const char *sdp, void *user_ptr) {
+	// Agent 1: Receive it from agent 2
+	juice_add_remote_candidate(agent1, sdp);
+}
+
+// Agent 1: on local candidates gathering done
+static void on_gathering_done1(juice_agent_t *agent, void *user_ptr) {
+	juice_set_remote_gathering_done(agent2); // optional
+}
+
+// Agent 2: on local candidates gathering done
+static void on_gathering_done2(juice_agent_t *agent, void *user_ptr) {
+	juice_set_remote_gathering_done(agent1); // optional
+}
+
+// Agent 1: on message received
+static void on_recv1(juice_agent_t *agent, const char *data, size_t size, void *user_ptr) {
+	++received1;
+}
+
+// Agent 2: on message received
+static void on_recv2(juice_agent_t *agent, const char *data, size_t size, void *user_ptr) {
+	++received2;
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "PeerConnection.h"
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Helpers shared by the benchmark programs.
+namespace bench {
+    struct PairSignal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int gathered = 0;
+        int connected = 0;
+    };
+
+    // Gathers both peers, exchanges full (non-trickled) descriptions in-process and waits until both
+    // report connected. Installs its own state and gathering callbacks on a and b.
+    inline bool connectPair(PeerConnection& a, PeerConnection& b,
+                            std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+        auto signal = std::make_shared<PairSignal>();
+        for (auto* pc : {&a, &b}) {
+            pc->onGatheringDone([signal]() {
+                std::lock_guard<std::mutex> lock(signal->mutex);
+                ++signal->gathered;
+                signal->cv.notify_all();
+            });
+            pc->onStateChange([signal, seen = std::make_shared<bool>(false)](juice_state state) {
+                if ((state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED) && !*seen) {
+                    *seen = true;
+                    std::lock_guard<std::mutex> lock(signal->mutex);
+                    ++signal->connected;
+                    signal->cv.notify_all();
+                }
+            });
+        }
+
+        const auto& deadline = std::chrono::steady_clock::now() + timeout;
+        if (!a.startGathering() || !b.startGathering()) {
+            return false;
+        }
+
+        std::unique_lock<std::mutex> lock(signal->mutex);
+        if (!signal->cv.wait_until(lock, deadline, [&signal] { return signal->gathered == 2; })) {
+            return false;
+        }
+        lock.unlock();
+
+        if (!b.setRemoteDescription(a.createOffer()) || !a.setRemoteDescription(b.createAnswer())) {
+            return false;
+        }
+        a.setRemoteGatheringDone();
+        b.setRemoteGatheringDone();
+
+        lock.lock();
+        return signal->cv.wait_until(lock, deadline, [&signal] { return signal->connected == 2; });
+    }
+
+    // Numeric field of /proc/self/status, e.g. "VmRSS:" (KiB) or "Threads:"
+    inline long readStatusField(const std::string& key) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, key.size(), key) == 0) {
+                return std::strtol(line.c_str() + key.size() + 1, nullptr, 10);
+            }
+        }
+        return 0;
+    }
+
+    // CPU seconds of the threads named name (e.g. "juice mux", "juice server"), from /proc/self/task/*/stat
+    inline double threadCpuSeconds(const std::string& name) {
+        double seconds = 0.0;
+        DIR* tasks = opendir("/proc/self/task");
+        if (!tasks) {
+            return seconds;
+        }
+        while (const auto* task = readdir(tasks)) {
+            const std::string dir = std::string("/proc/self/task/") + task->d_name;
+            std::string comm;
+            std::getline(std::ifstream(dir + "/comm"), comm);
+            if (comm != name) {
+                continue;
+            }
+            std::string stat;
+            std::getline(std::ifstream(dir + "/stat"), stat);
+            // Fields after the parenthesized name; utime and stime are the 14th and 15th overall
+            std::istringstream fields(stat.substr(stat.rfind(')') + 2));
+            std::string field;
+            unsigned long long utime = 0, stime = 0;
+            for (int i = 3; i <= 15 && fields >> field; ++i) {
+                if (i == 14) {
+                    utime = std::stoull(field);
+                } else if (i == 15) {
+                    stime = std::stoull(field);
+                }
+            }
+            seconds += static_cast<double>(utime + stime) / sysconf(_SC_CLK_TCK);
+        }
+        closedir(tasks);
+        return seconds;
+    }
+
+    // User + system CPU time of the whole process
+    inline double cpuSeconds() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec
+               + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+    }
+
+    // Every agent outside MUX mode owns a socket
+    inline void raiseFileLimit() {
+        rlimit limit{};
+        if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+            limit.rlim_cur = limit.rlim_max;
+            setrlimit(RLIMIT_NOFILE, &limit);
+        }
+    }
+
+    // Nearest-rank percentile, p in [0, 100].
+    inline double percentile(std::vector<double> samples, double p) {
+        if (samples.empty()) {
+            return 0.0;
+        }
+        std::sort(samples.begin(), samples.end());
+        const auto& rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+        return samples[std::min(rank, samples.size() - 1)];
+    }
+}
@@ -0,0 +1,95 @@
+#include "BenchUtil.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+// Memory footprint of idle libjuice agents, without the PeerConnection around them: N agents with
+// host candidates only, created then gathered, in POLL and MUX mode. Reports the heap bytes in use
+// (mallinfo2) and the resident memory per agent after each step, which is what the candidate, pair
+// and STUN entry tables of struct juice_agent cost when nothing is connected.
+// Usage: agent_memory_bench [N] (default 10000)
+namespace {
+    constexpr uint16_t kMuxPort = 49000;
+    constexpr auto kGatherTimeout = std::chrono::minutes(1);
+
+    struct Footprint {
+        size_t heap = 0;
+        long rss_kib = 0;
+    };
+
+    Footprint footprint() {
+        return {mallinfo2().uordblks, bench::readStatusField("VmRSS:")};
+    }
+
+    double kibPerAgent(size_t before, size_t after, size_t count) {
+        return count ? (static_cast<double>(after) - static_cast<double>(before)) / 1024.0 / count : 0.0;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    _logger->set_level(spdlog::level::info);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+    bench::raiseFileLimit();
+
+    const size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+
+    _logger->info("{:>5} {:>7} {:>8} {:>14} {:>13} {:>14} {:>13}", "mode", "agents", "gathered", "created heap",
+                  "created RSS", "gathered heap", "gathered RSS");
+    for (const auto mode : {JUICE_CONCURRENCY_MODE_POLL, JUICE_CONCURRENCY_MODE_MUX}) {
+        auto gathered = std::make_shared<std::atomic<size_t>>(0);
+
+        juice_config_t config{};
+        config.concurrency_mode = mode;
+        config.bind_address = "127.0.0.1";
+        if (mode == JUICE_CONCURRENCY_MODE_MUX) {
+            config.local_port_range_begin = config.local_port_range_end = kMuxPort;
+        }
+        config.cb_gathering_done = [](juice_agent_t*, void* user_ptr) {
+            static_cast<std::atomic<size_t>*>(user_ptr)->fetch_add(1, std::memory_order_relaxed);
+        };
+        config.user_ptr = gathered.get();
+
+        // Hand memory freed by the previous round back to the kernel so the deltas are per round
+        malloc_trim(0);
+        const auto& base = footprint();
+        std::vector<juice_agent_t*> agents;
+        agents.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            juice_agent_t* agent = juice_create(&config);
+            if (!agent) {
+                _logger->warn("Only {} of {} agents could be created (file descriptor limit?)", i, count);
+                break;
+            }
+            agents.push_back(agent);
+        }
+        const auto& created = footprint();
+
+        for (auto* agent : agents) {
+            juice_gather_candidates(agent);
+        }
+        const auto& deadline = std::chrono::steady_clock::now() + kGatherTimeout;
+        while (gathered->load() < agents.size() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        const auto& after_gathering = footprint();
+
+        _logger->info("{:>5} {:>7} {:>8} {:>10.2f} KiB {:>9.2f} KiB {:>10.2f} KiB {:>9.2f} KiB",
+                      mode == JUICE_CONCURRENCY_MODE_POLL ? "POLL" : "MUX", agents.size(), gathered->load(),
+                      kibPerAgent(base.heap, created.heap, agents.size()),
+                      kibPerAgent(base.rss_kib * 1024, created.rss_kib * 1024, agents.size()),
+                      kibPerAgent(base.heap, after_gathering.heap, agents.size()),
+                      kibPerAgent(base.rss_kib * 1024, after_gathering.rss_kib * 1024, agents.size()));
+
+        for (auto* agent : agents) {
+            juice_destroy(agent);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "BenchUtil.h"
+#include "MessageFramer.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+// Large-message goodput through MessageFramer over a loopback pair, for message sizes from 4 KiB to
+// 16 MiB. Fragments are plain datagrams, so an unpaced sender loses whatever overflows the receive
+// socket buffer and the whole message with it; the paced runs show the rate the path sustains.
+// Usage: framer_bench [pacing MB/s] (default 120)
+namespace {
+    constexpr size_t kBytesPerSize = 64 * 1024 * 1024;
+
+    struct Result {
+        int sent = 0;
+        int delivered = 0;
+        size_t partial = 0; // messages still missing fragments when the receiver went quiet
+        double seconds = 0.0;
+        FramerStats rx_stats;
+    };
+
+    Result run(size_t size, uint64_t pacing, int round) {
+        Result result;
+        const auto& config = host_only_config();
+        PeerConnection tx(true, "TX-" + std::to_string(round), config);
+        PeerConnection rx(false, "RX-" + std::to_string(round), config);
+
+        FramerOptions options;
+        options.pacing_bytes_per_sec = pacing;
+        MessageFramer tx_framer(tx, options);
+        MessageFramer rx_framer(rx, options);
+
+        std::atomic<int> delivered{0};
+        std::atomic<std::chrono::steady_clock::rep> last_delivery{0};
+        rx_framer.onMessage([&delivered, &last_delivery](std::string_view) {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            last_delivery.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        });
+
+        if (!bench::connectPair(tx, rx)) {
+            spdlog::error("Connection failed");
+            return result;
+        }
+
+        const std::string payload(size, 'f');
+        const int messages = static_cast<int>(std::max<size_t>(4, kBytesPerSize / size));
+        const auto& start = std::chrono::steady_clock::now();
+        for (int i = 0; i < messages; ++i) {
+            if (tx_framer.send(payload) == SendResult::Ok) {
+                ++result.sent;
+            }
+        }
+
+        // Wait for the receiver to go quiet
+        int last = -1;
+        while (delivered.load() != last) {
+            last = delivered.load();
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+
+        if (last > 0) {
+            const auto& end = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last_delivery.load()));
+            result.seconds = std::chrono::duration<double>(end - start).count();
+        }
+        result.delivered = last;
+        result.partial = rx_framer.pendingMessages();
+        result.rx_stats = rx_framer.stats();
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+
+    const uint64_t paced_rate = (argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 120) * 1000 * 1000;
+
+    int round = 0;
+    _logger->info("{:>9} {:>10} {:>6} {:>9} {:>10} {:>10} {:>9}", "size", "pacing", "sent", "delivered",
+                  "goodput", "frag loss", "partial");
+    for (size_t size = 4 * 1024; size <= 16 * 1024 * 1024; size *= 4) {
+        for (const uint64_t pacing : {uint64_t(0), paced_rate}) {
+            const auto& r = run(size, pacing, round++);
+            const auto& expected_fragments = static_cast<double>(r.sent)
+                    * ((size + FramerOptions{}.fragment_size - MessageFramer::kHeaderSize - 1)
+                       / (FramerOptions{}.fragment_size - MessageFramer::kHeaderSize));
+            const auto& goodput = r.seconds > 0 ? r.delivered * static_cast<double>(size) / r.seconds / 1e6 : 0.0;
+            _logger->info("{:>8}K {:>10} {:>6} {:>9} {:>5.0f} MB/s {:>9.2f}% {:>9}", size / 1024,
+                          pacing ? std::to_string(pacing / 1000000) + " MB/s" : "unpaced", r.sent, r.delivered,
+                          goodput,
+                          expected_fragments > 0 ? 100.0 * (1.0 - r.rx_stats.fragments_received / expected_fragments) : 0.0,
+                          r.partial + r.rx_stats.evicted);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,203 @@
+#include "BenchUtil.h"
+#include "PeerManager.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Relay-host shape: N agents multiplexed on one local MUX port, each connected to its own POLL
+// client agent (the clients need distinct source addresses, which is what the mux demultiplexes
+// on). Reports resident memory per agent on both sides, the time to connect every pair, the
+// datagram rate once only keepalives and consent checks remain, and the cost of lookup_agent from
+// the juice_mux_get_stats() counters and the CPU time of the mux thread. Finally every client floods
+// its MUX peer with small messages, which gives the packet rate the mux socket sustains; build
+// libjuice with -DDISABLE_RECVMMSG=ON to compare with one recvfrom() per datagram.
+// Usage: mux_scale_bench [PAIRS] [KEEPALIVE_SECONDS] [FLOOD_SECONDS] (default 10000 15 5)
+namespace {
+    constexpr int kMuxPort = 48000;
+    constexpr auto kConnectTimeout = std::chrono::minutes(5);
+    constexpr size_t kFloodMessageSize = 64;
+    constexpr int kFloodBurst = 8; // messages per client before moving to the next one
+
+    struct ConnectSignal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t connected = 0;
+        size_t failed = 0;
+    };
+
+    juice_mux_stats_t muxStats() {
+        juice_mux_stats_t stats{};
+        juice_mux_get_stats(kMuxPort, &stats);
+        return stats;
+    }
+
+    uint64_t wireDatagramsSent(PeerManager& manager) {
+        uint64_t total = 0;
+        for (const auto& id : manager.peerIds()) {
+            if (const auto& pc = manager.peer(id)) {
+                total += pc->stats().transport.wire_datagrams_sent;
+            }
+        }
+        return total;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the manager loggers created below
+    _logger->set_level(spdlog::level::info);
+    bench::raiseFileLimit();
+
+    const size_t pairs = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000;
+    const auto keepalive_window = std::chrono::seconds(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 15);
+    const auto flood_window = std::chrono::seconds(argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 5);
+
+    PeerManagerConfig mux_config;
+    mux_config.name = "MUX";
+    mux_config.peer.concurrency_mode = JUICE_CONCURRENCY_MODE_MUX;
+    mux_config.peer.bind_address = "127.0.0.1";
+    mux_config.peer.local_port_begin = mux_config.peer.local_port_end = kMuxPort;
+    mux_config.peer.host_only = true;
+
+    PeerManagerConfig client_config = mux_config;
+    client_config.name = "CLIENT";
+    client_config.peer.concurrency_mode = JUICE_CONCURRENCY_MODE_POLL;
+    client_config.peer.local_port_begin = client_config.peer.local_port_end = 0;
+
+    // MEMORY
+    malloc_trim(0);
+    const long base_rss = bench::readStatusField("VmRSS:");
+    PeerManager mux_side(mux_config);
+    const auto& mux_ids = mux_side.createPeers(pairs, false);
+    const long mux_rss = bench::readStatusField("VmRSS:");
+    PeerManager client_side(client_config);
+    const auto& client_ids = client_side.createPeers(mux_ids.size(), true);
+    const long client_rss = bench::readStatusField("VmRSS:");
+    const size_t count = std::min(mux_ids.size(), client_ids.size());
+    if (count < pairs) {
+        _logger->warn("Only {} of {} pairs could be created (file descriptor limit?)", count, pairs);
+    }
+    if (count == 0) {
+        return 1;
+    }
+
+    _logger->info("pairs:                     {}", count);
+    _logger->info("RSS per MUX agent:         {:.1f} KiB", static_cast<double>(mux_rss - base_rss) / count);
+    _logger->info("RSS per POLL client agent: {:.1f} KiB", static_cast<double>(client_rss - mux_rss) / count);
+
+    // CONNECT
+    auto signal = std::make_shared<ConnectSignal>();
+    for (const auto& id : mux_ids) {
+        mux_side.peer(id)->onStateChange([signal, seen = std::make_shared<bool>(false)](juice_state state) {
+            const auto& connected = state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED;
+            if ((connected || state == JUICE_STATE_FAILED) && !*seen) {
+                *seen = true;
+                std::lock_guard<std::mutex> lock(signal->mutex);
+                ++(connected ? signal->connected : signal->failed);
+                signal->cv.notify_all();
+            }
+        });
+    }
+
+    const auto& connect_start = std::chrono::steady_clock::now();
+    mux_side.gatherAll();
+    client_side.gatherAll();
+    for (size_t i = 0; i < count; ++i) {
+        const auto& client = client_side.peer(client_ids[i]);
+        const auto& server = mux_side.peer(mux_ids[i]);
+        if (!server->setRemoteDescription(client->createOffer())
+            || !client->setRemoteDescription(server->createAnswer())) {
+            _logger->error("Offer/answer failed for pair {}", i);
+            return 1;
+        }
+        client->setRemoteGatheringDone();
+        server->setRemoteGatheringDone();
+    }
+    const auto& signaled_seconds =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - connect_start).count();
+
+    std::unique_lock<std::mutex> lock(signal->mutex);
+    signal->cv.wait_for(lock, kConnectTimeout, [&] { return signal->connected + signal->failed == count; });
+    const size_t connected = signal->connected;
+    const size_t failed = signal->failed;
+    lock.unlock();
+    const auto& connect_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - connect_start).count();
+    const auto& setup = muxStats();
+
+    _logger->info("offer/answer for all:      {:.2f} s", signaled_seconds);
+    _logger->info("connected:                 {} ({} failed) in {:.2f} s, {:.0f} pairs/s", connected, failed,
+                  connect_seconds, connected / connect_seconds);
+    _logger->info("setup lookups:             {} ({:.2f} probes each, {} fell back, {:.0f} agents scanned per "
+                  "fallback)", setup.lookups, setup.lookups ? double(setup.map_probes) / setup.lookups : 0.0,
+                  setup.map_misses, setup.map_misses ? double(setup.agents_scanned) / setup.map_misses : 0.0);
+
+    // KEEPALIVE
+    const auto& before = muxStats();
+    const auto& mux_sent_before = wireDatagramsSent(mux_side);
+    const auto& mux_cpu_before = bench::threadCpuSeconds("juice mux");
+    std::this_thread::sleep_for(keepalive_window);
+    const auto& after = muxStats();
+    const auto& mux_sent_after = wireDatagramsSent(mux_side);
+    const auto& mux_cpu = bench::threadCpuSeconds("juice mux") - mux_cpu_before;
+    const auto& window = std::chrono::duration<double>(keepalive_window).count();
+
+    const auto& received = after.datagrams_received - before.datagrams_received;
+    const auto& lookups = after.lookups - before.lookups;
+    const auto& misses = after.map_misses - before.map_misses;
+    _logger->info("steady state, {:.0f} s window:", window);
+    _logger->info("  MUX socket in/out:       {:.0f} / {:.0f} datagrams/s", received / window,
+                  (mux_sent_after - mux_sent_before) / window);
+    _logger->info("  address map:             {} of {} slots, {:.2f} probes per lookup, {} misses", after.map_count,
+                  after.map_size, lookups ? double(after.map_probes - before.map_probes) / lookups : 0.0, misses);
+    _logger->info("  mux thread CPU:          {:.1f} % ({:.2f} us per received datagram)", mux_cpu / window * 100.0,
+                  received ? mux_cpu * 1e6 / received : 0.0);
+    _logger->info("  still connected:         {} of {}", mux_side.stats().connected(), count);
+
+    // FLOOD
+    std::vector<std::shared_ptr<PeerConnection>> clients;
+    for (size_t i = 0; i < count; ++i) {
+        if (auto pc = client_side.peer(client_ids[i])) {
+            clients.push_back(std::move(pc));
+        }
+    }
+    std::atomic<bool> flooding{true};
+    std::atomic<uint64_t> flood_sent{0};
+    const auto& flood_before = muxStats();
+    const auto& flood_cpu_before = bench::threadCpuSeconds("juice mux");
+    std::thread sender([&clients, &flooding, &flood_sent] {
+        const std::string msg(kFloodMessageSize, 'f');
+        uint64_t sent = 0;
+        while (flooding.load(std::memory_order_relaxed)) {
+            for (const auto& pc : clients) {
+                for (int i = 0; i < kFloodBurst; ++i) {
+                    sent += pc->send(std::string_view(msg)) == SendResult::Ok ? 1 : 0;
+                }
+            }
+        }
+        flood_sent = sent;
+    });
+    std::this_thread::sleep_for(flood_window);
+    flooding = false;
+    sender.join();
+    const auto& flood_after = muxStats();
+    const auto& flood_cpu = bench::threadCpuSeconds("juice mux") - flood_cpu_before;
+    const auto& flood_seconds = std::chrono::duration<double>(flood_window).count();
+    const auto& flood_received = flood_after.datagrams_received - flood_before.datagrams_received;
+
+    _logger->info("flood, {:.0f} s window, {} B messages:", flood_seconds, kFloodMessageSize);
+    _logger->info("  clients sent:            {:.0f} datagrams/s", flood_sent.load() / flood_seconds);
+    _logger->info("  MUX socket in:           {:.0f} datagrams/s", flood_received / flood_seconds);
+    _logger->info("  mux thread CPU:          {:.1f} % ({:.2f} us per received datagram)",
+                  flood_cpu / flood_seconds * 100.0, flood_received ? flood_cpu * 1e6 / flood_received : 0.0);
+    return 0;
+}
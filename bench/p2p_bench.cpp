@@ -0,0 +1,222 @@
+#include "BenchUtil.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Data path throughput and latency through PeerConnection, for every payload size and concurrency
+// mode. "pingpong" keeps one message in flight and measures its round trip; "flood" sends as fast as
+// the socket accepts and counts what arrives. For pingpong a message is one round trip; CPU per
+// message is the process CPU time (both peers) divided by the messages that arrived.
+//
+//   p2p_bench [--duration MS] [--json PATH]
+//
+// --json writes the results as JSON for CI to diff ("-" for stdout, which silences the table).
+namespace {
+    constexpr std::array<size_t, 4> kPayloadSizes = {64, 256, 1024, 4096};
+    constexpr auto kRoundTripTimeout = std::chrono::seconds(1);
+    constexpr auto kDrainTime = std::chrono::milliseconds(200);
+    constexpr uint16_t kMuxPort = 47000;
+
+    struct Mode {
+        juice_concurrency_mode value;
+        const char* name;
+    };
+    constexpr std::array<Mode, 4> kModes = {{
+        {JUICE_CONCURRENCY_MODE_POLL, "poll"},
+        {JUICE_CONCURRENCY_MODE_MUX, "mux"},
+        {JUICE_CONCURRENCY_MODE_THREAD, "thread"},
+        {JUICE_CONCURRENCY_MODE_URING, "uring"},
+    }};
+
+    // Shared with the receive callbacks, which may still fire after a workload returns
+    struct Echo {
+        std::mutex mutex;
+        std::condition_variable cv;
+        uint64_t seq = 0;
+    };
+
+    struct Result {
+        std::string workload;
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        double seconds = 0.0;
+        double cpu_seconds = 0.0;
+        std::vector<double> rtt_us;
+    };
+
+    // One message in flight: a sends a sequence number, b echoes it, a waits for the echo
+    Result ping_pong(PeerConnection& a, PeerConnection& b, size_t size, std::chrono::milliseconds duration) {
+        Result result;
+        result.workload = "pingpong";
+
+        auto echo = std::make_shared<Echo>();
+        b.onMessageView([&b](std::string_view msg) { b.send(msg); });
+        a.onMessageView([echo](std::string_view msg) {
+            uint64_t seq = 0;
+            std::memcpy(&seq, msg.data(), sizeof(seq));
+            std::lock_guard<std::mutex> lock(echo->mutex);
+            echo->seq = seq;
+            echo->cv.notify_one();
+        });
+
+        std::string message(size, 'p');
+        const auto& cpu_start = bench::cpuSeconds();
+        const auto& start = std::chrono::steady_clock::now();
+        for (uint64_t seq = 1; std::chrono::steady_clock::now() - start < duration; ++seq) {
+            std::memcpy(message.data(), &seq, sizeof(seq));
+            const auto& sent_at = std::chrono::steady_clock::now();
+            if (a.send(message) != SendResult::Ok) {
+                continue;
+            }
+            ++result.sent;
+
+            std::unique_lock<std::mutex> lock(echo->mutex);
+            if (echo->cv.wait_for(lock, kRoundTripTimeout, [&] { return echo->seq == seq; })) {
+                ++result.received;
+                result.rtt_us.push_back(
+                        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent_at).count());
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.cpu_seconds = bench::cpuSeconds() - cpu_start;
+
+        return result;
+    }
+
+    // a sends back to back for the whole duration, retrying when the socket buffer is full
+    Result flood(PeerConnection& a, PeerConnection& b, size_t size, std::chrono::milliseconds duration) {
+        Result result;
+        result.workload = "flood";
+
+        auto received = std::make_shared<std::atomic<uint64_t>>(0);
+        b.onMessageView([received](std::string_view) { received->fetch_add(1, std::memory_order_relaxed); });
+
+        const std::string message(size, 'f');
+        const auto& cpu_start = bench::cpuSeconds();
+        const auto& start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < duration) {
+            for (int i = 0; i < 64; ++i) {
+                const auto& sent = a.send(message);
+                if (sent == SendResult::Ok) {
+                    ++result.sent;
+                } else if (sent == SendResult::Again) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::this_thread::sleep_for(kDrainTime);
+        result.cpu_seconds = bench::cpuSeconds() - cpu_start;
+        result.received = received->load();
+
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    auto duration = std::chrono::milliseconds(1000);
+    std::string json_path;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--duration") == 0) {
+            duration = std::chrono::milliseconds(std::atoi(argv[i + 1]));
+        } else if (std::strcmp(argv[i], "--json") == 0) {
+            json_path = argv[i + 1];
+        }
+    }
+
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(json_path == "-" ? spdlog::level::warn : spdlog::level::info);
+
+    nlohmann::json report;
+    report["benchmark"] = "p2p_bench";
+    report["duration_ms"] = duration.count();
+    report["results"] = nlohmann::json::array();
+
+    _logger->info("{:>7} {:>9} {:>6} {:>10} {:>11} {:>8} {:>9} {:>9} {:>9} {:>10}", "mode", "workload", "bytes",
+                  "received", "msgs/s", "MB/s", "p50 us", "p99 us", "p999 us", "CPU us/msg");
+    int round = 0;
+    for (const auto& mode : kModes) {
+        for (const auto& size : kPayloadSizes) {
+            for (const auto& workload : {ping_pong, flood}) {
+                // A fresh pair per run, so no callback is swapped under a live receive path
+                auto a_config = host_only_config(mode.value);
+                auto b_config = a_config;
+                if (mode.value == JUICE_CONCURRENCY_MODE_MUX) {
+                    // Both agents on one mux socket would be indistinguishable: give each its own port
+                    a_config.local_port_begin = a_config.local_port_end = kMuxPort;
+                    b_config.local_port_begin = b_config.local_port_end = kMuxPort + 1;
+                }
+                PeerConnection a(true, "A-" + std::to_string(round), a_config);
+                PeerConnection b(false, "B-" + std::to_string(round), b_config);
+                ++round;
+                if (!bench::connectPair(a, b)) {
+                    _logger->error("{}: connection failed", mode.name);
+                    return 1;
+                }
+
+                const auto& result = workload(a, b, size, duration);
+                const auto& msgs_per_sec = result.received / result.seconds;
+                const auto& mb_per_sec = msgs_per_sec * size / 1e6;
+                const auto& cpu_us_per_msg = result.received ? result.cpu_seconds * 1e6 / result.received : 0.0;
+
+                nlohmann::json entry;
+                entry["mode"] = mode.name;
+                entry["workload"] = result.workload;
+                entry["payload_bytes"] = size;
+                entry["sent"] = result.sent;
+                entry["received"] = result.received;
+                entry["msgs_per_sec"] = msgs_per_sec;
+                entry["mb_per_sec"] = mb_per_sec;
+                entry["cpu_us_per_msg"] = cpu_us_per_msg;
+                if (result.rtt_us.empty()) {
+                    entry["rtt_us"] = nullptr;
+                } else {
+                    entry["rtt_us"] = {
+                        {"p50", bench::percentile(result.rtt_us, 50)},
+                        {"p99", bench::percentile(result.rtt_us, 99)},
+                        {"p999", bench::percentile(result.rtt_us, 99.9)},
+                    };
+                }
+                report["results"].push_back(entry);
+
+                if (result.rtt_us.empty()) {
+                    _logger->info("{:>7} {:>9} {:>6} {:>10} {:>11.0f} {:>8.1f} {:>9} {:>9} {:>9} {:>10.2f}", mode.name,
+                                  result.workload, size, result.received, msgs_per_sec, mb_per_sec, "-", "-", "-",
+                                  cpu_us_per_msg);
+                } else {
+                    _logger->info("{:>7} {:>9} {:>6} {:>10} {:>11.0f} {:>8.1f} {:>9.1f} {:>9.1f} {:>9.1f} {:>10.2f}",
+                                  mode.name, result.workload, size, result.received, msgs_per_sec, mb_per_sec,
+                                  bench::percentile(result.rtt_us, 50), bench::percentile(result.rtt_us, 99),
+                                  bench::percentile(result.rtt_us, 99.9), cpu_us_per_msg);
+                }
+            }
+        }
+    }
+
+    if (json_path == "-") {
+        std::cout << report.dump(2) << std::endl;
+    } else if (!json_path.empty()) {
+        std::ofstream out(json_path);
+        if (!out) {
+            _logger->error("Cannot write {}", json_path);
+            return 1;
+        }
+        out << report.dump(2) << std::endl;
+        _logger->info("Results written to {}", json_path);
+    }
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include "BenchUtil.h"
+#include "PeerManager.h"
+
+#include <malloc.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Creates N idle peers bound to loopback in each concurrency mode and reports the process thread
+// count, resident memory and CPU time, both for bulk creation and for an idle window afterwards.
+// Usage: peer_scale_bench [N...] (default 1000 5000 10000)
+namespace {
+    constexpr auto kIdleWindow = std::chrono::seconds(2);
+
+    const char* modeName(juice_concurrency_mode mode) {
+        switch (mode) {
+            case JUICE_CONCURRENCY_MODE_POLL: return "POLL";
+            case JUICE_CONCURRENCY_MODE_MUX: return "MUX";
+            case JUICE_CONCURRENCY_MODE_THREAD: return "THREAD";
+            case JUICE_CONCURRENCY_MODE_URING: return "URING";
+        }
+        return "?";
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the manager loggers created below
+    _logger->set_level(spdlog::level::info);
+    bench::raiseFileLimit();
+
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (counts.empty()) {
+        counts = {1000, 5000, 10000};
+    }
+
+    _logger->info("{:>6} {:>6} {:>7} {:>7} {:>9} {:>11} {:>10} {:>12}", "mode", "peers", "created", "threads",
+                  "RSS MiB", "KiB/peer", "create/s", "idle CPU %");
+    for (const auto mode : {JUICE_CONCURRENCY_MODE_POLL, JUICE_CONCURRENCY_MODE_MUX, JUICE_CONCURRENCY_MODE_THREAD,
+                            JUICE_CONCURRENCY_MODE_URING}) {
+        for (const auto& count : counts) {
+            PeerManagerConfig config;
+            config.name = std::string("SCALE-") + modeName(mode);
+            config.peer.concurrency_mode = mode;
+            config.peer.bind_address = "127.0.0.1";
+            config.peer.host_only = true;
+
+            // Hand memory freed by the previous round back to the kernel so the RSS delta is per round
+            malloc_trim(0);
+            const long base_rss = bench::readStatusField("VmRSS:");
+
+            PeerManager manager(config);
+            const auto& start = std::chrono::steady_clock::now();
+            const auto& created = manager.createPeers(count).size();
+            manager.gatherAll();
+            const auto& create_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            const auto& idle_cpu_start = bench::cpuSeconds();
+            std::this_thread::sleep_for(kIdleWindow);
+            const auto& idle_cpu = (bench::cpuSeconds() - idle_cpu_start) / std::chrono::duration<double>(kIdleWindow).count();
+
+            const long rss = bench::readStatusField("VmRSS:");
+            _logger->info("{:>6} {:>6} {:>7} {:>7} {:>9.1f} {:>11.1f} {:>10.0f} {:>12.1f}", modeName(mode), count,
+                          created, bench::readStatusField("Threads:"), rss / 1024.0,
+                          created ? static_cast<double>(rss - base_rss) / created : 0.0,
+                          created / create_seconds, idle_cpu * 100.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "BenchUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Cost of a datagram in POLL mode as a function of how many agents share the poll thread: N idle
+// agents with gathered host sockets, plus one connected pair doing ping-pong over loopback. With a
+// pollfd array rebuilt on every wake-up the round-trip rate drops as N grows; with epoll it should
+// not. Build libjuice with -DDISABLE_EPOLL=ON to compare.
+// Usage: poll_dispatch_bench [N...] (default 0 1000 5000)
+namespace {
+    constexpr auto kWindow = std::chrono::seconds(2);
+    constexpr auto kGatherTimeout = std::chrono::minutes(1);
+
+    // Idle agents in the POLL registry, gathered so each one has a socket to poll
+    std::vector<juice_agent_t*> createIdle(size_t count) {
+        auto gathered = std::make_shared<std::atomic<size_t>>(0);
+        juice_config_t config{};
+        config.concurrency_mode = JUICE_CONCURRENCY_MODE_POLL;
+        config.bind_address = "127.0.0.1";
+        config.cb_gathering_done = [](juice_agent_t*, void* user_ptr) {
+            static_cast<std::atomic<size_t>*>(user_ptr)->fetch_add(1, std::memory_order_relaxed);
+        };
+        config.user_ptr = gathered.get();
+
+        std::vector<juice_agent_t*> agents;
+        agents.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            juice_agent_t* agent = juice_create(&config);
+            if (!agent) {
+                break;
+            }
+            agents.push_back(agent);
+            juice_gather_candidates(agent);
+        }
+        const auto& deadline = std::chrono::steady_clock::now() + kGatherTimeout;
+        while (gathered->load() < agents.size() && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return agents;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+    bench::raiseFileLimit();
+
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (counts.empty()) {
+        counts = {0, 1000, 5000};
+    }
+
+    _logger->info("{:>6} {:>12} {:>10} {:>12}", "idle", "round trips", "RTT us", "CPU us/trip");
+    for (const auto& count : counts) {
+        const auto& idle = createIdle(count);
+        if (idle.size() < count) {
+            _logger->warn("Only {} of {} idle agents could be created (file descriptor limit?)", idle.size(), count);
+        }
+
+        {
+            auto config = host_only_config(JUICE_CONCURRENCY_MODE_POLL);
+            config.bind_address = "127.0.0.1";
+            PeerConnection a(true, "PING", config);
+            PeerConnection b(false, "PONG", config);
+            if (!bench::connectPair(a, b)) {
+                _logger->error("Connection failed");
+                return 1;
+            }
+
+            std::atomic<bool> running{true};
+            std::atomic<uint64_t> trips{0};
+            b.onMessageView([&b](std::string_view msg) { b.send(msg); });
+            a.onMessageView([&a, &running, &trips](std::string_view msg) {
+                trips.fetch_add(1, std::memory_order_relaxed);
+                if (running.load(std::memory_order_relaxed)) {
+                    a.send(msg);
+                }
+            });
+
+            const auto& cpu_start = bench::cpuSeconds();
+            const auto& start = std::chrono::steady_clock::now();
+            a.send("ping");
+            std::this_thread::sleep_for(kWindow);
+            running = false;
+            const auto& seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const auto& cpu_seconds = bench::cpuSeconds() - cpu_start;
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+            const auto& done = trips.load();
+            _logger->info("{:>6} {:>12} {:>10.1f} {:>12.1f}", idle.size(), done,
+                          done ? seconds * 1e6 / done : 0.0, done ? cpu_seconds * 1e6 / done : 0.0);
+        }
+
+        for (auto* agent : idle) {
+            juice_destroy(agent);
+        }
+    }
+    return 0;
+}
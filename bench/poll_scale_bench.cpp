@@ -0,0 +1,170 @@
+#include "BenchUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Aggregate datagram rate of POLL mode as the agents are spread over more poll threads (see
+// juice_set_poll_config()). P loopback pairs each keep W small messages bouncing between their two
+// peers, so all receive processing and callbacks run on the poll threads; with enough cores the
+// rate should grow close to linearly with the thread count. "speedup" is relative to the first row.
+// Usage: poll_scale_bench [--pairs P] [--window W] [--seconds S] [--pin 0|1] [--hash 0|1] [THREADS...]
+// (default 64 pairs, window 8, 3 seconds, threads 1 2 4 8 16)
+namespace {
+    constexpr size_t kMessageSize = 64;
+    constexpr auto kDrainTime = std::chrono::milliseconds(200);
+
+    // One per peer, on its own cache line so that poll threads do not share counters
+    struct alignas(64) Counter {
+        std::atomic<uint64_t> value{0};
+    };
+
+    struct Result {
+        size_t pairs = 0;
+        double packets_per_second = 0.0;
+        double cpu_load = 0.0; // process CPU seconds per second
+        long os_threads = 0;
+    };
+
+    bool run(int threads, size_t pair_count, size_t window, std::chrono::seconds window_time, bool pin, bool hash,
+             const std::shared_ptr<spdlog::logger>& peer_logger, Result& result) {
+        juice_poll_config_t poll_config{};
+        poll_config.threads = threads;
+        poll_config.balance = hash ? JUICE_POLL_BALANCE_HASH : JUICE_POLL_BALANCE_LEAST_LOADED;
+        poll_config.pin_threads = pin;
+        if (juice_set_poll_config(&poll_config) != JUICE_ERR_SUCCESS) {
+            return false;
+        }
+
+        std::atomic<bool> running{true};
+        std::vector<Counter> counters(pair_count * 2);
+        std::vector<std::unique_ptr<PeerConnection>> peers;
+        for (size_t i = 0; i < pair_count; ++i) {
+            auto config = host_only_config(JUICE_CONCURRENCY_MODE_POLL);
+            config.bind_address = "127.0.0.1";
+            config.logger = peer_logger;
+            config.poll_affinity_key = static_cast<uint32_t>(i + 1); // with --hash, a pair shares a thread
+            auto a = std::make_unique<PeerConnection>(true, "A" + std::to_string(i), config);
+            auto b = std::make_unique<PeerConnection>(false, "B" + std::to_string(i), config);
+            if (!bench::connectPair(*a, *b)) {
+                return false;
+            }
+
+            auto* a_ptr = a.get();
+            auto* b_ptr = b.get();
+            auto* a_count = &counters[2 * i].value;
+            auto* b_count = &counters[2 * i + 1].value;
+            a->onMessageView([a_ptr, a_count, &running](std::string_view msg) {
+                a_count->fetch_add(1, std::memory_order_relaxed);
+                if (running.load(std::memory_order_relaxed)) {
+                    a_ptr->send(msg);
+                }
+            });
+            b->onMessageView([b_ptr, b_count](std::string_view msg) {
+                b_count->fetch_add(1, std::memory_order_relaxed);
+                b_ptr->send(msg);
+            });
+            peers.push_back(std::move(a));
+            peers.push_back(std::move(b));
+        }
+
+        const auto total = [&counters]() {
+            uint64_t sum = 0;
+            for (const auto& counter : counters) {
+                sum += counter.value.load(std::memory_order_relaxed);
+            }
+            return sum;
+        };
+
+        const std::string payload(kMessageSize, 's');
+        for (size_t i = 0; i < peers.size(); i += 2) {
+            for (size_t j = 0; j < window; ++j) {
+                peers[i]->send(payload);
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let every pair get going
+
+        const auto& start_packets = total();
+        const auto& cpu_start = bench::cpuSeconds();
+        const auto& start = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(window_time);
+        const auto& packets = total() - start_packets;
+        const auto& seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        const auto& cpu_seconds = bench::cpuSeconds() - cpu_start;
+        result.os_threads = bench::readStatusField("Threads:");
+        running = false;
+        std::this_thread::sleep_for(kDrainTime);
+
+        result.pairs = pair_count;
+        result.packets_per_second = packets / seconds;
+        result.cpu_load = cpu_seconds / seconds;
+        peers.clear(); // the poll threads stop with their last agent
+        return true;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t pairs = 64;
+    size_t window = 8;
+    long seconds = 3;
+    bool pin = false;
+    bool hash = false;
+    std::vector<int> thread_counts;
+    for (int i = 1; i < argc; ++i) {
+        const char* value = i + 1 < argc ? argv[i + 1] : "0";
+        if (std::strcmp(argv[i], "--pairs") == 0) {
+            pairs = std::strtoul(value, nullptr, 10);
+            ++i;
+        } else if (std::strcmp(argv[i], "--window") == 0) {
+            window = std::strtoul(value, nullptr, 10);
+            ++i;
+        } else if (std::strcmp(argv[i], "--seconds") == 0) {
+            seconds = std::strtol(value, nullptr, 10);
+            ++i;
+        } else if (std::strcmp(argv[i], "--pin") == 0) {
+            pin = std::strtol(value, nullptr, 10) != 0;
+            ++i;
+        } else if (std::strcmp(argv[i], "--hash") == 0) {
+            hash = std::strtol(value, nullptr, 10) != 0;
+            ++i;
+        } else {
+            thread_counts.push_back(static_cast<int>(std::strtol(argv[i], nullptr, 10)));
+        }
+    }
+    if (thread_counts.empty()) {
+        thread_counts = {1, 2, 4, 8, 16};
+    }
+
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn);
+    _logger->set_level(spdlog::level::info);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+    bench::raiseFileLimit();
+    const auto peer_logger = spdlog::stdout_color_mt("PEER");
+
+    _logger->info("{} pairs, {} messages of {} B in flight per pair, {} CPUs, pinning {}, {} balancing", pairs,
+                  window, kMessageSize, std::thread::hardware_concurrency(), pin ? "on" : "off",
+                  hash ? "hash" : "least-loaded");
+    _logger->info("{:>7} {:>12} {:>8} {:>9} {:>10}", "threads", "packets/s", "speedup", "CPU load", "OS threads");
+    double baseline = 0.0;
+    for (const auto& threads : thread_counts) {
+        Result result;
+        if (!run(threads, pairs, window, std::chrono::seconds(seconds), pin, hash, peer_logger, result)) {
+            _logger->error("Run with {} poll threads failed", threads);
+            return 1;
+        }
+        if (baseline <= 0.0) {
+            baseline = result.packets_per_second;
+        }
+        _logger->info("{:>7} {:>12.0f} {:>8.2f} {:>9.2f} {:>10}", threads, result.packets_per_second,
+                      baseline > 0.0 ? result.packets_per_second / baseline : 0.0, result.cpu_load,
+                      result.os_threads);
+    }
+    return 0;
+}
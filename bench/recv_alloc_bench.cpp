@@ -0,0 +1,174 @@
+#include "PeerConnection.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <string>
+#include <thread>
+
+// Heap allocations made by the calling thread. The receive callbacks run on the juice thread, so
+// sampling this counter from inside them isolates the allocations of the receive path.
+static thread_local std::size_t t_allocations = 0;
+
+void* operator new(std::size_t size) {
+    ++t_allocations;
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+namespace {
+    constexpr int kMessages = 20000;
+    constexpr std::size_t kPayloadSize = 512;
+
+    struct RecvProbe {
+        std::atomic<int> received{0};
+        std::size_t first_allocations = 0;
+        std::size_t last_allocations = 0;
+
+        void sample() {
+            const auto& count = received.fetch_add(1) + 1;
+            if (count == 1) {
+                first_allocations = t_allocations;
+            }
+            last_allocations = t_allocations;
+        }
+    };
+
+    struct Signal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool gathering_done = false;
+        bool connected = false;
+    };
+
+    void on_sender_state(juice_agent_t*, juice_state_t state, void* user_ptr) {
+        auto* signal = static_cast<Signal*>(user_ptr);
+        if (state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED) {
+            std::lock_guard<std::mutex> lock(signal->mutex);
+            signal->connected = true;
+            signal->cv.notify_all();
+        }
+    }
+
+    void on_sender_gathering_done(juice_agent_t*, void* user_ptr) {
+        auto* signal = static_cast<Signal*>(user_ptr);
+        std::lock_guard<std::mutex> lock(signal->mutex);
+        signal->gathering_done = true;
+        signal->cv.notify_all();
+    }
+
+    // Runs one receive pass. The sender is a bare juice agent so that only the receiving
+    // PeerConnection is measured.
+    bool run(const std::string& label, bool use_view) {
+        RecvProbe probe;
+        Signal signal;
+        std::atomic<bool> rx_connected{false};
+        std::atomic<bool> rx_gathering_done{false};
+
+        PeerConnection rx(false, "RX-" + label, host_only_config());
+        if (use_view) {
+            rx.onMessageView([&probe](std::string_view) { probe.sample(); });
+        } else {
+            rx.onMessage([&probe](const std::string&) { probe.sample(); });
+        }
+        rx.onStateChange([&rx_connected](juice_state state) {
+            if (state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED) {
+                rx_connected = true;
+            }
+        });
+        rx.onGatheringDone([&rx_gathering_done]() { rx_gathering_done = true; });
+
+        juice_config_t cfg{};
+        cfg.concurrency_mode = JUICE_CONCURRENCY_MODE_THREAD;
+        cfg.cb_state_changed = on_sender_state;
+        cfg.cb_gathering_done = on_sender_gathering_done;
+        cfg.user_ptr = &signal;
+        juice_agent_t* tx = juice_create(&cfg);
+        if (!tx) {
+            return false;
+        }
+
+        // SDP EXCHANGE (non-trickled: both sides gather fully first)
+        juice_gather_candidates(tx);
+        rx.startGathering();
+        {
+            std::unique_lock<std::mutex> lock(signal.mutex);
+            signal.cv.wait_for(lock, std::chrono::seconds(10), [&signal] { return signal.gathering_done; });
+        }
+        while (!rx_gathering_done) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        char tx_sdp[JUICE_MAX_SDP_STRING_LEN];
+        juice_get_local_description(tx, tx_sdp, sizeof(tx_sdp));
+        rx.setRemoteDescription(tx_sdp);
+        juice_set_remote_description(tx, rx.createAnswer().c_str());
+        juice_set_remote_gathering_done(tx);
+        rx.setRemoteGatheringDone();
+
+        {
+            std::unique_lock<std::mutex> lock(signal.mutex);
+            signal.cv.wait_for(lock, std::chrono::seconds(10), [&signal] { return signal.connected; });
+        }
+        const auto& deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!rx_connected && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (!signal.connected || !rx_connected) {
+            spdlog::error("[{}] connection failed", label);
+            juice_destroy(tx);
+            return false;
+        }
+
+        // SEND
+        const std::string payload(kPayloadSize, 'x');
+        const auto& start = std::chrono::steady_clock::now();
+        for (int i = 0; i < kMessages; ++i) {
+            while (juice_send(tx, payload.data(), payload.size()) == JUICE_ERR_AGAIN) {
+                std::this_thread::yield();
+            }
+            // Stay under the socket buffer so the receiver is not measured on drops
+            if (i % 64 == 63) {
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+            }
+        }
+
+        const auto& settle = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (probe.received < kMessages && std::chrono::steady_clock::now() < settle) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        const auto& elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        const int received = probe.received;
+        const double per_message = received > 1
+                ? static_cast<double>(probe.last_allocations - probe.first_allocations) / (received - 1)
+                : 0.0;
+        spdlog::info("[{:>7}] received {}/{} msgs of {} B in {:.3f}s, {:.3f} allocations/msg on receive thread",
+                     label, received, kMessages, kPayloadSize, elapsed, per_message);
+
+        juice_destroy(tx);
+        return true;
+    }
+}
+
+int main() {
+    spdlog::set_pattern("[%H:%M:%S.%e] [%n] %v");
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+
+    bool ok = run("owning", false);
+    ok = run("view", true) && ok;
+    return ok ? 0 : 1;
+}
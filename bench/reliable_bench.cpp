@@ -0,0 +1,106 @@
+#include "BenchUtil.h"
+#include "LossInjector.h"
+#include "ReliableChannel.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+// Goodput of ReliableChannel over a loopback pair while a LossInjector drops data and ACK datagrams
+// in both directions. Every message carries its index, so the receiver also verifies that delivery is
+// complete and in order.
+// Usage: reliable_bench [MiB per run] (default 32)
+namespace {
+    struct Result {
+        bool connected = false;
+        bool complete = false;
+        bool in_order = true;
+        uint64_t delivered = 0;
+        double seconds = 0.0;
+        ReliableStats tx_stats;
+        uint64_t injected = 0;
+    };
+
+    Result run(double loss_rate, size_t total_bytes, int round) {
+        Result result;
+        const auto& config = host_only_config();
+        PeerConnection tx(true, "TX-" + std::to_string(round), config);
+        PeerConnection rx(false, "RX-" + std::to_string(round), config);
+
+        LossInjector tx_loss(loss_rate, 2 * round + 1);
+        LossInjector rx_loss(loss_rate, 2 * round + 2);
+        ReliableChannel tx_channel(tx_loss.wrap([&tx](std::string_view d) { return tx.send(d); }));
+        ReliableChannel rx_channel(rx_loss.wrap([&rx](std::string_view d) { return rx.send(d); }));
+        tx.onMessageView([&tx_channel](std::string_view d) { tx_channel.input(d); });
+
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<bool> in_order{true};
+        rx_channel.onMessage([&delivered, &in_order](std::string_view msg) {
+            uint64_t index = 0;
+            std::memcpy(&index, msg.data(), sizeof(index));
+            if (index != delivered.load(std::memory_order_relaxed)) {
+                in_order.store(false, std::memory_order_relaxed);
+            }
+            delivered.fetch_add(1, std::memory_order_relaxed);
+        });
+        rx.onMessageView([&rx_channel](std::string_view d) { rx_channel.input(d); });
+
+        // Loss starts after the handshake, which does not go through the channel anyway
+        if (!bench::connectPair(tx, rx)) {
+            spdlog::error("Connection failed");
+            return result;
+        }
+        result.connected = true;
+
+        std::string payload(tx_channel.maxPayload(), 'r');
+        const uint64_t messages = total_bytes / payload.size();
+        const auto& start = std::chrono::steady_clock::now();
+        for (uint64_t i = 0; i < messages; ++i) {
+            std::memcpy(payload.data(), &i, sizeof(i));
+            while (tx_channel.send(payload) == SendResult::Again) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        result.complete = tx_channel.flush(std::chrono::seconds(60));
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // The last ACK may arrive before the receiver callback returns
+        const auto& deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+        while (delivered.load() < messages && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        result.delivered = delivered.load() * payload.size();
+        result.complete = result.complete && delivered.load() == messages;
+        result.in_order = in_order.load();
+        result.tx_stats = tx_channel.stats();
+        result.injected = tx_loss.dropped() + rx_loss.dropped();
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+
+    const size_t total_bytes = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 32) * 1024 * 1024;
+
+    int round = 0;
+    _logger->info("{:>6} {:>10} {:>8} {:>8} {:>9} {:>8} {:>8} {:>9} {:>9}", "loss", "goodput", "complete",
+                  "ordered", "injected", "retrans", "RTOs", "srtt ms", "cwnd KiB");
+    for (const double loss : {0.0, 0.001, 0.005, 0.01, 0.02, 0.05, 0.10}) {
+        const auto& r = run(loss, total_bytes, round++);
+        if (!r.connected) {
+            return 1;
+        }
+        _logger->info("{:>5.1f}% {:>5.1f} MB/s {:>8} {:>8} {:>9} {:>8} {:>8} {:>9.3f} {:>9.0f}", loss * 100,
+                      r.seconds > 0 ? r.delivered / r.seconds / 1e6 : 0.0, r.complete ? "yes" : "NO",
+                      r.in_order ? "yes" : "NO", r.injected, r.tx_stats.retransmits, r.tx_stats.timeouts,
+                      r.tx_stats.srtt_ms, r.tx_stats.cwnd_bytes / 1024.0);
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+#include "BenchUtil.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Sender cost of small messages over a loopback POLL pair, sent one send() at a time or as
+// sendBatch() calls of 1 to 64 messages, which take the send mutex once and go out in a single
+// sendmmsg. A full socket buffer is retried after a yield, so every message is eventually sent;
+// "sender us/msg" is the CPU time of the sending thread only. Build libjuice with
+// -DDISABLE_SENDMMSG=ON to separate the lock from the syscall savings. With --offload 1 both peers
+// enable UDP segmentation and receive offload, so a batch goes out as one datagram train and
+// arrives coalesced; compare at file transfer sizes, e.g. --size 1200.
+// Usage: send_batch_bench [--messages N] [--size BYTES] [--offload 0|1]
+namespace {
+    constexpr std::array<size_t, 7> kBatchSizes = {1, 2, 4, 8, 16, 32, 64};
+    constexpr auto kDrainTime = std::chrono::milliseconds(200);
+
+    struct Result {
+        double seconds = 0.0;
+        double sender_cpu_seconds = 0.0;
+        size_t sent = 0;
+        uint64_t retries = 0;
+    };
+
+    double threadCpuSeconds() {
+        timespec ts{};
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return ts.tv_sec + ts.tv_nsec / 1e9;
+    }
+
+    Result run(PeerConnection& tx, size_t messages, size_t batch, bool batched, const std::string& payload) {
+        Result result;
+        const std::vector<std::string_view> msgs(batch, std::string_view(payload));
+        const auto& cpu_start = threadCpuSeconds();
+        const auto& start = std::chrono::steady_clock::now();
+        for (size_t done = 0; done < messages; done += batch) {
+            size_t sent = 0;
+            while (sent < batch) {
+                if (batched) {
+                    SendResult last = SendResult::Ok;
+                    if (sent == 0) {
+                        sent = tx.sendBatch(msgs, &last);
+                    } else {
+                        sent += tx.sendBatch(std::vector<std::string_view>(msgs.begin() + sent, msgs.end()), &last);
+                    }
+                    if (last == SendResult::Ok) {
+                        continue;
+                    }
+                    if (last != SendResult::Again) {
+                        return result;
+                    }
+                } else {
+                    const auto& last = tx.send(msgs[sent]);
+                    if (last == SendResult::Ok) {
+                        ++sent;
+                        continue;
+                    }
+                    if (last != SendResult::Again) {
+                        return result;
+                    }
+                }
+                ++result.retries;
+                std::this_thread::yield();
+            }
+            result.sent += sent;
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.sender_cpu_seconds = threadCpuSeconds() - cpu_start;
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    size_t messages = 200000;
+    size_t size = 64;
+    bool offload = false;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* value = argv[i + 1];
+        if (std::strcmp(argv[i], "--messages") == 0) {
+            messages = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--size") == 0) {
+            size = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--offload") == 0) {
+            offload = std::strtoul(value, nullptr, 10) != 0;
+        }
+    }
+
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+
+    auto config = host_only_config(JUICE_CONCURRENCY_MODE_POLL);
+    config.bind_address = "127.0.0.1";
+    config.udp_offload = offload;
+    PeerConnection tx(true, "TX", config);
+    PeerConnection rx(false, "RX", config);
+    std::atomic<uint64_t> delivered{0};
+    rx.onMessageView([&delivered](std::string_view) { delivered.fetch_add(1, std::memory_order_relaxed); });
+    if (!bench::connectPair(tx, rx)) {
+        _logger->error("Connection failed");
+        return 1;
+    }
+
+    const std::string payload(size, 'b');
+    _logger->info("{} messages of {} B per run, UDP offload {}", messages, size, offload ? "on" : "off");
+    _logger->info("{:>5} {:>6} {:>10} {:>14} {:>9} {:>10}", "batch", "api", "msgs/s", "sender us/msg", "retries",
+                  "delivered");
+    for (const auto& batch : kBatchSizes) {
+        for (const bool batched : {false, true}) {
+            delivered = 0;
+            const auto& result = run(tx, messages, batch, batched, payload);
+            std::this_thread::sleep_for(kDrainTime);
+            if (result.seconds <= 0.0) {
+                _logger->error("Send failed");
+                return 1;
+            }
+            _logger->info("{:>5} {:>6} {:>10.0f} {:>14.2f} {:>9} {:>10}", batch, batched ? "batch" : "send",
+                          result.sent / result.seconds, result.sender_cpu_seconds * 1e6 / result.sent, result.retries,
+                          delivered.load());
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "BenchUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Compares producers calling juice_send directly against the bounded send queue, at several
+// producer thread counts. Direct sends lose whatever hits a full socket buffer; queued producers
+// throttle on the watermark callbacks instead, and the sender thread retries a full socket buffer,
+// so the queue drops nothing (q-dropped). Datagrams can still be lost after leaving: on loopback the
+// receiving socket overflows when its thread falls behind, which shows as accepted - delivered.
+// Only end-to-end flow control such as ReliableChannel prevents that.
+namespace {
+    constexpr int kTotalMessages = 200000;
+    constexpr size_t kPayloadSize = 256;
+
+    struct Result {
+        int accepted = 0;
+        int rejected = 0;
+        uint64_t queue_dropped = 0;
+        int delivered = 0;
+        double seconds = 0.0;
+    };
+
+    Result run(int producers, bool queued, int round) {
+        Result result;
+        const auto& suffix = std::to_string(round);
+        const auto& config = host_only_config();
+        PeerConnection tx(true, "TX-" + suffix, config);
+        PeerConnection rx(false, "RX-" + suffix, config);
+
+        std::atomic<int> delivered{0};
+        std::atomic<std::chrono::steady_clock::rep> last_delivery{0};
+        rx.onMessageView([&delivered, &last_delivery](std::string_view) {
+            delivered.fetch_add(1, std::memory_order_relaxed);
+            last_delivery.store(std::chrono::steady_clock::now().time_since_epoch().count(), std::memory_order_relaxed);
+        });
+
+        std::mutex throttle_mutex;
+        std::condition_variable throttle_cv;
+        std::atomic<bool> paused{false};
+        if (queued) {
+            SendQueueOptions options;
+            options.capacity = 4096;
+            options.high_watermark = 3072;
+            options.low_watermark = 1024;
+            tx.enableSendQueue(options);
+            tx.onSendQueueHigh([&paused](size_t) { paused = true; });
+            tx.onSendQueueLow([&](size_t) {
+                std::lock_guard<std::mutex> lock(throttle_mutex);
+                paused = false;
+                throttle_cv.notify_all();
+            });
+        }
+
+        if (!bench::connectPair(tx, rx)) {
+            spdlog::error("Connection failed");
+            return result;
+        }
+
+        std::atomic<int> accepted{0};
+        std::atomic<int> rejected{0};
+        const auto& start = std::chrono::steady_clock::now();
+
+        std::vector<std::thread> threads;
+        for (int p = 0; p < producers; ++p) {
+            const int count = kTotalMessages / producers + (p < kTotalMessages % producers ? 1 : 0);
+            threads.emplace_back([&, count]() {
+                const std::string payload(kPayloadSize, 'q');
+                for (int i = 0; i < count; ++i) {
+                    if (queued && paused.load(std::memory_order_relaxed)) {
+                        std::unique_lock<std::mutex> lock(throttle_mutex);
+                        throttle_cv.wait_for(lock, std::chrono::milliseconds(5), [&paused] { return !paused; });
+                    }
+
+                    auto status = tx.send(std::string_view(payload));
+                    while (queued && status == SendResult::Again) {
+                        std::this_thread::yield();
+                        status = tx.send(std::string_view(payload));
+                    }
+
+                    if (status == SendResult::Ok) {
+                        accepted.fetch_add(1, std::memory_order_relaxed);
+                    } else {
+                        rejected.fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        // Wait for the queue to drain and the receiver to go quiet
+        int last = -1;
+        while (tx.sendQueueSize() > 0 || delivered.load() != last) {
+            last = delivered.load();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+
+        const auto& end = std::chrono::steady_clock::time_point(std::chrono::steady_clock::duration(last_delivery.load()));
+        result.seconds = std::chrono::duration<double>(end - start).count();
+        result.accepted = accepted;
+        result.rejected = rejected;
+        result.queue_dropped = tx.sendQueueDropped();
+        result.delivered = delivered;
+        return result;
+    }
+}
+
+int main() {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+
+    int round = 0;
+    _logger->info("{:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>12}", "producers", "mode", "accepted", "rejected",
+                  "q-dropped", "delivered", "delivered/s");
+    for (int producers : {1, 8, 64}) {
+        for (bool queued : {false, true}) {
+            const auto& r = run(producers, queued, round++);
+            _logger->info("{:>9} {:>7} {:>9} {:>9} {:>9} {:>9} {:>12.0f}", producers, queued ? "queued" : "direct",
+                          r.accepted, r.rejected, r.queue_dropped, r.delivered,
+                          r.seconds > 0 ? r.delivered / r.seconds : 0.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "BenchUtil.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+// Connectivity storm on libjuice's simulated network: N pairs of agents, each agent behind its own
+// port-restricted cone NAT, all gathering through one simulated STUN server and then checking at
+// once over a network with latency, jitter and loss. Everything runs on the virtual clock in this
+// thread, so a run is repeatable and not bound by wall time. Reports how long the storm took in
+// virtual time, the per-pair connection time percentiles, and how much faster than real time the
+// simulation ran.
+// Usage: sim_storm_bench [PAIRS...] (default 100 1000 2500)
+namespace {
+    constexpr int kStepMs = 10;
+    constexpr int kTimeoutMs = 120000;
+    constexpr const char* kStunServer = "198.51.100.1";
+    constexpr uint16_t kStunPort = 3478;
+
+    struct Peer {
+        juice_agent_t* agent = nullptr;
+        bool done = false; // connected or failed
+        int64_t connected_ms = -1; // virtual time from the description exchange
+        int64_t* exchange_ms = nullptr;
+        size_t* pending = nullptr;
+    };
+
+    int64_t simElapsedMs() {
+        juice_sim_stats_t stats{};
+        juice_sim_get_stats(&stats);
+        return stats.elapsed_ms;
+    }
+
+    // Pair i is x.y = i: its hosts are 10.1.x.y and 10.2.x.y, behind the NATs 100.64.x.y and 100.65.x.y
+    std::string address(int first, int side, size_t i) {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "%d.%d.%zu.%zu", first, side, (i >> 8) & 0xFF, i & 0xFF);
+        return buffer;
+    }
+
+    // Advances in steps until pending reaches zero or the timeout
+    void advanceUntil(const size_t& pending) {
+        for (int elapsed = 0; pending > 0 && elapsed < kTimeoutMs; elapsed += kStepMs) {
+            juice_sim_advance(kStepMs);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    _logger->set_level(spdlog::level::info);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (counts.empty()) {
+        counts = {100, 1000, 2500};
+    }
+
+    juice_sim_config_t sim_config{};
+    sim_config.seed = 1;
+    sim_config.latency_ms = 30;
+    sim_config.jitter_ms = 10;
+    sim_config.loss = 0.01;
+    sim_config.stun_server_address = kStunServer;
+    sim_config.stun_server_port = kStunPort;
+
+    _logger->info("{} ms one-way latency, {} ms jitter, {:.0f} % loss", sim_config.latency_ms, sim_config.jitter_ms,
+                  sim_config.loss * 100.0);
+    _logger->info("{:>6} {:>9} {:>9} {:>10} {:>11} {:>11} {:>8} {:>9} {:>11}", "pairs", "connected", "gather s",
+                  "connect s", "conn p50ms", "conn p99ms", "wall s", "speedup", "events/s");
+    for (const auto& count : counts) {
+        if (count > 65536) {
+            _logger->error("At most 65536 pairs");
+            return 1;
+        }
+        if (juice_sim_start(&sim_config) != JUICE_ERR_SUCCESS) {
+            _logger->error("Simulation start failed");
+            return 1;
+        }
+        const auto& wall_start = std::chrono::steady_clock::now();
+
+        size_t pending = 2 * count;
+        int64_t exchange_ms = 0;
+        std::vector<Peer> peers(2 * count);
+        std::vector<std::string> hosts(2 * count);
+        for (size_t i = 0; i < peers.size(); ++i) {
+            const int side = static_cast<int>(i % 2) + 1;
+            hosts[i] = address(10, side, i / 2);
+            juice_sim_set_nat(hosts[i].c_str(), address(100, 63 + side, i / 2).c_str(),
+                              JUICE_SIM_NAT_PORT_RESTRICTED_CONE);
+
+            auto& peer = peers[i];
+            peer.exchange_ms = &exchange_ms;
+            peer.pending = &pending;
+
+            juice_config_t config{};
+            config.concurrency_mode = JUICE_CONCURRENCY_MODE_SIM;
+            config.stun_server_host = kStunServer;
+            config.stun_server_port = kStunPort;
+            config.bind_address = hosts[i].c_str();
+            config.cb_gathering_done = [](juice_agent_t*, void* user_ptr) {
+                auto* peer = static_cast<Peer*>(user_ptr);
+                --*peer->pending;
+            };
+            config.cb_state_changed = [](juice_agent_t*, juice_state_t state, void* user_ptr) {
+                auto* peer = static_cast<Peer*>(user_ptr);
+                const bool connected = state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED;
+                if ((connected || state == JUICE_STATE_FAILED) && !peer->done) {
+                    peer->done = true;
+                    if (connected) {
+                        peer->connected_ms = simElapsedMs() - *peer->exchange_ms;
+                    }
+                    --*peer->pending;
+                }
+            };
+            config.user_ptr = &peer;
+            peer.agent = juice_create(&config);
+        }
+
+        // GATHER, host and server reflexive candidates
+        for (auto& peer : peers) {
+            juice_gather_candidates(peer.agent);
+        }
+        advanceUntil(pending);
+        exchange_ms = simElapsedMs();
+
+        // CONNECT, full descriptions exchanged at once
+        pending = 2 * count;
+        char sdp[JUICE_MAX_SDP_STRING_LEN];
+        for (size_t i = 0; i < count; ++i) {
+            juice_agent_t* a = peers[2 * i].agent;
+            juice_agent_t* b = peers[2 * i + 1].agent;
+            juice_get_local_description(a, sdp, sizeof(sdp));
+            juice_set_remote_description(b, sdp);
+            juice_get_local_description(b, sdp, sizeof(sdp));
+            juice_set_remote_description(a, sdp);
+            juice_set_remote_gathering_done(a);
+            juice_set_remote_gathering_done(b);
+        }
+        advanceUntil(pending);
+
+        juice_sim_stats_t stats{};
+        juice_sim_get_stats(&stats);
+        const auto& wall_seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+
+        size_t connected_pairs = 0;
+        std::vector<double> connect_ms;
+        for (size_t i = 0; i < count; ++i) {
+            const auto& a = peers[2 * i];
+            const auto& b = peers[2 * i + 1];
+            if (a.connected_ms >= 0 && b.connected_ms >= 0) {
+                ++connected_pairs;
+                connect_ms.push_back(static_cast<double>(std::max(a.connected_ms, b.connected_ms)));
+            }
+        }
+        const auto& virtual_seconds = stats.elapsed_ms / 1000.0;
+        _logger->info("{:>6} {:>9} {:>9.2f} {:>10.2f} {:>11.0f} {:>11.0f} {:>8.2f} {:>8.1f}x {:>11.0f}", count,
+                      connected_pairs, exchange_ms / 1000.0, virtual_seconds - exchange_ms / 1000.0,
+                      bench::percentile(connect_ms, 50), bench::percentile(connect_ms, 99), wall_seconds,
+                      virtual_seconds / wall_seconds, stats.events / wall_seconds);
+
+        for (auto& peer : peers) {
+            juice_destroy(peer.agent);
+        }
+        juice_sim_stop();
+    }
+    return 0;
+}
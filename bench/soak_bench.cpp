@@ -0,0 +1,245 @@
+#include "BenchUtil.h"
+#include "ImpairmentProxy.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Soak test through an ImpairmentProxy: every round connects a fresh POLL pair over the impaired
+// loopback path, streams sequenced messages from A to B, and cuts the path completely for a while
+// in the middle. Connectivity checks and consent freshness go through the same impairments as the
+// messages. Reports the distributions over rounds of time-to-connect, message loss outside the
+// outage, and recovery time: from the end of the outage to the first message B receives again.
+// Usage: soak_bench [--rounds N] [--loss P] [--duplicate P] [--reorder P] [--delay MS] [--jitter MS]
+//                   [--bandwidth BYTES/S] [--outage MS] [--duration MS]
+namespace {
+    constexpr auto kConnectTimeout = std::chrono::seconds(20);
+    constexpr auto kSendInterval = std::chrono::milliseconds(20);
+    constexpr size_t kMessageSize = 200;
+
+    struct Result {
+        bool connected = false;
+        double connect_ms = 0.0;
+        uint64_t sent = 0;     // outside the outage
+        uint64_t received = 0; // of those, counted once
+        double recovery_ms = -1.0;
+        ImpairmentStats a_to_b;
+        ImpairmentStats b_to_a;
+    };
+
+    struct Receiver {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int connected = 0;
+        std::vector<std::chrono::steady_clock::time_point> received_at; // first arrival per sequence
+    };
+
+    Result run(int round, const ImpairmentOptions& options, std::chrono::milliseconds outage,
+               std::chrono::milliseconds duration) {
+        Result result;
+        ImpairmentProxy proxy(options, static_cast<uint64_t>(round) + 1);
+        if (!proxy.isValid()) {
+            spdlog::error("Proxy bind failed");
+            return result;
+        }
+
+        auto config = host_only_config(JUICE_CONCURRENCY_MODE_POLL);
+        config.bind_address = "127.0.0.1";
+        PeerConnection a(true, "SOAK-A-" + std::to_string(round), config);
+        PeerConnection b(false, "SOAK-B-" + std::to_string(round), config);
+
+        const size_t total = static_cast<size_t>(duration / kSendInterval);
+        Receiver receiver;
+        receiver.received_at.resize(total);
+        for (auto* pc : {&a, &b}) {
+            pc->onStateChange([&receiver, seen = std::make_shared<bool>(false)](juice_state state) {
+                if ((state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED) && !*seen) {
+                    *seen = true;
+                    std::lock_guard<std::mutex> lock(receiver.mutex);
+                    ++receiver.connected;
+                    receiver.cv.notify_all();
+                }
+            });
+        }
+        b.onMessageView([&receiver](std::string_view msg) {
+            uint64_t seq = 0;
+            if (msg.size() < sizeof(seq)) {
+                return;
+            }
+            std::memcpy(&seq, msg.data(), sizeof(seq));
+            const auto& now = std::chrono::steady_clock::now();
+            std::lock_guard<std::mutex> lock(receiver.mutex);
+            if (seq < receiver.received_at.size() && receiver.received_at[seq].time_since_epoch().count() == 0) {
+                receiver.received_at[seq] = now;
+            }
+        });
+
+        // Host-only gathering completes in startGathering()
+        const auto& connect_start = std::chrono::steady_clock::now();
+        if (!a.startGathering() || !b.startGathering()
+            || !b.setRemoteDescription(proxy.descriptionForB(a.createOffer()))
+            || !a.setRemoteDescription(proxy.descriptionForA(b.createAnswer()))) {
+            spdlog::error("Description exchange failed");
+            return result;
+        }
+        a.setRemoteGatheringDone();
+        b.setRemoteGatheringDone();
+        {
+            std::unique_lock<std::mutex> lock(receiver.mutex);
+            result.connected = receiver.cv.wait_for(lock, kConnectTimeout, [&receiver] {
+                return receiver.connected == 2;
+            });
+        }
+        result.connect_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - connect_start).count();
+        if (!result.connected) {
+            return result;
+        }
+
+        // The outage sits in the middle of the stream
+        const auto& stream_start = std::chrono::steady_clock::now();
+        const auto& outage_start = stream_start + (duration - outage) / 2;
+        const auto& outage_end = outage_start + outage;
+        ImpairmentOptions blackout = options;
+        blackout.loss = 1.0;
+
+        std::vector<bool> in_outage(total, false);
+        bool cut = false;
+        std::string msg(kMessageSize, 'm');
+        for (uint64_t seq = 0; seq < total; ++seq) {
+            std::this_thread::sleep_until(stream_start + seq * kSendInterval);
+            const auto& now = std::chrono::steady_clock::now();
+            const bool outage_now = now >= outage_start && now < outage_end;
+            if (outage_now != cut) {
+                proxy.setOptions(outage_now ? blackout : options);
+                cut = outage_now;
+            }
+            in_outage[seq] = outage_now;
+            std::memcpy(msg.data(), &seq, sizeof(seq));
+            a.send(std::string_view(msg));
+        }
+        proxy.setOptions(options);
+        // Let the tail drain through the delay and the reorder hold-back
+        std::this_thread::sleep_for(options.delay + options.jitter + options.reorder_delay
+                                    + std::chrono::milliseconds(200));
+
+        std::lock_guard<std::mutex> lock(receiver.mutex);
+        for (size_t seq = 0; seq < total; ++seq) {
+            const auto& at = receiver.received_at[seq];
+            const bool received = at.time_since_epoch().count() != 0;
+            if (!in_outage[seq]) {
+                ++result.sent;
+                result.received += received ? 1 : 0;
+            }
+            if (received && at >= outage_end) {
+                const auto& recovery = std::chrono::duration<double, std::milli>(at - outage_end).count();
+                result.recovery_ms = result.recovery_ms < 0.0 ? recovery : std::min(result.recovery_ms, recovery);
+            }
+        }
+        result.a_to_b = proxy.statsAtoB();
+        result.b_to_a = proxy.statsBtoA();
+        return result;
+    }
+
+    void add(ImpairmentStats& total, const ImpairmentStats& stats) {
+        total.forwarded += stats.forwarded;
+        total.lost += stats.lost;
+        total.queue_dropped += stats.queue_dropped;
+        total.duplicated += stats.duplicated;
+        total.reordered += stats.reordered;
+    }
+}
+
+int main(int argc, char** argv) {
+    int rounds = 10;
+    ImpairmentOptions options;
+    options.loss = 0.05;
+    options.duplicate = 0.01;
+    options.reorder = 0.02;
+    options.delay = std::chrono::milliseconds(20);
+    options.jitter = std::chrono::milliseconds(10);
+    auto outage = std::chrono::milliseconds(2000);
+    auto duration = std::chrono::milliseconds(6000);
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* value = argv[i + 1];
+        if (std::strcmp(argv[i], "--rounds") == 0) {
+            rounds = std::atoi(value);
+        } else if (std::strcmp(argv[i], "--loss") == 0) {
+            options.loss = std::atof(value);
+        } else if (std::strcmp(argv[i], "--duplicate") == 0) {
+            options.duplicate = std::atof(value);
+        } else if (std::strcmp(argv[i], "--reorder") == 0) {
+            options.reorder = std::atof(value);
+        } else if (std::strcmp(argv[i], "--delay") == 0) {
+            options.delay = std::chrono::milliseconds(std::atoi(value));
+        } else if (std::strcmp(argv[i], "--jitter") == 0) {
+            options.jitter = std::chrono::milliseconds(std::atoi(value));
+        } else if (std::strcmp(argv[i], "--bandwidth") == 0) {
+            options.bandwidth_bytes_per_sec = std::strtoull(value, nullptr, 10);
+        } else if (std::strcmp(argv[i], "--outage") == 0) {
+            outage = std::chrono::milliseconds(std::atoi(value));
+        } else if (std::strcmp(argv[i], "--duration") == 0) {
+            duration = std::chrono::milliseconds(std::atoi(value));
+        }
+    }
+    outage = std::min(outage, duration);
+
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+
+    _logger->info("{:.1f} % loss, {:.1f} % duplicate, {:.1f} % reorder, {} ms delay, {} ms jitter, {} B/s, "
+                  "{} ms outage in {} ms", options.loss * 100.0, options.duplicate * 100.0,
+                  options.reorder * 100.0, options.delay.count(), options.jitter.count(),
+                  options.bandwidth_bytes_per_sec, outage.count(), duration.count());
+    _logger->info("{:>5} {:>10} {:>8} {:>8} {:>8} {:>11}", "round", "connect ms", "sent", "received", "loss %",
+                  "recovery ms");
+
+    std::vector<double> connect_ms, loss_percent, recovery_ms;
+    int connect_failures = 0, recovery_failures = 0;
+    ImpairmentStats a_to_b, b_to_a;
+    for (int round = 0; round < rounds; ++round) {
+        const auto& result = run(round, options, outage, duration);
+        if (!result.connected) {
+            ++connect_failures;
+            _logger->info("{:>5} {:>10}", round, "FAILED");
+            continue;
+        }
+        connect_ms.push_back(result.connect_ms);
+        const auto& loss = result.sent ? 100.0 * (result.sent - result.received) / result.sent : 0.0;
+        loss_percent.push_back(loss);
+        if (result.recovery_ms >= 0.0) {
+            recovery_ms.push_back(result.recovery_ms);
+        } else {
+            ++recovery_failures;
+        }
+        add(a_to_b, result.a_to_b);
+        add(b_to_a, result.b_to_a);
+        _logger->info("{:>5} {:>10.1f} {:>8} {:>8} {:>8.2f} {:>11}", round, result.connect_ms, result.sent,
+                      result.received, loss,
+                      result.recovery_ms >= 0.0 ? fmt::format("{:.1f}", result.recovery_ms) : "never");
+    }
+
+    _logger->info("{:>12} {:>8} {:>8} {:>8} {:>8} {:>9}", "", "p50", "p90", "p99", "max", "failures");
+    const auto& summary = [&_logger](const char* name, const std::vector<double>& samples, int failures) {
+        _logger->info("{:>12} {:>8.2f} {:>8.2f} {:>8.2f} {:>8.2f} {:>9}", name, bench::percentile(samples, 50),
+                      bench::percentile(samples, 90), bench::percentile(samples, 99),
+                      bench::percentile(samples, 100), failures);
+    };
+    summary("connect ms", connect_ms, connect_failures);
+    summary("loss %", loss_percent, 0);
+    summary("recovery ms", recovery_ms, recovery_failures);
+    for (const auto& [name, stats] : {std::make_pair("A->B", a_to_b), std::make_pair("B->A", b_to_a)}) {
+        _logger->info("proxy {}: {} forwarded, {} lost, {} queue dropped, {} duplicated, {} reordered", name,
+                      stats.forwarded, stats.lost, stats.queue_dropped, stats.duplicated, stats.reordered);
+    }
+    return connect_failures + recovery_failures ? 1 : 0;
+}
@@ -0,0 +1,124 @@
+#include "BenchUtil.h"
+#include "StreamMux.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Chat latency while a bulk transfer saturates the same PeerConnection. "shared" puts chat and bulk
+// on one stream, which is what a single sendMessage queue amounts to; "prioritized" gives chat its
+// own EF stream at a higher priority than the CS1 bulk stream. A small pacing rate keeps the kernel
+// socket buffers, which know nothing about streams, from becoming the queue.
+namespace {
+    constexpr auto kDuration = std::chrono::seconds(3);
+    constexpr auto kChatInterval = std::chrono::milliseconds(2);
+    constexpr size_t kBulkChunk = 1024;
+    constexpr size_t kChatSize = 64;
+    constexpr uint64_t kPacing = 100 * 1000 * 1000;
+
+    struct Result {
+        std::vector<double> latencies_us;
+        int chat_sent = 0;
+        double bulk_mbps = 0.0;
+    };
+
+    Result run(bool prioritized, int round) {
+        Result result;
+        const auto& config = host_only_config();
+        PeerConnection tx(true, "TX-" + std::to_string(round), config);
+        PeerConnection rx(false, "RX-" + std::to_string(round), config);
+
+        StreamMuxOptions options;
+        options.pacing_bytes_per_sec = kPacing;
+        StreamMux tx_mux(tx, options);
+        StreamMux rx_mux(rx, options);
+
+        StreamOptions chat_options;
+        chat_options.name = "chat";
+        chat_options.dscp = 46;
+        StreamOptions bulk_options;
+        bulk_options.name = "bulk";
+        bulk_options.priority = 1;
+        bulk_options.dscp = 8;
+        for (auto* mux : {&tx_mux, &rx_mux}) {
+            mux->addStream(bulk_options);
+            mux->addStream(chat_options);
+        }
+        const StreamMux::StreamId bulk = 0;
+        const StreamMux::StreamId chat = prioritized ? 1 : 0;
+
+        std::mutex latency_mutex;
+        std::atomic<uint64_t> bulk_bytes{0};
+        rx_mux.onMessage([&](StreamMux::StreamId, std::string_view msg) {
+            if (msg.size() != kChatSize) {
+                bulk_bytes.fetch_add(msg.size(), std::memory_order_relaxed);
+                return;
+            }
+            int64_t sent_ns = 0;
+            std::memcpy(&sent_ns, msg.data(), sizeof(sent_ns));
+            const auto& now_ns = std::chrono::steady_clock::now().time_since_epoch().count();
+            std::lock_guard<std::mutex> lock(latency_mutex);
+            result.latencies_us.push_back((now_ns - sent_ns) / 1000.0);
+        });
+
+        if (!bench::connectPair(tx, rx)) {
+            spdlog::error("Connection failed");
+            return result;
+        }
+
+        std::atomic<bool> running{true};
+        std::thread bulk_thread([&]() {
+            const std::string chunk(kBulkChunk, 'b');
+            while (running) {
+                if (tx_mux.send(bulk, chunk) == SendResult::Again) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+            }
+        });
+
+        const auto& start = std::chrono::steady_clock::now();
+        std::string message(kChatSize, 'c');
+        while (std::chrono::steady_clock::now() - start < kDuration) {
+            std::this_thread::sleep_for(kChatInterval);
+            const int64_t now_ns = std::chrono::steady_clock::now().time_since_epoch().count();
+            std::memcpy(message.data(), &now_ns, sizeof(now_ns));
+            while (tx_mux.send(chat, message) == SendResult::Again) {
+                std::this_thread::yield();
+            }
+            ++result.chat_sent;
+        }
+        running = false;
+        bulk_thread.join();
+        result.bulk_mbps = bulk_bytes.load() / std::chrono::duration<double>(kDuration).count() / 1e6;
+
+        // Let the queued chat messages arrive
+        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        std::lock_guard<std::mutex> lock(latency_mutex);
+        return result;
+    }
+}
+
+int main() {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+
+    int round = 0;
+    _logger->info("{:>12} {:>11} {:>9} {:>9} {:>9} {:>9}", "mode", "chat recv", "p50 us", "p99 us",
+                  "max us", "bulk MB/s");
+    for (bool prioritized : {false, true}) {
+        const auto& r = run(prioritized, round++);
+        const auto& max = r.latencies_us.empty()
+                ? 0.0 : *std::max_element(r.latencies_us.begin(), r.latencies_us.end());
+        _logger->info("{:>12} {:>5}/{:<5} {:>9.0f} {:>9.0f} {:>9.0f} {:>9.1f}", prioritized ? "prioritized" : "shared",
+                      r.latencies_us.size(), r.chat_sent, bench::percentile(r.latencies_us, 50),
+                      bench::percentile(r.latencies_us, 99), max, r.bulk_mbps);
+    }
+    return 0;
+}
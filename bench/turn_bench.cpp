@@ -0,0 +1,228 @@
+#include "BenchUtil.h"
+
+#include <malloc.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// TURN relaying against an in-process juice_server on loopback, for a growing number of concurrent
+// allocations. Both peers of every pair allocate a relay and only advertise their relayed candidate,
+// so every message goes A -> server -> relay of A -> relay of B -> server -> B. The agents bind other
+// loopback addresses than the server: TURN permissions are per IP, which keeps the host candidates
+// from reaching the other relay directly. Reports the allocation setup time (gathering, from the
+// juice_get_stats() timestamps), the flood throughput with ChannelData and with Send indications, and
+// the CPU time of the server thread per delivered message (two relay hops).
+// Usage: turn_bench [PAIRS...] (default 1 10 100 1000)
+namespace {
+    constexpr const char* kServerAddress = "127.0.0.1";
+    constexpr const char* kAddressA = "127.0.0.2";
+    constexpr const char* kAddressB = "127.0.0.3";
+    constexpr auto kSetupTimeout = std::chrono::minutes(2);
+    constexpr auto kFloodDuration = std::chrono::seconds(2);
+    constexpr auto kDrainTime = std::chrono::milliseconds(200);
+    constexpr size_t kPayloadSize = 1024;
+
+    struct SetupSignal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        size_t gathered = 0;
+        size_t connected = 0;
+        size_t failed = 0;
+    };
+
+    // Keeps the session lines and the relayed candidates only
+    std::string relayOnly(const std::string& sdp) {
+        std::istringstream in(sdp);
+        std::string out, line;
+        while (std::getline(in, line)) {
+            if (line.rfind("a=candidate:", 0) != 0 || line.find(" typ relay") != std::string::npos) {
+                out += line;
+                out += '\n';
+            }
+        }
+        return out;
+    }
+
+    struct Run {
+        size_t connected = 0;
+        std::vector<double> allocation_ms;
+        double gather_seconds = 0.0;
+        double connect_seconds = 0.0;
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        double seconds = 0.0;
+        double server_cpu_seconds = 0.0;
+    };
+
+    // A fresh server per run: allocations of destroyed agents stay until their lifetime expires
+    juice_server_t* createServer(size_t allocations) {
+        juice_server_credentials_t credentials{};
+        credentials.username = "bench";
+        credentials.password = "bench";
+        credentials.allocations_quota = 0; // unlimited
+
+        juice_server_config_t config{};
+        config.credentials = &credentials;
+        config.credentials_count = 1;
+        config.max_allocations = static_cast<int>(allocations);
+        config.bind_address = kServerAddress;
+        config.external_address = kServerAddress;
+        return juice_server_create(&config);
+    }
+
+    Run run(size_t pairs, uint16_t server_port, bool send_indication, const std::shared_ptr<spdlog::logger>& logger) {
+        PeerConnectionConfig config_a;
+        config_a.concurrency_mode = JUICE_CONCURRENCY_MODE_POLL;
+        config_a.bind_address = kAddressA;
+        config_a.stun_server_host.clear();
+        config_a.turn_servers.push_back({kServerAddress, server_port, "bench", "bench"});
+        config_a.turn_send_indication = send_indication;
+        config_a.logger = logger;
+        PeerConnectionConfig config_b = config_a;
+        config_b.bind_address = kAddressB;
+
+        Run result;
+        auto signal = std::make_shared<SetupSignal>();
+        std::vector<std::unique_ptr<PeerConnection>> a_side, b_side;
+        for (size_t i = 0; i < pairs; ++i) {
+            a_side.push_back(std::make_unique<PeerConnection>(true, "A-" + std::to_string(i), config_a));
+            b_side.push_back(std::make_unique<PeerConnection>(false, "B-" + std::to_string(i), config_b));
+        }
+        for (auto* side : {&a_side, &b_side}) {
+            for (const auto& pc : *side) {
+                pc->onGatheringDone([signal]() {
+                    std::lock_guard<std::mutex> lock(signal->mutex);
+                    ++signal->gathered;
+                    signal->cv.notify_all();
+                });
+            }
+        }
+        for (const auto& pc : a_side) {
+            pc->onStateChange([signal, seen = std::make_shared<bool>(false)](juice_state state) {
+                const auto& connected = state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED;
+                if ((connected || state == JUICE_STATE_FAILED) && !*seen) {
+                    *seen = true;
+                    std::lock_guard<std::mutex> lock(signal->mutex);
+                    ++(connected ? signal->connected : signal->failed);
+                    signal->cv.notify_all();
+                }
+            });
+        }
+
+        // ALLOCATE
+        const auto& gather_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pairs; ++i) {
+            a_side[i]->startGathering();
+            b_side[i]->startGathering();
+        }
+        std::unique_lock<std::mutex> lock(signal->mutex);
+        signal->cv.wait_for(lock, kSetupTimeout, [&] { return signal->gathered == 2 * pairs; });
+        lock.unlock();
+        result.gather_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - gather_start).count();
+        for (auto* side : {&a_side, &b_side}) {
+            for (const auto& pc : *side) {
+                const auto& transport = pc->stats().transport;
+                if (transport.gathering_done_ms >= 0) {
+                    result.allocation_ms.push_back(static_cast<double>(transport.gathering_done_ms
+                                                                       - transport.gathering_ms));
+                }
+            }
+        }
+
+        // CONNECT
+        const auto& connect_start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < pairs; ++i) {
+            if (!b_side[i]->setRemoteDescription(relayOnly(a_side[i]->createOffer()))
+                || !a_side[i]->setRemoteDescription(relayOnly(b_side[i]->createAnswer()))) {
+                logger->error("Offer/answer failed for pair {}", i);
+                continue;
+            }
+            a_side[i]->setRemoteGatheringDone();
+            b_side[i]->setRemoteGatheringDone();
+        }
+        lock.lock();
+        signal->cv.wait_for(lock, kSetupTimeout, [&] { return signal->connected + signal->failed == pairs; });
+        result.connected = signal->connected;
+        lock.unlock();
+        result.connect_seconds =
+                std::chrono::duration<double>(std::chrono::steady_clock::now() - connect_start).count();
+
+        // FLOOD, round robin over the pairs
+        auto received = std::make_shared<std::atomic<uint64_t>>(0);
+        for (const auto& pc : b_side) {
+            pc->onMessageView([received](std::string_view) { received->fetch_add(1, std::memory_order_relaxed); });
+        }
+        const std::string message(kPayloadSize, 't');
+        const auto& cpu_start = bench::threadCpuSeconds("juice server");
+        const auto& start = std::chrono::steady_clock::now();
+        while (std::chrono::steady_clock::now() - start < kFloodDuration) {
+            for (const auto& pc : a_side) {
+                const auto& sent = pc->send(message);
+                if (sent == SendResult::Ok) {
+                    ++result.sent;
+                } else if (sent == SendResult::Again) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::this_thread::sleep_for(kDrainTime);
+        result.server_cpu_seconds = bench::threadCpuSeconds("juice server") - cpu_start;
+        result.received = received->load();
+        return result;
+    }
+}
+
+int main(int argc, char** argv) {
+    const auto _logger = spdlog::stdout_color_mt("BENCH");
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+    _logger->set_level(spdlog::level::info);
+    bench::raiseFileLimit();
+
+    std::vector<size_t> counts;
+    for (int i = 1; i < argc; ++i) {
+        counts.push_back(std::strtoul(argv[i], nullptr, 10));
+    }
+    if (counts.empty()) {
+        counts = {1, 10, 100, 1000};
+    }
+    const auto& peer_logger = spdlog::stdout_color_mt("PEERS");
+
+    _logger->info("TURN server on {}, {} byte messages, {} s flood", kServerAddress, kPayloadSize,
+                  std::chrono::duration<double>(kFloodDuration).count());
+    _logger->info("{:>6} {:>8} {:>9} {:>10} {:>10} {:>10} {:>9} {:>11} {:>8} {:>13}", "pairs", "framing", "connected",
+                  "alloc p50", "alloc p99", "gather s", "connect s", "msgs/s", "MB/s", "server us/msg");
+    for (const auto& count : counts) {
+        for (const bool send_indication : {false, true}) {
+            // Hand memory freed by the previous round back to the kernel
+            malloc_trim(0);
+            juice_server_t* server = createServer(2 * count);
+            if (!server) {
+                _logger->error("TURN server creation failed");
+                return 1;
+            }
+            const auto& result = run(count, juice_server_get_port(server), send_indication, peer_logger);
+            juice_server_destroy(server);
+            const auto& msgs_per_sec = result.received / result.seconds;
+            _logger->info("{:>6} {:>8} {:>9} {:>8.0f}ms {:>8.0f}ms {:>10.2f} {:>9.2f} {:>11.0f} {:>8.1f} {:>13.2f}",
+                          count, send_indication ? "send" : "channel", result.connected,
+                          bench::percentile(result.allocation_ms, 50), bench::percentile(result.allocation_ms, 99),
+                          result.gather_seconds, result.connect_seconds, msgs_per_sec,
+                          msgs_per_sec * kPayloadSize / 1e6,
+                          result.received ? result.server_cpu_seconds * 1e6 / result.received : 0.0);
+            if (result.connected < count) {
+                _logger->warn("Only {} of {} pairs connected", result.connected, count);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Runs PeerConnection user callbacks. Anything but InlineExecutor keeps slow handlers off the juice
+// I/O thread, which in POLL and MUX modes is shared by every agent of the registry.
+class CallbackExecutor {
+public:
+    virtual ~CallbackExecutor() = default;
+
+    virtual void post(std::function<void()> task) = 0;
+
+    // Inline executors let PeerConnection call handlers directly, keeping the zero-copy receive path
+    virtual bool runsInline() const {
+        return false;
+    }
+};
+
+// Runs tasks on the posting thread (the juice I/O thread for PeerConnection callbacks).
+class InlineExecutor : public CallbackExecutor {
+public:
+    void post(std::function<void()> task) override;
+    bool runsInline() const override;
+};
+
+// Worker threads sharing one task queue. Each wakeup drains up to max_batch tasks under a single lock.
+// May be destroyed from one of its own tasks: that worker is detached and finishes the queue alone.
+class ThreadPoolExecutor : public CallbackExecutor {
+public:
+    explicit ThreadPoolExecutor(size_t threads = std::thread::hardware_concurrency(), size_t max_batch = 64,
+                                const std::string& name = "cb pool");
+    ~ThreadPoolExecutor() override;
+
+    void post(std::function<void()> task) override;
+    size_t threadCount() const;
+
+private:
+    // Shared with the workers, so a detached one does not outlive what it uses
+    struct State {
+        size_t max_batch = 64;
+        std::string name;
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<std::function<void()>> tasks;
+        bool stop = false;
+    };
+
+    static void run(const std::shared_ptr<State>& state);
+
+    std::shared_ptr<State> _state;
+    std::vector<std::thread> _threads;
+};
+
+// Single dedicated callback thread.
+class ThreadExecutor : public ThreadPoolExecutor {
+public:
+    explicit ThreadExecutor(size_t max_batch = 64, const std::string& name = "cb thread");
+};
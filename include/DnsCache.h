@@ -0,0 +1,45 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Process-wide cache of server hostname lookups. PeerConnection hands libjuice the numeric address
+// from here once it is known, so later agents skip libjuice's per-agent resolver thread and only
+// one lookup of a name pays for DNS. Failed lookups are cached for a shorter time.
+class DnsCache {
+public:
+    static DnsCache& instance();
+
+    // Numeric address for host (IPv4 preferred), or empty on failure. Numeric hosts are returned
+    // as-is. Blocks only on a miss; concurrent misses for the same host share one lookup.
+    std::string resolve(const std::string& host, uint16_t port);
+    // Numeric address if it is already known, otherwise empty after starting a background lookup.
+    // Never blocks.
+    std::string cached(const std::string& host, uint16_t port);
+    // Starts a lookup in the background so a later resolve() does not block
+    void prefetch(const std::string& host, uint16_t port);
+
+    void setTtl(std::chrono::seconds ttl, std::chrono::seconds negative_ttl);
+    void clear();
+    size_t size() const;
+
+private:
+    DnsCache() = default;
+
+    struct Entry {
+        std::shared_future<std::string> result;
+        std::chrono::steady_clock::time_point expires;
+    };
+
+    std::shared_future<std::string> lookup(const std::string& host, uint16_t port, bool async);
+    static std::string query(const std::string& host, uint16_t port);
+
+    mutable std::mutex _mutex;
+    std::unordered_map<std::string, Entry> _entries;
+    std::chrono::seconds _ttl{300};
+    std::chrono::seconds _negative_ttl{10};
+};
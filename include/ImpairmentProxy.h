@@ -0,0 +1,105 @@
+#pragma once
+
+#include <netinet/in.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Impairments applied to each direction of an ImpairmentProxy
+struct ImpairmentOptions {
+    double loss = 0.0;      // probability to drop a datagram
+    double duplicate = 0.0; // probability to forward a datagram twice
+    double reorder = 0.0;   // probability to hold a datagram back by reorder_delay, so later ones overtake it
+    std::chrono::milliseconds reorder_delay{20};
+    std::chrono::milliseconds delay{0};  // one-way
+    std::chrono::milliseconds jitter{0}; // extra delay drawn uniformly in [0, jitter]
+    uint64_t bandwidth_bytes_per_sec = 0; // 0: unlimited
+    size_t queue_bytes = 64 * 1024;       // bottleneck buffer: datagrams that do not fit are dropped
+};
+
+struct ImpairmentStats {
+    uint64_t forwarded = 0;
+    uint64_t lost = 0;
+    uint64_t queue_dropped = 0;
+    uint64_t duplicated = 0;
+    uint64_t reordered = 0;
+};
+
+// UDP relay between two local agents A and B that degrades the path between them with loss,
+// duplication, reordering, delay and jitter, and a bandwidth cap in front of a bounded queue.
+// Everything crosses it, connectivity and consent checks included. The proxy binds one socket
+// facing each agent; hand each agent the other's description through descriptionForA() and
+// descriptionForB() so that it only knows its peer through the proxy.
+class ImpairmentProxy {
+public:
+    explicit ImpairmentProxy(const ImpairmentOptions& options = {}, uint64_t seed = 1,
+                             const std::string& bind_address = "127.0.0.1");
+    ~ImpairmentProxy();
+
+    ImpairmentProxy(const ImpairmentProxy&) = delete;
+    ImpairmentProxy& operator=(const ImpairmentProxy&) = delete;
+
+    bool isValid() const;
+
+    // Keeps the first IPv4 UDP host candidate of B's description, records it as B's address and
+    // points it at the proxy. Pass the result to A.
+    std::string descriptionForA(const std::string& description_of_b);
+    std::string descriptionForB(const std::string& description_of_a);
+
+    // Takes effect from the next datagram in both directions, e.g. a loss of 1.0 for an outage
+    void setOptions(const ImpairmentOptions& options);
+    ImpairmentOptions options() const;
+
+    ImpairmentStats statsAtoB() const;
+    ImpairmentStats statsBtoA() const;
+
+private:
+    static constexpr int kSideA = 0;
+    static constexpr int kSideB = 1;
+
+    struct Pending {
+        std::chrono::steady_clock::time_point release;
+        uint64_t seq = 0; // keeps datagrams released at the same time in arrival order
+        int to = kSideA;
+        std::string data;
+
+        bool operator>(const Pending& other) const {
+            return release > other.release || (release == other.release && seq > other.seq);
+        }
+    };
+
+    struct Side {
+        int sock = -1;
+        sockaddr_in local{}; // where the agent on this side sends to reach the other one
+        sockaddr_in peer{};  // the agent on this side
+        bool has_peer = false;
+        std::chrono::steady_clock::time_point link_free; // when the bottleneck towards this side drains
+        ImpairmentStats stats;                           // of datagrams going out to this side
+    };
+
+    std::string rewrite(const std::string& description, int described, int facing);
+    void impairLocked(int to, std::string_view data, std::chrono::steady_clock::time_point now);
+    void run();
+
+    mutable std::mutex _mutex;
+    ImpairmentOptions _options;
+    std::mt19937_64 _rng;
+    std::uniform_real_distribution<double> _uniform{0.0, 1.0};
+    std::array<Side, 2> _sides;
+    std::priority_queue<Pending, std::vector<Pending>, std::greater<Pending>> _pending;
+    uint64_t _next_seq = 0;
+
+    std::atomic<bool> _stop{false};
+    std::thread _thread;
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include "PeerConnection.h"
+
+// Drops datagrams at random on their way to the transport, so loss recovery can be exercised over
+// loopback. Dropped datagrams report Ok, like a datagram lost on the path.
+class LossInjector {
+public:
+    explicit LossInjector(double loss_rate = 0.0, uint64_t seed = 1);
+
+    // The injector must outlive the returned sender
+    DatagramSender wrap(DatagramSender inner);
+
+    void setLossRate(double loss_rate);
+    uint64_t dropped() const;
+    uint64_t passed() const;
+
+private:
+    bool drop();
+
+    std::mutex _mutex;
+    std::mt19937_64 _rng;
+    std::uniform_real_distribution<double> _uniform{0.0, 1.0};
+    std::atomic<double> _loss_rate;
+    std::atomic<uint64_t> _dropped{0};
+    std::atomic<uint64_t> _passed{0};
+};
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "PeerConnection.h"
+#include "SendPacing.h"
+
+struct FramerOptions {
+    size_t fragment_size = 1200;                   // datagram size including the header; must match the peer's
+    size_t max_message_size = 64 * 1024 * 1024;    // larger sends return TooLarge, larger headers are dropped
+    size_t max_pending_messages = 64;              // reassembly window; the oldest partial message is evicted
+    size_t max_pending_bytes = 128 * 1024 * 1024;  // memory bound over all partial messages
+    std::chrono::milliseconds reassembly_timeout{5000};
+    std::chrono::milliseconds send_timeout{1000};  // how long one fragment may keep hitting Again
+    size_t pool_buffers = 8;                       // reassembly buffers kept for reuse
+    uint64_t pacing_bytes_per_sec = 0;             // 0: unpaced
+    size_t pacing_burst_bytes = 64 * 1024;
+};
+
+struct FramerStats {
+    uint64_t messages_sent = 0;
+    uint64_t fragments_sent = 0;
+    uint64_t messages_received = 0;
+    uint64_t fragments_received = 0;
+    uint64_t reassembly_timeouts = 0;
+    uint64_t evicted = 0; // partial messages pushed out of the reassembly window
+    uint64_t invalid = 0; // datagrams that are not fragments or contradict their message
+};
+
+// Splits messages into datagram-sized fragments and reassembles them on the other side.
+// Fragments are unreliable: a message is delivered only once all of its fragments arrived, and a
+// partial message is dropped after reassembly_timeout or when the window overflows.
+//
+// Wire format, big-endian, in front of every fragment:
+//   u8 magic | u8 reserved | u32 message id | u32 fragment index | u32 fragment count | u32 message size
+// Every fragment but the last carries fragment_size - kHeaderSize bytes of payload; fragments that
+// disagree with their message size are dropped.
+class MessageFramer {
+public:
+    static constexpr size_t kHeaderSize = 18;
+
+    // Generic transport: fragments go out through send_datagram and received datagrams are fed to input()
+    MessageFramer(DatagramSender send_datagram, FramerOptions options = {});
+    // Takes over pc's onMessageView callback. The framer must outlive pc's receive path: destroy pc first.
+    explicit MessageFramer(PeerConnection& pc, FramerOptions options = {});
+
+    MessageFramer(const MessageFramer&) = delete;
+    MessageFramer& operator=(const MessageFramer&) = delete;
+
+    // Blocks while the socket (or pacer) pushes back. Thread-safe.
+    SendResult send(std::string_view msg);
+
+    // Reassembled message, valid only during the callback
+    void onMessage(std::function<void(std::string_view)> cb);
+    void input(std::string_view datagram);
+    // Drops partial messages older than reassembly_timeout; also done lazily by input()
+    void expire();
+
+    size_t pendingMessages() const;
+    FramerStats stats() const;
+
+private:
+    struct Reassembly {
+        std::string buffer;
+        std::vector<bool> received;
+        uint32_t remaining = 0;
+        std::chrono::steady_clock::time_point started;
+        std::list<uint32_t>::iterator order; // in _pending_order
+    };
+
+    void expireLocked(std::chrono::steady_clock::time_point now);
+    void dropLocked(uint32_t id);
+    std::string acquireBuffer(size_t size);
+    void releaseBuffer(std::string&& buffer);
+
+    DatagramSender _send_datagram;
+    FramerOptions _options;
+    std::function<void(std::string_view)> _message_cb;
+    std::atomic<uint32_t> _next_id{1};
+
+    Pacer _pacer;
+
+    mutable std::mutex _recv_mutex;
+    std::unordered_map<uint32_t, Reassembly> _pending;
+    std::list<uint32_t> _pending_order; // arrival order of the pending message ids, oldest first
+    size_t _pending_bytes = 0;
+    std::vector<std::string> _pool;
+    std::chrono::steady_clock::time_point _last_expire;
+
+    std::atomic<uint64_t> _messages_sent{0};
+    std::atomic<uint64_t> _fragments_sent{0};
+    std::atomic<uint64_t> _messages_received{0};
+    std::atomic<uint64_t> _fragments_received{0};
+    std::atomic<uint64_t> _reassembly_timeouts{0};
+    std::atomic<uint64_t> _evicted{0};
+    std::atomic<uint64_t> _invalid{0};
+};
@@ -1,14 +1,62 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <future>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <string_view>
 #include <functional>
+#include <thread>
+#include <vector>
+#ifdef P2P_COROUTINES
+#include <coroutine>
+#endif
 #include <juice/juice.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include "CallbackExecutor.h"
+#include "PeerConnectionConfig.h"
+#include "SendQueue.h"
+
+// Outcome of a send call, mapped from the juice_send error codes.
+enum class SendResult {
+    Ok,
+    NotConnected, // no agent, or ICE has not reached connected/completed yet
+    Again,        // JUICE_ERR_AGAIN: socket buffer full, retry later
+    TooLarge,     // JUICE_ERR_TOO_LARGE: datagram exceeds what the path or libjuice accepts
+    Failed,
+};
+
+const char* send_result_to_string(SendResult result);
+
+// Datagram sink used by the layers stacked on a PeerConnection (framing, reliability)
+using DatagramSender = std::function<SendResult(std::string_view)>;
+
+// Application-level message counters, updated with relaxed atomics.
+struct MessageCounters {
+    uint64_t messages_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t send_failures = 0;
+    uint64_t messages_received = 0;
+    uint64_t bytes_received = 0;
+};
+
+// Snapshot of everything a live connection counts. transport comes from juice_get_stats() and is
+// zeroed when there is no agent.
+struct ConnectionStats {
+    juice_stats_t transport{};
+    MessageCounters messages;
+    size_t send_queue_depth = 0;
+    uint64_t send_queue_dropped = 0;
+};
 
 class PeerConnection {
 public:
     PeerConnection(bool is_controlling = true, const std::string& name = "PeerConnection");
+    PeerConnection(bool is_controlling, const std::string& name, const PeerConnectionConfig& config);
     ~PeerConnection();
 
     bool startGathering();
@@ -18,27 +66,180 @@ public:
     void setRemoteGatheringDone();
     bool addRemoteCandidate(const std::string& candidate);
 
-    void sendMessage(const std::string& msg);
+    // Starts gathering unless already started and completes from the gathering-done callback, on the
+    // juice thread and before onGatheringDone. false when gathering could not start or the connection
+    // went away first.
+    std::future<bool> gatherAsync();
+    // Completes from the state callback on the first connected, completed or failed state, with that
+    // state; at once if already there. Connecting still takes the usual description exchange.
+    std::future<juice_state> connectAsync();
+    // Callback forms of the two above: done runs exactly once, inline when the outcome is already known.
+    void gatherThen(std::function<void(bool)> done);
+    void connectThen(std::function<void(juice_state)> done);
+
+#ifdef P2P_COROUTINES
+    // co_await pc.gather() / co_await pc.connect() continue at once when the outcome is already
+    // known. Otherwise the coroutine is resumed through the executor set with setExecutor(), or on
+    // the juice thread that completed the step when there is none: hop to an executor before
+    // blocking work then.
+    struct GatherAwaitable {
+        PeerConnection& pc;
+        bool result = false;
+        std::atomic<bool> completed{false}; // by whichever of await_suspend and the completion runs last
+
+        bool await_ready() { return pc.gatherOutcome(result); }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            pc.gatherThen([this, handle](bool success) {
+                result = success;
+                if (completed.exchange(true)) {
+                    pc.resumeAwaiter(handle);
+                }
+            });
+            return !completed.exchange(true); // false: completed inline, continue without suspending
+        }
+        bool await_resume() const noexcept { return result; }
+    };
+
+    struct ConnectAwaitable {
+        PeerConnection& pc;
+        juice_state result = JUICE_STATE_DISCONNECTED;
+        std::atomic<bool> completed{false};
+
+        bool await_ready() { return pc.connectOutcome(result); }
+        bool await_suspend(std::coroutine_handle<> handle) {
+            pc.connectThen([this, handle](juice_state state) {
+                result = state;
+                if (completed.exchange(true)) {
+                    pc.resumeAwaiter(handle);
+                }
+            });
+            return !completed.exchange(true);
+        }
+        juice_state await_resume() const noexcept { return result; }
+    };
+
+    GatherAwaitable gather() { return {*this}; }
+    ConnectAwaitable connect() { return {*this}; }
+#endif
+
+    SendResult send(const std::byte* data, size_t size);
+    SendResult send(std::string_view msg);
+    SendResult send(const char* msg);
+    // With a send queue, msg's buffer is taken over when its capacity is at least a slot's
+    SendResult send(std::string&& msg);
+    // Sends with the given DS field (DSCP << 2) through juice_send_diffserv; never goes through the send queue
+    SendResult sendDiffserv(std::string_view msg, int ds);
+    // Sends msgs in order and stops at the first failure. Returns how many were sent; the failure, if
+    // any, is reported through result. Without a send queue the whole batch goes through
+    // juice_send_batch, one lock and one sendmmsg for up to 64 messages.
+    size_t sendBatch(const std::vector<std::string_view>& msgs, SendResult* result = nullptr);
+    bool sendMessage(const std::string& msg);
 
+    // Routes every later send() through a bounded queue drained by a per-connection sender thread.
+    // Queued sends return Again when the queue is full and TooLarge beyond the slot size; a full
+    // socket buffer is retried by the sender thread instead of dropping the datagram. Nothing is
+    // lost on the sending side, but a receiver that falls behind still drops datagrams: use a
+    // ReliableChannel when every message has to arrive.
+    void enableSendQueue(const SendQueueOptions& options = {});
+    // Called on the producer thread when the depth reaches high_watermark, and on the sender thread
+    // when it drains back to low_watermark. Producers should pause between the two.
+    void onSendQueueHigh(std::function<void(size_t)> cb);
+    void onSendQueueLow(std::function<void(size_t)> cb);
+    size_t sendQueueSize() const;
+    uint64_t sendQueueDropped() const;
+
+    bool isValid() const;
     juice_state getState() const;
+    // Last state reported by the agent callback; never takes the agent lock
+    juice_state getCachedState() const;
+    bool isConnected() const;
+    MessageCounters counters() const;
+    // Takes the agent lock briefly for the RTT and phase timestamps; the counters are lock-free
+    ConnectionStats stats() const;
+    const std::string& name() const;
 
+    // Owning callback: copies every datagram into a std::string before delivery.
     void onMessage(std::function<void(const std::string&)> cb);
+    // Zero-copy callback: the view points into the juice receive buffer and is only valid for the
+    // duration of the call.
+    void onMessageView(std::function<void(std::string_view)> cb);
     void onStateChange(std::function<void(juice_state)> cb);
     void onCandidate(std::function<void(const std::string&)> cb);
     void onGatheringDone(std::function<void()> cb);
 
+    // Moves user callbacks off the juice I/O thread. Events keep their order and are handed to the
+    // executor in batches of up to max_batch per task. Received datagrams are copied once so they
+    // outlive the juice buffer. Call before startGathering(); nullptr restores inline delivery.
+    void setExecutor(std::shared_ptr<CallbackExecutor> executor, size_t max_batch = 64);
+
 private:
+    struct CallbackEvent;
+    struct CallbackQueue;
+
     juice_agent* _agent = nullptr;
     bool _is_controlling;
-    bool _message_sent = false;
+    // Mirrors the agent state from on_state_cb so the send path never takes the agent lock
+    std::atomic<bool> _connected{false};
+    std::atomic<juice_state> _state{JUICE_STATE_DISCONNECTED};
     std::string _name;
     std::shared_ptr<spdlog::logger> _logger;
+    bool _owns_logger = false;
+
+    std::atomic<uint64_t> _messages_sent{0};
+    std::atomic<uint64_t> _bytes_sent{0};
+    std::atomic<uint64_t> _send_failures{0};
+    std::atomic<uint64_t> _messages_received{0};
+    std::atomic<uint64_t> _bytes_received{0};
+
+    SendResult countSend(int err, size_t size);
 
     std::function<void(const std::string&)> _msg_cb;
+    std::function<void(std::string_view)> _msg_view_cb;
     std::function<void(juice_state)> _state_cb;
     std::function<void(const std::string&)> _candidate_cb;
     std::function<void()> _gathering_done_cb;
 
+    // CALLBACK EXECUTOR (null: callbacks run inline on the juice thread)
+    std::shared_ptr<CallbackQueue> _callback_queue;
+
+    void deliver(const CallbackEvent& event);
+    void deliverMessage(std::string_view msg);
+
+    // ASYNC (one-shot continuations of gatherAsync/connectAsync, run from the juice callbacks)
+    std::mutex _async_mutex;
+    bool _gathering_started = false;
+    bool _gathered = false;
+    std::vector<std::function<void(bool)>> _gather_waiters;
+    std::vector<std::function<void(juice_state)>> _connect_waiters;
+
+    void completeGathering(bool success);
+    void completeConnect(juice_state state);
+#ifdef P2P_COROUTINES
+    // true with the outcome when it is already known
+    bool gatherOutcome(bool& success);
+    bool connectOutcome(juice_state& state);
+    void resumeAwaiter(std::coroutine_handle<> handle);
+#endif
+
+    // SEND QUEUE
+    SendQueueOptions _queue_options;
+    std::unique_ptr<SendQueue> _send_queue;
+    std::mutex _producer_mutex; // serializes producers onto the single-producer ring
+    std::thread _drain_thread;
+    std::mutex _drain_mutex;
+    std::condition_variable _drain_cv;
+    std::atomic<bool> _drain_stop{false};
+    std::atomic<bool> _drain_idle{false};
+    std::atomic<bool> _above_high{false};
+    std::atomic<uint64_t> _queue_dropped{0};
+    std::function<void(size_t)> _queue_high_cb;
+    std::function<void(size_t)> _queue_low_cb;
+
+    template<typename T>
+    SendResult enqueue(T&& msg);
+    void drainLoop();
+    void stopSendQueue();
+
     static void on_data_cb(juice_agent* agent, const char* data, size_t size, void* user_ptr);
     static void on_state_cb(juice_agent* agent, juice_state state, void* user_ptr);
     static void on_candidate_cb(juice_agent* agent, const char* sdp, void* user_ptr);
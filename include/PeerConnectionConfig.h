@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <juice/juice.h>
+#include <spdlog/spdlog.h>
+
+struct PeerConnectionConfig {
+    // THREAD: one OS thread and socket per agent. POLL: agents share one thread, one socket each.
+    // MUX: agents share one thread and one socket (the first agent's port range picks it).
+    juice_concurrency_mode concurrency_mode = JUICE_CONCURRENCY_MODE_THREAD;
+    // POLL with juice_set_poll_config() hash balancing: peers with the same non-zero key share a thread
+    uint32_t poll_affinity_key = 0;
+
+    std::string bind_address; // empty: any
+    uint16_t local_port_begin = 0;
+    uint16_t local_port_end = 0;
+
+    std::string stun_server_host = "stun.l.google.com"; // empty: no STUN server
+    uint16_t stun_server_port = 19302;
+
+    struct TurnServer {
+        std::string host;
+        uint16_t port = 3478;
+        std::string username;
+        std::string password;
+    };
+    std::vector<TurnServer> turn_servers; // ignored in MUX mode
+    // Relay data in TURN Send indications rather than ChannelData (36 bytes of framing instead of 4)
+    bool turn_send_indication = false;
+    // Linux: send equal-sized sendBatch() runs as one UDP_SEGMENT datagram train and let the kernel
+    // coalesce received ones (GRO). Falls back to plain datagrams where unsupported.
+    bool udp_offload = false;
+
+    // Gather host candidates only, ignoring STUN and TURN: gathering completes inside startGathering()
+    // without any network round trip. For LAN and same-datacenter peers.
+    bool host_only = false;
+    // Hand libjuice server addresses already resolved in the process-wide DnsCache. On a miss the
+    // hostname is passed through (libjuice resolves it in the background) and the cache starts a
+    // lookup for later peers.
+    bool use_dns_cache = true;
+    // With use_dns_cache, wait for the lookup on a miss instead of passing the hostname through
+    bool dns_cache_blocking = false;
+
+    // Shared logger for large peer counts; by default each connection registers one under its name
+    std::shared_ptr<spdlog::logger> logger;
+};
+
+// Config for peers that only need host candidates (loopback, LAN, same datacenter).
+inline PeerConnectionConfig host_only_config(juice_concurrency_mode mode = JUICE_CONCURRENCY_MODE_THREAD) {
+    PeerConnectionConfig config;
+    config.concurrency_mode = mode;
+    config.host_only = true;
+    return config;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "PeerConnection.h"
+
+struct PeerManagerConfig {
+    std::string name = "PeerManager";
+    // Defaults to POLL: one juice thread for every peer instead of one per peer
+    PeerConnectionConfig peer = [] {
+        PeerConnectionConfig config;
+        config.concurrency_mode = JUICE_CONCURRENCY_MODE_POLL;
+        return config;
+    }();
+    // Optional executor shared by every peer's callbacks
+    std::shared_ptr<CallbackExecutor> executor;
+    size_t executor_max_batch = 64;
+};
+
+struct PeerManagerStats {
+    size_t peers = 0;
+    std::array<size_t, JUICE_STATE_FAILED + 1> states{}; // indexed by juice_state
+    MessageCounters counters;
+
+    size_t connected() const {
+        return states[JUICE_STATE_CONNECTED] + states[JUICE_STATE_COMPLETED];
+    }
+};
+
+// Owns a set of PeerConnections that share one configuration, logger and (optionally) executor.
+class PeerManager {
+public:
+    using PeerId = uint64_t;
+
+    explicit PeerManager(PeerManagerConfig config = {});
+    ~PeerManager();
+
+    PeerManager(const PeerManager&) = delete;
+    PeerManager& operator=(const PeerManager&) = delete;
+
+    // Creates up to count peers; stops at the first agent that cannot be created (e.g. out of sockets)
+    std::vector<PeerId> createPeers(size_t count, bool is_controlling = true);
+    std::shared_ptr<PeerConnection> peer(PeerId id) const;
+    std::vector<PeerId> peerIds() const;
+
+    // Starts gathering on every peer, returns how many started
+    size_t gatherAll();
+
+    size_t destroyPeers(const std::vector<PeerId>& ids);
+    void destroyAll();
+
+    size_t size() const;
+    PeerManagerStats stats() const;
+
+private:
+    std::vector<std::shared_ptr<PeerConnection>> snapshot() const;
+
+    PeerManagerConfig _config;
+    std::shared_ptr<spdlog::logger> _logger;
+
+    mutable std::mutex _mutex;
+    std::unordered_map<PeerId, std::shared_ptr<PeerConnection>> _peers;
+    PeerId _next_id = 1;
+};
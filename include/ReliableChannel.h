@@ -0,0 +1,176 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "PeerConnection.h"
+
+struct ReliableOptions {
+    size_t mss = 1200;                          // datagram size including the header
+    size_t send_buffer_packets = 4096;          // queued + unacknowledged packets; send() returns Again beyond
+    size_t recv_window_packets = 4096;          // out-of-order packets held back for reordering
+    size_t initial_cwnd_packets = 10;
+    size_t min_cwnd_packets = 2;
+    std::chrono::milliseconds target_delay{25}; // LEDBAT queuing delay target
+    double gain = 1.0;                          // LEDBAT window gain
+    std::chrono::milliseconds min_rto{50};
+    std::chrono::milliseconds max_rto{2000};
+    std::chrono::milliseconds ack_delay{5};     // longest an in-order packet waits for its ACK
+    size_t ack_every = 2;                       // in-order packets per immediate ACK
+    uint32_t reorder_threshold = 3;             // packets SACKed above a hole before it counts as lost
+};
+
+struct ReliableStats {
+    uint64_t packets_sent = 0;
+    uint64_t retransmits = 0;
+    uint64_t timeouts = 0;
+    uint64_t packets_received = 0;
+    uint64_t duplicates = 0;
+    uint64_t acks_sent = 0;
+    uint64_t acks_received = 0;
+    uint64_t messages_delivered = 0;
+    double srtt_ms = 0.0;
+    double rto_ms = 0.0;
+    double queuing_delay_ms = 0.0;
+    size_t cwnd_bytes = 0;
+    size_t in_flight_bytes = 0;
+};
+
+// Reliable, ordered delivery of datagram-sized messages over an unreliable datagram transport.
+//
+// Every packet carries a sequence number and a send timestamp. The receiver answers with cumulative
+// ACKs plus up to kMaxSackBlocks SACK ranges, the echoed timestamp (RTT) and a one-way delay sample.
+// The sender retransmits holes reported by SACK and on RTO, and sizes its window with a LEDBAT-style
+// delay-based controller: slow start until queuing delay reaches half the target, then grow or shrink
+// towards target_delay, halving on loss. Bulk transfers thereby back off as soon as they start to
+// queue in front of interactive traffic. A hole counts as lost once reorder_threshold later packets
+// were SACKed, or once a packet sent a quarter RTT after it was acknowledged; a tail loss probe two
+// RTTs after the last progress recovers a lost tail before the RTO has to. Packets the transport
+// refuses with Again never left: they are held and sent again, without counting as lost.
+//
+// Messages are limited to maxPayload(); put a MessageFramer on top for larger ones.
+// A sender thread per channel transmits, retransmits and sends delayed ACKs.
+class ReliableChannel {
+public:
+    static constexpr size_t kDataHeaderSize = 10;
+    static constexpr size_t kMaxSackBlocks = 8;
+
+    ReliableChannel(DatagramSender send_datagram, ReliableOptions options = {});
+    // Takes over pc's onMessageView callback. The channel must outlive pc's receive path: destroy pc first.
+    explicit ReliableChannel(PeerConnection& pc, ReliableOptions options = {});
+    ~ReliableChannel();
+
+    ReliableChannel(const ReliableChannel&) = delete;
+    ReliableChannel& operator=(const ReliableChannel&) = delete;
+
+    // Queues msg for delivery. Again when the send buffer is full, TooLarge above maxPayload(). Thread-safe.
+    SendResult send(std::string_view msg);
+    size_t maxPayload() const;
+
+    // In-order messages, valid only during the callback
+    void onMessage(std::function<void(std::string_view)> cb);
+    void input(std::string_view datagram);
+
+    // Waits until everything sent so far is acknowledged
+    bool flush(std::chrono::milliseconds timeout);
+    size_t bufferedPackets() const;
+    ReliableStats stats() const;
+
+private:
+    struct SeqLess {
+        bool operator()(uint32_t a, uint32_t b) const { return static_cast<int32_t>(a - b) < 0; }
+    };
+
+    struct Segment {
+        std::string payload;
+        uint64_t sent_us = 0; // last transmission, 0 when not sent yet
+        bool sacked = false;
+        bool lost = false;    // waiting for retransmission
+        bool in_flight = false;
+    };
+
+    void senderLoop();
+    bool onData(std::string_view datagram, std::string& ack, std::vector<std::string>& deliver);
+    void onAck(std::string_view datagram);
+    void ackSegment(Segment& segment, size_t& bytes_acked);
+    void detectLosses(uint64_t now);
+    void unsend(size_t sent, size_t count, uint64_t now);
+    void markLost(uint32_t seq, Segment& segment);
+    void onTimeout(uint64_t now);
+    void armTimer(uint64_t now);
+    void updateRtt(uint32_t sample_us);
+    void updateWindow(size_t bytes_acked, uint32_t delay_sample_us, uint64_t now);
+    void buildAck(std::string& out);
+    size_t transmit(std::vector<std::string>& out, uint64_t now);
+    void buildData(std::string& out, uint32_t seq, Segment& segment, uint64_t now);
+    uint64_t nowUs() const;
+
+    DatagramSender _send_datagram;
+    ReliableOptions _options;
+    std::function<void(std::string_view)> _message_cb;
+    const std::chrono::steady_clock::time_point _epoch;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    std::condition_variable _flush_cv;
+    bool _stop = false;
+    uint64_t _wake_us = 0; // when the sender thread will wake up on its own
+    std::thread _sender_thread;
+    std::vector<uint32_t> _batch_seqs; // sequence numbers of the data packets in the batch being sent
+    size_t _batch_retransmits = 0;     // how many of them, at the front, are retransmissions
+
+    // Sender: _segments holds [_snd_una, _snd_una + size), the first _snd_nxt - _snd_una already sent
+    std::deque<Segment> _segments;
+    std::vector<std::string> _spare; // payload buffers of acknowledged segments, reused by send()
+    uint32_t _snd_una = 0;
+    uint32_t _snd_nxt = 0;
+    uint32_t _highest_sacked = 0;
+    bool _has_sacked = false;
+    uint32_t _loss_scan = 0; // first transmissions below this were already checked for loss
+    std::deque<uint32_t> _lost; // waiting for retransmission, may hold stale entries
+    std::vector<uint32_t> _retransmitted; // retransmissions in flight, checked by send time
+    uint64_t _rack_xmit_us = 0; // latest send time of any acknowledged packet
+    size_t _in_flight = 0;
+    double _cwnd = 0.0;
+    double _ssthresh; // slow start below this window
+    bool _probe_sent = false; // tail loss probe sent since the last progress
+    uint32_t _recovery_seq = 0; // losses below this belong to the loss event already reacted to
+    bool _in_recovery = false;
+    double _srtt_us = 0.0;
+    double _rttvar_us = 0.0;
+    uint64_t _rto_us = 0;
+    uint64_t _rto_deadline_us = 0; // probe or retransmission timer, 0: stopped
+    std::array<uint32_t, 10> _base_delays{}; // per-minute minimum one-way delay, LEDBAT base history
+    size_t _base_index = 0;
+    uint64_t _base_minute = 0;
+    bool _has_base = false;
+    double _queuing_delay_us = 0.0;
+
+    // Receiver
+    uint32_t _rcv_nxt = 0;
+    std::map<uint32_t, std::string, SeqLess> _out_of_order;
+    uint32_t _echo_ts = 0;
+    uint32_t _delay_sample = 0;
+    size_t _unacked_received = 0;
+    uint64_t _ack_deadline_us = 0; // 0: no delayed ACK pending
+
+    std::atomic<uint64_t> _packets_sent{0};
+    std::atomic<uint64_t> _retransmits{0};
+    std::atomic<uint64_t> _timeouts{0};
+    std::atomic<uint64_t> _packets_received{0};
+    std::atomic<uint64_t> _duplicates{0};
+    std::atomic<uint64_t> _acks_sent{0};
+    std::atomic<uint64_t> _acks_received{0};
+    std::atomic<uint64_t> _messages_delivered{0};
+};
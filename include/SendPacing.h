@@ -0,0 +1,55 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "PeerConnection.h"
+
+// Token bucket for the senders that pace their datagrams. Thread-safe.
+class Pacer {
+public:
+    // 0 bytes per second: unpaced, pace() returns at once
+    Pacer(uint64_t bytes_per_sec, size_t burst_bytes);
+
+    // Sleeps until bytes fit in the budget, then spends them. A datagram larger than the burst
+    // still goes out, once the bucket is full.
+    void pace(size_t bytes);
+
+private:
+    const double _rate;
+    const double _burst;
+
+    std::mutex _mutex;
+    double _tokens;
+    std::chrono::steady_clock::time_point _last_refill;
+};
+
+// Waits between the attempts of a send that returned Again. A full socket buffer usually drains
+// within microseconds, so the first waits are short; they double up to kMaxWait so that a stalled
+// link is not polled at full speed. Not thread-safe: one per sending thread.
+class SendBackoff {
+public:
+    static constexpr std::chrono::microseconds kInitialWait{20};
+    static constexpr std::chrono::microseconds kMaxWait{1000};
+
+    void wait();
+    // After a send went through
+    void reset() { _wait = kInitialWait; }
+
+private:
+    std::chrono::microseconds _wait = kInitialWait;
+};
+
+// Calls send() until it returns something other than Again or keep_trying() turns false, backing
+// off in between. Returns the last result.
+template<typename Send, typename KeepTrying>
+SendResult send_retrying(Send&& send, KeepTrying&& keep_trying) {
+    auto result = send();
+    SendBackoff backoff;
+    while (result == SendResult::Again && keep_trying()) {
+        backoff.wait();
+        result = send();
+    }
+    return result;
+}
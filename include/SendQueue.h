@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct SendQueueOptions {
+    size_t capacity = 1024;      // slots, rounded up to a power of two
+    size_t high_watermark = 768; // onSendQueueHigh fires when the depth reaches this
+    size_t low_watermark = 256;  // onSendQueueLow fires when the depth drains back to this
+    size_t slot_size = 4096;     // bytes preallocated per slot (libjuice datagram limit)
+};
+
+// Bounded single-producer/single-consumer ring of pooled message buffers.
+// Every slot keeps its storage between uses, so steady-state pushes never allocate.
+class SendQueue {
+public:
+    explicit SendQueue(const SendQueueOptions& options);
+
+    // Producer side
+    bool push(std::string_view msg);
+    bool push(std::string&& msg); // takes msg's buffer if at least slot-sized, copies otherwise
+
+    // Consumer side
+    const std::string* front() const; // nullptr when empty
+    void pop();
+
+    size_t size() const;
+    size_t capacity() const;
+    size_t slotSize() const;
+
+private:
+    std::vector<std::string> _slots;
+    size_t _mask;
+    size_t _slot_size;
+
+    alignas(64) std::atomic<size_t> _head{0}; // next slot to consume
+    alignas(64) std::atomic<size_t> _tail{0}; // next slot to produce
+};
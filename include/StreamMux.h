@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "PeerConnection.h"
+#include "SendPacing.h"
+
+struct StreamOptions {
+    std::string name;
+    unsigned priority = 0;   // strict priority: a lower value is always served first
+    unsigned weight = 1;     // share of the link among streams with the same priority
+    int dscp = 0;            // DiffServ code point, e.g. 46 (EF) for chat, 8 (CS1) for bulk
+    size_t max_queued = 1024; // messages; send() returns Again beyond
+};
+
+struct StreamMuxOptions {
+    size_t quantum = 1500;            // bytes per weight unit and round of the deficit round robin
+    uint64_t pacing_bytes_per_sec = 0; // 0: unpaced. Pacing keeps the kernel queues, which ignore priorities, short.
+    size_t pacing_burst_bytes = 16 * 1024;
+};
+
+struct StreamStats {
+    uint64_t messages_sent = 0;
+    uint64_t bytes_sent = 0;
+    uint64_t send_failures = 0;
+    size_t queued = 0;
+};
+
+// Multiplexes several logical streams (chat, presence, file chunks...) over one PeerConnection.
+// Each stream has its own queue, priority and DSCP. A scheduler thread picks what goes on the wire
+// next: strict priority between priority levels, deficit round robin by weight within a level, so
+// a bulk transfer never sits in front of a chat message. Every datagram starts with a one-byte
+// stream id; messages are limited to one datagram (put a MessageFramer on a stream for more).
+class StreamMux {
+public:
+    using StreamId = uint8_t;
+    static constexpr size_t kHeaderSize = 1;
+    static constexpr size_t kMaxStreams = 256; // ids are one byte
+
+    // Takes over pc's onMessageView callback. The mux must outlive pc's receive path: destroy pc first.
+    explicit StreamMux(PeerConnection& pc, StreamMuxOptions options = {});
+    ~StreamMux();
+
+    StreamMux(const StreamMux&) = delete;
+    StreamMux& operator=(const StreamMux&) = delete;
+
+    // Streams are numbered in creation order; both sides must create the same streams. Up to
+    // kMaxStreams, nullopt beyond.
+    std::optional<StreamId> addStream(const StreamOptions& options);
+
+    // Queues msg on the stream. Again when the stream queue is full. Thread-safe.
+    SendResult send(StreamId stream, std::string_view msg);
+
+    // Messages of every stream, tagged with their stream id; valid only during the callback
+    void onMessage(std::function<void(StreamId, std::string_view)> cb);
+
+    StreamStats stats(StreamId stream) const;
+    size_t streamCount() const;
+
+private:
+    struct Stream {
+        StreamOptions options;
+        std::deque<std::string> queue; // datagrams, stream id included
+        size_t deficit = 0;
+        std::atomic<uint64_t> messages_sent{0};
+        std::atomic<uint64_t> bytes_sent{0};
+        std::atomic<uint64_t> send_failures{0};
+    };
+
+    void schedulerLoop();
+    Stream* pickLocked();
+
+    PeerConnection& _pc;
+    StreamMuxOptions _options;
+    std::function<void(StreamId, std::string_view)> _message_cb;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cv;
+    std::atomic<bool> _stop{false}; // written under _mutex, read without it while a send is retried
+    std::vector<std::unique_ptr<Stream>> _streams;
+    std::vector<std::string> _spare; // datagram buffers returned by the scheduler, reused by send()
+    size_t _queued = 0;
+    size_t _cursor = 0; // round robin position among the streams of the level being served
+    bool _new_visit = true;
+    Pacer _pacer;
+    std::thread _scheduler_thread;
+};
@@ -0,0 +1,93 @@
+#include "CallbackExecutor.h"
+
+#if defined(__linux__)
+#include <pthread.h>
+#endif
+
+void InlineExecutor::post(std::function<void()> task) {
+    task();
+}
+
+bool InlineExecutor::runsInline() const {
+    return true;
+}
+
+ThreadPoolExecutor::ThreadPoolExecutor(size_t threads, size_t max_batch, const std::string& name)
+    : _state(std::make_shared<State>()) {
+
+    _state->max_batch = max_batch ? max_batch : 1;
+    _state->name = name;
+    if (threads == 0) {
+        threads = 1;
+    }
+    _threads.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        _threads.emplace_back(&ThreadPoolExecutor::run, _state);
+    }
+}
+
+ThreadPoolExecutor::~ThreadPoolExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->stop = true;
+    }
+    _state->cv.notify_all();
+    for (auto& thread : _threads) {
+        // The last reference went away in one of our tasks: joining would deadlock
+        if (thread.get_id() == std::this_thread::get_id()) {
+            thread.detach();
+        } else {
+            thread.join();
+        }
+    }
+}
+
+void ThreadPoolExecutor::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(_state->mutex);
+        _state->tasks.push_back(std::move(task));
+    }
+    _state->cv.notify_one();
+}
+
+size_t ThreadPoolExecutor::threadCount() const {
+    return _threads.size();
+}
+
+void ThreadPoolExecutor::run(const std::shared_ptr<State>& state) {
+#if defined(__linux__)
+    pthread_setname_np(pthread_self(), state->name.substr(0, 15).c_str());
+#endif
+
+    std::vector<std::function<void()>> batch;
+    batch.reserve(state->max_batch);
+    while (true) {
+        bool more = false;
+        {
+            std::unique_lock<std::mutex> lock(state->mutex);
+            state->cv.wait(lock, [&state] { return state->stop || !state->tasks.empty(); });
+            if (state->tasks.empty()) {
+                return; // stopped and drained
+            }
+
+            while (!state->tasks.empty() && batch.size() < state->max_batch) {
+                batch.push_back(std::move(state->tasks.front()));
+                state->tasks.pop_front();
+            }
+            more = !state->tasks.empty();
+        }
+
+        // Let another worker pick up the remainder while this one runs its batch
+        if (more) {
+            state->cv.notify_one();
+        }
+        for (auto& task : batch) {
+            task();
+        }
+        batch.clear();
+    }
+}
+
+ThreadExecutor::ThreadExecutor(size_t max_batch, const std::string& name)
+    : ThreadPoolExecutor(1, max_batch, name) {
+}
@@ -0,0 +1,118 @@
+#include "DnsCache.h"
+
+#include <netdb.h>
+#include <sys/socket.h>
+
+#include <thread>
+
+DnsCache& DnsCache::instance() {
+    // Never destroyed: a detached prefetch may still be running at exit
+    static auto* cache = new DnsCache();
+    return *cache;
+}
+
+std::string DnsCache::resolve(const std::string& host, uint16_t port) {
+    return lookup(host, port, false).get();
+}
+
+void DnsCache::prefetch(const std::string& host, uint16_t port) {
+    lookup(host, port, true);
+}
+
+std::string DnsCache::cached(const std::string& host, uint16_t port) {
+    const auto& result = lookup(host, port, true);
+    if (result.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return {};
+    }
+    return result.get();
+}
+
+void DnsCache::setTtl(std::chrono::seconds ttl, std::chrono::seconds negative_ttl) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _ttl = ttl;
+    _negative_ttl = negative_ttl;
+}
+
+void DnsCache::clear() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _entries.clear();
+}
+
+size_t DnsCache::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _entries.size();
+}
+
+std::shared_future<std::string> DnsCache::lookup(const std::string& host, uint16_t port, bool async) {
+    const auto& key = host + ":" + std::to_string(port);
+    const auto& now = std::chrono::steady_clock::now();
+
+    std::promise<std::string> promise;
+    std::shared_future<std::string> future;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto& it = _entries.find(key);
+        if (it != _entries.end()) {
+            const auto& ready = it->second.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+            // A pending lookup is never expired; whoever started it sets the real expiry
+            if (!ready || now < it->second.expires) {
+                return it->second.result;
+            }
+        }
+        future = promise.get_future().share();
+        _entries[key] = Entry{future, std::chrono::steady_clock::time_point::max()};
+    }
+
+    auto finish = [this, key, host, port](std::promise<std::string> promise) {
+        auto address = query(host, port);
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto& it = _entries.find(key);
+            if (it != _entries.end()) {
+                it->second.expires = std::chrono::steady_clock::now() + (address.empty() ? _negative_ttl : _ttl);
+            }
+        }
+        promise.set_value(std::move(address));
+    };
+
+    if (async) {
+        std::thread(finish, std::move(promise)).detach();
+    } else {
+        finish(std::move(promise));
+    }
+    return future;
+}
+
+std::string DnsCache::query(const std::string& host, uint16_t port) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_protocol = IPPROTO_UDP;
+    hints.ai_flags = AI_ADDRCONFIG;
+    addrinfo* ai_list = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &ai_list) != 0) {
+        return {};
+    }
+
+    // Prefer IPv4 like libjuice does for its server entries
+    const addrinfo* chosen = nullptr;
+    for (const addrinfo* ai = ai_list; ai; ai = ai->ai_next) {
+        if (ai->ai_family == AF_INET) {
+            chosen = ai;
+            break;
+        }
+        if (ai->ai_family == AF_INET6 && !chosen) {
+            chosen = ai;
+        }
+    }
+
+    std::string address;
+    if (chosen) {
+        char buffer[NI_MAXHOST];
+        if (getnameinfo(chosen->ai_addr, chosen->ai_addrlen, buffer, sizeof(buffer), nullptr, 0, NI_NUMERICHOST) == 0) {
+            address = buffer;
+        }
+    }
+    freeaddrinfo(ai_list);
+    return address;
+}
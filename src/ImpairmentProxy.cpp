@@ -0,0 +1,234 @@
+#include "ImpairmentProxy.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <sstream>
+
+namespace {
+    constexpr size_t kMaxDatagramSize = 65536;
+    // Upper bound of a poll, so the destructor is noticed without a wakeup channel
+    constexpr auto kMaxPollWait = std::chrono::milliseconds(50);
+
+    int bindSocket(const std::string& address, sockaddr_in& local) {
+        const int sock = socket(AF_INET, SOCK_DGRAM, 0);
+        if (sock < 0) {
+            return -1;
+        }
+        local = {};
+        local.sin_family = AF_INET;
+        if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1
+            || bind(sock, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+            close(sock);
+            return -1;
+        }
+        socklen_t len = sizeof(local);
+        getsockname(sock, reinterpret_cast<sockaddr*>(&local), &len);
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+        return sock;
+    }
+}
+
+ImpairmentProxy::ImpairmentProxy(const ImpairmentOptions& options, uint64_t seed, const std::string& bind_address)
+    : _options(options),
+    _rng(seed) {
+
+    for (auto& side : _sides) {
+        side.sock = bindSocket(bind_address, side.local);
+    }
+    if (isValid()) {
+        _thread = std::thread([this]() { run(); });
+    }
+}
+
+ImpairmentProxy::~ImpairmentProxy() {
+    _stop = true;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+    for (auto& side : _sides) {
+        if (side.sock >= 0) {
+            close(side.sock);
+        }
+    }
+}
+
+bool ImpairmentProxy::isValid() const {
+    return _sides[kSideA].sock >= 0 && _sides[kSideB].sock >= 0;
+}
+
+std::string ImpairmentProxy::descriptionForA(const std::string& description_of_b) {
+    return rewrite(description_of_b, kSideB, kSideA);
+}
+
+std::string ImpairmentProxy::descriptionForB(const std::string& description_of_a) {
+    return rewrite(description_of_a, kSideA, kSideB);
+}
+
+void ImpairmentProxy::setOptions(const ImpairmentOptions& options) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _options = options;
+}
+
+ImpairmentOptions ImpairmentProxy::options() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _options;
+}
+
+ImpairmentStats ImpairmentProxy::statsAtoB() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sides[kSideB].stats;
+}
+
+ImpairmentStats ImpairmentProxy::statsBtoA() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _sides[kSideA].stats;
+}
+
+// Candidate lines read "a=candidate:<foundation> <component> <transport> <priority> <address> <port> typ <type> ..."
+std::string ImpairmentProxy::rewrite(const std::string& description, int described, int facing) {
+    std::istringstream in(description);
+    std::string out, line;
+    bool kept = false;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.rfind("a=candidate:", 0) != 0) {
+            out += line;
+            out += "\r\n";
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::vector<std::string> tokens;
+        for (std::string token; fields >> token;) {
+            tokens.push_back(token);
+        }
+        sockaddr_in peer{};
+        peer.sin_family = AF_INET;
+        if (kept || tokens.size() < 8 || tokens[6] != "typ" || tokens[7] != "host"
+            || (tokens[2] != "UDP" && tokens[2] != "udp")
+            || inet_pton(AF_INET, tokens[4].c_str(), &peer.sin_addr) != 1) {
+            continue;
+        }
+        peer.sin_port = htons(static_cast<uint16_t>(std::stoul(tokens[5])));
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _sides[described].peer = peer;
+            _sides[described].has_peer = true;
+        }
+
+        char address[INET_ADDRSTRLEN] = {};
+        inet_ntop(AF_INET, &_sides[facing].local.sin_addr, address, sizeof(address));
+        tokens[4] = address;
+        tokens[5] = std::to_string(ntohs(_sides[facing].local.sin_port));
+        for (size_t i = 0; i < tokens.size(); ++i) {
+            out += i ? " " : "";
+            out += tokens[i];
+        }
+        out += "\r\n";
+        kept = true;
+    }
+    return out;
+}
+
+void ImpairmentProxy::impairLocked(int to, std::string_view data, std::chrono::steady_clock::time_point now) {
+    auto& side = _sides[to];
+    if (_options.loss > 0.0 && _uniform(_rng) < _options.loss) {
+        ++side.stats.lost;
+        return;
+    }
+
+    const int copies = _options.duplicate > 0.0 && _uniform(_rng) < _options.duplicate ? 2 : 1;
+    side.stats.duplicated += copies - 1;
+    for (int i = 0; i < copies; ++i) {
+        auto departure = now;
+        if (_options.bandwidth_bytes_per_sec > 0) {
+            // A single bottleneck queue: the backlog is what the link has not drained yet
+            const std::chrono::steady_clock::time_point start = std::max(now, side.link_free);
+            const auto& backlog = std::chrono::duration<double>(start - now).count() * _options.bandwidth_bytes_per_sec;
+            if (backlog + data.size() > _options.queue_bytes) {
+                ++side.stats.queue_dropped;
+                continue;
+            }
+            side.link_free = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(static_cast<double>(data.size()) / _options.bandwidth_bytes_per_sec));
+            departure = side.link_free;
+        }
+
+        Pending pending;
+        pending.release = departure + _options.delay;
+        if (_options.jitter.count() > 0) {
+            pending.release += std::chrono::milliseconds(
+                    std::uniform_int_distribution<int64_t>(0, _options.jitter.count())(_rng));
+        }
+        if (_options.reorder > 0.0 && _uniform(_rng) < _options.reorder) {
+            pending.release += _options.reorder_delay;
+            ++side.stats.reordered;
+        }
+        pending.seq = _next_seq++;
+        pending.to = to;
+        pending.data.assign(data.data(), data.size());
+        _pending.push(std::move(pending));
+    }
+}
+
+void ImpairmentProxy::run() {
+    std::vector<char> buffer(kMaxDatagramSize);
+    std::array<pollfd, 2> pfds{};
+    for (int i = 0; i < 2; ++i) {
+        pfds[i].fd = _sides[i].sock;
+        pfds[i].events = POLLIN;
+    }
+
+    while (!_stop) {
+        auto wait = kMaxPollWait;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_pending.empty()) {
+                const auto& until = std::chrono::ceil<std::chrono::milliseconds>(
+                        _pending.top().release - std::chrono::steady_clock::now());
+                wait = std::clamp(until, std::chrono::milliseconds(0), kMaxPollWait);
+            }
+        }
+        if (poll(pfds.data(), pfds.size(), static_cast<int>(wait.count())) < 0 && errno != EINTR) {
+            break;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto& now = std::chrono::steady_clock::now();
+        for (int from = 0; from < 2; ++from) {
+            if (!(pfds[from].revents & POLLIN)) {
+                continue;
+            }
+            sockaddr_in src{};
+            socklen_t len = sizeof(src);
+            ssize_t size;
+            while ((size = recvfrom(_sides[from].sock, buffer.data(), buffer.size(), 0,
+                                    reinterpret_cast<sockaddr*>(&src), &len)) >= 0) {
+                // Whoever sends to the socket facing a side is the agent on that side
+                _sides[from].peer = src;
+                _sides[from].has_peer = true;
+                impairLocked(1 - from, std::string_view(buffer.data(), static_cast<size_t>(size)), now);
+                len = sizeof(src);
+            }
+        }
+
+        while (!_pending.empty() && _pending.top().release <= now) {
+            const auto& pending = _pending.top();
+            auto& to = _sides[pending.to];
+            if (to.has_peer) {
+                sendto(to.sock, pending.data.data(), pending.data.size(), 0,
+                       reinterpret_cast<const sockaddr*>(&to.peer), sizeof(to.peer));
+                ++to.stats.forwarded;
+            }
+            _pending.pop();
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#include "LossInjector.h"
+
+LossInjector::LossInjector(double loss_rate, uint64_t seed)
+    : _rng(seed),
+    _loss_rate(loss_rate) {
+}
+
+DatagramSender LossInjector::wrap(DatagramSender inner) {
+    return [this, inner = std::move(inner)](std::string_view datagram) {
+        if (drop()) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+            return SendResult::Ok;
+        }
+        _passed.fetch_add(1, std::memory_order_relaxed);
+        return inner(datagram);
+    };
+}
+
+void LossInjector::setLossRate(double loss_rate) {
+    _loss_rate.store(loss_rate, std::memory_order_relaxed);
+}
+
+uint64_t LossInjector::dropped() const {
+    return _dropped.load(std::memory_order_relaxed);
+}
+
+uint64_t LossInjector::passed() const {
+    return _passed.load(std::memory_order_relaxed);
+}
+
+bool LossInjector::drop() {
+    const auto& rate = _loss_rate.load(std::memory_order_relaxed);
+    if (rate <= 0.0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _uniform(_rng) < rate;
+}
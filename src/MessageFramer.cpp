@@ -0,0 +1,237 @@
+#include "MessageFramer.h"
+
+#include <algorithm>
+
+namespace {
+    constexpr uint8_t kMagic = 0xF7;
+
+    void write_u32(char* out, uint32_t value) {
+        out[0] = static_cast<char>(value >> 24);
+        out[1] = static_cast<char>(value >> 16);
+        out[2] = static_cast<char>(value >> 8);
+        out[3] = static_cast<char>(value);
+    }
+
+    uint32_t read_u32(const char* in) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(in);
+        return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+    }
+}
+
+MessageFramer::MessageFramer(DatagramSender send_datagram, FramerOptions options)
+    : _send_datagram(std::move(send_datagram)),
+    _options(options),
+    _pacer(options.pacing_bytes_per_sec, options.pacing_burst_bytes) {
+
+    _options.fragment_size = std::max(_options.fragment_size, kHeaderSize + 1);
+    _options.max_pending_messages = std::max<size_t>(_options.max_pending_messages, 1);
+    _last_expire = std::chrono::steady_clock::now();
+}
+
+MessageFramer::MessageFramer(PeerConnection& pc, FramerOptions options)
+    : MessageFramer([&pc](std::string_view datagram) { return pc.send(datagram); }, options) {
+
+    pc.onMessageView([this](std::string_view datagram) { input(datagram); });
+}
+
+SendResult MessageFramer::send(std::string_view msg) {
+    if (msg.size() > _options.max_message_size || msg.size() > UINT32_MAX) {
+        return SendResult::TooLarge;
+    }
+
+    const auto& payload_size = _options.fragment_size - kHeaderSize;
+    const size_t count = std::max<size_t>(1, (msg.size() + payload_size - 1) / payload_size);
+    const auto& id = _next_id.fetch_add(1, std::memory_order_relaxed);
+
+    // One datagram buffer per sending thread, reused across messages
+    thread_local std::string datagram;
+    datagram.resize(kHeaderSize);
+    datagram[0] = static_cast<char>(kMagic);
+    datagram[1] = 0;
+    write_u32(&datagram[2], id);
+    write_u32(&datagram[10], static_cast<uint32_t>(count));
+    write_u32(&datagram[14], static_cast<uint32_t>(msg.size()));
+
+    for (size_t index = 0; index < count; ++index) {
+        const auto& chunk = msg.substr(index * payload_size, payload_size);
+        datagram.resize(kHeaderSize);
+        write_u32(&datagram[6], static_cast<uint32_t>(index));
+        datagram.append(chunk.data(), chunk.size());
+
+        _pacer.pace(datagram.size());
+
+        // Socket buffer or send queue full: let the other side catch up
+        const auto& deadline = std::chrono::steady_clock::now() + _options.send_timeout;
+        const auto& result = send_retrying([this]() { return _send_datagram(datagram); },
+                                           [&deadline]() { return std::chrono::steady_clock::now() < deadline; });
+        if (result != SendResult::Ok) {
+            return result;
+        }
+        _fragments_sent.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    _messages_sent.fetch_add(1, std::memory_order_relaxed);
+    return SendResult::Ok;
+}
+
+void MessageFramer::onMessage(std::function<void(std::string_view)> cb) {
+    _message_cb = std::move(cb);
+}
+
+void MessageFramer::input(std::string_view datagram) {
+    if (datagram.size() < kHeaderSize || static_cast<uint8_t>(datagram[0]) != kMagic) {
+        _invalid.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const auto& id = read_u32(&datagram[2]);
+    const auto& index = read_u32(&datagram[6]);
+    const auto& count = read_u32(&datagram[10]);
+    const auto& size = read_u32(&datagram[14]);
+    const auto& payload = datagram.substr(kHeaderSize);
+    if (index >= count || size > _options.max_message_size) {
+        _invalid.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Both sides split at the same payload size, so the size alone fixes the count and every
+    // fragment's place: a header that disagrees is dropped before anything is allocated for it
+    const auto& fragment_payload = _options.fragment_size - kHeaderSize;
+    const auto& whole_size = static_cast<size_t>(size);
+    const size_t expected_count = std::max<size_t>(1, (whole_size + fragment_payload - 1) / fragment_payload);
+    const auto& offset = static_cast<size_t>(index) * fragment_payload;
+    const auto& expected_payload = index == count - 1 ? whole_size - offset : fragment_payload;
+    if (count != expected_count || payload.size() != expected_payload) {
+        _invalid.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    _fragments_received.fetch_add(1, std::memory_order_relaxed);
+
+    // Single-fragment messages are delivered straight from the datagram
+    if (count == 1) {
+        _messages_received.fetch_add(1, std::memory_order_relaxed);
+        if (_message_cb) {
+            _message_cb(payload);
+        }
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(_recv_mutex);
+    const auto& now = std::chrono::steady_clock::now();
+    if (now - _last_expire >= std::chrono::milliseconds(10)) {
+        expireLocked(now);
+    }
+
+    auto it = _pending.find(id);
+    if (it == _pending.end()) {
+        if (size > _options.max_pending_bytes) {
+            _invalid.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        // Make room in the window by evicting the oldest partial messages
+        while (!_pending_order.empty()
+               && (_pending.size() >= _options.max_pending_messages
+                   || _pending_bytes + size > _options.max_pending_bytes)) {
+            dropLocked(_pending_order.front());
+            _evicted.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Reassembly reassembly;
+        reassembly.buffer = acquireBuffer(size);
+        reassembly.received.assign(count, false);
+        reassembly.remaining = count;
+        reassembly.started = now;
+        reassembly.order = _pending_order.insert(_pending_order.end(), id);
+        it = _pending.emplace(id, std::move(reassembly)).first;
+        _pending_bytes += size;
+    }
+
+    auto& reassembly = it->second;
+    if (reassembly.buffer.size() != size || reassembly.received.size() != count) {
+        _invalid.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (reassembly.received[index]) {
+        return; // duplicate
+    }
+    reassembly.received[index] = true;
+    std::copy(payload.begin(), payload.end(), reassembly.buffer.begin() + offset);
+    if (--reassembly.remaining > 0) {
+        return;
+    }
+
+    auto buffer = std::move(reassembly.buffer);
+    _pending_bytes -= size;
+    _pending_order.erase(reassembly.order);
+    _pending.erase(it);
+    lock.unlock();
+
+    _messages_received.fetch_add(1, std::memory_order_relaxed);
+    if (_message_cb) {
+        _message_cb(buffer);
+    }
+
+    lock.lock();
+    releaseBuffer(std::move(buffer));
+}
+
+void MessageFramer::expire() {
+    std::lock_guard<std::mutex> lock(_recv_mutex);
+    expireLocked(std::chrono::steady_clock::now());
+}
+
+size_t MessageFramer::pendingMessages() const {
+    std::lock_guard<std::mutex> lock(_recv_mutex);
+    return _pending.size();
+}
+
+FramerStats MessageFramer::stats() const {
+    FramerStats stats;
+    stats.messages_sent = _messages_sent.load(std::memory_order_relaxed);
+    stats.fragments_sent = _fragments_sent.load(std::memory_order_relaxed);
+    stats.messages_received = _messages_received.load(std::memory_order_relaxed);
+    stats.fragments_received = _fragments_received.load(std::memory_order_relaxed);
+    stats.reassembly_timeouts = _reassembly_timeouts.load(std::memory_order_relaxed);
+    stats.evicted = _evicted.load(std::memory_order_relaxed);
+    stats.invalid = _invalid.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void MessageFramer::expireLocked(std::chrono::steady_clock::time_point now) {
+    _last_expire = now;
+    // Ids are queued in arrival order, so expired messages are at the front
+    while (!_pending_order.empty()) {
+        const auto& it = _pending.find(_pending_order.front());
+        if (now - it->second.started < _options.reassembly_timeout) {
+            break;
+        }
+        dropLocked(it->first);
+        _reassembly_timeouts.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void MessageFramer::dropLocked(uint32_t id) {
+    const auto& it = _pending.find(id);
+    _pending_bytes -= it->second.buffer.size();
+    releaseBuffer(std::move(it->second.buffer));
+    _pending_order.erase(it->second.order);
+    _pending.erase(it);
+}
+
+std::string MessageFramer::acquireBuffer(size_t size) {
+    std::string buffer;
+    if (!_pool.empty()) {
+        buffer = std::move(_pool.back());
+        _pool.pop_back();
+    }
+    buffer.resize(size);
+    return buffer;
+}
+
+void MessageFramer::releaseBuffer(std::string&& buffer) {
+    if (_pool.size() < _options.pool_buffers) {
+        buffer.clear();
+        _pool.push_back(std::move(buffer));
+    }
+}
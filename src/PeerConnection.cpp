@@ -1,20 +1,225 @@
 #include "PeerConnection.h"
+#include "DnsCache.h"
+#include "SendPacing.h"
 #include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <deque>
+
+namespace {
+    constexpr size_t kSendBatchChunk = 64; // messages per juice_send_batch call, one sendmmsg
+
+    SendResult to_send_result(int err) {
+        switch (err) {
+            case JUICE_ERR_SUCCESS:
+                return SendResult::Ok;
+            case JUICE_ERR_AGAIN:
+                return SendResult::Again;
+            case JUICE_ERR_TOO_LARGE:
+                return SendResult::TooLarge;
+            default:
+                return SendResult::Failed;
+        }
+    }
+
+    // States that settle a connectAsync()
+    bool is_connect_outcome(juice_state state) {
+        return state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED || state == JUICE_STATE_FAILED;
+    }
+}
+
+const char* send_result_to_string(SendResult result) {
+    switch (result) {
+        case SendResult::Ok:
+            return "ok";
+        case SendResult::NotConnected:
+            return "not connected";
+        case SendResult::Again:
+            return "again";
+        case SendResult::TooLarge:
+            return "too large";
+        case SendResult::Failed:
+            return "failed";
+    }
+    return "unknown";
+}
+
+struct PeerConnection::CallbackEvent {
+    enum class Type { Message, State, Candidate, GatheringDone };
+
+    Type type;
+    juice_state state = JUICE_STATE_DISCONNECTED;
+    std::string payload; // datagram or candidate SDP
+};
+
+// Serializes one connection's events onto a (possibly shared) executor, so a thread pool still
+// delivers them in order. At most one drain task per connection is queued at a time.
+struct PeerConnection::CallbackQueue {
+    std::shared_ptr<CallbackExecutor> executor;
+    size_t max_batch = 64;
+    PeerConnection* owner = nullptr; // cleared on close, guarded by mutex
+
+    std::mutex mutex;
+    std::condition_variable idle_cv;
+    std::deque<CallbackEvent> pending;
+    bool scheduled = false;
+    bool running = false;
+    std::thread::id drain_thread; // valid while running
+
+    static void push(const std::shared_ptr<CallbackQueue>& queue, CallbackEvent&& event) {
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            if (!queue->owner) {
+                return;
+            }
+            queue->pending.push_back(std::move(event));
+            if (queue->scheduled) {
+                return;
+            }
+            queue->scheduled = true;
+        }
+        post(queue);
+    }
+
+    // Tasks hold the queue weakly: a connection gone meanwhile takes its queue and executor along
+    static void post(const std::shared_ptr<CallbackQueue>& queue) {
+        queue->executor->post([weak = std::weak_ptr<CallbackQueue>(queue)]() {
+            if (const auto& alive = weak.lock()) {
+                drain(alive);
+            }
+        });
+    }
+
+    static void drain(const std::shared_ptr<CallbackQueue>& queue) {
+        std::vector<CallbackEvent> batch;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            if (!queue->owner) {
+                queue->scheduled = false;
+                return;
+            }
+            queue->running = true;
+            queue->drain_thread = std::this_thread::get_id();
+            batch.reserve(std::min(queue->pending.size(), queue->max_batch));
+            while (!queue->pending.empty() && batch.size() < queue->max_batch) {
+                batch.push_back(std::move(queue->pending.front()));
+                queue->pending.pop_front();
+            }
+        }
+
+        // A handler may close the queue, possibly destroying the owner, so look it up every time
+        for (const auto& event : batch) {
+            PeerConnection* owner = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(queue->mutex);
+                owner = queue->owner;
+            }
+            if (!owner) {
+                break;
+            }
+            owner->deliver(event);
+        }
+
+        bool again = false;
+        {
+            std::lock_guard<std::mutex> lock(queue->mutex);
+            queue->running = false;
+            again = queue->owner && !queue->pending.empty();
+            queue->scheduled = again;
+        }
+        queue->idle_cv.notify_all();
+
+        // Requeue instead of looping so other connections sharing the executor get a turn
+        if (again) {
+            post(queue);
+        }
+    }
+
+    static bool closed(const std::shared_ptr<CallbackQueue>& queue) {
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        return !queue->owner;
+    }
+
+    // Drops undelivered events and waits for a batch in progress to finish, unless called from one
+    // of its handlers: that batch then stops after the handler returns.
+    static void close(const std::shared_ptr<CallbackQueue>& queue) {
+        std::unique_lock<std::mutex> lock(queue->mutex);
+        queue->owner = nullptr;
+        queue->pending.clear();
+        if (queue->running && queue->drain_thread == std::this_thread::get_id()) {
+            return;
+        }
+        queue->idle_cv.wait(lock, [&queue] { return !queue->running; });
+    }
+};
 
 PeerConnection::PeerConnection(bool is_controlling, const std::string& name)
+    : PeerConnection(is_controlling, name, PeerConnectionConfig{}) {
+}
+
+PeerConnection::PeerConnection(bool is_controlling, const std::string& name, const PeerConnectionConfig& config)
     : _is_controlling(is_controlling),
-    _message_sent(false),
     _name(name) {
 
-    _logger = spdlog::stdout_color_mt(_name);
-    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    if (config.logger) {
+        _logger = config.logger;
+    } else {
+        _logger = spdlog::stdout_color_mt(_name);
+        _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+        _owns_logger = true;
+    }
+
+    // Numeric server hosts make libjuice register its STUN/TURN entries synchronously instead of
+    // starting a resolver thread per agent. Without a cached address the hostname is kept, so
+    // libjuice still resolves it.
+    auto server_host = [&config, this](const std::string& host, uint16_t port) -> std::string {
+        if (host.empty() || !config.use_dns_cache) {
+            return host;
+        }
+        auto& cache = DnsCache::instance();
+        auto address = config.dns_cache_blocking ? cache.resolve(host, port) : cache.cached(host, port);
+        if (address.empty()) {
+            if (config.dns_cache_blocking) {
+                _logger->warn("Server address resolution failed for {}:{}", host, port);
+            }
+            return host;
+        }
+        return address;
+    };
+
+    std::string stun_host;
+    std::vector<std::string> turn_hosts;
+    std::vector<juice_turn_server> turn_servers;
+    if (!config.host_only) {
+        stun_host = server_host(config.stun_server_host, config.stun_server_port);
+        turn_hosts.reserve(config.turn_servers.size());
+        for (const auto& server : config.turn_servers) {
+            turn_hosts.push_back(server_host(server.host, server.port));
+            if (turn_hosts.back().empty()) {
+                continue;
+            }
+            juice_turn_server turn{};
+            turn.host = turn_hosts.back().c_str();
+            turn.port = server.port;
+            turn.username = server.username.c_str();
+            turn.password = server.password.c_str();
+            turn_servers.push_back(turn);
+        }
+    }
 
     juice_config cfg{};
-    cfg.concurrency_mode = JUICE_CONCURRENCY_MODE_THREAD;
-    cfg.local_port_range_begin = 0;
-    cfg.local_port_range_end = 0;
-    cfg.stun_server_host = "stun.l.google.com";
-    cfg.stun_server_port = 19302;
+    cfg.concurrency_mode = config.concurrency_mode;
+    cfg.bind_address = config.bind_address.empty() ? nullptr : config.bind_address.c_str();
+    cfg.local_port_range_begin = config.local_port_begin;
+    cfg.local_port_range_end = config.local_port_end;
+    cfg.stun_server_host = stun_host.empty() ? nullptr : stun_host.c_str();
+    cfg.stun_server_port = config.stun_server_port;
+    cfg.turn_servers = turn_servers.empty() ? nullptr : turn_servers.data();
+    cfg.turn_servers_count = static_cast<int>(turn_servers.size());
+    cfg.turn_send_indication = config.turn_send_indication;
+    cfg.enable_udp_offload = config.udp_offload;
+    cfg.poll_affinity_key = config.poll_affinity_key;
     cfg.cb_recv = PeerConnection::on_data_cb;
     cfg.cb_state_changed = PeerConnection::on_state_cb;
     cfg.cb_candidate = PeerConnection::on_candidate_cb;
@@ -24,16 +229,30 @@ PeerConnection::PeerConnection(bool is_controlling, const std::string& name)
     juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
     _agent = juice_create(&cfg);
     if (_agent) {
-        _logger->info("Agent created successfully - STUN: {}:{}", cfg.stun_server_host, cfg.stun_server_port);
+        _logger->info("Agent created successfully - STUN: {}:{}",
+                      cfg.stun_server_host ? cfg.stun_server_host : "none", cfg.stun_server_port);
     }
 }
 
 PeerConnection::~PeerConnection() {
     _logger->info("Destroying connection");
+    stopSendQueue();
     if (_agent) {
         juice_destroy(_agent);
         _logger->info("Agent destroyed successfully");
     }
+
+    // No callback can come anymore: settle what is still waiting
+    completeGathering(false);
+    completeConnect(_state.load(std::memory_order_acquire));
+
+    if (const auto& queue = std::atomic_load(&_callback_queue)) {
+        CallbackQueue::close(queue);
+    }
+
+    if (_owns_logger) {
+        spdlog::drop(_name);
+    }
 }
 
 bool PeerConnection::startGathering() {
@@ -42,10 +261,104 @@ bool PeerConnection::startGathering() {
         return false;
     }
 
+    {
+        std::lock_guard<std::mutex> lock(_async_mutex);
+        _gathering_started = true;
+    }
     const auto& success = juice_gather_candidates(_agent) == JUICE_ERR_SUCCESS;
     return success;
 }
 
+std::future<bool> PeerConnection::gatherAsync() {
+    auto promise = std::make_shared<std::promise<bool>>();
+    auto future = promise->get_future();
+    gatherThen([promise](bool success) { promise->set_value(success); });
+    return future;
+}
+
+std::future<juice_state> PeerConnection::connectAsync() {
+    auto promise = std::make_shared<std::promise<juice_state>>();
+    auto future = promise->get_future();
+    connectThen([promise](juice_state state) { promise->set_value(state); });
+    return future;
+}
+
+void PeerConnection::gatherThen(std::function<void(bool)> done) {
+    bool start = false;
+    {
+        std::unique_lock<std::mutex> lock(_async_mutex);
+        if (_gathered || !_agent) {
+            lock.unlock();
+            done(_gathered);
+            return;
+        }
+        _gather_waiters.push_back(std::move(done));
+        start = !_gathering_started;
+    }
+    // Host-only gathering completes inside startGathering(), through the callback
+    if (start && !startGathering()) {
+        completeGathering(false);
+    }
+}
+
+void PeerConnection::connectThen(std::function<void(juice_state)> done) {
+    std::unique_lock<std::mutex> lock(_async_mutex);
+    const auto& state = _state.load(std::memory_order_acquire);
+    if (is_connect_outcome(state) || !_agent) {
+        lock.unlock();
+        done(state);
+        return;
+    }
+    _connect_waiters.push_back(std::move(done));
+}
+
+void PeerConnection::completeGathering(bool success) {
+    std::vector<std::function<void(bool)>> waiters;
+    {
+        std::lock_guard<std::mutex> lock(_async_mutex);
+        _gathered = _gathered || success;
+        waiters.swap(_gather_waiters);
+    }
+    for (auto& waiter : waiters) {
+        waiter(success);
+    }
+}
+
+void PeerConnection::completeConnect(juice_state state) {
+    std::vector<std::function<void(juice_state)>> waiters;
+    {
+        std::lock_guard<std::mutex> lock(_async_mutex);
+        waiters.swap(_connect_waiters);
+    }
+    for (auto& waiter : waiters) {
+        waiter(state);
+    }
+}
+
+#ifdef P2P_COROUTINES
+bool PeerConnection::gatherOutcome(bool& success) {
+    std::lock_guard<std::mutex> lock(_async_mutex);
+    if (!_gathered && _agent) {
+        return false;
+    }
+    success = _gathered;
+    return true;
+}
+
+bool PeerConnection::connectOutcome(juice_state& state) {
+    state = _state.load(std::memory_order_acquire);
+    return is_connect_outcome(state) || !_agent;
+}
+
+void PeerConnection::resumeAwaiter(std::coroutine_handle<> handle) {
+    if (const auto& queue = std::atomic_load(&_callback_queue)) {
+        queue->executor->post([handle]() { handle.resume(); });
+    } else {
+        handle.resume();
+    }
+}
+#endif
+
 std::string PeerConnection::createOffer() {
     if (!_agent) {
         _logger->error("Cannot create offer: agent is null");
@@ -99,26 +412,209 @@ bool PeerConnection::addRemoteCandidate(const std::string& candidate) {
     return false;
 }
 
-void PeerConnection::sendMessage(const std::string& msg) {
-    if (!_agent) {
-        return;
+SendResult PeerConnection::send(const std::byte* data, size_t size) {
+    return send(std::string_view(reinterpret_cast<const char*>(data), size));
+}
+
+SendResult PeerConnection::send(std::string_view msg) {
+    if (_send_queue) {
+        return enqueue(msg);
     }
 
-    if (_message_sent) {
-        return;
+    if (!_agent || !_connected.load(std::memory_order_acquire)) {
+        return SendResult::NotConnected;
+    }
+    return countSend(juice_send(_agent, msg.data(), msg.size()), msg.size());
+}
+
+SendResult PeerConnection::send(const char* msg) {
+    return send(std::string_view(msg));
+}
+
+SendResult PeerConnection::send(std::string&& msg) {
+    if (_send_queue) {
+        return enqueue(std::move(msg));
+    }
+    return send(std::string_view(msg));
+}
+
+SendResult PeerConnection::sendDiffserv(std::string_view msg, int ds) {
+    if (!_agent || !_connected.load(std::memory_order_acquire)) {
+        return SendResult::NotConnected;
+    }
+    return countSend(juice_send_diffserv(_agent, msg.data(), msg.size(), ds), msg.size());
+}
+
+size_t PeerConnection::sendBatch(const std::vector<std::string_view>& msgs, SendResult* result) {
+    SendResult last = SendResult::Ok;
+    size_t sent = 0;
+    if (_send_queue) {
+        for (const auto& msg : msgs) {
+            last = send(msg);
+            if (last != SendResult::Ok) {
+                break;
+            }
+            ++sent;
+        }
+    } else if (!_agent || !_connected.load(std::memory_order_acquire)) {
+        last = msgs.empty() ? SendResult::Ok : SendResult::NotConnected;
+    } else {
+        // A partial send returns the count; sending the rest again reports why it stopped
+        std::array<juice_iovec_t, kSendBatchChunk> iovecs;
+        while (sent < msgs.size()) {
+            const size_t count = std::min(msgs.size() - sent, iovecs.size());
+            for (size_t i = 0; i < count; ++i) {
+                iovecs[i] = {msgs[sent + i].data(), msgs[sent + i].size()};
+            }
+
+            const int ret = juice_send_batch(_agent, iovecs.data(), count);
+            if (ret <= 0) {
+                last = countSend(ret < 0 ? ret : JUICE_ERR_FAILED, 0);
+                break;
+            }
+
+            size_t bytes = 0;
+            for (int i = 0; i < ret; ++i) {
+                bytes += iovecs[i].size;
+            }
+            _messages_sent.fetch_add(ret, std::memory_order_relaxed);
+            _bytes_sent.fetch_add(bytes, std::memory_order_relaxed);
+            sent += static_cast<size_t>(ret);
+        }
     }
 
-    juice_state state = juice_get_state(_agent);
-    if (state != JUICE_STATE_CONNECTED && state != JUICE_STATE_COMPLETED) {
+    if (result) {
+        *result = last;
+    }
+    return sent;
+}
+
+bool PeerConnection::sendMessage(const std::string& msg) {
+    const auto& result = send(std::string_view(msg));
+    if (result != SendResult::Ok) {
+        _logger->warn("Send failed: {}", send_result_to_string(result));
+        return false;
+    }
+    return true;
+}
+
+void PeerConnection::enableSendQueue(const SendQueueOptions& options) {
+    if (_send_queue) {
+        _logger->warn("Send queue already enabled");
         return;
     }
 
-    _message_sent = true;
+    _queue_options = options;
+    _send_queue = std::make_unique<SendQueue>(options);
+    _drain_stop = false;
+    _drain_thread = std::thread(&PeerConnection::drainLoop, this);
+    _logger->info("Send queue enabled - capacity: {}, watermarks: {}/{}",
+                  _send_queue->capacity(), options.high_watermark, options.low_watermark);
+}
+
+void PeerConnection::onSendQueueHigh(std::function<void(size_t)> cb) {
+    _queue_high_cb = cb;
+}
+
+void PeerConnection::onSendQueueLow(std::function<void(size_t)> cb) {
+    _queue_low_cb = cb;
+}
+
+size_t PeerConnection::sendQueueSize() const {
+    return _send_queue ? _send_queue->size() : 0;
+}
+
+uint64_t PeerConnection::sendQueueDropped() const {
+    return _queue_dropped.load(std::memory_order_relaxed);
+}
+
+template<typename T>
+SendResult PeerConnection::enqueue(T&& msg) {
+    if (msg.size() > _send_queue->slotSize()) {
+        return SendResult::TooLarge;
+    }
+
+    size_t depth = 0;
+    {
+        std::lock_guard<std::mutex> lock(_producer_mutex);
+        if (!_send_queue->push(std::forward<T>(msg))) {
+            return SendResult::Again;
+        }
+        depth = _send_queue->size();
+    }
+
+    if (depth >= _queue_options.high_watermark && !_above_high.exchange(true)) {
+        if (_queue_high_cb) {
+            _queue_high_cb(depth);
+        }
+    }
 
-    const auto& result = juice_send(_agent, msg.c_str(), msg.size());
-    if (result != JUICE_ERR_SUCCESS) {
-        _message_sent = false;
+    // Pairs with the fence in drainLoop: either the sender sees the new slot, or we see it idle
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (_drain_idle.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(_drain_mutex);
+        _drain_cv.notify_one();
     }
+    return SendResult::Ok;
+}
+
+void PeerConnection::drainLoop() {
+    SendBackoff backoff;
+    while (!_drain_stop.load(std::memory_order_acquire)) {
+        const std::string* msg = _send_queue->front();
+        if (!msg) {
+            std::unique_lock<std::mutex> lock(_drain_mutex);
+            _drain_idle.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            _drain_cv.wait_for(lock, std::chrono::milliseconds(100), [this] {
+                return _drain_stop.load(std::memory_order_acquire) || _send_queue->front() != nullptr;
+            });
+            _drain_idle.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        if (!_connected.load(std::memory_order_acquire)) {
+            // Woken by on_state_cb once connected
+            std::unique_lock<std::mutex> lock(_drain_mutex);
+            _drain_cv.wait(lock, [this] {
+                return _drain_stop.load(std::memory_order_acquire) || _connected.load(std::memory_order_acquire);
+            });
+            continue;
+        }
+
+        const auto& result = countSend(juice_send(_agent, msg->data(), msg->size()), msg->size());
+        if (result == SendResult::Again) {
+            // Socket buffer full: keep the datagram and let the kernel catch up
+            backoff.wait();
+            continue;
+        }
+        backoff.reset();
+        if (result != SendResult::Ok) {
+            _queue_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        _send_queue->pop();
+
+        if (_above_high.load(std::memory_order_relaxed)) {
+            const auto& depth = _send_queue->size();
+            if (depth <= _queue_options.low_watermark && _above_high.exchange(false) && _queue_low_cb) {
+                _queue_low_cb(depth);
+            }
+        }
+    }
+}
+
+void PeerConnection::stopSendQueue() {
+    if (!_drain_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_drain_mutex);
+        _drain_stop = true;
+    }
+    _drain_cv.notify_one();
+    _drain_thread.join();
 }
 
 juice_state PeerConnection::getState() const {
@@ -128,10 +624,62 @@ juice_state PeerConnection::getState() const {
     return juice_get_state(_agent);
 }
 
+bool PeerConnection::isValid() const {
+    return _agent != nullptr;
+}
+
+juice_state PeerConnection::getCachedState() const {
+    return _state.load(std::memory_order_acquire);
+}
+
+bool PeerConnection::isConnected() const {
+    return _connected.load(std::memory_order_acquire);
+}
+
+MessageCounters PeerConnection::counters() const {
+    MessageCounters counters;
+    counters.messages_sent = _messages_sent.load(std::memory_order_relaxed);
+    counters.bytes_sent = _bytes_sent.load(std::memory_order_relaxed);
+    counters.send_failures = _send_failures.load(std::memory_order_relaxed);
+    counters.messages_received = _messages_received.load(std::memory_order_relaxed);
+    counters.bytes_received = _bytes_received.load(std::memory_order_relaxed);
+    return counters;
+}
+
+ConnectionStats PeerConnection::stats() const {
+    ConnectionStats stats;
+    if (_agent) {
+        juice_get_stats(_agent, &stats.transport);
+    }
+    stats.messages = counters();
+    stats.send_queue_depth = sendQueueSize();
+    stats.send_queue_dropped = sendQueueDropped();
+    return stats;
+}
+
+const std::string& PeerConnection::name() const {
+    return _name;
+}
+
+SendResult PeerConnection::countSend(int err, size_t size) {
+    const auto& result = to_send_result(err);
+    if (result == SendResult::Ok) {
+        _messages_sent.fetch_add(1, std::memory_order_relaxed);
+        _bytes_sent.fetch_add(size, std::memory_order_relaxed);
+    } else if (result != SendResult::Again) {
+        _send_failures.fetch_add(1, std::memory_order_relaxed);
+    }
+    return result;
+}
+
 void PeerConnection::onMessage(std::function<void(const std::string&)> cb) {
     _msg_cb = cb;
+}
 
+void PeerConnection::onMessageView(std::function<void(std::string_view)> cb) {
+    _msg_view_cb = cb;
 }
+
 void PeerConnection::onStateChange(std::function<void(juice_state)> cb) {
     _state_cb = cb;
 }
@@ -144,27 +692,111 @@ void PeerConnection::onGatheringDone(std::function<void()> cb) {
     _gathering_done_cb = cb;
 }
 
+void PeerConnection::setExecutor(std::shared_ptr<CallbackExecutor> executor, size_t max_batch) {
+    // Atomic swaps, as the juice thread may be pushing events when called from a handler
+    if (const auto& old_queue = std::atomic_exchange(&_callback_queue, std::shared_ptr<CallbackQueue>())) {
+        CallbackQueue::close(old_queue);
+    }
+
+    if (!executor || executor->runsInline()) {
+        return;
+    }
+
+    auto queue = std::make_shared<CallbackQueue>();
+    queue->executor = std::move(executor);
+    queue->max_batch = max_batch ? max_batch : 1;
+    queue->owner = this;
+    std::atomic_store(&_callback_queue, std::move(queue));
+}
+
+void PeerConnection::deliver(const CallbackEvent& event) {
+    switch (event.type) {
+        case CallbackEvent::Type::Message:
+            deliverMessage(event.payload);
+            break;
+        case CallbackEvent::Type::State:
+            if (_state_cb) {
+                _state_cb(event.state);
+            }
+            break;
+        case CallbackEvent::Type::Candidate:
+            if (_candidate_cb) {
+                _candidate_cb(event.payload);
+            }
+            break;
+        case CallbackEvent::Type::GatheringDone:
+            if (_gathering_done_cb) {
+                _gathering_done_cb();
+            }
+            break;
+    }
+}
+
+void PeerConnection::deliverMessage(std::string_view msg) {
+    if (_msg_view_cb) {
+        // The handler may destroy this connection, which closes its queue first
+        const auto& queue = std::atomic_load(&_callback_queue);
+        _msg_view_cb(msg);
+        if (queue && CallbackQueue::closed(queue)) {
+            return;
+        }
+    }
+
+    // Only pay for the copy when an owning callback was registered
+    if (_msg_cb) {
+        _msg_cb(std::string(msg));
+    }
+}
+
 void PeerConnection::on_data_cb(juice_agent* agent, const char* data, size_t size, void* user_ptr) {
     auto* self = static_cast<PeerConnection*>(user_ptr);
-    std::string msg(data, size);
+    self->_messages_received.fetch_add(1, std::memory_order_relaxed);
+    self->_bytes_received.fetch_add(size, std::memory_order_relaxed);
 
-    if (self->_msg_cb) {
-        self->_msg_cb(msg);
+    if (const auto& queue = std::atomic_load(&self->_callback_queue)) {
+        CallbackQueue::push(queue, {CallbackEvent::Type::Message, {}, std::string(data, size)});
+        return;
     }
+    self->deliverMessage(std::string_view(data, size));
 }
 
 void PeerConnection::on_state_cb(juice_agent* agent, juice_state state, void* user_ptr) {
     auto* self = static_cast<PeerConnection*>(user_ptr);
     std::string state_name = juice_state_to_string(state);
 
+    self->_state.store(state, std::memory_order_release);
+    const auto& connected = state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED;
+    if (!self->_connected.exchange(connected, std::memory_order_acq_rel) && connected) {
+        // Releases the drain thread if it waits for the connection with messages queued
+        std::lock_guard<std::mutex> lock(self->_drain_mutex);
+        self->_drain_cv.notify_one();
+    }
+
     if (self->_state_cb) {
         self->_logger->info("State changed to: {}", state_name);
+    }
+
+    // Stored above before the waiters are taken, so connectThen() cannot miss the outcome
+    if (is_connect_outcome(state)) {
+        self->completeConnect(state);
+    }
+
+    if (const auto& queue = std::atomic_load(&self->_callback_queue)) {
+        CallbackQueue::push(queue, {CallbackEvent::Type::State, state, {}});
+        return;
+    }
+    if (self->_state_cb) {
         self->_state_cb(state);
     }
 }
 
 void PeerConnection::on_candidate_cb(juice_agent* agent, const char* sdp, void* user_ptr) {
     auto* self = static_cast<PeerConnection*>(user_ptr);
+
+    if (const auto& queue = std::atomic_load(&self->_callback_queue)) {
+        CallbackQueue::push(queue, {CallbackEvent::Type::Candidate, JUICE_STATE_DISCONNECTED, sdp});
+        return;
+    }
     if (self->_candidate_cb) {
         std::string candidate(sdp);
         self->_candidate_cb(candidate);
@@ -173,6 +805,12 @@ void PeerConnection::on_candidate_cb(juice_agent* agent, const char* sdp, void*
 
 void PeerConnection::on_gathering_done_cb(juice_agent* agent, void* user_ptr) {
     auto* self = static_cast<PeerConnection*>(user_ptr);
+    self->completeGathering(true);
+
+    if (const auto& queue = std::atomic_load(&self->_callback_queue)) {
+        CallbackQueue::push(queue, {CallbackEvent::Type::GatheringDone, JUICE_STATE_DISCONNECTED, {}});
+        return;
+    }
     if (self->_gathering_done_cb) {
         self->_gathering_done_cb();
     }
@@ -0,0 +1,139 @@
+#include "PeerManager.h"
+
+#include <spdlog/sinks/stdout_color_sinks.h>
+
+PeerManager::PeerManager(PeerManagerConfig config)
+    : _config(std::move(config)) {
+
+    _logger = spdlog::stdout_color_mt(_config.name);
+    _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
+    if (!_config.peer.logger) {
+        _config.peer.logger = _logger;
+    }
+}
+
+PeerManager::~PeerManager() {
+    destroyAll();
+    spdlog::drop(_config.name);
+}
+
+std::vector<PeerManager::PeerId> PeerManager::createPeers(size_t count, bool is_controlling) {
+    std::vector<PeerId> ids;
+    ids.reserve(count);
+
+    // Construct outside the lock: creating an agent opens a socket and may start a thread
+    PeerId first_id;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        first_id = _next_id;
+        _next_id += count;
+    }
+
+    std::vector<std::shared_ptr<PeerConnection>> created;
+    created.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const auto& id = first_id + i;
+        auto pc = std::make_shared<PeerConnection>(is_controlling, _config.name + "-" + std::to_string(id),
+                                                   _config.peer);
+        if (!pc->isValid()) {
+            _logger->error("Peer creation failed after {} of {}", i, count);
+            break;
+        }
+        if (_config.executor) {
+            pc->setExecutor(_config.executor, _config.executor_max_batch);
+        }
+        created.push_back(std::move(pc));
+        ids.push_back(id);
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    for (size_t i = 0; i < created.size(); ++i) {
+        _peers.emplace(ids[i], std::move(created[i]));
+    }
+    return ids;
+}
+
+std::shared_ptr<PeerConnection> PeerManager::peer(PeerId id) const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto& it = _peers.find(id);
+    return it != _peers.end() ? it->second : nullptr;
+}
+
+std::vector<PeerManager::PeerId> PeerManager::peerIds() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<PeerId> ids;
+    ids.reserve(_peers.size());
+    for (const auto& entry : _peers) {
+        ids.push_back(entry.first);
+    }
+    return ids;
+}
+
+size_t PeerManager::gatherAll() {
+    size_t started = 0;
+    for (const auto& pc : snapshot()) {
+        if (pc->startGathering()) {
+            ++started;
+        }
+    }
+    return started;
+}
+
+size_t PeerManager::destroyPeers(const std::vector<PeerId>& ids) {
+    std::vector<std::shared_ptr<PeerConnection>> removed;
+    removed.reserve(ids.size());
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (const auto& id : ids) {
+            const auto& it = _peers.find(id);
+            if (it != _peers.end()) {
+                removed.push_back(std::move(it->second));
+                _peers.erase(it);
+            }
+        }
+    }
+
+    // Agents are destroyed here, outside the lock, since juice_destroy joins or unregisters from the poll thread
+    const auto& count = removed.size();
+    removed.clear();
+    return count;
+}
+
+void PeerManager::destroyAll() {
+    std::unordered_map<PeerId, std::shared_ptr<PeerConnection>> removed;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        removed.swap(_peers);
+    }
+}
+
+size_t PeerManager::size() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _peers.size();
+}
+
+PeerManagerStats PeerManager::stats() const {
+    PeerManagerStats stats;
+    for (const auto& pc : snapshot()) {
+        ++stats.peers;
+        ++stats.states[pc->getCachedState()];
+
+        const auto& counters = pc->counters();
+        stats.counters.messages_sent += counters.messages_sent;
+        stats.counters.bytes_sent += counters.bytes_sent;
+        stats.counters.send_failures += counters.send_failures;
+        stats.counters.messages_received += counters.messages_received;
+        stats.counters.bytes_received += counters.bytes_received;
+    }
+    return stats;
+}
+
+std::vector<std::shared_ptr<PeerConnection>> PeerManager::snapshot() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    std::vector<std::shared_ptr<PeerConnection>> peers;
+    peers.reserve(_peers.size());
+    for (const auto& entry : _peers) {
+        peers.push_back(entry.second);
+    }
+    return peers;
+}
@@ -0,0 +1,628 @@
+#include "ReliableChannel.h"
+#include "SendPacing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+    constexpr uint8_t kTypeData = 0xD1;
+    constexpr uint8_t kTypeAck = 0xA1;
+    // u8 type | u8 SACK block count | u32 cumulative ACK | u32 echoed timestamp | u32 one-way delay
+    constexpr size_t kAckHeaderSize = 14;
+    constexpr size_t kMaxBatch = 64;
+
+    void write_u32(char* out, uint32_t value) {
+        out[0] = static_cast<char>(value >> 24);
+        out[1] = static_cast<char>(value >> 16);
+        out[2] = static_cast<char>(value >> 8);
+        out[3] = static_cast<char>(value);
+    }
+
+    uint32_t read_u32(const char* in) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(in);
+        return (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+    }
+
+    bool seq_less(uint32_t a, uint32_t b) {
+        return static_cast<int32_t>(a - b) < 0;
+    }
+
+    std::string& next_slot(std::vector<std::string>& out, size_t& count) {
+        if (count == out.size()) {
+            out.emplace_back();
+        }
+        return out[count++];
+    }
+}
+
+ReliableChannel::ReliableChannel(DatagramSender send_datagram, ReliableOptions options)
+    : _send_datagram(std::move(send_datagram)),
+    _options(options),
+    _epoch(std::chrono::steady_clock::now()) {
+
+    _options.mss = std::max(_options.mss, kDataHeaderSize + 1);
+    _options.min_cwnd_packets = std::max<size_t>(_options.min_cwnd_packets, 1);
+    _options.ack_every = std::max<size_t>(_options.ack_every, 1);
+    _cwnd = static_cast<double>(std::max(_options.initial_cwnd_packets, _options.min_cwnd_packets) * _options.mss);
+    _ssthresh = std::numeric_limits<double>::max();
+    _rto_us = std::min<uint64_t>(1000000, std::chrono::microseconds(_options.max_rto).count());
+
+    _sender_thread = std::thread([this]() { senderLoop(); });
+}
+
+ReliableChannel::ReliableChannel(PeerConnection& pc, ReliableOptions options)
+    : ReliableChannel([&pc](std::string_view datagram) { return pc.send(datagram); }, options) {
+
+    pc.onMessageView([this](std::string_view datagram) { input(datagram); });
+}
+
+ReliableChannel::~ReliableChannel() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    if (_sender_thread.joinable()) {
+        _sender_thread.join();
+    }
+}
+
+SendResult ReliableChannel::send(std::string_view msg) {
+    if (msg.size() > maxPayload()) {
+        return SendResult::TooLarge;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_segments.size() >= _options.send_buffer_packets) {
+        return SendResult::Again;
+    }
+
+    // Only an idle sender thread needs waking; a busy one picks the segment up on its next pass
+    const auto& idle = static_cast<size_t>(_snd_nxt - _snd_una) == _segments.size();
+    Segment segment;
+    if (!_spare.empty()) {
+        segment.payload = std::move(_spare.back());
+        _spare.pop_back();
+    }
+    segment.payload.assign(msg.data(), msg.size());
+    _segments.push_back(std::move(segment));
+    if (idle) {
+        _cv.notify_one();
+    }
+    return SendResult::Ok;
+}
+
+size_t ReliableChannel::maxPayload() const {
+    return _options.mss - kDataHeaderSize;
+}
+
+void ReliableChannel::onMessage(std::function<void(std::string_view)> cb) {
+    _message_cb = std::move(cb);
+}
+
+void ReliableChannel::input(std::string_view datagram) {
+    if (datagram.empty()) {
+        return;
+    }
+
+    const auto& type = static_cast<uint8_t>(datagram[0]);
+    if (type == kTypeAck) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        onAck(datagram);
+        return;
+    }
+    if (type != kTypeData || datagram.size() < kDataHeaderSize) {
+        return;
+    }
+
+    // Reused across calls: input() runs on the transport's receive path, one datagram at a time
+    thread_local std::string ack;
+    thread_local std::vector<std::string> deliver;
+    ack.clear();
+    deliver.clear();
+
+    bool deliver_current;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        deliver_current = onData(datagram, ack, deliver);
+    }
+
+    if (!ack.empty()) {
+        _send_datagram(ack);
+    }
+
+    // Delivered outside the lock; order holds because the transport feeds input() serially
+    const auto& delivered = (deliver_current ? 1 : 0) + deliver.size();
+    _messages_delivered.fetch_add(delivered, std::memory_order_relaxed);
+    if (_message_cb) {
+        if (deliver_current) {
+            _message_cb(datagram.substr(kDataHeaderSize));
+        }
+        for (const auto& msg : deliver) {
+            _message_cb(msg);
+        }
+    }
+}
+
+bool ReliableChannel::flush(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(_mutex);
+    return _flush_cv.wait_for(lock, timeout, [this] { return _segments.empty(); });
+}
+
+size_t ReliableChannel::bufferedPackets() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _segments.size();
+}
+
+ReliableStats ReliableChannel::stats() const {
+    ReliableStats stats;
+    stats.packets_sent = _packets_sent.load(std::memory_order_relaxed);
+    stats.retransmits = _retransmits.load(std::memory_order_relaxed);
+    stats.timeouts = _timeouts.load(std::memory_order_relaxed);
+    stats.packets_received = _packets_received.load(std::memory_order_relaxed);
+    stats.duplicates = _duplicates.load(std::memory_order_relaxed);
+    stats.acks_sent = _acks_sent.load(std::memory_order_relaxed);
+    stats.acks_received = _acks_received.load(std::memory_order_relaxed);
+    stats.messages_delivered = _messages_delivered.load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    stats.srtt_ms = _srtt_us / 1000.0;
+    stats.rto_ms = _rto_us / 1000.0;
+    stats.queuing_delay_ms = _queuing_delay_us / 1000.0;
+    stats.cwnd_bytes = static_cast<size_t>(_cwnd);
+    stats.in_flight_bytes = _in_flight;
+    return stats;
+}
+
+void ReliableChannel::senderLoop() {
+    std::vector<std::string> out;
+    SendBackoff backoff;
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (!_stop) {
+        const auto& now = nowUs();
+        if (_rto_deadline_us && now >= _rto_deadline_us) {
+            onTimeout(now);
+        }
+
+        size_t count = transmit(out, now);
+        if (_ack_deadline_us && now >= _ack_deadline_us) {
+            buildAck(next_slot(out, count));
+        }
+
+        if (count > 0) {
+            lock.unlock();
+            size_t sent = 0;
+            while (sent < count && _send_datagram(out[sent]) != SendResult::Again) {
+                ++sent;
+            }
+            if (sent < count) {
+                // Socket buffer full: let it drain, then send the rest again
+                backoff.wait();
+            } else {
+                backoff.reset();
+            }
+            lock.lock();
+
+            const auto& data_sent = std::min(sent, _batch_seqs.size());
+            _packets_sent.fetch_add(data_sent, std::memory_order_relaxed);
+            _retransmits.fetch_add(std::min(data_sent, _batch_retransmits), std::memory_order_relaxed);
+            if (sent < count) {
+                unsend(sent, count, now);
+            }
+            continue;
+        }
+
+        uint64_t wake = std::numeric_limits<uint64_t>::max();
+        if (_rto_deadline_us) {
+            wake = std::min(wake, _rto_deadline_us);
+        }
+        if (_ack_deadline_us) {
+            wake = std::min(wake, _ack_deadline_us);
+        }
+        _wake_us = wake;
+        if (wake == std::numeric_limits<uint64_t>::max()) {
+            _cv.wait(lock);
+        } else {
+            _cv.wait_for(lock, std::chrono::microseconds(wake - now));
+        }
+        _wake_us = 0;
+    }
+}
+
+bool ReliableChannel::onData(std::string_view datagram, std::string& ack, std::vector<std::string>& deliver) {
+    const auto& seq = read_u32(&datagram[2]);
+    const auto& now = nowUs();
+    _packets_received.fetch_add(1, std::memory_order_relaxed);
+    _echo_ts = read_u32(&datagram[6]);
+    _delay_sample = static_cast<uint32_t>(now) - _echo_ts;
+
+    bool deliver_current = false;
+    bool immediate = false;
+    if (seq == _rcv_nxt) {
+        deliver_current = true;
+        ++_rcv_nxt;
+        while (!_out_of_order.empty() && _out_of_order.begin()->first == _rcv_nxt) {
+            deliver.push_back(std::move(_out_of_order.begin()->second));
+            _out_of_order.erase(_out_of_order.begin());
+            ++_rcv_nxt;
+        }
+        // Filling a hole is acknowledged at once so the sender's recovery ends quickly
+        immediate = !deliver.empty() || ++_unacked_received >= _options.ack_every;
+    } else if (seq_less(seq, _rcv_nxt)) {
+        // Our ACK was lost or late: repeat it so the sender stops retransmitting
+        _duplicates.fetch_add(1, std::memory_order_relaxed);
+        immediate = true;
+    } else {
+        if (seq - _rcv_nxt < _options.recv_window_packets) {
+            if (!_out_of_order.emplace(seq, std::string(datagram.substr(kDataHeaderSize))).second) {
+                _duplicates.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+        immediate = true;
+    }
+
+    if (immediate) {
+        buildAck(ack);
+    } else if (!_ack_deadline_us) {
+        _ack_deadline_us = now + std::chrono::microseconds(_options.ack_delay).count();
+        if (_ack_deadline_us < _wake_us) {
+            _cv.notify_one();
+        }
+    }
+    return deliver_current;
+}
+
+void ReliableChannel::onAck(std::string_view datagram) {
+    if (datagram.size() < kAckHeaderSize) {
+        return;
+    }
+    const auto& blocks = static_cast<size_t>(static_cast<uint8_t>(datagram[1]));
+    if (datagram.size() < kAckHeaderSize + blocks * 8) {
+        return;
+    }
+    _acks_received.fetch_add(1, std::memory_order_relaxed);
+
+    const auto& cumulative = read_u32(&datagram[2]);
+    const auto& echo_ts = read_u32(&datagram[6]);
+    const auto& delay = read_u32(&datagram[10]);
+    const auto& now = nowUs();
+
+    size_t bytes_acked = 0;
+    if (seq_less(_snd_una, cumulative) && !seq_less(_snd_nxt, cumulative)) {
+        while (_snd_una != cumulative) {
+            auto& segment = _segments.front();
+            ackSegment(segment, bytes_acked);
+            _spare.push_back(std::move(segment.payload));
+            _segments.pop_front();
+            ++_snd_una;
+        }
+        if (_has_sacked && seq_less(_highest_sacked, _snd_una)) {
+            _has_sacked = false;
+        }
+        if (_in_recovery && !seq_less(_snd_una, _recovery_seq)) {
+            _in_recovery = false;
+        }
+    }
+
+    for (size_t i = 0; i < blocks; ++i) {
+        const auto* block = &datagram[kAckHeaderSize + i * 8];
+        auto seq = read_u32(block);
+        const auto& end = read_u32(block + 4);
+        if (seq_less(seq, _snd_una)) {
+            seq = _snd_una;
+        }
+        for (; seq_less(seq, end) && seq_less(seq, _snd_nxt); ++seq) {
+            auto& segment = _segments[seq - _snd_una];
+            if (!segment.sacked) {
+                segment.sacked = true;
+                ackSegment(segment, bytes_acked);
+                if (!_has_sacked || seq_less(_highest_sacked, seq)) {
+                    _highest_sacked = seq;
+                    _has_sacked = true;
+                }
+            }
+        }
+    }
+
+    if (bytes_acked == 0) {
+        return;
+    }
+
+    updateRtt(static_cast<uint32_t>(now) - echo_ts);
+    updateWindow(bytes_acked, delay, now);
+    detectLosses(now);
+
+    // Restart the timers on progress
+    _probe_sent = false;
+    _rto_deadline_us = 0;
+    armTimer(now);
+    _cv.notify_one();
+    if (_segments.empty()) {
+        _flush_cv.notify_all();
+    }
+}
+
+void ReliableChannel::ackSegment(Segment& segment, size_t& bytes_acked) {
+    const auto& size = segment.payload.size() + kDataHeaderSize;
+    if (segment.in_flight) {
+        segment.in_flight = false;
+        _in_flight -= size;
+    }
+    segment.lost = false;
+    if (segment.sent_us) {
+        _rack_xmit_us = std::max(_rack_xmit_us, segment.sent_us);
+    }
+    bytes_acked += size;
+}
+
+void ReliableChannel::detectLosses(uint64_t now) {
+    const auto& reorder_window = static_cast<uint64_t>(_srtt_us / 4);
+    auto sent_before_acked = [this, now, reorder_window](const Segment& segment) {
+        return segment.sent_us + reorder_window < _rack_xmit_us && now - segment.sent_us > reorder_window;
+    };
+
+    if (_has_sacked) {
+        if (seq_less(_loss_scan, _snd_una)) {
+            _loss_scan = _snd_una;
+        }
+        // First transmissions: lost once reorder_threshold later packets were SACKed
+        for (; seq_less(_loss_scan + _options.reorder_threshold - 1, _highest_sacked); ++_loss_scan) {
+            auto& segment = _segments[_loss_scan - _snd_una];
+            if (segment.in_flight) {
+                markLost(_loss_scan, segment);
+            }
+        }
+        // ... or, in windows too small for that, once a packet sent after them was acknowledged
+        for (auto seq = _loss_scan; seq_less(seq, _highest_sacked); ++seq) {
+            auto& segment = _segments[seq - _snd_una];
+            if (segment.in_flight && sent_before_acked(segment)) {
+                markLost(seq, segment);
+            }
+        }
+    }
+
+    // Retransmissions are out of sequence order, so only the time rule applies to them
+    auto it = _retransmitted.begin();
+    while (it != _retransmitted.end()) {
+        const auto& seq = *it;
+        if (seq_less(seq, _snd_una) || !_segments[seq - _snd_una].in_flight) {
+            it = _retransmitted.erase(it);
+            continue;
+        }
+        auto& segment = _segments[seq - _snd_una];
+        if (sent_before_acked(segment)) {
+            markLost(seq, segment);
+            it = _retransmitted.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+void ReliableChannel::unsend(size_t sent, size_t count, uint64_t now) {
+    // The packets never left: no loss and no window reduction, they go out first on the next pass
+    for (size_t i = _batch_seqs.size(); i-- > sent;) {
+        const auto& seq = _batch_seqs[i];
+        if (seq_less(seq, _snd_una) || !_segments[seq - _snd_una].in_flight) {
+            continue;
+        }
+        auto& segment = _segments[seq - _snd_una];
+        segment.in_flight = false;
+        _in_flight -= segment.payload.size() + kDataHeaderSize;
+        if (i >= _batch_retransmits && seq + 1 == _snd_nxt) {
+            segment.sent_us = 0;
+            --_snd_nxt;
+        } else {
+            segment.lost = true;
+            _lost.push_front(seq);
+        }
+    }
+    // An ACK that did not leave is built again right away
+    if (count > _batch_seqs.size()) {
+        _ack_deadline_us = now;
+    }
+}
+
+void ReliableChannel::markLost(uint32_t seq, Segment& segment) {
+    segment.in_flight = false;
+    segment.lost = true;
+    _in_flight -= segment.payload.size() + kDataHeaderSize;
+    _lost.push_back(seq);
+
+    // One window reduction per loss event (a round trip's worth of losses)
+    if (!_in_recovery || !seq_less(seq, _recovery_seq)) {
+        _cwnd = std::max(_cwnd / 2, static_cast<double>(_options.min_cwnd_packets * _options.mss));
+        _ssthresh = _cwnd;
+        _in_recovery = true;
+        _recovery_seq = _snd_nxt;
+    }
+}
+
+void ReliableChannel::onTimeout(uint64_t now) {
+    _rto_deadline_us = 0;
+    if (_in_flight == 0) {
+        return;
+    }
+
+    // Tail loss probe: resend the newest packet in flight so its ACK reveals any hole before it
+    if (!_probe_sent && _srtt_us > 0.0) {
+        _probe_sent = true;
+        for (auto seq = _snd_nxt - 1; !seq_less(seq, _snd_una); --seq) {
+            auto& segment = _segments[seq - _snd_una];
+            if (segment.in_flight) {
+                segment.in_flight = false;
+                segment.lost = true;
+                _in_flight -= segment.payload.size() + kDataHeaderSize;
+                _lost.push_front(seq);
+                break;
+            }
+        }
+        armTimer(now);
+        return;
+    }
+    _timeouts.fetch_add(1, std::memory_order_relaxed);
+
+    // Everything unacknowledged is presumed lost
+    for (uint32_t seq = _snd_una; seq_less(seq, _snd_nxt); ++seq) {
+        auto& segment = _segments[seq - _snd_una];
+        if (segment.in_flight) {
+            segment.in_flight = false;
+            segment.lost = true;
+            _lost.push_back(seq);
+        }
+    }
+    _in_flight = 0;
+    _retransmitted.clear();
+
+    _ssthresh = std::max(_cwnd / 2, static_cast<double>(_options.min_cwnd_packets * _options.mss));
+    _cwnd = static_cast<double>(_options.min_cwnd_packets * _options.mss);
+    _in_recovery = true;
+    _recovery_seq = _snd_nxt;
+    _rto_us = std::min<uint64_t>(_rto_us * 2, std::chrono::microseconds(_options.max_rto).count());
+}
+
+void ReliableChannel::armTimer(uint64_t now) {
+    if (_rto_deadline_us || (_in_flight == 0 && _lost.empty())) {
+        return;
+    }
+    // The probe waits out a delayed ACK on top of two round trips
+    const auto& probe_us = 2 * _srtt_us + std::chrono::microseconds(_options.ack_delay).count();
+    const auto& use_probe = !_probe_sent && _srtt_us > 0.0 && probe_us < _rto_us;
+    _rto_deadline_us = now + (use_probe ? static_cast<uint64_t>(probe_us) : _rto_us);
+}
+
+void ReliableChannel::updateRtt(uint32_t sample_us) {
+    if (sample_us > std::numeric_limits<int32_t>::max()) {
+        return; // echo from before a clock wrap, or garbage
+    }
+
+    if (_srtt_us == 0.0) {
+        _srtt_us = sample_us;
+        _rttvar_us = sample_us / 2.0;
+    } else {
+        _rttvar_us = 0.75 * _rttvar_us + 0.25 * std::abs(_srtt_us - sample_us);
+        _srtt_us = 0.875 * _srtt_us + 0.125 * sample_us;
+    }
+
+    const auto& rto = _srtt_us + std::max(4 * _rttvar_us, 1000.0);
+    _rto_us = std::clamp<uint64_t>(static_cast<uint64_t>(rto), std::chrono::microseconds(_options.min_rto).count(),
+                                   std::chrono::microseconds(_options.max_rto).count());
+}
+
+void ReliableChannel::updateWindow(size_t bytes_acked, uint32_t delay_sample_us, uint64_t now) {
+    // Base delay: minimum one-way delay over the last ten minutes, one bucket per minute. The clock
+    // offset between the peers is part of every sample and cancels out.
+    const auto& minute = now / 60000000;
+    if (!_has_base) {
+        _base_delays.fill(delay_sample_us);
+        _base_minute = minute;
+        _has_base = true;
+    } else if (minute != _base_minute) {
+        _base_index = (_base_index + 1) % _base_delays.size();
+        _base_delays[_base_index] = delay_sample_us;
+        _base_minute = minute;
+    } else if (seq_less(delay_sample_us, _base_delays[_base_index])) {
+        _base_delays[_base_index] = delay_sample_us;
+    }
+    // Samples live on a wrapping 32-bit clock (the offset may well be "negative"), so compare modulo 2^32
+    const auto& base = *std::min_element(_base_delays.begin(), _base_delays.end(), seq_less);
+    _queuing_delay_us = 0.75 * _queuing_delay_us + 0.25 * std::max(static_cast<int32_t>(delay_sample_us - base), 0);
+
+    const auto& target = static_cast<double>(std::chrono::microseconds(_options.target_delay).count());
+    const auto& mss = static_cast<double>(_options.mss);
+    if (_cwnd < _ssthresh && _queuing_delay_us > target / 2) {
+        _ssthresh = _cwnd;
+    }
+    if (_cwnd < _ssthresh) {
+        _cwnd += bytes_acked;
+    } else {
+        const auto& off_target = (target - _queuing_delay_us) / target;
+        _cwnd += _options.gain * off_target * bytes_acked * mss / _cwnd;
+    }
+    _cwnd = std::clamp(_cwnd, _options.min_cwnd_packets * mss, _options.send_buffer_packets * mss);
+}
+
+void ReliableChannel::buildAck(std::string& out) {
+    out.resize(kAckHeaderSize);
+    out[0] = static_cast<char>(kTypeAck);
+    write_u32(&out[2], _rcv_nxt);
+    write_u32(&out[6], _echo_ts);
+    write_u32(&out[10], _delay_sample);
+
+    // SACK the lowest ranges first: those are the holes the sender has to fill next
+    size_t blocks = 0;
+    auto it = _out_of_order.begin();
+    while (it != _out_of_order.end() && blocks < kMaxSackBlocks) {
+        const auto& start = it->first;
+        uint32_t end = start + 1;
+        for (++it; it != _out_of_order.end() && it->first == end; ++it) {
+            ++end;
+        }
+        out.resize(out.size() + 8);
+        write_u32(&out[out.size() - 8], start);
+        write_u32(&out[out.size() - 4], end);
+        ++blocks;
+    }
+    out[1] = static_cast<char>(blocks);
+
+    _unacked_received = 0;
+    _ack_deadline_us = 0;
+    _acks_sent.fetch_add(1, std::memory_order_relaxed);
+}
+
+size_t ReliableChannel::transmit(std::vector<std::string>& out, uint64_t now) {
+    size_t count = 0;
+    _batch_seqs.clear();
+    _batch_retransmits = 0;
+    auto window_open = [this](size_t size) { return _in_flight == 0 || _in_flight + size <= _cwnd; };
+
+    // Retransmissions go first
+    while (!_lost.empty() && count < kMaxBatch) {
+        const auto& seq = _lost.front();
+        if (seq_less(seq, _snd_una) || !_segments[seq - _snd_una].lost) {
+            _lost.pop_front();
+            continue;
+        }
+        auto& segment = _segments[seq - _snd_una];
+        if (!window_open(segment.payload.size() + kDataHeaderSize)) {
+            return count;
+        }
+        buildData(next_slot(out, count), seq, segment, now);
+        _batch_seqs.push_back(seq);
+        segment.lost = false;
+        _retransmitted.push_back(seq);
+        ++_batch_retransmits;
+        _lost.pop_front();
+    }
+
+    while (static_cast<size_t>(_snd_nxt - _snd_una) < _segments.size() && count < kMaxBatch) {
+        auto& segment = _segments[_snd_nxt - _snd_una];
+        if (!window_open(segment.payload.size() + kDataHeaderSize)) {
+            break;
+        }
+        buildData(next_slot(out, count), _snd_nxt, segment, now);
+        _batch_seqs.push_back(_snd_nxt);
+        ++_snd_nxt;
+    }
+    return count;
+}
+
+void ReliableChannel::buildData(std::string& out, uint32_t seq, Segment& segment, uint64_t now) {
+    out.resize(kDataHeaderSize);
+    out[0] = static_cast<char>(kTypeData);
+    out[1] = 0;
+    write_u32(&out[2], seq);
+    write_u32(&out[6], static_cast<uint32_t>(now));
+    out.append(segment.payload);
+
+    segment.sent_us = now;
+    segment.in_flight = true;
+    _in_flight += out.size();
+    armTimer(now);
+}
+
+uint64_t ReliableChannel::nowUs() const {
+    // Offset by one so that a send time of 0 can mean "never sent"
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - _epoch).count() + 1;
+}
@@ -0,0 +1,35 @@
+#include "SendPacing.h"
+
+#include <algorithm>
+#include <thread>
+
+Pacer::Pacer(uint64_t bytes_per_sec, size_t burst_bytes)
+    : _rate(static_cast<double>(bytes_per_sec)),
+    _burst(static_cast<double>(burst_bytes)),
+    _tokens(static_cast<double>(burst_bytes)),
+    _last_refill(std::chrono::steady_clock::now()) {
+}
+
+void Pacer::pace(size_t bytes) {
+    if (_rate <= 0.0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(_mutex);
+    const auto& burst = std::max(_burst, static_cast<double>(bytes));
+    auto now = std::chrono::steady_clock::now();
+    _tokens = std::min(burst, _tokens + std::chrono::duration<double>(now - _last_refill).count() * _rate);
+    _last_refill = now;
+    if (_tokens < bytes) {
+        std::this_thread::sleep_for(std::chrono::duration<double>((bytes - _tokens) / _rate));
+        now = std::chrono::steady_clock::now();
+        _tokens = std::min(burst, _tokens + std::chrono::duration<double>(now - _last_refill).count() * _rate);
+        _last_refill = now;
+    }
+    _tokens -= bytes;
+}
+
+void SendBackoff::wait() {
+    std::this_thread::sleep_for(_wait);
+    _wait = std::min(_wait * 2, kMaxWait);
+}
@@ -0,0 +1,74 @@
+#include "SendQueue.h"
+
+namespace {
+    size_t round_up_pow2(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+}
+
+SendQueue::SendQueue(const SendQueueOptions& options)
+    : _slots(round_up_pow2(options.capacity ? options.capacity : 1)),
+    _mask(_slots.size() - 1),
+    _slot_size(options.slot_size) {
+
+    for (auto& slot : _slots) {
+        slot.reserve(_slot_size);
+    }
+}
+
+bool SendQueue::push(std::string_view msg) {
+    const auto tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == _slots.size()) {
+        return false;
+    }
+
+    _slots[tail & _mask].assign(msg.data(), msg.size());
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+bool SendQueue::push(std::string&& msg) {
+    const auto tail = _tail.load(std::memory_order_relaxed);
+    if (tail - _head.load(std::memory_order_acquire) == _slots.size()) {
+        return false;
+    }
+
+    // Taking msg's buffer only pays when it is as roomy as the pooled one handed back in exchange
+    auto& slot = _slots[tail & _mask];
+    if (msg.capacity() >= _slot_size) {
+        slot.swap(msg);
+    } else {
+        slot.assign(msg);
+    }
+    _tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+const std::string* SendQueue::front() const {
+    const auto head = _head.load(std::memory_order_relaxed);
+    if (head == _tail.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &_slots[head & _mask];
+}
+
+void SendQueue::pop() {
+    _head.store(_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+size_t SendQueue::size() const {
+    const auto head = _head.load(std::memory_order_acquire);
+    return _tail.load(std::memory_order_acquire) - head;
+}
+
+size_t SendQueue::capacity() const {
+    return _slots.size();
+}
+
+size_t SendQueue::slotSize() const {
+    return _slot_size;
+}
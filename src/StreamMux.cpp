@@ -0,0 +1,157 @@
+#include "StreamMux.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+    constexpr size_t kMaxSpareBuffers = 1024;
+}
+
+StreamMux::StreamMux(PeerConnection& pc, StreamMuxOptions options)
+    : _pc(pc),
+    _options(options),
+    _pacer(options.pacing_bytes_per_sec, options.pacing_burst_bytes) {
+
+    _options.quantum = std::max<size_t>(_options.quantum, 1);
+
+    _pc.onMessageView([this](std::string_view datagram) {
+        if (!datagram.empty() && _message_cb) {
+            _message_cb(static_cast<StreamId>(datagram[0]), datagram.substr(kHeaderSize));
+        }
+    });
+    _scheduler_thread = std::thread([this]() { schedulerLoop(); });
+}
+
+StreamMux::~StreamMux() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _cv.notify_all();
+    if (_scheduler_thread.joinable()) {
+        _scheduler_thread.join();
+    }
+}
+
+std::optional<StreamMux::StreamId> StreamMux::addStream(const StreamOptions& options) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_streams.size() >= kMaxStreams) {
+        return std::nullopt;
+    }
+    auto stream = std::make_unique<Stream>();
+    stream->options = options;
+    stream->options.weight = std::max(stream->options.weight, 1u);
+    _streams.push_back(std::move(stream));
+    return static_cast<StreamId>(_streams.size() - 1);
+}
+
+SendResult StreamMux::send(StreamId stream, std::string_view msg) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (stream >= _streams.size()) {
+        return SendResult::Failed;
+    }
+    auto& queue = _streams[stream]->queue;
+    if (queue.size() >= _streams[stream]->options.max_queued) {
+        return SendResult::Again;
+    }
+
+    std::string datagram;
+    if (!_spare.empty()) {
+        datagram = std::move(_spare.back());
+        _spare.pop_back();
+    }
+    datagram.assign(1, static_cast<char>(stream));
+    datagram.append(msg.data(), msg.size());
+    queue.push_back(std::move(datagram));
+    if (++_queued == 1) {
+        _cv.notify_one();
+    }
+    return SendResult::Ok;
+}
+
+void StreamMux::onMessage(std::function<void(StreamId, std::string_view)> cb) {
+    _message_cb = std::move(cb);
+}
+
+StreamStats StreamMux::stats(StreamId stream) const {
+    StreamStats stats;
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (stream < _streams.size()) {
+        const auto& s = *_streams[stream];
+        stats.messages_sent = s.messages_sent.load(std::memory_order_relaxed);
+        stats.bytes_sent = s.bytes_sent.load(std::memory_order_relaxed);
+        stats.send_failures = s.send_failures.load(std::memory_order_relaxed);
+        stats.queued = s.queue.size();
+    }
+    return stats;
+}
+
+size_t StreamMux::streamCount() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _streams.size();
+}
+
+void StreamMux::schedulerLoop() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    while (true) {
+        _cv.wait(lock, [this] { return _stop || _queued > 0; });
+        if (_stop) {
+            break;
+        }
+
+        // One message per pass, so a higher priority arrival is served right after the current send
+        auto* stream = pickLocked();
+        auto datagram = std::move(stream->queue.front());
+        stream->queue.pop_front();
+        --_queued;
+        stream->deficit -= datagram.size();
+        if (stream->queue.empty()) {
+            stream->deficit = 0;
+        }
+        const auto& ds = stream->options.dscp << 2;
+        lock.unlock();
+
+        _pacer.pace(datagram.size());
+        // Socket buffer full: wait rather than drop, the message already left its queue
+        const auto& result = send_retrying([this, &datagram, ds]() { return _pc.sendDiffserv(datagram, ds); },
+                                           [this]() { return !_stop.load(std::memory_order_relaxed); });
+        // Still Again if the mux is being destroyed meanwhile, then the message counts as failed
+        if (result == SendResult::Ok) {
+            stream->messages_sent.fetch_add(1, std::memory_order_relaxed);
+            stream->bytes_sent.fetch_add(datagram.size() - kHeaderSize, std::memory_order_relaxed);
+        } else {
+            stream->send_failures.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        lock.lock();
+        if (_spare.size() < kMaxSpareBuffers) {
+            _spare.push_back(std::move(datagram));
+        }
+    }
+}
+
+StreamMux::Stream* StreamMux::pickLocked() {
+    auto best = std::numeric_limits<unsigned>::max();
+    for (const auto& stream : _streams) {
+        if (!stream->queue.empty()) {
+            best = std::min(best, stream->options.priority);
+        }
+    }
+
+    // Deficit round robin among the streams of that level: each visit adds weight quanta to the
+    // stream's deficit, which it spends on whole messages before the cursor moves on
+    while (true) {
+        auto& stream = *_streams[_cursor];
+        if (!stream.queue.empty() && stream.options.priority == best) {
+            if (_new_visit) {
+                stream.deficit += _options.quantum * stream.options.weight;
+                _new_visit = false;
+            }
+            if (stream.deficit >= stream.queue.front().size()) {
+                return &stream;
+            }
+        }
+        _cursor = (_cursor + 1) % _streams.size();
+        _new_visit = true;
+    }
+}
@@ -1,46 +1,180 @@
-
 #include "PeerConnection.h"
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
 #include <spdlog/sinks/stdout_color_sinks.h>
 
-int main() {
+namespace {
+    constexpr auto kBenchPhaseTimeout = std::chrono::seconds(5);
+    constexpr std::array<const char*, 5> kBenchPhases = {"gather", "offer/answer", "connect", "exchange", "total"};
+
+    struct BenchSignal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        int gathered = 0;
+        int connected = 0;
+        bool pong = false;
+    };
+
+    double percentile(std::vector<double> samples, double p) {
+        std::sort(samples.begin(), samples.end());
+        const auto& rank = static_cast<size_t>(p / 100.0 * (samples.size() - 1) + 0.5);
+        return samples[std::min(rank, samples.size() - 1)];
+    }
+
+    double elapsed_ms(std::chrono::steady_clock::time_point since) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+    }
+
+    // One full lifecycle on 127.0.0.1: gather -> offer/answer -> connect -> ping/pong.
+    // Fills one duration per phase, in milliseconds.
+    bool bench_iteration(const std::shared_ptr<spdlog::logger>& _logger, std::array<double, 5>& phases) {
+        auto config = host_only_config();
+        config.bind_address = "127.0.0.1";
+        PeerConnection pc1(true, "PC1", config);
+        PeerConnection pc2(false, "PC2", config);
+
+        auto signal = std::make_shared<BenchSignal>();
+        for (auto* pc : {&pc1, &pc2}) {
+            pc->onGatheringDone([signal]() {
+                std::lock_guard<std::mutex> lock(signal->mutex);
+                ++signal->gathered;
+                signal->cv.notify_all();
+            });
+            pc->onStateChange([signal, seen = std::make_shared<bool>(false)](juice_state state) {
+                if ((state == JUICE_STATE_CONNECTED || state == JUICE_STATE_COMPLETED) && !*seen) {
+                    *seen = true;
+                    std::lock_guard<std::mutex> lock(signal->mutex);
+                    ++signal->connected;
+                    signal->cv.notify_all();
+                }
+            });
+        }
+        pc2.onMessageView([&pc2](std::string_view msg) {
+            if (msg == "ping") {
+                pc2.send("pong");
+            }
+        });
+        pc1.onMessageView([signal](std::string_view msg) {
+            if (msg == "pong") {
+                std::lock_guard<std::mutex> lock(signal->mutex);
+                signal->pong = true;
+                signal->cv.notify_all();
+            }
+        });
+
+        const auto& start = std::chrono::steady_clock::now();
+        auto phase_start = start;
+        if (!pc1.startGathering() || !pc2.startGathering()) {
+            _logger->error("Gathering failed to start");
+            return false;
+        }
+        std::unique_lock<std::mutex> lock(signal->mutex);
+        if (!signal->cv.wait_for(lock, kBenchPhaseTimeout, [&signal] { return signal->gathered == 2; })) {
+            _logger->error("ICE gathering timeout");
+            return false;
+        }
+        lock.unlock();
+        phases[0] = elapsed_ms(phase_start);
+
+        phase_start = std::chrono::steady_clock::now();
+        if (!pc2.setRemoteDescription(pc1.createOffer()) || !pc1.setRemoteDescription(pc2.createAnswer())) {
+            _logger->error("Offer/answer exchange failed");
+            return false;
+        }
+        pc1.setRemoteGatheringDone();
+        pc2.setRemoteGatheringDone();
+        phases[1] = elapsed_ms(phase_start);
+
+        phase_start = std::chrono::steady_clock::now();
+        lock.lock();
+        if (!signal->cv.wait_for(lock, kBenchPhaseTimeout, [&signal] { return signal->connected == 2; })) {
+            _logger->error("Connection timeout");
+            return false;
+        }
+        lock.unlock();
+        phases[2] = elapsed_ms(phase_start);
+
+        phase_start = std::chrono::steady_clock::now();
+        if (pc1.send("ping") != SendResult::Ok) {
+            _logger->error("Ping send failed");
+            return false;
+        }
+        lock.lock();
+        if (!signal->cv.wait_for(lock, kBenchPhaseTimeout, [&signal] { return signal->pong; })) {
+            _logger->error("Message exchange timeout");
+            return false;
+        }
+        phases[3] = elapsed_ms(phase_start);
+        phases[4] = elapsed_ms(start);
+        return true;
+    }
+
+    // Repeats the connection lifecycle without any network beyond loopback and prints the latency
+    // distribution of each phase, to track connection-setup regressions offline.
+    int run_bench(const std::shared_ptr<spdlog::logger>& _logger, int iterations) {
+        spdlog::set_level(spdlog::level::warn); // quiet the per-connection loggers created below
+        _logger->set_level(spdlog::level::info);
+        _logger->info("Benchmarking {} connection lifecycles on 127.0.0.1", iterations);
+
+        std::array<std::vector<double>, kBenchPhases.size()> samples;
+        for (int i = 0; i < iterations; ++i) {
+            std::array<double, kBenchPhases.size()> phases{};
+            if (!bench_iteration(_logger, phases)) {
+                _logger->error("Iteration {} failed", i);
+                return 1;
+            }
+            for (size_t phase = 0; phase < phases.size(); ++phase) {
+                samples[phase].push_back(phases[phase]);
+            }
+        }
+
+        _logger->info("{:>14} {:>9} {:>9} {:>9} {:>9}", "phase (ms)", "p50", "p90", "p99", "max");
+        for (size_t phase = 0; phase < kBenchPhases.size(); ++phase) {
+            _logger->info("{:>14} {:>9.3f} {:>9.3f} {:>9.3f} {:>9.3f}", kBenchPhases[phase],
+                          percentile(samples[phase], 50), percentile(samples[phase], 90),
+                          percentile(samples[phase], 99), percentile(samples[phase], 100));
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char** argv) {
     const auto _logger = spdlog::stdout_color_mt("MAIN");
     _logger->set_pattern("[%H:%M:%S.%e] [%n] %v");
 
+    if (argc >= 2 && std::strcmp(argv[1], "--bench") == 0) {
+        const auto& iterations = argc >= 3 ? std::atoi(argv[2]) : 100;
+        if (iterations <= 0) {
+            _logger->error("Usage: {} [--bench N]", argv[0]);
+            return 1;
+        }
+        return run_bench(_logger, iterations);
+    }
+
     _logger->info("========================================");
     _logger->info("      loki-p2p-chat demo starting     ");
     _logger->info("========================================");
 
-    // INIT
-    std::atomic<bool> pc1_gathering_done{false};
-    std::atomic<bool> pc2_gathering_done{false};
-    std::atomic<bool> offer_answer_exchanged{false};
-    std::atomic<bool> pc1_connected{false};
-    std::atomic<bool> pc2_connected{false};
-
-    // ROLE
-    PeerConnection pc1(true, "PC1");
-    PeerConnection pc2(false, "PC2");
-
-    // STATE
-    pc1.onStateChange([&pc1_connected, &_logger](juice_state state){
-        if (state == JUICE_STATE_COMPLETED || state == JUICE_STATE_CONNECTED) {
-            pc1_connected = true;
-        }
-    });
+    // Declared before the connections, whose callbacks use them
+    std::mutex received_mutex;
+    std::condition_variable received_cv;
+    int received = 0;
 
-    pc2.onStateChange([&pc2_connected, &_logger](juice_state state){
-        if (state == JUICE_STATE_COMPLETED || state == JUICE_STATE_CONNECTED) {
-            pc2_connected = true;
-        }
-    });
+    // ROLE (both peers live in this process, so host candidates are enough and gathering needs no STUN round trip)
+    PeerConnection pc1(true, "PC1", host_only_config());
+    PeerConnection pc2(false, "PC2", host_only_config());
 
     // RECEIVE
-    pc1.onMessage([&_logger](const std::string& msg){
-        _logger->info("PC1 received: \"{}\"", msg);
-    });
-    pc2.onMessage([&_logger](const std::string& msg){
-        _logger->info("PC2 received: \"{}\"", msg);
-    });
+    for (auto* pc : {&pc1, &pc2}) {
+        pc->onMessage([&, pc](const std::string& msg){
+            _logger->info("{} received: \"{}\"", pc->name(), msg);
+            std::lock_guard<std::mutex> lock(received_mutex);
+            ++received;
+            received_cv.notify_all();
+        });
+    }
 
     // CANDIDATES EXCHANGE
     pc1.onCandidate([&pc2, &_logger](const std::string& cand){
@@ -50,31 +184,23 @@ int main() {
         pc1.addRemoteCandidate(cand);
     });
 
-    // GATHERING DONE
-    pc1.onGatheringDone([&pc1_gathering_done, &_logger](){
-        pc1_gathering_done = true;
-    });
-    pc2.onGatheringDone([&pc2_gathering_done, &_logger](){
-        pc2_gathering_done = true;
-    });
-
     // GATHERING
     _logger->info("");
     _logger->info("Phase 1: ICE Candidate Gathering");
     _logger->info("--------------------------------");
 
-    pc1.startGathering();
-    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-    pc2.startGathering();
-
     auto gathering_start = std::chrono::steady_clock::now();
-    while (!pc1_gathering_done || !pc2_gathering_done) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        auto elapsed = std::chrono::steady_clock::now() - gathering_start;
-        if (elapsed > std::chrono::seconds(10)) {
-            _logger->error("ICE gathering timeout");
-            return 1;
-        }
+    auto pc1_gathered = pc1.gatherAsync();
+    auto pc2_gathered = pc2.gatherAsync();
+    const auto& gathering_deadline = gathering_start + std::chrono::seconds(10);
+    if (pc1_gathered.wait_until(gathering_deadline) != std::future_status::ready
+        || pc2_gathered.wait_until(gathering_deadline) != std::future_status::ready) {
+        _logger->error("ICE gathering timeout");
+        return 1;
+    }
+    if (!pc1_gathered.get() || !pc2_gathered.get()) {
+        _logger->error("ICE gathering failed");
+        return 1;
     }
 
     auto gathering_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - gathering_start);
@@ -84,27 +210,25 @@ int main() {
     _logger->info("");
     _logger->info("Phase 2: SDP Offer/Answer Exchange");
     _logger->info("----------------------------------");
-    if (!offer_answer_exchanged) {
-        offer_answer_exchanged = true;
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));
-        std::string offer = pc1.createOffer();
-        if (!offer.empty()) {
-            const auto& result = pc2.setRemoteDescription(offer);
-            if (result) {
-                std::string answer = pc2.createAnswer();
-                if (!answer.empty()) {
-                    const auto& result2 = pc1.setRemoteDescription(answer);
-                    if (result2) {
-                        pc1.setRemoteGatheringDone();
-                        pc2.setRemoteGatheringDone();
-                    }
-                } else {
-                    return 1;
+    auto pc1_connected = pc1.connectAsync();
+    auto pc2_connected = pc2.connectAsync();
+    std::string offer = pc1.createOffer();
+    if (!offer.empty()) {
+        const auto& result = pc2.setRemoteDescription(offer);
+        if (result) {
+            std::string answer = pc2.createAnswer();
+            if (!answer.empty()) {
+                const auto& result2 = pc1.setRemoteDescription(answer);
+                if (result2) {
+                    pc1.setRemoteGatheringDone();
+                    pc2.setRemoteGatheringDone();
                 }
+            } else {
+                return 1;
             }
-        } else {
-            return 1;
         }
+    } else {
+        return 1;
     }
 
     // ESTABLISHMENT
@@ -114,36 +238,41 @@ int main() {
     _logger->info("Waiting for P2P connection to establish...");
 
     auto connection_start = std::chrono::steady_clock::now();
-    int timeout = 50; // 5[SEC]
-    while(timeout > 0 && (!pc1_connected || !pc2_connected)) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        timeout--;
-        if (timeout % 10 == 0) {
+    const auto& connection_deadline = connection_start + std::chrono::seconds(5);
+    for (auto* connected : {&pc1_connected, &pc2_connected}) {
+        while (connected->wait_for(std::chrono::seconds(1)) != std::future_status::ready) {
+            if (std::chrono::steady_clock::now() >= connection_deadline) {
+                _logger->error("Connection timeout - PC1: {} | PC2: {}", juice_state_to_string(pc1.getState()),
+                               juice_state_to_string(pc2.getState()));
+                return 1;
+            }
             _logger->info("Still connecting... PC1: {} | PC2: {}",
                               juice_state_to_string(pc1.getState()),
                               juice_state_to_string(pc2.getState()));
         }
     }
-
-    auto connection_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connection_start);
-    if (timeout <= 0) {
+    if (pc1_connected.get() == JUICE_STATE_FAILED || pc2_connected.get() == JUICE_STATE_FAILED) {
+        _logger->error("Connection failed");
         return 1;
     }
 
+    auto connection_duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - connection_start);
+
     _logger->info("P2P connection established successfully in {}ms", connection_duration.count());
     _logger->info("");
     _logger->info("Phase 4: Message Exchange Test");
     _logger->info("------------------------------");
 
     // SEND
-    std::this_thread::sleep_for(std::chrono::milliseconds(500));
-    if (pc1_connected) {
-        pc1.sendMessage("Hey PC2, Are you there ???");
-    }
-    if (pc2_connected) {
-        pc2.sendMessage("Yes, PC1! Ready to chat !!!");
+    pc1.sendMessage("Hey PC2, Are you there ???");
+    pc2.sendMessage("Yes, PC1! Ready to chat !!!");
+    {
+        std::unique_lock<std::mutex> lock(received_mutex);
+        if (!received_cv.wait_for(lock, std::chrono::seconds(5), [&received] { return received == 2; })) {
+            _logger->error("Message exchange timeout - {} of 2 messages received", received);
+            return 1;
+        }
     }
-    std::this_thread::sleep_for(std::chrono::seconds(1));
 
     // FINALIZE
     _logger->info("");
@@ -155,6 +284,14 @@ int main() {
     _logger->info(" - Connection Time: {}ms", connection_duration.count());
     _logger->info(" - PC1 Final State: {}", juice_state_to_string(pc1.getState()));
     _logger->info(" - PC2 Final State: {}", juice_state_to_string(pc2.getState()));
+    for (const auto* pc : {&pc1, &pc2}) {
+        const auto& stats = pc->stats().transport;
+        _logger->info(" - {} Transport: {} datagrams / {} bytes out, {} datagrams / {} bytes in, "
+                      "{} STUN requests ({} retransmitted), RTT {}ms, connected after {}ms",
+                      pc->name(), stats.wire_datagrams_sent, stats.wire_bytes_sent, stats.wire_datagrams_received,
+                      stats.wire_bytes_received, stats.stun_requests_sent, stats.stun_retransmissions, stats.rtt_ms,
+                      stats.connected_ms);
+    }
     _logger->info("");
 
     return 0;
@@ -0,0 +1,257 @@
+#include "PeerConnection.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Callback delivery through an executor: messages keep their order across small batches, a burst is
+// handed over in batches rather than one task per event, and a connection may destroy itself or
+// switch executors from one of its own handlers without deadlocking. Exits non-zero on failure.
+namespace {
+    constexpr auto kTimeout = std::chrono::seconds(10);
+    constexpr size_t kMessages = 300;
+    constexpr size_t kMaxBatch = 4;
+
+    // Counts the tasks posted to a thread pool
+    class CountingExecutor : public ThreadPoolExecutor {
+    public:
+        explicit CountingExecutor(size_t threads) : ThreadPoolExecutor(threads, 64, "test pool") {
+        }
+
+        void post(std::function<void()> task) override {
+            posted.fetch_add(1, std::memory_order_relaxed);
+            ThreadPoolExecutor::post(std::move(task));
+        }
+
+        std::atomic<size_t> posted{0};
+    };
+
+    // Set once, waited on with a timeout
+    struct Flag {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool set = false;
+
+        void raise() {
+            std::lock_guard<std::mutex> lock(mutex);
+            set = true;
+            cv.notify_all();
+        }
+
+        bool wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            return cv.wait_for(lock, kTimeout, [this] { return set; });
+        }
+    };
+
+    bool check(bool condition, const char* what) {
+        std::printf("%s: %s\n", condition ? "ok  " : "FAIL", what);
+        return condition;
+    }
+
+    PeerConnectionConfig loopbackConfig() {
+        auto config = host_only_config(JUICE_CONCURRENCY_MODE_POLL);
+        config.bind_address = "127.0.0.1";
+        return config;
+    }
+
+    bool connect(PeerConnection& a, PeerConnection& b) {
+        auto a_gathered = a.gatherAsync();
+        auto b_gathered = b.gatherAsync();
+        if (a_gathered.wait_for(kTimeout) != std::future_status::ready || !a_gathered.get() ||
+            b_gathered.wait_for(kTimeout) != std::future_status::ready || !b_gathered.get()) {
+            return false;
+        }
+
+        auto a_connected = a.connectAsync();
+        auto b_connected = b.connectAsync();
+        if (!b.setRemoteDescription(a.createOffer()) || !a.setRemoteDescription(b.createAnswer())) {
+            return false;
+        }
+        a.setRemoteGatheringDone();
+        b.setRemoteGatheringDone();
+        return a_connected.wait_for(kTimeout) == std::future_status::ready &&
+               b_connected.wait_for(kTimeout) == std::future_status::ready && a.isConnected() && b.isConnected();
+    }
+
+    bool sendNumbered(PeerConnection& tx, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            if (tx.send(std::to_string(i)) != SendResult::Ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The first handler blocks until the whole burst is queued, so the rest is delivered in batches
+    bool testOrderingAndBatching() {
+        auto executor = std::make_shared<CountingExecutor>(4);
+        PeerConnection tx(true, "TX", loopbackConfig());
+        PeerConnection rx(false, "RX", loopbackConfig());
+        rx.setExecutor(executor, kMaxBatch);
+
+        Flag release;
+        Flag done;
+        std::mutex mutex;
+        std::vector<size_t> received;
+        rx.onMessage([&](const std::string& msg) {
+            if (msg == "0") {
+                release.wait();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            received.push_back(std::stoul(msg));
+            if (received.size() == kMessages) {
+                done.raise();
+            }
+        });
+        if (!check(connect(tx, rx), "pair connects")) {
+            return false;
+        }
+
+        const size_t posted_before = executor->posted.load();
+        bool ok = check(sendNumbered(tx, kMessages), "burst sent");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200)); // let the burst reach the queue
+        release.raise();
+        ok &= check(done.wait(), "every message delivered");
+
+        std::lock_guard<std::mutex> lock(mutex);
+        bool ordered = true;
+        for (size_t i = 0; i < received.size(); ++i) {
+            ordered &= received[i] == i;
+        }
+        ok &= check(ordered, "messages delivered in order on a thread pool");
+        const size_t posted = executor->posted.load() - posted_before;
+        std::printf("      %zu messages in %zu executor tasks, batches of up to %zu\n", received.size(), posted,
+                    kMaxBatch);
+        ok &= check(posted <= kMessages / 2, "burst delivered in batches");
+        return ok;
+    }
+
+    bool testDestroyFromCallback(const std::shared_ptr<CallbackExecutor>& executor, const char* what) {
+        PeerConnection tx(true, "TX", loopbackConfig());
+        auto rx = std::make_unique<PeerConnection>(false, "RX", loopbackConfig());
+        rx->setExecutor(executor, kMaxBatch);
+
+        Flag destroyed;
+        std::atomic<size_t> after{0};
+        std::atomic<bool> gone{false};
+        rx->onMessage([&](const std::string& msg) {
+            if (gone.load()) {
+                after.fetch_add(1);
+                return;
+            }
+            if (msg == "10") {
+                gone = true;
+                auto* flag = &destroyed; // the closure goes away with the connection
+                rx.reset();
+                flag->raise();
+            }
+        });
+        if (!check(connect(tx, *rx), "pair connects")) {
+            return false;
+        }
+
+        bool ok = check(sendNumbered(tx, 100), "messages sent");
+        ok &= check(destroyed.wait(), what);
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        ok &= check(after.load() == 0, "no delivery after destroy");
+        return ok;
+    }
+
+    // Only the connection references the executor, so destroying the connection, here or from a
+    // handler running on that executor, also destroys the executor, possibly from its own worker
+    bool testUnownedExecutor(bool from_callback, const char* what) {
+        PeerConnection tx(true, "TX", loopbackConfig());
+        auto rx = std::make_unique<PeerConnection>(false, "RX", loopbackConfig());
+        rx->setExecutor(std::make_shared<ThreadExecutor>(kMaxBatch, "test unowned"), kMaxBatch);
+
+        Flag destroyed;
+        Flag delivering;
+        std::atomic<bool> gone{false};
+        rx->onMessage([&, from_callback](const std::string& msg) {
+            if (gone.load()) {
+                return;
+            }
+            delivering.raise();
+            if (from_callback && msg == "10") {
+                gone = true;
+                auto* flag = &destroyed; // the closure goes away with the connection
+                rx.reset();
+                flag->raise();
+            }
+        });
+        if (!check(connect(tx, *rx), "pair connects")) {
+            return false;
+        }
+
+        bool ok = check(sendNumbered(tx, 100), "messages sent");
+        if (from_callback) {
+            ok &= check(destroyed.wait(), what);
+        } else {
+            ok &= check(delivering.wait(), "delivery started");
+            gone = true;
+            rx.reset(); // while the executor thread may be running a batch
+            ok &= check(true, what);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        return ok;
+    }
+
+    bool testSwitchExecutorFromCallback() {
+        auto first = std::make_shared<ThreadExecutor>(kMaxBatch, "test first");
+        auto second = std::make_shared<ThreadExecutor>(kMaxBatch, "test second");
+        PeerConnection tx(true, "TX", loopbackConfig());
+        PeerConnection rx(false, "RX", loopbackConfig());
+        rx.setExecutor(first, kMaxBatch);
+
+        Flag switched;
+        Flag resumed;
+        rx.onMessage([&](const std::string& msg) {
+            if (msg == "switch") {
+                rx.setExecutor(second, kMaxBatch);
+                switched.raise();
+            } else if (msg == "after") {
+                resumed.raise();
+            }
+        });
+        if (!check(connect(tx, rx), "pair connects")) {
+            return false;
+        }
+
+        tx.send("switch");
+        bool ok = check(switched.wait(), "setExecutor from a handler returns");
+        tx.send("after");
+        ok &= check(resumed.wait(), "delivery continues on the new executor");
+        return ok;
+    }
+}
+
+int main() {
+    spdlog::set_level(spdlog::level::warn);
+    juice_set_log_level(JUICE_LOG_LEVEL_ERROR);
+
+    // A deadlock fails the run instead of hanging it
+    std::thread([] {
+        std::this_thread::sleep_for(std::chrono::minutes(2));
+        std::printf("FAIL: timed out\n");
+        std::_Exit(1);
+    }).detach();
+
+    bool ok = testOrderingAndBatching();
+    ok &= testDestroyFromCallback(std::make_shared<ThreadExecutor>(kMaxBatch, "test thread"),
+                                  "destroy from a handler on a thread executor returns");
+    ok &= testDestroyFromCallback(std::make_shared<ThreadPoolExecutor>(4, 64, "test pool"),
+                                  "destroy from a handler on a thread pool returns");
+    ok &= testUnownedExecutor(true, "destroy from a handler on an executor nobody else holds returns");
+    ok &= testUnownedExecutor(false, "destroy during delivery on an executor nobody else holds returns");
+    ok &= testSwitchExecutorFromCallback();
+    std::printf("%s\n", ok ? "Success" : "Failure");
+    return ok ? 0 : 1;
+}
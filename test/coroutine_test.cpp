@@ -0,0 +1,160 @@
+#include "PeerConnection.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// The coroutine awaitables of PeerConnection: an outcome already known continues without suspending,
+// and a coroutine suspended on a connection with an executor is resumed through that executor
+// rather than on the juice thread. Built with P2P_COROUTINES only. Exits non-zero on failure.
+namespace {
+    constexpr auto kTimeout = std::chrono::seconds(10);
+
+    thread_local bool in_executor_task = false;
+
+    // Marks the tasks it runs, so a coroutine can tell where it was resumed
+    class MarkingExecutor : public ThreadPoolExecutor {
+    public:
+        MarkingExecutor() : ThreadPoolExecutor(1, 64, "test pool") {
+        }
+
+        void post(std::function<void()> task) override {
+            posted.fetch_add(1, std::memory_order_relaxed);
+            ThreadPoolExecutor::post([task = std::move(task)]() {
+                in_executor_task = true;
+                task();
+                in_executor_task = false;
+            });
+        }
+
+        std::atomic<size_t> posted{0};
+    };
+
+    // Fire and forget: starts at once, the frame goes away when the body returns
+    struct Task {
+        struct promise_type {
+            Task get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    // Set once, waited on with a timeout
+    struct Flag {
+        std::mutex mutex;
+        std::condition_variable cv;
+        bool set = false;
+
+        void raise() {
+            std::lock_guard<std::mutex> lock(mutex);
+            set = true;
+            cv.notify_all();
+        }
+
+        bool wait() {
+            std::unique_lock<std::mutex> lock(mutex);
+            return cv.wait_for(lock, kTimeout, [this] { return set; });
+        }
+    };
+
+    bool check(bool condition, const char* what) {
+        std::printf("%s: %s\n", condition ? "ok  " : "FAIL", what);
+        return condition;
+    }
+
+    PeerConnectionConfig loopbackConfig() {
+        auto config = host_only_config(JUICE_CONCURRENCY_MODE_POLL);
+        config.bind_address = "127.0.0.1";
+        return config;
+    }
+
+    struct InlineResult {
+        bool gathered = false;
+        bool same_thread = false;
+        bool finished = false;
+    };
+
+    Task awaitGathered(PeerConnection& pc, InlineResult& result) {
+        const auto& before = std::this_thread::get_id();
+        result.gathered = co_await pc.gather();
+        result.same_thread = std::this_thread::get_id() == before;
+        result.finished = true;
+    }
+
+    bool testKnownOutcome() {
+        PeerConnection pc(true, "PC", loopbackConfig());
+        auto gathered = pc.gatherAsync();
+        if (!check(gathered.wait_for(kTimeout) == std::future_status::ready && gathered.get(), "gathered")) {
+            return false;
+        }
+
+        InlineResult result;
+        awaitGathered(pc, result);
+        bool ok = check(result.finished, "known outcome continues without suspending");
+        ok &= check(result.gathered && result.same_thread, "known outcome returned on the awaiting thread");
+        return ok;
+    }
+
+    struct ConnectResult {
+        bool gathered = false;
+        bool described = false;
+        juice_state state = JUICE_STATE_DISCONNECTED;
+        bool resumed_on_executor = false;
+        juice_state again = JUICE_STATE_DISCONNECTED;
+        bool again_inline = false;
+    };
+
+    Task connectPair(PeerConnection& a, PeerConnection& b, ConnectResult& result, Flag& done) {
+        result.gathered = co_await a.gather() && co_await b.gather();
+        if (result.gathered) {
+            result.described = b.setRemoteDescription(a.createOffer()) && a.setRemoteDescription(b.createAnswer());
+        }
+        if (result.described) {
+            a.setRemoteGatheringDone();
+            b.setRemoteGatheringDone();
+            result.state = co_await a.connect();
+            result.resumed_on_executor = in_executor_task;
+
+            const auto& before = std::this_thread::get_id();
+            result.again = co_await a.connect();
+            result.again_inline = std::this_thread::get_id() == before;
+        }
+        done.raise();
+    }
+
+    bool testResumeOnExecutor() {
+        auto executor = std::make_shared<MarkingExecutor>();
+        PeerConnection a(true, "A", loopbackConfig());
+        PeerConnection b(false, "B", loopbackConfig());
+        a.setExecutor(executor);
+
+        ConnectResult result;
+        Flag done;
+        connectPair(a, b, result, done);
+        if (!check(done.wait(), "coroutine finished")) {
+            return false;
+        }
+
+        bool ok = check(result.gathered && result.described, "both sides gathered and described");
+        ok &= check(result.state == JUICE_STATE_CONNECTED || result.state == JUICE_STATE_COMPLETED, "connected");
+        ok &= check(result.resumed_on_executor, "resumed through the connection's executor");
+        ok &= check(result.again == result.state || result.again == JUICE_STATE_COMPLETED, "known state returned again");
+        ok &= check(result.again_inline, "known state continues on the same thread");
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = testKnownOutcome();
+    ok &= testResumeOnExecutor();
+    std::printf("%s\n", ok ? "Success" : "Failure");
+    return ok ? 0 : 1;
+}
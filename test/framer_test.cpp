@@ -0,0 +1,153 @@
+#include "MessageFramer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Fragmentation and reassembly without a network: fragments go straight from one framer into the
+// other, and hand-made headers check that anything contradicting its message size is dropped
+// before it allocates or delivers. Exits non-zero on failure.
+namespace {
+    constexpr size_t kFragmentSize = 100;
+    constexpr size_t kPayload = kFragmentSize - MessageFramer::kHeaderSize;
+
+    bool check(bool condition, const char* what) {
+        std::printf("%s: %s\n", condition ? "ok  " : "FAIL", what);
+        return condition;
+    }
+
+    FramerOptions testOptions() {
+        FramerOptions options;
+        options.fragment_size = kFragmentSize;
+        return options;
+    }
+
+    std::string fragment(uint32_t id, uint32_t index, uint32_t count, uint32_t size, const std::string& payload) {
+        std::string datagram(MessageFramer::kHeaderSize, '\0');
+        datagram[0] = static_cast<char>(0xF7);
+        const uint32_t fields[] = {id, index, count, size};
+        for (size_t i = 0; i < 4; ++i) {
+            for (size_t b = 0; b < 4; ++b) {
+                datagram[2 + 4 * i + b] = static_cast<char>(fields[i] >> (24 - 8 * b));
+            }
+        }
+        return datagram + payload;
+    }
+
+    // Feeds datagrams to a fresh receiver and reports what came out
+    struct Receiver {
+        MessageFramer framer{[](std::string_view) { return SendResult::Ok; }, testOptions()};
+        std::vector<std::string> messages;
+
+        Receiver() {
+            framer.onMessage([this](std::string_view msg) { messages.emplace_back(msg); });
+        }
+    };
+
+    bool testRoundTrip() {
+        Receiver rx;
+        std::vector<std::string> datagrams;
+        MessageFramer tx([&datagrams](std::string_view datagram) {
+            datagrams.emplace_back(datagram);
+            return SendResult::Ok;
+        }, testOptions());
+
+        std::vector<std::string> sent;
+        for (const auto& size : {size_t(0), size_t(1), kPayload, kPayload + 1, 10 * kPayload, 10 * kPayload + 7}) {
+            std::string msg(size, '\0');
+            for (size_t i = 0; i < size; ++i) {
+                msg[i] = static_cast<char>('a' + (i + size) % 26);
+            }
+            sent.push_back(msg);
+            tx.send(msg);
+        }
+        // Backwards, so every message completes with its first fragment, and with duplicates before that
+        for (auto it = datagrams.rbegin(); it != datagrams.rend(); ++it) {
+            rx.framer.input(*it);
+            if ((*it)[9] != 0) {
+                rx.framer.input(*it);
+            }
+        }
+
+        bool ok = check(rx.messages.size() == sent.size(), "every message delivered once");
+        bool intact = rx.messages.size() == sent.size();
+        for (const auto& msg : sent) {
+            intact &= std::find(rx.messages.begin(), rx.messages.end(), msg) != rx.messages.end();
+        }
+        ok &= check(intact, "messages reassembled intact");
+        ok &= check(rx.framer.stats().invalid == 0, "no fragment counted invalid");
+        ok &= check(rx.framer.pendingMessages() == 0, "nothing left pending");
+        return ok;
+    }
+
+    bool testHugeCount() {
+        Receiver rx;
+        // The last fragment of a one-byte message claiming 2^32 - 1 fragments
+        for (uint32_t id = 1; id <= 4; ++id) {
+            rx.framer.input(fragment(id, 0xFFFFFFFE, 0xFFFFFFFF, 1, "x"));
+        }
+        bool ok = check(rx.framer.pendingMessages() == 0, "huge fragment count allocates nothing");
+        ok &= check(rx.framer.stats().invalid == 4, "huge fragment count counted invalid");
+        return ok;
+    }
+
+    bool testCountMismatch() {
+        Receiver rx;
+        const std::string payload(kPayload, 'p');
+        rx.framer.input(fragment(1, 0, 3, 2 * kPayload, payload)); // two fragments' worth
+        rx.framer.input(fragment(2, 0, 1, 2 * kPayload, payload)); // too few
+        bool ok = check(rx.framer.pendingMessages() == 0, "count that does not match the size dropped");
+        ok &= check(rx.framer.stats().invalid == 2, "count mismatches counted invalid");
+        return ok;
+    }
+
+    bool testPayloadSizes() {
+        Receiver rx;
+        const uint32_t size = 2 * kPayload + 10;
+        rx.framer.input(fragment(1, 0, 3, size, ""));                            // empty non-last
+        rx.framer.input(fragment(1, 1, 3, size, std::string(kPayload - 1, 'a'))); // short non-last
+        rx.framer.input(fragment(1, 0, 3, size, std::string(kPayload + 1, 'a'))); // long non-last
+        rx.framer.input(fragment(1, 2, 3, size, std::string(11, 'a')));           // long last
+        rx.framer.input(fragment(1, 0, 1, 5, "abc"));                            // short single
+        bool ok = check(rx.framer.stats().invalid == 5, "fragments of the wrong payload size dropped");
+        ok &= check(rx.framer.pendingMessages() == 0, "wrong payload sizes start no reassembly");
+
+        // A mix of valid and resized fragments of one message never completes it
+        rx.framer.input(fragment(2, 0, 3, size, std::string(kPayload, 'a')));
+        rx.framer.input(fragment(2, 1, 3, size, std::string(kPayload / 2, 'b')));
+        rx.framer.input(fragment(2, 2, 3, size, std::string(10, 'c')));
+        ok &= check(rx.messages.empty(), "mixed fragment sizes deliver nothing");
+
+        rx.framer.input(fragment(2, 1, 3, size, std::string(kPayload, 'b')));
+        const auto& expected = std::string(kPayload, 'a') + std::string(kPayload, 'b') + std::string(10, 'c');
+        ok &= check(rx.messages.size() == 1 && rx.messages[0] == expected, "message completes once the fragment is right");
+        return ok;
+    }
+
+    bool testBadHeaders() {
+        Receiver rx;
+        rx.framer.input("short");
+        auto bad_magic = fragment(1, 0, 1, 1, "x");
+        bad_magic[0] = 0;
+        rx.framer.input(bad_magic);
+        rx.framer.input(fragment(1, 3, 3, 2 * kPayload + 1, "x")); // index past count
+        rx.framer.input(fragment(1, 0, 0, 0, ""));                 // no fragment at all
+        FramerOptions options = testOptions();
+        rx.framer.input(fragment(1, 0, 1, static_cast<uint32_t>(options.max_message_size + 1), "x"));
+        bool ok = check(rx.framer.stats().invalid == 5, "malformed headers counted invalid");
+        ok &= check(rx.messages.empty() && rx.framer.pendingMessages() == 0, "malformed headers deliver nothing");
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = testRoundTrip();
+    ok &= testHugeCount();
+    ok &= testCountMismatch();
+    ok &= testPayloadSizes();
+    ok &= testBadHeaders();
+    std::printf("%s\n", ok ? "Success" : "Failure");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+#include "ReliableChannel.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Window, ACK and retransmission logic of ReliableChannel over an in-process link that can drop
+// datagrams or refuse them with Again: the window caps what is in flight, losses are repaired in
+// order, and refused datagrams are sent again without counting as lost. Exits non-zero on failure.
+namespace {
+    constexpr auto kTimeout = std::chrono::seconds(10);
+    constexpr size_t kMessages = 300;
+
+    bool check(bool condition, const char* what) {
+        std::printf("%s: %s\n", condition ? "ok  " : "FAIL", what);
+        return condition;
+    }
+
+    bool isData(std::string_view datagram) {
+        return datagram.size() >= ReliableChannel::kDataHeaderSize && static_cast<uint8_t>(datagram[0]) == 0xD1;
+    }
+
+    uint32_t dataSeq(std::string_view datagram) {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(datagram.data());
+        return (uint32_t(bytes[2]) << 24) | (uint32_t(bytes[3]) << 16) | (uint32_t(bytes[4]) << 8) | bytes[5];
+    }
+
+    // One direction of the link, handing datagrams straight to the channel on the other end
+    class Link {
+    public:
+        enum class Fate { Deliver, Drop, Refuse };
+        using Filter = std::function<Fate(std::string_view)>;
+
+        explicit Link(Filter filter = {}) : _filter(std::move(filter)) {
+        }
+
+        DatagramSender sender() {
+            return [this](std::string_view datagram) { return deliver(datagram); };
+        }
+
+        void connect(ReliableChannel* to) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _to = to;
+        }
+
+    private:
+        SendResult deliver(std::string_view datagram) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto& fate = _filter ? _filter(datagram) : Fate::Deliver;
+            if (fate == Fate::Refuse) {
+                return SendResult::Again;
+            }
+            if (fate == Fate::Deliver && _to) {
+                _to->input(datagram);
+            }
+            return SendResult::Ok;
+        }
+
+        std::mutex _mutex;
+        Filter _filter;
+        ReliableChannel* _to = nullptr;
+    };
+
+    // A sending and a receiving channel; the receiver only sends ACKs back
+    struct Pair {
+        Link forward;
+        Link backward;
+        std::mutex mutex;
+        std::vector<std::string> received;
+        ReliableChannel sender;
+        ReliableChannel receiver;
+
+        Pair(ReliableOptions options, Link::Filter filter = {})
+            : forward(std::move(filter)),
+            sender(forward.sender(), options),
+            receiver(backward.sender(), options) {
+
+            receiver.onMessage([this](std::string_view msg) {
+                std::lock_guard<std::mutex> lock(mutex);
+                received.emplace_back(msg);
+            });
+            forward.connect(&receiver);
+            backward.connect(&sender);
+        }
+
+        ~Pair() {
+            forward.connect(nullptr);
+            backward.connect(nullptr);
+        }
+
+        bool sendAll(size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                if (sender.send("message " + std::to_string(i)) != SendResult::Ok) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // Waits for count messages and checks they arrived once each and in order
+        bool receivedInOrder(size_t count) {
+            const auto& deadline = std::chrono::steady_clock::now() + kTimeout;
+            while (std::chrono::steady_clock::now() < deadline) {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (received.size() >= count) {
+                        break;
+                    }
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            bool ok = received.size() == count;
+            for (size_t i = 0; ok && i < count; ++i) {
+                ok = received[i] == "message " + std::to_string(i);
+            }
+            return ok;
+        }
+    };
+
+    // ACKs leave at once and neither a probe nor an RTO fires within a test
+    ReliableOptions quietOptions() {
+        ReliableOptions options;
+        options.ack_every = 1;
+        options.ack_delay = std::chrono::milliseconds(1000);
+        options.min_rto = std::chrono::milliseconds(1000);
+        return options;
+    }
+
+    bool testDelivery() {
+        Pair pair(quietOptions());
+        bool ok = check(pair.sendAll(kMessages), "messages queued");
+        ok &= check(pair.receivedInOrder(kMessages), "lossless link delivers every message in order");
+        ok &= check(pair.sender.flush(kTimeout), "everything acknowledged");
+
+        const auto& stats = pair.sender.stats();
+        ok &= check(stats.packets_sent == kMessages, "each packet sent once");
+        ok &= check(stats.retransmits == 0 && stats.timeouts == 0, "nothing retransmitted");
+        ok &= check(stats.in_flight_bytes == 0, "nothing left in flight");
+        ok &= check(stats.acks_received > 0, "ACKs received");
+        return ok;
+    }
+
+    bool testWindow() {
+        ReliableOptions options = quietOptions();
+        Pair pair(options, [](std::string_view) { return Link::Fate::Drop; });
+        const std::string msg(pair.sender.maxPayload(), 'w');
+        for (size_t i = 0; i < 5 * options.initial_cwnd_packets; ++i) {
+            pair.sender.send(msg);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        const auto& stats = pair.sender.stats();
+        const auto& window = options.initial_cwnd_packets * options.mss;
+        bool ok = check(stats.packets_sent == options.initial_cwnd_packets, "only the initial window sent without ACKs");
+        ok &= check(stats.in_flight_bytes == window, "in flight bytes fill the window");
+        ok &= check(stats.cwnd_bytes == window, "window unchanged without ACKs");
+        ok &= check(pair.sender.bufferedPackets() == 5 * options.initial_cwnd_packets, "unacknowledged packets kept");
+        return ok;
+    }
+
+    bool testLoss() {
+        // The first transmissions of two packets are lost
+        std::set<uint32_t> dropped;
+        Pair pair(quietOptions(), [&dropped](std::string_view datagram) {
+            if (isData(datagram)) {
+                const auto& seq = dataSeq(datagram);
+                if ((seq == 5 || seq == 40) && dropped.insert(seq).second) {
+                    return Link::Fate::Drop;
+                }
+            }
+            return Link::Fate::Deliver;
+        });
+        bool ok = check(pair.sendAll(kMessages), "messages queued");
+        ok &= check(pair.receivedInOrder(kMessages), "lost packets repaired in order");
+        ok &= check(pair.sender.flush(kTimeout), "everything acknowledged after losses");
+
+        const auto& stats = pair.sender.stats();
+        ok &= check(stats.retransmits >= 2, "lost packets retransmitted");
+        ok &= check(stats.timeouts == 0, "SACKs recover the losses before the RTO");
+        return ok;
+    }
+
+    bool testRefused() {
+        // Every third datagram is refused by the transport, as by a full socket buffer
+        size_t attempts = 0;
+        size_t refused = 0;
+        Pair pair(quietOptions(), [&attempts, &refused](std::string_view) {
+            if (++attempts % 3 == 0) {
+                ++refused;
+                return Link::Fate::Refuse;
+            }
+            return Link::Fate::Deliver;
+        });
+        bool ok = check(pair.sendAll(kMessages), "messages queued");
+        ok &= check(pair.receivedInOrder(kMessages), "refused datagrams sent again in order");
+        ok &= check(pair.sender.flush(kTimeout), "everything acknowledged after refusals");
+
+        const auto& stats = pair.sender.stats();
+        ok &= check(refused > 0, "transport refused datagrams");
+        ok &= check(stats.packets_sent == kMessages, "refused datagrams not counted as sent");
+        ok &= check(stats.retransmits == 0 && stats.timeouts == 0, "refused datagrams not counted as lost");
+        return ok;
+    }
+}
+
+int main() {
+    bool ok = testDelivery();
+    ok &= testWindow();
+    ok &= testLoss();
+    ok &= testRefused();
+    std::printf("%s\n", ok ? "Success" : "Failure");
+    return ok ? 0 : 1;
+}